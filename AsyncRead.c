@@ -0,0 +1,378 @@
+/***********************************************
+*
+* @Purpose: Batches of reads of a file kept in flight at the same time. io_uring is used through its system
+*           calls, so no library is needed, and a pool of threads doing pread() takes its place when the kernel
+*           does not have it or does not allow it
+* @Author: Óscar Cubeles Ollé
+* @Creation Date: October 2026
+*
+************************************************/
+#define _GNU_SOURCE
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#include "AsyncRead.h"
+
+typedef struct AsyncReadTask{
+  AsyncReadRequest *request;              // Read done by the task
+  AsyncReadCallback callback;             // Function called when the read completes
+  void *context;                          // Data passed to the callback
+  int fd;                                 // File read
+} AsyncReadTask;
+
+const char *ASYNC_READ_MODE_NAMES[] = {ASYNC_READ_MODES};
+
+
+/***********************************************
+*
+* @Purpose: Unmaps the rings of an io_uring instance and closes it
+* @Parameters: AsyncReadRing *ring, instance to be closed
+* @Return: -
+*
+************************************************/
+static void AsyncRead_closeRing(AsyncReadRing *ring){
+	if (ring->sqes != NULL) munmap(ring->sqes, ring->sqes_size);
+	if (ring->cq_map != NULL && ring->cq_map != ring->sq_map) munmap(ring->cq_map, ring->cq_map_size);
+	if (ring->sq_map != NULL) munmap(ring->sq_map, ring->sq_map_size);
+	if (ring->fd >= 0) close(ring->fd);
+	memset(ring, 0, sizeof(AsyncReadRing));
+	ring->fd = -1;
+}
+
+
+/***********************************************
+*
+* @Purpose: Creates an io_uring instance and maps its submission and completion rings
+* @Parameters: AsyncReadRing *ring, filled with the instance
+*              int depth, number of entries of the submission ring
+* @Return: 0 on success, -1 if io_uring is not available
+*
+************************************************/
+static int AsyncRead_openRing(AsyncReadRing *ring, int depth){
+	struct io_uring_params params;
+	char *sq, *cq;
+
+	memset(ring, 0, sizeof(AsyncReadRing));
+	memset(&params, 0, sizeof(params));
+	ring->fd = (int) syscall(__NR_io_uring_setup, depth, &params);
+	if (ring->fd < 0) return -1;
+
+	ring->sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+	ring->cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	// Since Linux 5.4 both rings are in the same mapping
+	if (params.features & IORING_FEAT_SINGLE_MMAP){
+		if (ring->cq_map_size > ring->sq_map_size) ring->sq_map_size = ring->cq_map_size;
+		ring->cq_map_size = ring->sq_map_size;
+	}
+	ring->sq_map = mmap(NULL, ring->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+	if (ring->sq_map == MAP_FAILED){
+		ring->sq_map = NULL;
+		AsyncRead_closeRing(ring);
+		return -1;
+	}
+	if (params.features & IORING_FEAT_SINGLE_MMAP){
+		ring->cq_map = ring->sq_map;
+	}else{
+		ring->cq_map = mmap(NULL, ring->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+		if (ring->cq_map == MAP_FAILED){
+			ring->cq_map = NULL;
+			AsyncRead_closeRing(ring);
+			return -1;
+		}
+	}
+	ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+	if (ring->sqes == MAP_FAILED){
+		ring->sqes = NULL;
+		AsyncRead_closeRing(ring);
+		return -1;
+	}
+
+	sq = (char *) ring->sq_map;
+	cq = (char *) ring->cq_map;
+	ring->sq_tail = (unsigned int *) (sq + params.sq_off.tail);
+	ring->sq_mask = (unsigned int *) (sq + params.sq_off.ring_mask);
+	ring->sq_array = (unsigned int *) (sq + params.sq_off.array);
+	ring->cq_head = (unsigned int *) (cq + params.cq_off.head);
+	ring->cq_tail = (unsigned int *) (cq + params.cq_off.tail);
+	ring->cq_mask = (unsigned int *) (cq + params.cq_off.ring_mask);
+	ring->cqes = cq + params.cq_off.cqes;
+	return 0;
+}
+
+
+/***********************************************
+*
+* @Purpose: Creates the reader of a file. io_uring is tried first when it is wanted, and the pool of threads
+*           is started if it cannot be used
+* @Parameters: int fd, file read
+*              int depth, maximum number of reads in flight, up to ASYNC_READ_MAX_DEPTH
+*              int use_uring, 1 to use io_uring when it is available, 0 to always use the threads
+* @Return: the reader, NULL if neither io_uring nor the threads can be used
+*
+************************************************/
+AsyncRead *AsyncRead_create(int fd, int depth, int use_uring){
+	AsyncRead *reader = (AsyncRead *) calloc(1, sizeof(AsyncRead));
+
+	if (reader == NULL) return NULL;
+	if (depth < 1) depth = 1;
+	if (depth > ASYNC_READ_MAX_DEPTH) depth = ASYNC_READ_MAX_DEPTH;
+	reader->fd = fd;
+	reader->depth = depth;
+	reader->ring.fd = -1;
+	if (use_uring && AsyncRead_openRing(&reader->ring, depth) == 0){
+		reader->mode = ASYNC_READ_URING;
+	}else{
+		reader->mode = ASYNC_READ_THREADS;
+		reader->pool = WorkPool_create(depth);
+		if (reader->pool == NULL){
+			free(reader);
+			return NULL;
+		}
+	}
+	pthread_mutex_init(&reader->lock, NULL);
+	return reader;
+}
+
+
+/***********************************************
+*
+* @Purpose: Frees a reader, closing its io_uring instance or stopping its threads
+* @Parameters: AsyncRead *reader, reader to be freed
+* @Return: -
+*
+************************************************/
+void AsyncRead_destroy(AsyncRead *reader){
+	if (reader == NULL) return;
+	if (reader->mode == ASYNC_READ_URING){
+		AsyncRead_closeRing(&reader->ring);
+	}else{
+		WorkPool_destroy(reader->pool);
+	}
+	pthread_mutex_destroy(&reader->lock);
+	free(reader);
+}
+
+
+/***********************************************
+*
+* @Purpose: Hands every read in the completion ring to the callback and frees its entries
+* @Parameters: AsyncReadRing *ring, io_uring instance
+*              AsyncReadRequest *requests, reads of the batch
+*              AsyncReadCallback callback, function called for every read completed
+*              void *context, data passed to the callback
+* @Return: number of reads completed
+*
+************************************************/
+static int AsyncRead_reapRing(AsyncReadRing *ring, AsyncReadRequest *requests, AsyncReadCallback callback, void *context){
+	struct io_uring_cqe *cqe;
+	unsigned int head = *ring->cq_head;
+	int completed = 0;
+
+	while (head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)){
+		cqe = (struct io_uring_cqe *) ring->cqes + (head & *ring->cq_mask);
+		requests[cqe->user_data].result = cqe->res;
+		callback(&requests[cqe->user_data], context);
+		head++;
+		completed++;
+	}
+	__atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+	return completed;
+}
+
+
+/***********************************************
+*
+* @Purpose: Runs a batch of reads with io_uring. The submission ring is refilled every time completions are
+*           collected, so that up to depth reads are in flight until the last ones are submitted
+* @Parameters: AsyncRead *reader, reader
+*              AsyncReadRequest *requests, reads of the batch
+*              int count, number of reads
+*              AsyncReadCallback callback, function called for every read completed
+*              void *context, data passed to the callback
+* @Return: 0 on success, -1 if the ring fails. It is closed then, and the reads not completed are left pending
+*
+************************************************/
+static int AsyncRead_runRing(AsyncRead *reader, AsyncReadRequest *requests, int count, AsyncReadCallback callback, void *context){
+	AsyncReadRing *ring = &reader->ring;
+	struct io_uring_sqe *sqe;
+	unsigned int tail, index;
+	int submitted = 0, completed = 0, in_flight = 0, to_submit = 0, reaped, error;
+	long result;
+
+	while (completed < count){
+		// Queuing the reads that fit, the program is the only producer of the submission ring. The entries the
+		// kernel did not take in the last call are still in the ring and are submitted again
+		tail = *ring->sq_tail;
+		while (submitted < count && in_flight < reader->depth){
+			index = tail & *ring->sq_mask;
+			sqe = (struct io_uring_sqe *) ring->sqes + index;
+			memset(sqe, 0, sizeof(struct io_uring_sqe));
+			requests[submitted].iov.iov_base = requests[submitted].buffer;
+			requests[submitted].iov.iov_len = requests[submitted].size;
+			sqe->opcode = IORING_OP_READV;
+			sqe->fd = reader->fd;
+			sqe->addr = (unsigned long) &requests[submitted].iov;
+			sqe->len = 1;
+			sqe->off = requests[submitted].offset;
+			sqe->user_data = submitted;
+			ring->sq_array[index] = index;
+			tail++;
+			submitted++;
+			in_flight++;
+			to_submit++;
+		}
+		__atomic_store_n(ring->sq_tail, tail, __ATOMIC_RELEASE);
+
+		// Submitting them and waiting for at least one completion. EAGAIN and EBUSY only mean that the kernel
+		// is short of resources or that the completion ring is full, so the completions are collected and the
+		// call is done again
+		result = syscall(__NR_io_uring_enter, ring->fd, to_submit, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+		if (result < 0){
+			error = errno;
+			if (error == EINTR) continue;
+			if (error != EAGAIN && error != EBUSY) break;
+		}else{
+			to_submit -= result;
+		}
+
+		// Handing every read completed to the callback
+		reaped = AsyncRead_reapRing(ring, requests, callback, context);
+		completed += reaped;
+		in_flight -= reaped;
+	}
+	if (completed == count) return 0;
+
+	// The ring cannot be used anymore. The reads it has completed keep their result, and the ones taken by the
+	// kernel point to the buffers, so they are waited for before closing it. The rest are left pending
+	in_flight -= AsyncRead_reapRing(ring, requests, callback, context);
+	while (in_flight > to_submit){
+		result = syscall(__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+		if (result < 0 && errno != EINTR) break;
+		in_flight -= AsyncRead_reapRing(ring, requests, callback, context);
+	}
+	AsyncRead_closeRing(ring);
+	return -1;
+}
+
+
+/***********************************************
+*
+* @Purpose: Task of the pool of threads, reads a request and hands it to the callback
+* @Parameters: void *argument, AsyncReadTask of the read
+*              int worker, number of the worker running the task
+* @Return: -
+*
+************************************************/
+static void AsyncRead_readTask(void *argument, int worker){
+	AsyncReadTask *task = (AsyncReadTask *) argument;
+	AsyncReadRequest *request = task->request;
+	ssize_t bytes;
+
+	(void) worker;
+	do{
+		bytes = pread(task->fd, request->buffer, request->size, request->offset);
+	}while (bytes < 0 && errno == EINTR);
+	request->result = bytes < 0 ? -errno : bytes;
+	task->callback(request, task->context);
+}
+
+
+/***********************************************
+*
+* @Purpose: Runs the reads of a batch that are still pending with the pool of threads, every thread doing a
+*           pread() at a time
+* @Parameters: AsyncRead *reader, reader
+*              AsyncReadRequest *requests, reads of the batch
+*              int count, number of reads
+*              AsyncReadCallback callback, function called for every read completed
+*              void *context, data passed to the callback
+* @Return: 0 on success, -1 if there is not enough memory (the reads are done one at a time)
+*
+************************************************/
+static int AsyncRead_runThreads(AsyncRead *reader, AsyncReadRequest *requests, int count, AsyncReadCallback callback, void *context){
+	AsyncReadTask *tasks = (AsyncReadTask *) malloc(sizeof(AsyncReadTask) * count);
+	int error = tasks == NULL ? -1 : 0;
+	AsyncReadTask task;
+
+	for (int i = 0; i < count; i++){
+		if (requests[i].result != ASYNC_READ_PENDING) continue;
+		if (tasks != NULL){
+			tasks[i].request = &requests[i];
+			tasks[i].callback = callback;
+			tasks[i].context = context;
+			tasks[i].fd = reader->fd;
+			if (WorkPool_submit(reader->pool, WORK_POOL_NO_WORKER, AsyncRead_readTask, &tasks[i]) == 0) continue;
+		}
+		// The read is done here when it cannot be given to the pool
+		task.request = &requests[i];
+		task.callback = callback;
+		task.context = context;
+		task.fd = reader->fd;
+		AsyncRead_readTask(&task, WORK_POOL_NO_WORKER);
+	}
+	WorkPool_wait(reader->pool);
+	free(tasks);
+	return error;
+}
+
+
+/***********************************************
+*
+* @Purpose: Reads a batch of requests keeping up to depth of them in flight. The callback is called for every
+*           one of them as it completes, and the function returns once all of them have completed
+* @Parameters: AsyncRead *reader, reader
+*              AsyncReadRequest *requests, reads of the batch, their result is filled
+*              int count, number of reads
+*              AsyncReadCallback callback, function called for every read completed
+*              void *context, data passed to the callback
+* @Return: 0 on success, -1 if some reads could not be done
+*
+************************************************/
+int AsyncRead_run(AsyncRead *reader, AsyncReadRequest *requests, int count, AsyncReadCallback callback, void *context){
+	int result = 0;
+
+	if (count <= 0) return 0;
+	for (int i = 0; i < count; i++){
+		requests[i].result = ASYNC_READ_PENDING;
+	}
+	pthread_mutex_lock(&reader->lock);
+	if (reader->mode == ASYNC_READ_URING && reader->ring.fd >= 0){
+		result = AsyncRead_runRing(reader, requests, count, callback, context);
+	}
+	// A ring that has failed is replaced by the threads, which also do the reads it did not complete
+	if (reader->mode == ASYNC_READ_URING && reader->ring.fd < 0){
+		reader->pool = WorkPool_create(reader->depth);
+		if (reader->pool != NULL) reader->mode = ASYNC_READ_THREADS;
+	}
+	if (reader->mode == ASYNC_READ_THREADS){
+		result = AsyncRead_runThreads(reader, requests, count, callback, context);
+	}else if (reader->ring.fd < 0){
+		result = -1;
+		for (int i = 0; i < count; i++){
+			if (requests[i].result == ASYNC_READ_PENDING){
+				requests[i].result = -EIO;
+				callback(&requests[i], context);
+			}
+		}
+	}
+	pthread_mutex_unlock(&reader->lock);
+	return result;
+}
+
+
+/***********************************************
+*
+* @Purpose: Gives the name of the way the reads are done
+* @Parameters: AsyncRead *reader, reader
+* @Return: "io_uring" or "threads"
+*
+************************************************/
+const char *AsyncRead_getModeName(AsyncRead *reader){
+	return ASYNC_READ_MODE_NAMES[reader->mode];
+}
@@ -0,0 +1,71 @@
+/***********************************************
+*
+* @Purpose: Batches of reads of a file kept in flight at the same time, with io_uring when the kernel allows it
+*           and with a pool of threads doing pread() otherwise. Every read is handed to a callback as soon as it
+*           completes, so the caller does not wait for the slowest one to use the rest
+* @Author: Óscar Cubeles Ollé
+* @Creation Date: October 2026
+*
+************************************************/
+#ifndef ASYNCREAD_H
+    #define ASYNCREAD_H
+
+    #include <errno.h>
+    #include <sys/types.h>
+    #include <sys/uio.h>
+    #include <pthread.h>
+
+    #include "WorkPool.h"
+
+    // Ways the reads are done
+    #define ASYNC_READ_URING 0
+    #define ASYNC_READ_THREADS 1
+    #define ASYNC_READ_MODES "io_uring", "threads"
+    // Maximum number of reads in flight
+    #define ASYNC_READ_MAX_DEPTH 256
+    // Result of a read that has not completed yet
+    #define ASYNC_READ_PENDING (-EINPROGRESS)
+
+    typedef struct AsyncReadRequest{
+      off_t offset;                           // Position of the file read
+      size_t size;                            // Number of bytes read
+      void *buffer;                           // Destination of the bytes
+      ssize_t result;                         // Bytes read, or a negative errno value, once the read has completed
+      struct iovec iov;                       // Buffer given to the kernel
+    } AsyncReadRequest;
+
+    // Function called for every read completed. With the threads it can be called from several threads at once
+    typedef void (*AsyncReadCallback)(AsyncReadRequest *request, void *context);
+
+    typedef struct AsyncReadRing{
+      int fd;                                 // Descriptor of the ring returned by io_uring_setup()
+      void *sq_map;                           // Mapping of the submission ring
+      size_t sq_map_size;                     // Size of the mapping of the submission ring
+      void *cq_map;                           // Mapping of the completion ring, the same as sq_map with IORING_FEAT_SINGLE_MMAP
+      size_t cq_map_size;                     // Size of the mapping of the completion ring
+      void *sqes;                             // Mapping of the submission queue entries
+      size_t sqes_size;                       // Size of the mapping of the entries
+      unsigned int *sq_tail;                  // Tail of the submission ring, written by the program
+      unsigned int *sq_mask;                  // Mask of the positions of the submission ring
+      unsigned int *sq_array;                 // Indexes of the entries submitted
+      unsigned int *cq_head;                  // Head of the completion ring, written by the program
+      unsigned int *cq_tail;                  // Tail of the completion ring, written by the kernel
+      unsigned int *cq_mask;                  // Mask of the positions of the completion ring
+      void *cqes;                             // Completion queue entries
+    } AsyncReadRing;
+
+    typedef struct AsyncRead{
+      int fd;                                 // File read
+      int depth;                              // Maximum number of reads in flight
+      int mode;                               // ASYNC_READ_URING or ASYNC_READ_THREADS
+      AsyncReadRing ring;                     // io_uring instance, when mode is ASYNC_READ_URING
+      WorkPool *pool;                         // Threads doing the reads, when mode is ASYNC_READ_THREADS
+      pthread_mutex_t lock;                   // A batch runs at a time, the ring and the pool are not shared
+    } AsyncRead;
+
+
+    AsyncRead *AsyncRead_create(int fd, int depth, int use_uring);
+    void AsyncRead_destroy(AsyncRead *reader);
+    int AsyncRead_run(AsyncRead *reader, AsyncReadRequest *requests, int count, AsyncReadCallback callback, void *context);
+    const char *AsyncRead_getModeName(AsyncRead *reader);
+#endif
@@ -0,0 +1,546 @@
+/***********************************************
+*
+* @Purpose: Benchmark of Shooter. Generates FAT16 and Ext2 volumes of several sizes with VolumeGen and times
+*           /info, /find of an existing file, of a missing one and of an absolute path, and /delete on them,
+*           reporting the throughput, the p50 and p99 latencies and the system calls of every operation
+* @Author: Óscar Cubeles Ollé
+* @Creation Date: October 2026
+*
+************************************************/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ptrace.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+#include "../NameIndex.h"
+
+#define BENCH_USAGE "Usage: Bench [--shooter=<path>] [--generator=<path>] [--dir=<folder>] [--runs=<n>] [--files=<n>[,<n>...]]\n" \
+		"             [--depth=<n>] [--fanout=<n>] [--name-length=<n>] [--file-size=<bytes>] [--fragment=<percent>]\n" \
+		"             [--block-size=<bytes>] [--seed=<n>] [--option=<Shooter option>]...\n"
+#define BENCH_OPTION_SHOOTER "--shooter="
+#define BENCH_OPTION_GENERATOR "--generator="
+#define BENCH_OPTION_DIR "--dir="
+#define BENCH_OPTION_RUNS "--runs="
+#define BENCH_OPTION_FILES "--files="
+#define BENCH_OPTION_SHOOTER_OPTION "--option="
+// Options given as they are to VolumeGen
+#define BENCH_GENERATOR_OPTIONS "--depth=", "--fanout=", "--name-length=", "--file-size=", "--fragment=", "--block-size=", "--seed="
+#define BENCH_NUM_GENERATOR_OPTIONS 7
+
+#define BENCH_DEFAULT_SHOOTER "./Shooter"
+#define BENCH_DEFAULT_GENERATOR "./Bench/VolumeGen"
+#define BENCH_DEFAULT_DIR "/tmp"
+#define BENCH_DEFAULT_RUNS 10
+#define BENCH_DEFAULT_FILES 1000, 10000, 50000
+#define BENCH_NUM_DEFAULT_FILES 3
+#define BENCH_MAX_SIZES 16
+#define BENCH_MAX_ARGS 64
+#define BENCH_PATH_SIZE 512
+#define BENCH_MISSING_NAME "missing_file.txt"
+#define BENCH_NUM_TYPES 2
+#define BENCH_TYPES "fat16", "ext2"
+#define BENCH_NUM_CASES 5
+#define BENCH_CASE_INFO 0
+#define BENCH_CASE_FIND_HIT 1
+#define BENCH_CASE_FIND_MISS 2
+#define BENCH_CASE_FIND_PATH 3
+#define BENCH_CASE_DELETE 4
+#define BENCH_CASES "/info", "/find hit", "/find miss", "/find path", "/delete"
+#define BENCH_NO_COUNT -1LL
+
+typedef struct BenchOptions{
+  const char *shooter;                    // Shooter binary
+  const char *generator;                  // VolumeGen binary
+  const char *dir;                        // Folder of the generated volumes
+  int runs;                               // Timed runs of every operation
+  int sizes[BENCH_MAX_SIZES];             // Number of files of every volume size
+  int size_count;                         // Number of volume sizes
+  char *generator_args[BENCH_MAX_ARGS];   // Options given to VolumeGen
+  int generator_arg_count;                // Number of options given to VolumeGen
+  char *shooter_args[BENCH_MAX_ARGS];     // Options given to Shooter
+  int shooter_arg_count;                  // Number of options given to Shooter
+} BenchOptions;
+
+typedef struct BenchList{
+  char **paths;                           // Path of every file of the volume
+  int count;                              // Number of files
+} BenchList;
+
+typedef struct BenchResult{
+  double *latencies;                      // Time of every run, in seconds
+  int runs;                               // Number of runs
+  long long syscalls;                     // System calls of the traced run, BENCH_NO_COUNT if it could not be traced
+  long long reads;                        // Read system calls of the traced run
+  int failed;                             // 1 if a run did not finish successfully
+} BenchResult;
+
+const char *BENCH_GENERATOR_OPTION_NAMES[] = {BENCH_GENERATOR_OPTIONS};
+const char *BENCH_TYPE_NAMES[] = {BENCH_TYPES};
+const char *BENCH_CASE_NAMES[] = {BENCH_CASES};
+
+
+/***********************************************
+*
+* @Purpose: Reads the options of the command line
+* @Parameters: int argc, number of arguments
+*              char *argv[], arguments
+*              BenchOptions *options, filled with the options
+* @Return: 0 on success, -1 if an option is not valid
+*
+************************************************/
+static int Bench_parseOptions(int argc, char *argv[], BenchOptions *options){
+	const int default_sizes[] = {BENCH_DEFAULT_FILES};
+	char *sizes = NULL, *size, *end;
+	int known;
+
+	memset(options, 0, sizeof(BenchOptions));
+	options->shooter = BENCH_DEFAULT_SHOOTER;
+	options->generator = BENCH_DEFAULT_GENERATOR;
+	options->dir = BENCH_DEFAULT_DIR;
+	options->runs = BENCH_DEFAULT_RUNS;
+	for (int i = 1; i < argc; i++){
+		known = 1;
+		if (strncmp(argv[i], BENCH_OPTION_SHOOTER, strlen(BENCH_OPTION_SHOOTER)) == 0){
+			options->shooter = argv[i] + strlen(BENCH_OPTION_SHOOTER);
+		}else if (strncmp(argv[i], BENCH_OPTION_GENERATOR, strlen(BENCH_OPTION_GENERATOR)) == 0){
+			options->generator = argv[i] + strlen(BENCH_OPTION_GENERATOR);
+		}else if (strncmp(argv[i], BENCH_OPTION_DIR, strlen(BENCH_OPTION_DIR)) == 0){
+			options->dir = argv[i] + strlen(BENCH_OPTION_DIR);
+		}else if (strncmp(argv[i], BENCH_OPTION_RUNS, strlen(BENCH_OPTION_RUNS)) == 0){
+			options->runs = atoi(argv[i] + strlen(BENCH_OPTION_RUNS));
+			if (options->runs <= 0) return -1;
+		}else if (strncmp(argv[i], BENCH_OPTION_FILES, strlen(BENCH_OPTION_FILES)) == 0){
+			sizes = argv[i] + strlen(BENCH_OPTION_FILES);
+		}else if (strncmp(argv[i], BENCH_OPTION_SHOOTER_OPTION, strlen(BENCH_OPTION_SHOOTER_OPTION)) == 0){
+			if (options->shooter_arg_count == BENCH_MAX_ARGS) return -1;
+			options->shooter_args[options->shooter_arg_count++] = argv[i] + strlen(BENCH_OPTION_SHOOTER_OPTION);
+		}else{
+			known = 0;
+			for (int j = 0; j < BENCH_NUM_GENERATOR_OPTIONS && known == 0; j++){
+				known = strncmp(argv[i], BENCH_GENERATOR_OPTION_NAMES[j], strlen(BENCH_GENERATOR_OPTION_NAMES[j])) == 0;
+			}
+			if (known == 0 || options->generator_arg_count == BENCH_MAX_ARGS) return -1;
+			options->generator_args[options->generator_arg_count++] = argv[i];
+		}
+	}
+
+	if (sizes == NULL){
+		for (int i = 0; i < BENCH_NUM_DEFAULT_FILES; i++){
+			options->sizes[options->size_count++] = default_sizes[i];
+		}
+		return 0;
+	}
+	for (size = sizes; *size != '\0'; size = *end == ',' ? end + 1 : end){
+		if (options->size_count == BENCH_MAX_SIZES) return -1;
+		options->sizes[options->size_count] = (int) strtol(size, &end, 10);
+		if (end == size || options->sizes[options->size_count] <= 0 || (*end != ',' && *end != '\0')) return -1;
+		options->size_count++;
+	}
+	return options->size_count > 0 ? 0 : -1;
+}
+
+
+/***********************************************
+*
+* @Purpose: Gives the time of the monotonic clock
+* @Parameters: -
+* @Return: the time in seconds
+*
+************************************************/
+static double Bench_now(void){
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double) now.tv_sec + (double) now.tv_nsec / 1e9;
+}
+
+
+/***********************************************
+*
+* @Purpose: Starts a program with its output sent to /dev/null
+* @Parameters: char *const args[], program and its arguments, ending with NULL
+*              int traced, 1 to stop the program right after the fork so that it can be traced
+* @Return: the process id, -1 on error
+*
+************************************************/
+static pid_t Bench_spawn(char *const args[], int traced){
+	pid_t pid = fork();
+	int null_fd;
+
+	if (pid != 0) return pid;
+	null_fd = open("/dev/null", O_WRONLY);
+	if (null_fd >= 0){
+		dup2(null_fd, STDOUT_FILENO);
+		close(null_fd);
+	}
+	if (traced){
+		ptrace(PTRACE_TRACEME, 0, NULL, NULL);
+		raise(SIGSTOP);
+	}
+	execv(args[0], args);
+	_exit(127);
+}
+
+
+/***********************************************
+*
+* @Purpose: Runs a program and waits for it
+* @Parameters: char *const args[], program and its arguments, ending with NULL
+*              double *elapsed, filled with the time from the fork to the end of the program, in seconds
+* @Return: 0 if the program exits with 0, -1 otherwise
+*
+************************************************/
+static int Bench_run(char *const args[], double *elapsed){
+	double start = Bench_now();
+	pid_t pid = Bench_spawn(args, 0);
+	int status;
+
+	if (pid < 0 || waitpid(pid, &status, 0) < 0) return -1;
+	*elapsed = Bench_now() - start;
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+
+/***********************************************
+*
+* @Purpose: Runs a program under ptrace, counting the system calls of all its threads
+* @Parameters: char *const args[], program and its arguments, ending with NULL
+*              long long *syscalls, filled with the number of system calls
+*              long long *reads, filled with the number of read, pread and preadv calls
+* @Return: 0 if the program exits with 0, -1 if it fails, -2 if it cannot be traced
+*
+************************************************/
+static int Bench_trace(char *const args[], long long *syscalls, long long *reads){
+	struct __ptrace_syscall_info info;
+	pid_t pid = Bench_spawn(args, 1), stopped;
+	int status, signal_number, result = -1, event;
+
+	*syscalls = 0;
+	*reads = 0;
+	if (pid < 0) return -1;
+	if (waitpid(pid, &status, 0) < 0 || !WIFSTOPPED(status)){
+		// The program could not stop itself to be traced, it has already run
+		return -2;
+	}
+	if (ptrace(PTRACE_SETOPTIONS, pid, NULL, (void *) (long) (PTRACE_O_TRACESYSGOOD | PTRACE_O_TRACECLONE | PTRACE_O_TRACEEXEC | PTRACE_O_EXITKILL)) < 0){
+		kill(pid, SIGKILL);
+		waitpid(pid, &status, 0);
+		return -2;
+	}
+	ptrace(PTRACE_SYSCALL, pid, NULL, NULL);
+	while ((stopped = waitpid(-1, &status, __WALL)) > 0){
+		if (WIFEXITED(status) || WIFSIGNALED(status)){
+			if (stopped == pid){
+				result = WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+			}
+			continue;
+		}
+		signal_number = 0;
+		event = status >> 16;
+		if (WSTOPSIG(status) == (SIGTRAP | 0x80)){
+			if (ptrace(PTRACE_GET_SYSCALL_INFO, stopped, (void *) sizeof(info), &info) > 0 && info.op == PTRACE_SYSCALL_INFO_ENTRY){
+				(*syscalls)++;
+				if (info.entry.nr == SYS_read || info.entry.nr == SYS_pread64 || info.entry.nr == SYS_preadv || info.entry.nr == SYS_readv){
+					(*reads)++;
+				}
+			}
+		}else if (WSTOPSIG(status) != SIGSTOP && !(WSTOPSIG(status) == SIGTRAP && event != 0)){
+			// Signals sent to the program are delivered, the stops of the new threads and events are not
+			signal_number = WSTOPSIG(status);
+		}
+		ptrace(PTRACE_SYSCALL, stopped, NULL, (void *) (long) signal_number);
+	}
+	return result;
+}
+
+
+/***********************************************
+*
+* @Purpose: Reads the list of files written by VolumeGen
+* @Parameters: const char *path, list file
+*              BenchList *list, filled with the paths
+* @Return: 0 on success, -1 on error
+*
+************************************************/
+static int Bench_readList(const char *path, BenchList *list){
+	char line[BENCH_PATH_SIZE];
+	FILE *file = fopen(path, "r");
+	int capacity = 0;
+	char **paths;
+
+	list->paths = NULL;
+	list->count = 0;
+	if (file == NULL) return -1;
+	while (fgets(line, sizeof(line), file) != NULL){
+		line[strcspn(line, "\n")] = '\0';
+		if (list->count == capacity){
+			capacity = capacity == 0 ? 1024 : capacity * 2;
+			paths = (char **) realloc(list->paths, capacity * sizeof(char *));
+			if (paths == NULL) break;
+			list->paths = paths;
+		}
+		list->paths[list->count] = strdup(line);
+		if (list->paths[list->count] == NULL) break;
+		list->count++;
+	}
+	fclose(file);
+	return list->count > 0 ? 0 : -1;
+}
+
+
+/***********************************************
+*
+* @Purpose: Frees the list of files
+* @Parameters: BenchList *list, list to be freed
+* @Return: -
+*
+************************************************/
+static void Bench_freeList(BenchList *list){
+	for (int i = 0; i < list->count; i++){
+		free(list->paths[i]);
+	}
+	free(list->paths);
+	list->paths = NULL;
+	list->count = 0;
+}
+
+
+/***********************************************
+*
+* @Purpose: Gives the name of a file without its folders
+* @Parameters: char *path, path of the file
+* @Return: the name, inside the path
+*
+************************************************/
+static char *Bench_baseName(char *path){
+	char *slash = strrchr(path, '/');
+
+	return slash == NULL ? path : slash + 1;
+}
+
+
+/***********************************************
+*
+* @Purpose: Builds the command line of Shooter for a run of an operation. /delete removes a different file in
+*           every run, the warm-up run being run 0
+* @Parameters: const BenchOptions *options, options of the benchmark
+*              int operation, BENCH_CASE_* operation
+*              char *image, volume
+*              BenchList *list, files of the volume
+*              int run, number of the run
+*              char *args[BENCH_MAX_ARGS * 2], filled with the command line
+* @Return: -
+*
+************************************************/
+static void Bench_shooterArgs(const BenchOptions *options, int operation, char *image, BenchList *list, int run, char *args[BENCH_MAX_ARGS * 2]){
+	char *last = list->paths[list->count - 1];
+	int count = 0;
+
+	args[count++] = (char *) options->shooter;
+	for (int i = 0; i < options->shooter_arg_count; i++){
+		args[count++] = options->shooter_args[i];
+	}
+	args[count++] = operation == BENCH_CASE_INFO ? "/info" : operation == BENCH_CASE_DELETE ? "/delete" : "/find";
+	args[count++] = image;
+	switch (operation){
+		case BENCH_CASE_FIND_HIT:
+			args[count++] = Bench_baseName(last);
+			break;
+		case BENCH_CASE_FIND_MISS:
+			args[count++] = BENCH_MISSING_NAME;
+			break;
+		case BENCH_CASE_FIND_PATH:
+			args[count++] = last;
+			break;
+		case BENCH_CASE_DELETE:
+			// Files spread over the volume, none of them the one searched before
+			args[count++] = Bench_baseName(list->paths[(long long) run * (list->count - 1) / (options->runs + 1)]);
+			break;
+	}
+	args[count] = NULL;
+}
+
+
+/***********************************************
+*
+* @Purpose: Sorts the latencies in increasing order
+* @Parameters: const void *a, first latency
+*              const void *b, second latency
+* @Return: negative, zero or positive as in strcmp
+*
+************************************************/
+static int Bench_compareLatencies(const void *a, const void *b){
+	double first = *(const double *) a, second = *(const double *) b;
+
+	return (first > second) - (first < second);
+}
+
+
+/***********************************************
+*
+* @Purpose: Gives a percentile of the sorted latencies, by the nearest rank method
+* @Parameters: const BenchResult *result, result with its latencies sorted
+*              int percentile, percentile between 1 and 100
+* @Return: the latency in seconds
+*
+************************************************/
+static double Bench_percentile(const BenchResult *result, int percentile){
+	int rank = (percentile * result->runs + 99) / 100;
+
+	return result->latencies[rank > 0 ? rank - 1 : 0];
+}
+
+
+/***********************************************
+*
+* @Purpose: Runs an operation once traced, to count its system calls and warm the page cache, and then the timed runs
+* @Parameters: const BenchOptions *options, options of the benchmark
+*              int operation, BENCH_CASE_* operation
+*              char *image, volume
+*              BenchList *list, files of the volume
+*              BenchResult *result, filled with the latencies and the system calls
+* @Return: 0 on success, -1 if there is not enough memory
+*
+************************************************/
+static int Bench_measure(const BenchOptions *options, int operation, char *image, BenchList *list, BenchResult *result){
+	char *args[BENCH_MAX_ARGS * 2];
+	int traced;
+
+	result->latencies = (double *) malloc(options->runs * sizeof(double));
+	result->runs = 0;
+	result->failed = 0;
+	if (result->latencies == NULL) return -1;
+
+	Bench_shooterArgs(options, operation, image, list, 0, args);
+	traced = Bench_trace(args, &result->syscalls, &result->reads);
+	if (traced == -2){
+		result->syscalls = BENCH_NO_COUNT;
+		result->reads = BENCH_NO_COUNT;
+	}
+	result->failed = traced == -1;
+	for (int run = 1; run <= options->runs; run++){
+		Bench_shooterArgs(options, operation, image, list, run, args);
+		if (Bench_run(args, &result->latencies[result->runs]) < 0){
+			result->failed = 1;
+			continue;
+		}
+		result->runs++;
+	}
+	qsort(result->latencies, result->runs, sizeof(double), Bench_compareLatencies);
+	return 0;
+}
+
+
+/***********************************************
+*
+* @Purpose: Prints the results of an operation
+* @Parameters: const char *type, file system of the volume
+*              int files, files of the volume
+*              int operation, BENCH_CASE_* operation
+*              const BenchResult *result, results of the operation
+* @Return: -
+*
+************************************************/
+static void Bench_printResult(const char *type, int files, int operation, const BenchResult *result){
+	char syscalls[32] = "-", reads[32] = "-";
+	double total = 0;
+
+	if (result->syscalls != BENCH_NO_COUNT){
+		snprintf(syscalls, sizeof(syscalls), "%lld", result->syscalls);
+		snprintf(reads, sizeof(reads), "%lld", result->reads);
+	}
+	if (result->runs == 0){
+		printf("%-6s %8d  %-11s %10s %14s %10s %10s %9s %8s  failed\n", type, files, BENCH_CASE_NAMES[operation], "-", "-", "-", "-", syscalls, reads);
+		return;
+	}
+	for (int i = 0; i < result->runs; i++){
+		total += result->latencies[i];
+	}
+	printf("%-6s %8d  %-11s %10.1f %14.0f %10.3f %10.3f %9s %8s%s\n", type, files, BENCH_CASE_NAMES[operation],
+			result->runs / total, files * result->runs / total, Bench_percentile(result, 50) * 1e3, Bench_percentile(result, 99) * 1e3,
+			syscalls, reads, result->failed ? "  some runs failed" : "");
+}
+
+
+/***********************************************
+*
+* @Purpose: Generates a volume and measures all the operations on it
+* @Parameters: const BenchOptions *options, options of the benchmark
+*              int type, index of the file system in BENCH_TYPE_NAMES
+*              int files, number of files of the volume
+* @Return: 0 on success, -1 if the volume could not be generated
+*
+************************************************/
+static int Bench_volume(const BenchOptions *options, int type, int files){
+	char image[BENCH_PATH_SIZE], list_path[BENCH_PATH_SIZE], index_path[BENCH_PATH_SIZE + 8], files_option[32], list_option[BENCH_PATH_SIZE + 8];
+	char *args[BENCH_MAX_ARGS + 8];
+	int count = 0, error = 0;
+	double elapsed;
+	BenchResult result;
+	BenchList list;
+
+	snprintf(image, sizeof(image), "%s/bench_%s_%d.img", options->dir, BENCH_TYPE_NAMES[type], files);
+	snprintf(list_path, sizeof(list_path), "%s/bench_%s_%d.txt", options->dir, BENCH_TYPE_NAMES[type], files);
+	snprintf(index_path, sizeof(index_path), "%s%s", image, NAME_INDEX_EXTENSION);
+	snprintf(files_option, sizeof(files_option), "--files=%d", files);
+	snprintf(list_option, sizeof(list_option), "--list=%s", list_path);
+	args[count++] = (char *) options->generator;
+	args[count++] = (char *) BENCH_TYPE_NAMES[type];
+	args[count++] = image;
+	args[count++] = files_option;
+	args[count++] = list_option;
+	for (int i = 0; i < options->generator_arg_count; i++){
+		args[count++] = options->generator_args[i];
+	}
+	args[count] = NULL;
+
+	unlink(index_path);
+	if (Bench_run(args, &elapsed) < 0 || Bench_readList(list_path, &list) < 0){
+		fprintf(stderr, "Unable to generate the %s volume with %d files\n", BENCH_TYPE_NAMES[type], files);
+		unlink(image);
+		unlink(list_path);
+		return -1;
+	}
+	for (int operation = 0; operation < BENCH_NUM_CASES && error == 0; operation++){
+		error = Bench_measure(options, operation, image, &list, &result);
+		if (error == 0){
+			Bench_printResult(BENCH_TYPE_NAMES[type], files, operation, &result);
+		}
+		free(result.latencies);
+	}
+	fflush(stdout);
+	Bench_freeList(&list);
+	unlink(image);
+	unlink(list_path);
+	unlink(index_path);
+	return error;
+}
+
+
+int main(int argc, char *argv[]){
+	BenchOptions options;
+
+	if (Bench_parseOptions(argc, argv, &options) < 0){
+		fprintf(stderr, BENCH_USAGE);
+		return 1;
+	}
+	if (access(options.shooter, X_OK) < 0 || access(options.generator, X_OK) < 0){
+		fprintf(stderr, "Unable to run %s or %s, build them with make bench\n", options.shooter, options.generator);
+		return 1;
+	}
+	printf("%d runs per operation, latencies in ms, system calls of a single run\n\n", options.runs);
+	printf("%-6s %8s  %-11s %10s %14s %10s %10s %9s %8s\n", "type", "files", "operation", "ops/s", "files/s", "p50", "p99", "syscalls", "reads");
+	for (int type = 0; type < BENCH_NUM_TYPES; type++){
+		for (int i = 0; i < options.size_count; i++){
+			Bench_volume(&options, type, options.sizes[i]);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,1374 @@
+/***********************************************
+*
+* @Purpose: Generator of synthetic FAT16 and Ext2 volumes for the benchmarks. The files are spread among a tree
+*           of folders with a given depth and fan-out, with names of a given length, and part of the files and
+*           folders can be fragmented. The content of the files is not written, so the images are sparse
+* @Author: Óscar Cubeles Ollé
+* @Creation Date: October 2026
+*
+************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../FatSystem.h"
+#include "../Ex2System.h"
+
+#define GEN_USAGE "Usage: VolumeGen <fat16|ext2> <image> [--files=<n>] [--depth=<n>] [--fanout=<n>] [--name-length=<n>]\n" \
+		"                 [--file-size=<bytes>] [--fragment=<percent>] [--block-size=<bytes>] [--seed=<n>] [--list=<file>]\n"
+#define GEN_TYPE_FAT16 "fat16"
+#define GEN_TYPE_EXT2 "ext2"
+#define GEN_OPTION_FILES "--files="
+#define GEN_OPTION_DEPTH "--depth="
+#define GEN_OPTION_FANOUT "--fanout="
+#define GEN_OPTION_NAME_LENGTH "--name-length="
+#define GEN_OPTION_FILE_SIZE "--file-size="
+#define GEN_OPTION_FRAGMENT "--fragment="
+#define GEN_OPTION_BLOCK_SIZE "--block-size="
+#define GEN_OPTION_SEED "--seed="
+#define GEN_OPTION_LIST "--list="
+
+#define GEN_DEFAULT_FILES 1000
+#define GEN_DEFAULT_DEPTH 3
+#define GEN_DEFAULT_FANOUT 4
+#define GEN_DEFAULT_NAME_LENGTH 16
+#define GEN_DEFAULT_FILE_SIZE 1024
+#define GEN_DEFAULT_BLOCK_SIZE 1024
+// Size of the name buffers, the longest name is 255 characters
+#define GEN_NAME_SIZE 256
+// The folders are named DIR<n>, that has to fit in an 8.3 name
+#define GEN_MAX_FOLDERS 99999
+// Time stamp of all the files, so that the same options always give the same image
+#define GEN_TIMESTAMP 1790000000U
+// Free units left after the files, besides the ones needed
+#define GEN_SLACK_UNITS 64
+
+// FAT16 layout
+#define GEN_FAT_SECTOR_SIZE 512
+#define GEN_FAT_MAX_SECTORS_PER_CLUSTER 64
+#define GEN_FAT_MIN_CLUSTERS 4085
+#define GEN_FAT_MAX_CLUSTERS 65524
+#define GEN_FAT_MIN_ROOT_ENTRIES 512
+#define GEN_FAT_NUM_FATS 2
+#define GEN_FAT_END_OF_CHAIN 0xFFFF
+#define GEN_FAT_MEDIA 0xF8
+#define GEN_FAT_MEDIA_OFFSET 21
+#define GEN_FAT_BOOT_SIGNATURE_OFFSET 38
+#define GEN_FAT_BOOT_SIGNATURE 0x29
+#define GEN_FAT_VOLUME_ID_OFFSET 39
+#define GEN_FAT_SIGNATURE_OFFSET 510
+// 12:00:00 of the 1st of January of 2026, in the FAT16 format
+#define GEN_FAT_TIME 0x6000
+#define GEN_FAT_DATE 0x5C21
+
+// Ext2 layout
+#define GEN_EXT_INODE_SIZE 128
+#define GEN_EXT_LOST_FOUND_INODE 11
+#define GEN_EXT_FIRST_INODE 11
+#define GEN_EXT_STATE_CLEAN 1
+#define GEN_EXT_ERRORS_CONTINUE 1
+#define GEN_EXT_DYNAMIC_REV 1
+#define GEN_EXT_FEATURE_FILETYPE 0x0002
+#define GEN_EXT_MODE_FOLDER 040755
+#define GEN_EXT_MODE_LOST_FOUND 040700
+#define GEN_EXT_MODE_FILE 0100644
+#define GEN_EXT_SECTOR_SIZE 512
+// Superblock fields without a constant in Ex2System.h
+#define GEN_EXT_LOG_FRAG_SIZE_OFFSET 28
+#define GEN_EXT_MAX_MOUNT_OFFSET 54
+#define GEN_EXT_STATE_OFFSET 58
+#define GEN_EXT_ERRORS_OFFSET 60
+#define GEN_EXT_REV_LEVEL_OFFSET 76
+#define GEN_EXT_GROUP_NUMBER_OFFSET 90
+#define GEN_EXT_FEATURE_INCOMPAT_OFFSET 96
+#define GEN_EXT_UUID_OFFSET 104
+#define GEN_EXT_UUID_SIZE 16
+#define GEN_EXT_SUPERBLOCK_SIZE 1024
+
+typedef struct GenOptions{
+  int is_fat;                             // 1 for a FAT16 volume, 0 for an Ext2 one
+  const char *image;                      // Path of the image generated
+  const char *list;                       // File where the path of every file is written, NULL if none
+  int files;                              // Number of files
+  int depth;                              // Levels of folders under the root
+  int fanout;                             // Subfolders of every folder above the last level
+  int name_length;                        // Length of the file names
+  unsigned int file_size;                 // Size of every file in bytes
+  int fragment;                           // Percentage of files and folders whose blocks are not contiguous
+  unsigned int block_size;                // Ext2 block size
+  unsigned long long seed;                // Seed of the choice of the fragmented files
+} GenOptions;
+
+typedef struct GenTree{
+  int folder_count;                       // Number of folders, including the root
+  int *parent;                            // Parent of every folder, -1 for the root
+  int *first_child;                       // First subfolder of every folder, the subfolders are consecutive
+  int *child_count;                       // Number of subfolders of every folder
+  char **path;                            // Path of every folder, "" for the root
+  int first_file_folder;                  // First folder with files, the root only has files when there are no folders
+  int file_folders;                       // Number of folders with files, the files are dealt among them in turns
+} GenTree;
+
+typedef struct GenAllocator{
+  unsigned char *used;                    // Bitmap of the allocation units in use
+  unsigned long long count;               // Number of allocation units
+  unsigned long long cursor;              // Next unit looked at, the units are allocated in increasing order
+  int full;                               // 1 if some allocation failed
+} GenAllocator;
+
+typedef struct GenFat{
+  unsigned int sectors_per_cluster;       // Sectors of a cluster
+  unsigned int cluster_size;              // Bytes of a cluster
+  unsigned int cluster_count;             // Clusters of the data region
+  unsigned int fat_sectors;               // Sectors of a FAT
+  unsigned int root_entries;              // Entries of the root directory region
+  unsigned int total_sectors;             // Sectors of the volume
+  unsigned long long root_position;       // Address of the root directory region
+  unsigned long long data_position;       // Address of the cluster 2
+  unsigned short *fat;                    // FAT, one entry per cluster
+  unsigned int *folder_cluster;           // First cluster of every folder
+  unsigned int *file_cluster;             // First cluster of every file, 0 for the empty ones
+  GenAllocator clusters;                  // Clusters in use
+} GenFat;
+
+typedef struct GenExt{
+  unsigned int block_size;                // Bytes of a block
+  unsigned int first_data_block;          // Block of the superblock of the first group
+  unsigned int groups;                    // Number of block groups
+  unsigned int blocks_per_group;          // Blocks of every group but the last one
+  unsigned int blocks_count;              // Blocks of the volume
+  unsigned int inodes_per_group;          // Inodes of every group
+  unsigned int inodes_count;              // Inodes of the volume
+  unsigned int inode_table_blocks;        // Blocks of the inode table of a group
+  unsigned int gdt_blocks;                // Blocks of the group descriptor table
+  unsigned int per_block;                 // Block numbers of an indirect block
+  unsigned char *inodes;                  // Inode tables of all the groups
+  GenAllocator blocks;                    // Blocks in use
+} GenExt;
+
+typedef struct GenPack{
+  unsigned char *buffer;                  // Blocks of the folder, NULL to only count them
+  unsigned int block_size;                // Bytes of a block
+  unsigned int block;                     // Block being filled
+  unsigned int offset;                    // Next free byte of the block
+  unsigned int last;                      // Offset of the last entry of the block
+} GenPack;
+
+
+/***********************************************
+*
+* @Purpose: Reads a non negative number of an option
+* @Parameters: const char *value, text after the option name
+*              int *number, filled with the number
+* @Return: 0 on success, -1 if it is not a number
+*
+************************************************/
+static int VolumeGen_parseNumber(const char *value, int *number){
+	char *end;
+	long parsed = strtol(value, &end, 10);
+
+	if (*value == '\0' || *end != '\0' || parsed < 0 || parsed > 0x7FFFFFFF) return -1;
+	*number = (int) parsed;
+	return 0;
+}
+
+
+/***********************************************
+*
+* @Purpose: Reads the type, the image and the options of the command line
+* @Parameters: int argc, number of arguments
+*              char *argv[], arguments
+*              GenOptions *options, filled with the options
+* @Return: 0 on success, -1 if the arguments are not valid
+*
+************************************************/
+static int VolumeGen_parseOptions(int argc, char *argv[], GenOptions *options){
+	int value, error = 0;
+
+	memset(options, 0, sizeof(GenOptions));
+	options->files = GEN_DEFAULT_FILES;
+	options->depth = GEN_DEFAULT_DEPTH;
+	options->fanout = GEN_DEFAULT_FANOUT;
+	options->name_length = GEN_DEFAULT_NAME_LENGTH;
+	options->file_size = GEN_DEFAULT_FILE_SIZE;
+	options->block_size = GEN_DEFAULT_BLOCK_SIZE;
+	options->seed = 1;
+	if (argc < 3) return -1;
+	if (strcmp(argv[1], GEN_TYPE_FAT16) == 0){
+		options->is_fat = 1;
+	}else if (strcmp(argv[1], GEN_TYPE_EXT2) != 0){
+		return -1;
+	}
+	options->image = argv[2];
+
+	for (int i = 3; i < argc && error == 0; i++){
+		if (strncmp(argv[i], GEN_OPTION_FILES, strlen(GEN_OPTION_FILES)) == 0){
+			error = VolumeGen_parseNumber(argv[i] + strlen(GEN_OPTION_FILES), &options->files);
+		}else if (strncmp(argv[i], GEN_OPTION_DEPTH, strlen(GEN_OPTION_DEPTH)) == 0){
+			error = VolumeGen_parseNumber(argv[i] + strlen(GEN_OPTION_DEPTH), &options->depth);
+		}else if (strncmp(argv[i], GEN_OPTION_FANOUT, strlen(GEN_OPTION_FANOUT)) == 0){
+			error = VolumeGen_parseNumber(argv[i] + strlen(GEN_OPTION_FANOUT), &options->fanout);
+		}else if (strncmp(argv[i], GEN_OPTION_NAME_LENGTH, strlen(GEN_OPTION_NAME_LENGTH)) == 0){
+			error = VolumeGen_parseNumber(argv[i] + strlen(GEN_OPTION_NAME_LENGTH), &options->name_length);
+		}else if (strncmp(argv[i], GEN_OPTION_FILE_SIZE, strlen(GEN_OPTION_FILE_SIZE)) == 0){
+			error = VolumeGen_parseNumber(argv[i] + strlen(GEN_OPTION_FILE_SIZE), &value);
+			options->file_size = (unsigned int) value;
+		}else if (strncmp(argv[i], GEN_OPTION_FRAGMENT, strlen(GEN_OPTION_FRAGMENT)) == 0){
+			error = VolumeGen_parseNumber(argv[i] + strlen(GEN_OPTION_FRAGMENT), &options->fragment);
+		}else if (strncmp(argv[i], GEN_OPTION_BLOCK_SIZE, strlen(GEN_OPTION_BLOCK_SIZE)) == 0){
+			error = VolumeGen_parseNumber(argv[i] + strlen(GEN_OPTION_BLOCK_SIZE), &value);
+			options->block_size = (unsigned int) value;
+		}else if (strncmp(argv[i], GEN_OPTION_SEED, strlen(GEN_OPTION_SEED)) == 0){
+			error = VolumeGen_parseNumber(argv[i] + strlen(GEN_OPTION_SEED), &value);
+			options->seed = (unsigned long long) value;
+		}else if (strncmp(argv[i], GEN_OPTION_LIST, strlen(GEN_OPTION_LIST)) == 0){
+			options->list = argv[i] + strlen(GEN_OPTION_LIST);
+		}else{
+			error = -1;
+		}
+	}
+	if (error != 0 || options->fragment > 100 || options->name_length >= GEN_NAME_SIZE) return -1;
+	if (options->block_size != 1024 && options->block_size != 2048 && options->block_size != 4096) return -1;
+	return 0;
+}
+
+
+/***********************************************
+*
+* @Purpose: Builds the name of a file: "file<n>_" padded with 'x' up to the name length, and ".txt"
+* @Parameters: const GenOptions *options, options of the volume
+*              int file, number of the file
+*              char name[GEN_NAME_SIZE], filled with the name
+* @Return: length of the name
+*
+************************************************/
+static int VolumeGen_fileName(const GenOptions *options, int file, char name[GEN_NAME_SIZE]){
+	int length = snprintf(name, GEN_NAME_SIZE, "file%d_", file);
+
+	while (length + 4 < options->name_length){
+		name[length++] = 'x';
+	}
+	memcpy(name + length, ".txt", 5);
+	return length + 4;
+}
+
+
+/***********************************************
+*
+* @Purpose: Builds the name of a folder, "DIR<n>", that is also a valid 8.3 name
+* @Parameters: int folder, number of the folder
+*              char name[GEN_NAME_SIZE], filled with the name
+* @Return: length of the name
+*
+************************************************/
+static int VolumeGen_folderName(int folder, char name[GEN_NAME_SIZE]){
+	return snprintf(name, GEN_NAME_SIZE, "DIR%d", folder);
+}
+
+
+/***********************************************
+*
+* @Purpose: Gives the first file of a folder. The files are dealt among the folders in turns, so the next one
+*           of the folder is file + tree->file_folders
+* @Parameters: const GenTree *tree, folders of the volume
+*              int folder, folder
+*              int files, number of files of the volume
+* @Return: the first file of the folder, -1 if it has none
+*
+************************************************/
+static int VolumeGen_firstFile(const GenTree *tree, int folder, int files){
+	int file = folder - tree->first_file_folder;
+
+	return file >= 0 && file < files ? file : -1;
+}
+
+
+/***********************************************
+*
+* @Purpose: Decides whether the blocks of a file or folder are scattered, the same way for the same seed
+* @Parameters: const GenOptions *options, options of the volume
+*              unsigned long long object, number of the folder, or folder count plus number of the file
+* @Return: 1 if the object is fragmented, 0 otherwise
+*
+************************************************/
+static int VolumeGen_isFragmented(const GenOptions *options, unsigned long long object){
+	// splitmix64 of the seed and the object
+	unsigned long long value = options->seed * 0x9E3779B97F4A7C15ULL + object;
+
+	value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+	value ^= value >> 31;
+	return (int) (value % 100) < options->fragment;
+}
+
+
+/***********************************************
+*
+* @Purpose: Builds the tree of folders, level by level, so that the subfolders of a folder are consecutive
+* @Parameters: const GenOptions *options, options of the volume
+*              GenTree *tree, filled with the folders
+* @Return: 0 on success, -1 if there are too many folders or not enough memory
+*
+************************************************/
+static int VolumeGen_buildTree(const GenOptions *options, GenTree *tree){
+	long long level = 1, total = 1;
+	char name[GEN_NAME_SIZE];
+	int next = 1;
+
+	memset(tree, 0, sizeof(GenTree));
+	for (int i = 0; i < options->depth && options->fanout > 0; i++){
+		level *= options->fanout;
+		total += level;
+		if (total > GEN_MAX_FOLDERS) return -1;
+	}
+	tree->folder_count = (int) total;
+	tree->parent = (int *) malloc(total * sizeof(int));
+	tree->first_child = (int *) calloc(total, sizeof(int));
+	tree->child_count = (int *) calloc(total, sizeof(int));
+	tree->path = (char **) calloc(total, sizeof(char *));
+	if (tree->parent == NULL || tree->first_child == NULL || tree->child_count == NULL || tree->path == NULL) return -1;
+	tree->parent[0] = -1;
+	tree->path[0] = strdup("");
+	if (tree->path[0] == NULL) return -1;
+	for (int folder = 0; folder < tree->folder_count; folder++){
+		if (next + options->fanout > tree->folder_count) continue;
+		tree->first_child[folder] = next;
+		tree->child_count[folder] = options->fanout;
+		for (int i = 0; i < options->fanout; i++, next++){
+			VolumeGen_folderName(next, name);
+			tree->parent[next] = folder;
+			tree->path[next] = (char *) malloc(strlen(tree->path[folder]) + strlen(name) + 2);
+			if (tree->path[next] == NULL) return -1;
+			sprintf(tree->path[next], "%s/%s", tree->path[folder], name);
+		}
+	}
+	tree->first_file_folder = tree->folder_count > 1 ? 1 : 0;
+	tree->file_folders = tree->folder_count - tree->first_file_folder;
+	return 0;
+}
+
+
+/***********************************************
+*
+* @Purpose: Frees the tree of folders
+* @Parameters: GenTree *tree, tree to be freed
+* @Return: -
+*
+************************************************/
+static void VolumeGen_freeTree(GenTree *tree){
+	for (int i = 0; tree->path != NULL && i < tree->folder_count; i++){
+		free(tree->path[i]);
+	}
+	free(tree->path);
+	free(tree->parent);
+	free(tree->first_child);
+	free(tree->child_count);
+}
+
+
+/***********************************************
+*
+* @Purpose: Writes the path of every file, one per line, in the order the files are numbered
+* @Parameters: const GenOptions *options, options of the volume
+*              const GenTree *tree, folders of the volume
+* @Return: 0 on success, -1 if the list cannot be written
+*
+************************************************/
+static int VolumeGen_writeList(const GenOptions *options, const GenTree *tree){
+	char name[GEN_NAME_SIZE];
+	FILE *list = fopen(options->list, "w");
+
+	if (list == NULL) return -1;
+	for (int file = 0; file < options->files; file++){
+		VolumeGen_fileName(options, file, name);
+		fprintf(list, "%s/%s\n", tree->path[tree->first_file_folder + file % tree->file_folders], name);
+	}
+	return fclose(list) == 0 ? 0 : -1;
+}
+
+
+/***********************************************
+*
+* @Purpose: Prepares an allocator of units, all of them free
+* @Parameters: GenAllocator *allocator, allocator to be initialized
+*              unsigned long long count, number of units
+* @Return: 0 on success, -1 if there is not enough memory
+*
+************************************************/
+static int VolumeGen_initAllocator(GenAllocator *allocator, unsigned long long count){
+	allocator->used = (unsigned char *) calloc(count / 8 + 1, 1);
+	allocator->count = count;
+	allocator->cursor = 0;
+	allocator->full = 0;
+	return allocator->used == NULL ? -1 : 0;
+}
+
+
+/***********************************************
+*
+* @Purpose: Marks a unit as used
+* @Parameters: GenAllocator *allocator, allocator
+*              unsigned long long unit, unit in use
+* @Return: -
+*
+************************************************/
+static void VolumeGen_markUsed(GenAllocator *allocator, unsigned long long unit){
+	allocator->used[unit / 8] |= 1 << (unit % 8);
+}
+
+
+/***********************************************
+*
+* @Purpose: Checks whether a unit is used
+* @Parameters: const GenAllocator *allocator, allocator
+*              unsigned long long unit, unit
+* @Return: 1 if it is used, 0 otherwise
+*
+************************************************/
+static int VolumeGen_isUsed(const GenAllocator *allocator, unsigned long long unit){
+	return (allocator->used[unit / 8] >> (unit % 8)) & 1;
+}
+
+
+/***********************************************
+*
+* @Purpose: Allocates the next free unit. The units of a fragmented object leave a free unit after them, that
+*           is never used, so that none of them is contiguous to the previous one
+* @Parameters: GenAllocator *allocator, allocator
+*              int fragmented, 1 if the unit belongs to a fragmented object
+* @Return: the unit, 0 if there are no free units
+*
+************************************************/
+static unsigned long long VolumeGen_allocate(GenAllocator *allocator, int fragmented){
+	unsigned long long unit;
+
+	while (allocator->cursor < allocator->count && VolumeGen_isUsed(allocator, allocator->cursor)){
+		allocator->cursor++;
+	}
+	if (allocator->cursor >= allocator->count){
+		allocator->full = 1;
+		return 0;
+	}
+	unit = allocator->cursor;
+	VolumeGen_markUsed(allocator, unit);
+	allocator->cursor += 1 + fragmented;
+	return unit;
+}
+
+
+/***********************************************
+*
+* @Purpose: Writes data at a position of the image
+* @Parameters: int fd, file descriptor of the image
+*              unsigned long long position, position in the image
+*              const void *data, data to be written
+*              size_t size, number of bytes
+* @Return: 0 on success, -1 on error
+*
+************************************************/
+static int VolumeGen_write(int fd, unsigned long long position, const void *data, size_t size){
+	return pwrite(fd, data, size, (off_t) position) == (ssize_t) size ? 0 : -1;
+}
+
+
+/***********************************************
+*
+* @Purpose: Stores a little endian 16 bit value
+* @Parameters: unsigned char *buffer, buffer
+*              size_t offset, position of the value in the buffer
+*              unsigned int value, value
+* @Return: -
+*
+************************************************/
+static void VolumeGen_put16(unsigned char *buffer, size_t offset, unsigned int value){
+	buffer[offset] = value & 0xFF;
+	buffer[offset + 1] = (value >> 8) & 0xFF;
+}
+
+
+/***********************************************
+*
+* @Purpose: Stores a little endian 32 bit value
+* @Parameters: unsigned char *buffer, buffer
+*              size_t offset, position of the value in the buffer
+*              unsigned int value, value
+* @Return: -
+*
+************************************************/
+static void VolumeGen_put32(unsigned char *buffer, size_t offset, unsigned int value){
+	VolumeGen_put16(buffer, offset, value & 0xFFFF);
+	VolumeGen_put16(buffer, offset + 2, value >> 16);
+}
+
+
+/***********************************************
+*
+* @Purpose: Counts the FAT16 directory entries of a folder: "." and "..", its subfolders and its files with the
+*           slots of their long names
+* @Parameters: const GenOptions *options, options of the volume
+*              const GenTree *tree, folders of the volume
+*              int folder, folder
+* @Return: number of directory entries
+*
+************************************************/
+static unsigned int VolumeGen_fatFolderEntries(const GenOptions *options, const GenTree *tree, int folder){
+	char name[GEN_NAME_SIZE];
+	unsigned int entries = folder == 0 ? 0 : 2;
+	int length;
+
+	entries += tree->child_count[folder];
+	for (int file = VolumeGen_firstFile(tree, folder, options->files); file >= 0 && file < options->files; file += tree->file_folders){
+		length = VolumeGen_fileName(options, file, name);
+		entries += 1 + (length + FAT_SYSTEM_LFN_CHARS - 1) / FAT_SYSTEM_LFN_CHARS;
+	}
+	return entries;
+}
+
+
+/***********************************************
+*
+* @Purpose: Chooses the cluster size and the layout of a FAT16 volume able to hold the files and folders
+* @Parameters: const GenOptions *options, options of the volume
+*              const GenTree *tree, folders of the volume
+*              GenFat *fat, filled with the layout
+* @Return: 0 on success, -1 if the files do not fit in a FAT16 volume
+*
+************************************************/
+static int VolumeGen_fatLayout(const GenOptions *options, const GenTree *tree, GenFat *fat){
+	unsigned long long needed;
+	unsigned int clusters, root_sectors;
+
+	fat->root_entries = VolumeGen_fatFolderEntries(options, tree, 0);
+	if (fat->root_entries < GEN_FAT_MIN_ROOT_ENTRIES) fat->root_entries = GEN_FAT_MIN_ROOT_ENTRIES;
+	fat->root_entries = (fat->root_entries + 15) & ~15U;
+	if (fat->root_entries > 0xFFF0) return -1;
+
+	// The smallest clusters that keep the volume under the FAT16 limit
+	for (fat->sectors_per_cluster = 1; fat->sectors_per_cluster <= GEN_FAT_MAX_SECTORS_PER_CLUSTER; fat->sectors_per_cluster *= 2){
+		fat->cluster_size = fat->sectors_per_cluster * GEN_FAT_SECTOR_SIZE;
+		needed = 0;
+		for (int folder = 1; folder < tree->folder_count; folder++){
+			clusters = (VolumeGen_fatFolderEntries(options, tree, folder) * FAT_SYSTEM_DIR_ENTRY_SIZE + fat->cluster_size - 1) / fat->cluster_size;
+			needed += (unsigned long long) clusters * (1 + VolumeGen_isFragmented(options, folder));
+		}
+		clusters = (options->file_size + fat->cluster_size - 1) / fat->cluster_size;
+		for (int file = 0; file < options->files; file++){
+			needed += (unsigned long long) clusters * (1 + VolumeGen_isFragmented(options, tree->folder_count + file));
+		}
+		if (needed + GEN_SLACK_UNITS <= GEN_FAT_MAX_CLUSTERS) break;
+	}
+	if (fat->sectors_per_cluster > GEN_FAT_MAX_SECTORS_PER_CLUSTER) return -1;
+	fat->cluster_count = needed + GEN_SLACK_UNITS < GEN_FAT_MIN_CLUSTERS ? GEN_FAT_MIN_CLUSTERS : (unsigned int) needed + GEN_SLACK_UNITS;
+
+	fat->fat_sectors = ((fat->cluster_count + FAT_SYSTEM_FIRST_CLUSTER) * 2 + GEN_FAT_SECTOR_SIZE - 1) / GEN_FAT_SECTOR_SIZE;
+	root_sectors = fat->root_entries * FAT_SYSTEM_DIR_ENTRY_SIZE / GEN_FAT_SECTOR_SIZE;
+	fat->root_position = (unsigned long long) (1 + GEN_FAT_NUM_FATS * fat->fat_sectors) * GEN_FAT_SECTOR_SIZE;
+	fat->data_position = fat->root_position + (unsigned long long) root_sectors * GEN_FAT_SECTOR_SIZE;
+	fat->total_sectors = 1 + GEN_FAT_NUM_FATS * fat->fat_sectors + root_sectors + fat->cluster_count * fat->sectors_per_cluster;
+	return 0;
+}
+
+
+/***********************************************
+*
+* @Purpose: Allocates a chain of clusters and links it in the FAT
+* @Parameters: GenFat *fat, FAT16 volume
+*              unsigned int clusters, number of clusters
+*              int fragmented, 1 to leave a free cluster after every cluster of the chain
+* @Return: first cluster of the chain, 0 if it is empty
+*
+************************************************/
+static unsigned int VolumeGen_fatChain(GenFat *fat, unsigned int clusters, int fragmented){
+	unsigned int first = 0, previous = 0, cluster;
+
+	for (unsigned int i = 0; i < clusters; i++){
+		cluster = (unsigned int) VolumeGen_allocate(&fat->clusters, fragmented);
+		if (cluster == 0) return first;
+		if (previous == 0){
+			first = cluster;
+		}else{
+			fat->fat[previous] = cluster;
+		}
+		fat->fat[cluster] = GEN_FAT_END_OF_CHAIN;
+		previous = cluster;
+	}
+	return first;
+}
+
+
+/***********************************************
+*
+* @Purpose: Allocates the clusters of a folder, of its files and of its subfolders, in this order
+* @Parameters: const GenOptions *options, options of the volume
+*              const GenTree *tree, folders of the volume
+*              GenFat *fat, FAT16 volume
+*              int folder, folder
+* @Return: -
+*
+************************************************/
+static void VolumeGen_fatAllocateFolder(const GenOptions *options, const GenTree *tree, GenFat *fat, int folder){
+	unsigned int clusters;
+
+	if (folder != 0){
+		clusters = (VolumeGen_fatFolderEntries(options, tree, folder) * FAT_SYSTEM_DIR_ENTRY_SIZE + fat->cluster_size - 1) / fat->cluster_size;
+		fat->folder_cluster[folder] = VolumeGen_fatChain(fat, clusters, VolumeGen_isFragmented(options, folder));
+	}
+	clusters = (options->file_size + fat->cluster_size - 1) / fat->cluster_size;
+	for (int file = VolumeGen_firstFile(tree, folder, options->files); file >= 0 && file < options->files; file += tree->file_folders){
+		fat->file_cluster[file] = VolumeGen_fatChain(fat, clusters, VolumeGen_isFragmented(options, tree->folder_count + file));
+	}
+	for (int i = 0; i < tree->child_count[folder]; i++){
+		VolumeGen_fatAllocateFolder(options, tree, fat, tree->first_child[folder] + i);
+	}
+}
+
+
+/***********************************************
+*
+* @Purpose: Fills a FAT16 short directory entry
+* @Parameters: FatDirEntry *entry, entry to be filled
+*              const char name[FAT_SYSTEM_DIR_NAME_SIZE], 8.3 name, padded with spaces
+*              unsigned char attributes, attributes of the entry
+*              unsigned int cluster, first cluster
+*              unsigned int size, size of the file
+* @Return: -
+*
+************************************************/
+static void VolumeGen_fatEntry(FatDirEntry *entry, const char name[FAT_SYSTEM_DIR_NAME_SIZE], unsigned char attributes, unsigned int cluster, unsigned int size){
+	memset(entry, 0, sizeof(FatDirEntry));
+	memcpy(entry->DIR_Name, name, FAT_SYSTEM_DIR_NAME_SIZE);
+	entry->DIR_Attr = (char) attributes;
+	entry->DIR_CrtTime = GEN_FAT_TIME;
+	entry->DIR_CrtDate = GEN_FAT_DATE;
+	entry->DIR_LstAccDate = GEN_FAT_DATE;
+	entry->DIR_WrtTime = GEN_FAT_TIME;
+	entry->DIR_WrtDate = GEN_FAT_DATE;
+	entry->DIR_FstClusLO = (unsigned short) cluster;
+	entry->DIR_FileSize = size;
+}
+
+
+/***********************************************
+*
+* @Purpose: Writes the long name slots of an entry, from the last part of the name to the first one
+* @Parameters: unsigned char *slots, where the slots are written
+*              const char *name, long name
+*              int length, length of the name
+*              const char short_name[FAT_SYSTEM_DIR_NAME_SIZE], 8.3 name of the entry, for the checksum
+* @Return: number of slots written
+*
+************************************************/
+static int VolumeGen_fatLongName(unsigned char *slots, const char *name, int length, const char short_name[FAT_SYSTEM_DIR_NAME_SIZE]){
+	static const int char_offsets[FAT_SYSTEM_LFN_CHARS] = {1, 3, 5, 7, 9, 14, 16, 18, 20, 22, 24, 28, 30};
+	int count = (length + FAT_SYSTEM_LFN_CHARS - 1) / FAT_SYSTEM_LFN_CHARS;
+	unsigned char checksum = 0, *slot;
+	unsigned int character;
+	int position;
+
+	for (int i = 0; i < FAT_SYSTEM_DIR_NAME_SIZE; i++){
+		checksum = ((checksum & 1) << 7) + (checksum >> 1) + (unsigned char) short_name[i];
+	}
+	for (int order = count; order >= 1; order--){
+		slot = slots + (size_t) (count - order) * FAT_SYSTEM_DIR_ENTRY_SIZE;
+		memset(slot, 0, FAT_SYSTEM_DIR_ENTRY_SIZE);
+		slot[0] = (unsigned char) order | (order == count ? FAT_SYSTEM_LFN_LAST : 0);
+		slot[FAT_SYSTEM_DIR_NAME_SIZE] = FAT_SYSTEM_ATTR_LONG_NAME;
+		slot[FAT_SYSTEM_LFN_CHECKSUM_OFFSET] = checksum;
+		for (int i = 0; i < FAT_SYSTEM_LFN_CHARS; i++){
+			// The name ends with 0x0000 and the rest of the slot is padded with 0xFFFF
+			position = (order - 1) * FAT_SYSTEM_LFN_CHARS + i;
+			character = position < length ? (unsigned char) name[position] : position == length ? 0x0000 : 0xFFFF;
+			VolumeGen_put16(slot, char_offsets[i], character);
+		}
+	}
+	return count;
+}
+
+
+/***********************************************
+*
+* @Purpose: Writes the directory entries of a folder in its clusters, or in the root directory region
+* @Parameters: int fd, file descriptor of the image
+*              const GenOptions *options, options of the volume
+*              const GenTree *tree, folders of the volume
+*              const GenFat *fat, FAT16 volume with all the clusters allocated
+*              int folder, folder
+* @Return: 0 on success, -1 on error
+*
+************************************************/
+static int VolumeGen_fatWriteFolder(int fd, const GenOptions *options, const GenTree *tree, const GenFat *fat, int folder){
+	char name[GEN_NAME_SIZE], short_name[GEN_NAME_SIZE];
+	unsigned int entries = VolumeGen_fatFolderEntries(options, tree, folder);
+	unsigned int clusters = (entries * FAT_SYSTEM_DIR_ENTRY_SIZE + fat->cluster_size - 1) / fat->cluster_size;
+	size_t size = folder == 0 ? (size_t) fat->root_entries * FAT_SYSTEM_DIR_ENTRY_SIZE : (size_t) clusters * fat->cluster_size;
+	unsigned char *buffer = (unsigned char *) calloc(size, 1);
+	unsigned int entry = 0, cluster;
+	int length, child, error = 0;
+
+	if (buffer == NULL) return -1;
+	if (folder != 0){
+		VolumeGen_fatEntry((FatDirEntry *) buffer, ".          ", FAT_SYSTEM_DIR_ENTRY_FOLDER, fat->folder_cluster[folder], 0);
+		VolumeGen_fatEntry((FatDirEntry *) buffer + 1, "..         ", FAT_SYSTEM_DIR_ENTRY_FOLDER, fat->folder_cluster[tree->parent[folder]], 0);
+		entry = 2;
+	}
+	for (int i = 0; i < tree->child_count[folder]; i++){
+		child = tree->first_child[folder] + i;
+		length = VolumeGen_folderName(child, name);
+		snprintf(short_name, sizeof(short_name), "%-11s", name);
+		VolumeGen_fatEntry((FatDirEntry *) buffer + entry++, short_name, FAT_SYSTEM_DIR_ENTRY_FOLDER, fat->folder_cluster[child], 0);
+	}
+	for (int file = VolumeGen_firstFile(tree, folder, options->files); file >= 0 && file < options->files; file += tree->file_folders){
+		length = VolumeGen_fileName(options, file, name);
+		snprintf(short_name, sizeof(short_name), "F%07XTXT", file);
+		entry += VolumeGen_fatLongName(buffer + (size_t) entry * FAT_SYSTEM_DIR_ENTRY_SIZE, name, length, short_name);
+		VolumeGen_fatEntry((FatDirEntry *) buffer + entry++, short_name, FAT_SYSTEM_DIR_ENTRY_FILE, fat->file_cluster[file], options->file_size);
+	}
+
+	if (folder == 0){
+		error = VolumeGen_write(fd, fat->root_position, buffer, size);
+	}else{
+		cluster = fat->folder_cluster[folder];
+		for (unsigned int i = 0; i < clusters && error == 0; i++){
+			error = VolumeGen_write(fd, fat->data_position + (unsigned long long) (cluster - FAT_SYSTEM_FIRST_CLUSTER) * fat->cluster_size,
+					buffer + (size_t) i * fat->cluster_size, fat->cluster_size);
+			cluster = fat->fat[cluster];
+		}
+	}
+	free(buffer);
+	return error;
+}
+
+
+/***********************************************
+*
+* @Purpose: Writes the boot sector of a FAT16 volume
+* @Parameters: int fd, file descriptor of the image
+*              const GenOptions *options, options of the volume
+*              const GenFat *fat, FAT16 volume
+* @Return: 0 on success, -1 on error
+*
+************************************************/
+static int VolumeGen_fatWriteBootSector(int fd, const GenOptions *options, const GenFat *fat){
+	unsigned char sector[GEN_FAT_SECTOR_SIZE];
+
+	memset(sector, 0, sizeof(sector));
+	sector[0] = 0xEB;
+	sector[1] = 0x3C;
+	sector[2] = 0x90;
+	memcpy(sector + FAT_SYSTEM_NAME_OFFSET, "SHOOTER ", FAT_SYSTEM_NAME_SIZE);
+	VolumeGen_put16(sector, FAT_SYSTEM_SIZE_OFFSET, GEN_FAT_SECTOR_SIZE);
+	sector[FAT_SYSTEM_SECTOR_CLUSTER_OFFSET] = (unsigned char) fat->sectors_per_cluster;
+	VolumeGen_put16(sector, FAT_SYSTEM_RESERVED_SECTORS_OFFSET, 1);
+	sector[FAT_SYSTEM_NUM_FATS_OFFSET] = GEN_FAT_NUM_FATS;
+	VolumeGen_put16(sector, FAT_SYSTEM_MAX_ROOT_OFFSET, fat->root_entries);
+	if (fat->total_sectors <= 0xFFFF){
+		VolumeGen_put16(sector, FAT_SYSTEM_TOTAL_SECTORS16_OFFSET, fat->total_sectors);
+	}else{
+		VolumeGen_put32(sector, FAT_SYSTEM_TOTAL_SECTORS32_OFFSET, fat->total_sectors);
+	}
+	sector[GEN_FAT_MEDIA_OFFSET] = GEN_FAT_MEDIA;
+	VolumeGen_put16(sector, FAT_SYSTEM_SECTORS_PER_FAT_OFFSET, fat->fat_sectors);
+	sector[GEN_FAT_BOOT_SIGNATURE_OFFSET] = GEN_FAT_BOOT_SIGNATURE;
+	VolumeGen_put32(sector, GEN_FAT_VOLUME_ID_OFFSET, (unsigned int) options->seed);
+	memcpy(sector + FAT_SYSTEM_LABEL_OFFSET, "BENCH      ", FAT_SYSTEM_LABEL_SIZE);
+	memcpy(sector + FAT_SYSTEM_SYSTYPE_OFFSET, FAT_SYSYTEM_NAME, FAT_SYSTEM_SYSTYPE_SIZE);
+	sector[GEN_FAT_SIGNATURE_OFFSET] = 0x55;
+	sector[GEN_FAT_SIGNATURE_OFFSET + 1] = 0xAA;
+	return VolumeGen_write(fd, 0, sector, sizeof(sector));
+}
+
+
+/***********************************************
+*
+* @Purpose: Generates a FAT16 volume
+* @Parameters: int fd, file descriptor of the image
+*              const GenOptions *options, options of the volume
+*              const GenTree *tree, folders of the volume
+* @Return: size of the volume in bytes, 0 on error
+*
+************************************************/
+static unsigned long long VolumeGen_fat(int fd, const GenOptions *options, const GenTree *tree){
+	size_t fat_size;
+	unsigned long long size = 0;
+	int error;
+	GenFat fat;
+
+	memset(&fat, 0, sizeof(GenFat));
+	if (VolumeGen_fatLayout(options, tree, &fat) < 0){
+		fprintf(stderr, "The files do not fit in a FAT16 volume\n");
+		return 0;
+	}
+	fat_size = (size_t) fat.fat_sectors * GEN_FAT_SECTOR_SIZE;
+	fat.fat = (unsigned short *) calloc(fat_size, 1);
+	fat.folder_cluster = (unsigned int *) calloc(tree->folder_count, sizeof(unsigned int));
+	fat.file_cluster = (unsigned int *) calloc(options->files > 0 ? options->files : 1, sizeof(unsigned int));
+	error = fat.fat == NULL || fat.folder_cluster == NULL || fat.file_cluster == NULL;
+	if (error == 0){
+		error = VolumeGen_initAllocator(&fat.clusters, (unsigned long long) fat.cluster_count + FAT_SYSTEM_FIRST_CLUSTER);
+	}
+	if (error == 0){
+		fat.fat[0] = 0xFF00 | GEN_FAT_MEDIA;
+		fat.fat[1] = GEN_FAT_END_OF_CHAIN;
+		VolumeGen_markUsed(&fat.clusters, 0);
+		VolumeGen_markUsed(&fat.clusters, 1);
+		// The clusters are allocated before the entries are written, the entries need the first cluster of the subfolders
+		VolumeGen_fatAllocateFolder(options, tree, &fat, 0);
+		error = fat.clusters.full;
+	}
+	for (int folder = 0; folder < tree->folder_count && error == 0; folder++){
+		error = VolumeGen_fatWriteFolder(fd, options, tree, &fat, folder);
+	}
+	for (int i = 0; i < GEN_FAT_NUM_FATS && error == 0; i++){
+		error = VolumeGen_write(fd, (unsigned long long) (1 + i * fat.fat_sectors) * GEN_FAT_SECTOR_SIZE, fat.fat, fat_size);
+	}
+	if (error == 0){
+		error = VolumeGen_fatWriteBootSector(fd, options, &fat);
+	}
+	if (error == 0){
+		size = (unsigned long long) fat.total_sectors * GEN_FAT_SECTOR_SIZE;
+		error = ftruncate(fd, (off_t) size);
+	}
+	free(fat.fat);
+	free(fat.folder_cluster);
+	free(fat.file_cluster);
+	free(fat.clusters.used);
+	return error == 0 ? size : 0;
+}
+
+
+/***********************************************
+*
+* @Purpose: Adds an entry to the blocks of an Ext2 folder. An entry that does not fit in the block goes to the
+*           next one, and the last entry of the block is extended to its end
+* @Parameters: GenPack *pack, blocks of the folder
+*              unsigned int inode, inode of the entry
+*              const char *name, name of the entry
+*              int length, length of the name
+*              unsigned char file_type, EXT2_FT_* type of the entry
+* @Return: -
+*
+************************************************/
+static void VolumeGen_extAddEntry(GenPack *pack, unsigned int inode, const char *name, int length, unsigned char file_type){
+	unsigned int record = (EXT_SYSTEM_DIR_ENTRY_HEADER_SIZE + length + 3) & ~3U;
+	unsigned char *entry;
+
+	if (pack->offset + record > pack->block_size){
+		if (pack->buffer != NULL){
+			VolumeGen_put16(pack->buffer, (size_t) pack->block * pack->block_size + pack->last + 4, pack->block_size - pack->last);
+		}
+		pack->block++;
+		pack->offset = 0;
+	}
+	if (pack->buffer != NULL){
+		entry = pack->buffer + (size_t) pack->block * pack->block_size + pack->offset;
+		VolumeGen_put32(entry, 0, inode);
+		VolumeGen_put16(entry, 4, record);
+		entry[6] = (unsigned char) length;
+		entry[7] = file_type;
+		memcpy(entry + EXT_SYSTEM_DIR_ENTRY_HEADER_SIZE, name, length);
+	}
+	pack->last = pack->offset;
+	pack->offset += record;
+}
+
+
+/***********************************************
+*
+* @Purpose: Gives the inode of a folder. The folders follow the lost+found folder, and the files follow them
+* @Parameters: int folder, folder
+* @Return: the inode number
+*
+************************************************/
+static unsigned int VolumeGen_extFolderInode(int folder){
+	return folder == 0 ? EXT_SYSTEM_ROOT_INODE : GEN_EXT_LOST_FOUND_INODE + (unsigned int) folder;
+}
+
+
+/***********************************************
+*
+* @Purpose: Lays out the directory entries of an Ext2 folder in its blocks, or only counts the blocks
+* @Parameters: const GenOptions *options, options of the volume
+*              const GenTree *tree, folders of the volume
+*              int folder, folder
+*              unsigned int block_size, size of a block
+*              unsigned char *buffer, where the blocks are filled, NULL to only count them
+* @Return: number of blocks of the folder
+*
+************************************************/
+static unsigned int VolumeGen_extPackFolder(const GenOptions *options, const GenTree *tree, int folder, unsigned int block_size, unsigned char *buffer){
+	char name[GEN_NAME_SIZE];
+	unsigned int parent = folder == 0 ? EXT_SYSTEM_ROOT_INODE : VolumeGen_extFolderInode(tree->parent[folder]);
+	int length, child;
+	GenPack pack;
+
+	memset(&pack, 0, sizeof(GenPack));
+	pack.buffer = buffer;
+	pack.block_size = block_size;
+	VolumeGen_extAddEntry(&pack, VolumeGen_extFolderInode(folder), ".", 1, EXT2_FT_DIR);
+	VolumeGen_extAddEntry(&pack, parent, "..", 2, EXT2_FT_DIR);
+	if (folder == 0){
+		VolumeGen_extAddEntry(&pack, GEN_EXT_LOST_FOUND_INODE, "lost+found", 10, EXT2_FT_DIR);
+	}
+	for (int i = 0; i < tree->child_count[folder]; i++){
+		child = tree->first_child[folder] + i;
+		length = VolumeGen_folderName(child, name);
+		VolumeGen_extAddEntry(&pack, VolumeGen_extFolderInode(child), name, length, EXT2_FT_DIR);
+	}
+	for (int file = VolumeGen_firstFile(tree, folder, options->files); file >= 0 && file < options->files; file += tree->file_folders){
+		length = VolumeGen_fileName(options, file, name);
+		VolumeGen_extAddEntry(&pack, VolumeGen_extFolderInode(tree->folder_count) + (unsigned int) file, name, length, EXT2_FT_REG_FILE);
+	}
+	if (buffer != NULL){
+		VolumeGen_put16(buffer, (size_t) pack.block * block_size + pack.last + 4, block_size - pack.last);
+	}
+	return pack.block + 1;
+}
+
+
+/***********************************************
+*
+* @Purpose: Counts the indirect blocks needed to map the data blocks of an inode
+* @Parameters: unsigned int per_block, block numbers of an indirect block
+*              unsigned long long blocks, data blocks of the inode
+* @Return: number of indirect blocks, ~0 if the inode needs the triple indirect block
+*
+************************************************/
+static unsigned long long VolumeGen_extIndirectBlocks(unsigned int per_block, unsigned long long blocks){
+	if (blocks <= EXT_SYSTEM_DIRECT_BLOCKS) return 0;
+	blocks -= EXT_SYSTEM_DIRECT_BLOCKS;
+	if (blocks <= per_block) return 1;
+	blocks -= per_block;
+	if (blocks > (unsigned long long) per_block * per_block) return ~0ULL;
+	return 2 + (blocks + per_block - 1) / per_block;
+}
+
+
+/***********************************************
+*
+* @Purpose: Gives an inode of the inode tables
+* @Parameters: GenExt *ext, Ext2 volume
+*              unsigned int number, inode number
+* @Return: the inode
+*
+************************************************/
+static InodeTableEntry *VolumeGen_extInode(GenExt *ext, unsigned int number){
+	return (InodeTableEntry *) (ext->inodes + (size_t) (number - 1) * GEN_EXT_INODE_SIZE);
+}
+
+
+/***********************************************
+*
+* @Purpose: Allocates the data blocks of an inode, with the indirect blocks that map them right before the data
+*           blocks they map, and writes the indirect blocks
+* @Parameters: int fd, file descriptor of the image
+*              GenExt *ext, Ext2 volume
+*              InodeTableEntry *inode, inode whose i_block and i_blocks are filled
+*              unsigned int blocks, number of data blocks
+*              int fragmented, 1 to leave a free block after every block
+*              unsigned int *data_blocks, filled with the data blocks, NULL if they are not needed
+* @Return: 0 on success, -1 on error
+*
+************************************************/
+static int VolumeGen_extAllocate(int fd, GenExt *ext, InodeTableEntry *inode, unsigned int blocks, int fragmented, unsigned int *data_blocks){
+	unsigned int per_block = ext->per_block, indirect_blocks = 0, block, index;
+	unsigned int *single = (unsigned int *) calloc(per_block, sizeof(unsigned int));
+	unsigned int *twice = (unsigned int *) calloc(per_block, sizeof(unsigned int));
+	unsigned int single_block = 0;
+	int error = single == NULL || twice == NULL ? -1 : 0;
+
+	for (unsigned int n = 0; n < blocks && error == 0; n++){
+		if (n < EXT_SYSTEM_DIRECT_BLOCKS){
+			block = (unsigned int) VolumeGen_allocate(&ext->blocks, fragmented);
+			inode->i_block[n] = block;
+		}else{
+			index = n - EXT_SYSTEM_DIRECT_BLOCKS;
+			// A new single indirect block, the one of the inode or one of the double indirect block
+			if (index % per_block == 0 || index == per_block){
+				if (single_block != 0){
+					error = VolumeGen_write(fd, (unsigned long long) single_block * ext->block_size, single, ext->block_size);
+					memset(single, 0, (size_t) per_block * sizeof(unsigned int));
+				}
+				if (index == per_block){
+					inode->i_block[EXT_SYSTEM_DIRECT_BLOCKS + 1] = (unsigned int) VolumeGen_allocate(&ext->blocks, fragmented);
+					indirect_blocks++;
+				}
+				single_block = (unsigned int) VolumeGen_allocate(&ext->blocks, fragmented);
+				indirect_blocks++;
+				if (index < per_block){
+					inode->i_block[EXT_SYSTEM_DIRECT_BLOCKS] = single_block;
+				}else{
+					twice[(index - per_block) / per_block] = single_block;
+				}
+			}
+			block = (unsigned int) VolumeGen_allocate(&ext->blocks, fragmented);
+			single[index < per_block ? index : (index - per_block) % per_block] = block;
+		}
+		if (data_blocks != NULL) data_blocks[n] = block;
+	}
+	if (error == 0 && single_block != 0){
+		error = VolumeGen_write(fd, (unsigned long long) single_block * ext->block_size, single, ext->block_size);
+	}
+	if (error == 0 && inode->i_block[EXT_SYSTEM_DIRECT_BLOCKS + 1] != 0){
+		error = VolumeGen_write(fd, (unsigned long long) inode->i_block[EXT_SYSTEM_DIRECT_BLOCKS + 1] * ext->block_size, twice, ext->block_size);
+	}
+	inode->i_blocks = (blocks + indirect_blocks) * (ext->block_size / GEN_EXT_SECTOR_SIZE);
+	free(single);
+	free(twice);
+	return error != 0 || ext->blocks.full ? -1 : 0;
+}
+
+
+/***********************************************
+*
+* @Purpose: Fills the fields of an inode shared by all of them
+* @Parameters: InodeTableEntry *inode, inode
+*              unsigned short mode, type and permissions
+*              unsigned short links, number of links
+*              unsigned int size, size in bytes
+* @Return: -
+*
+************************************************/
+static void VolumeGen_extInitInode(InodeTableEntry *inode, unsigned short mode, unsigned short links, unsigned int size){
+	memset(inode, 0, sizeof(InodeTableEntry));
+	inode->i_mode = mode;
+	inode->i_links_count = links;
+	inode->i_size = size;
+	inode->i_atime = GEN_TIMESTAMP;
+	inode->i_ctime = GEN_TIMESTAMP;
+	inode->i_mtime = GEN_TIMESTAMP;
+}
+
+
+/***********************************************
+*
+* @Purpose: Allocates and writes a folder with its directory entries, the blocks of its files and its subfolders,
+*           in this order
+* @Parameters: int fd, file descriptor of the image
+*              const GenOptions *options, options of the volume
+*              const GenTree *tree, folders of the volume
+*              GenExt *ext, Ext2 volume
+*              int folder, folder
+* @Return: 0 on success, -1 on error
+*
+************************************************/
+static int VolumeGen_extFolder(int fd, const GenOptions *options, const GenTree *tree, GenExt *ext, int folder){
+	unsigned int blocks = VolumeGen_extPackFolder(options, tree, folder, ext->block_size, NULL);
+	unsigned int file_blocks = (options->file_size + ext->block_size - 1) / ext->block_size;
+	unsigned int *data_blocks = (unsigned int *) malloc(blocks * sizeof(unsigned int));
+	unsigned char *buffer = (unsigned char *) calloc(blocks, ext->block_size);
+	unsigned int first_file_inode = VolumeGen_extFolderInode(tree->folder_count);
+	unsigned short links = 2 + tree->child_count[folder] + (folder == 0);
+	InodeTableEntry *inode = VolumeGen_extInode(ext, VolumeGen_extFolderInode(folder));
+	int error = data_blocks == NULL || buffer == NULL ? -1 : 0;
+
+	if (error == 0){
+		VolumeGen_extInitInode(inode, GEN_EXT_MODE_FOLDER, links, blocks * ext->block_size);
+		error = VolumeGen_extAllocate(fd, ext, inode, blocks, VolumeGen_isFragmented(options, folder), data_blocks);
+	}
+	if (error == 0){
+		VolumeGen_extPackFolder(options, tree, folder, ext->block_size, buffer);
+		for (unsigned int i = 0; i < blocks && error == 0; i++){
+			error = VolumeGen_write(fd, (unsigned long long) data_blocks[i] * ext->block_size, buffer + (size_t) i * ext->block_size, ext->block_size);
+		}
+	}
+	free(data_blocks);
+	free(buffer);
+
+	for (int file = VolumeGen_firstFile(tree, folder, options->files); file >= 0 && file < options->files && error == 0; file += tree->file_folders){
+		inode = VolumeGen_extInode(ext, first_file_inode + (unsigned int) file);
+		VolumeGen_extInitInode(inode, GEN_EXT_MODE_FILE, 1, options->file_size);
+		error = VolumeGen_extAllocate(fd, ext, inode, file_blocks, VolumeGen_isFragmented(options, tree->folder_count + file), NULL);
+	}
+	for (int i = 0; i < tree->child_count[folder] && error == 0; i++){
+		error = VolumeGen_extFolder(fd, options, tree, ext, tree->first_child[folder] + i);
+	}
+	return error;
+}
+
+
+/***********************************************
+*
+* @Purpose: Chooses the number of groups and the size of the inode tables of an Ext2 volume able to hold the
+*           files and folders. Every group has a copy of the superblock and of the group descriptors
+* @Parameters: const GenOptions *options, options of the volume
+*              const GenTree *tree, folders of the volume
+*              GenExt *ext, filled with the layout
+* @Return: 0 on success, -1 if the files are too big
+*
+************************************************/
+static int VolumeGen_extLayout(const GenOptions *options, const GenTree *tree, GenExt *ext){
+	unsigned long long needed = 0, blocks, indirect, inodes, overhead, usable, last;
+	unsigned int inodes_per_block;
+
+	ext->block_size = options->block_size;
+	ext->first_data_block = ext->block_size == 1024 ? 1 : 0;
+	ext->blocks_per_group = ext->block_size * 8;
+	ext->per_block = ext->block_size / sizeof(unsigned int);
+	inodes_per_block = ext->block_size / GEN_EXT_INODE_SIZE;
+
+	// Blocks of the folders and files, twice the blocks for the fragmented ones, and the block of lost+found
+	for (int folder = 0; folder < tree->folder_count; folder++){
+		blocks = VolumeGen_extPackFolder(options, tree, folder, ext->block_size, NULL);
+		indirect = VolumeGen_extIndirectBlocks(ext->per_block, blocks);
+		if (indirect == ~0ULL) return -1;
+		needed += (blocks + indirect) * (1 + VolumeGen_isFragmented(options, folder));
+	}
+	blocks = (options->file_size + ext->block_size - 1) / ext->block_size;
+	indirect = VolumeGen_extIndirectBlocks(ext->per_block, blocks);
+	if (indirect == ~0ULL) return -1;
+	for (int file = 0; file < options->files; file++){
+		needed += (blocks + indirect) * (1 + VolumeGen_isFragmented(options, tree->folder_count + file));
+	}
+	needed += 1 + GEN_SLACK_UNITS;
+	inodes = VolumeGen_extFolderInode(tree->folder_count) + (unsigned long long) options->files;
+
+	for (ext->groups = 1; ; ext->groups++){
+		ext->inodes_per_group = (unsigned int) ((inodes + ext->groups - 1) / ext->groups);
+		ext->inodes_per_group = (ext->inodes_per_group + inodes_per_block - 1) / inodes_per_block * inodes_per_block;
+		if (ext->inodes_per_group > ext->blocks_per_group) continue;
+		ext->inode_table_blocks = ext->inodes_per_group / inodes_per_block;
+		ext->gdt_blocks = (ext->groups * EXT_SYSTEM_GROUP_DESC_SIZE + ext->block_size - 1) / ext->block_size;
+		overhead = 1 + ext->gdt_blocks + 2 + ext->inode_table_blocks;
+		if (overhead + GEN_SLACK_UNITS > ext->blocks_per_group) return -1;
+		usable = (unsigned long long) ext->groups * (ext->blocks_per_group - overhead);
+		if (usable >= needed) break;
+	}
+	// The last group only has the blocks needed
+	last = needed - (unsigned long long) (ext->groups - 1) * (ext->blocks_per_group - overhead) + overhead;
+	if (last < overhead + GEN_SLACK_UNITS) last = overhead + GEN_SLACK_UNITS;
+	if (last > ext->blocks_per_group) last = ext->blocks_per_group;
+	if ((unsigned long long) ext->first_data_block + (unsigned long long) (ext->groups - 1) * ext->blocks_per_group + last > 0xFFFFFFFFULL) return -1;
+	ext->blocks_count = ext->first_data_block + (ext->groups - 1) * ext->blocks_per_group + (unsigned int) last;
+	ext->inodes_count = ext->groups * ext->inodes_per_group;
+	return 0;
+}
+
+
+/***********************************************
+*
+* @Purpose: Gives the first block of a group, where its copy of the superblock is
+* @Parameters: const GenExt *ext, Ext2 volume
+*              unsigned int group, group
+* @Return: the block number
+*
+************************************************/
+static unsigned int VolumeGen_extGroupStart(const GenExt *ext, unsigned int group){
+	return ext->first_data_block + group * ext->blocks_per_group;
+}
+
+
+/***********************************************
+*
+* @Purpose: Writes the bitmaps, the inode tables, and the copies of the superblock and of the group descriptors
+*           of every group, once all the inodes and blocks are allocated
+* @Parameters: int fd, file descriptor of the image
+*              const GenOptions *options, options of the volume
+*              const GenTree *tree, folders of the volume
+*              GenExt *ext, Ext2 volume
+* @Return: 0 on success, -1 on error
+*
+************************************************/
+static int VolumeGen_extWriteGroups(int fd, const GenOptions *options, const GenTree *tree, GenExt *ext){
+	unsigned int used_inodes = VolumeGen_extFolderInode(tree->folder_count) - 1 + (unsigned int) options->files;
+	unsigned int free_blocks_total = 0, free_inodes_total = 0, start, size, inode, free_blocks, free_inodes, folders;
+	unsigned char *gdt = (unsigned char *) calloc(ext->gdt_blocks, ext->block_size);
+	unsigned char *bitmap = (unsigned char *) malloc(ext->block_size);
+	unsigned char superblock[GEN_EXT_SUPERBLOCK_SIZE];
+	unsigned char *descriptor;
+	int error = gdt == NULL || bitmap == NULL ? -1 : 0;
+
+	for (unsigned int group = 0; group < ext->groups && error == 0; group++){
+		start = VolumeGen_extGroupStart(ext, group);
+		size = group == ext->groups - 1 ? ext->blocks_count - start : ext->blocks_per_group;
+		descriptor = gdt + (size_t) group * EXT_SYSTEM_GROUP_DESC_SIZE;
+
+		// Block bitmap, the bits after the end of the last group are set
+		memset(bitmap, 0xFF, ext->block_size);
+		free_blocks = 0;
+		for (unsigned int i = 0; i < size; i++){
+			if (VolumeGen_isUsed(&ext->blocks, (unsigned long long) start + i) == 0){
+				bitmap[i / 8] &= ~(1 << (i % 8));
+				free_blocks++;
+			}
+		}
+		error = VolumeGen_write(fd, (unsigned long long) (start + 1 + ext->gdt_blocks) * ext->block_size, bitmap, ext->block_size);
+
+		// Inode bitmap, the bits after the inodes of the group are set
+		memset(bitmap, 0xFF, ext->block_size);
+		free_inodes = 0;
+		folders = 0;
+		for (unsigned int i = 0; i < ext->inodes_per_group; i++){
+			inode = group * ext->inodes_per_group + i + 1;
+			if (inode > used_inodes){
+				bitmap[i / 8] &= ~(1 << (i % 8));
+				free_inodes++;
+			}else if ((VolumeGen_extInode(ext, inode)->i_mode & EXT_SYSTEM_MODE_TYPE_MASK) == EXT_SYSTEM_MODE_DIRECTORY){
+				folders++;
+			}
+		}
+		if (error == 0){
+			error = VolumeGen_write(fd, (unsigned long long) (start + 2 + ext->gdt_blocks) * ext->block_size, bitmap, ext->block_size);
+		}
+		if (error == 0){
+			error = VolumeGen_write(fd, (unsigned long long) (start + 3 + ext->gdt_blocks) * ext->block_size,
+					VolumeGen_extInode(ext, group * ext->inodes_per_group + 1), (size_t) ext->inodes_per_group * GEN_EXT_INODE_SIZE);
+		}
+		VolumeGen_put32(descriptor, 0, start + 1 + ext->gdt_blocks);
+		VolumeGen_put32(descriptor, 4, start + 2 + ext->gdt_blocks);
+		VolumeGen_put32(descriptor, 8, start + 3 + ext->gdt_blocks);
+		VolumeGen_put16(descriptor, 12, free_blocks);
+		VolumeGen_put16(descriptor, 14, free_inodes);
+		VolumeGen_put16(descriptor, 16, folders);
+		free_blocks_total += free_blocks;
+		free_inodes_total += free_inodes;
+	}
+
+	memset(superblock, 0, sizeof(superblock));
+	VolumeGen_put32(superblock, EXT_SYSTEM_INODE_COUNT_OFFSET, ext->inodes_count);
+	VolumeGen_put32(superblock, EXT_SYSTEM_BLOCK_N_TOTALBLOCKS_OFFSET, ext->blocks_count);
+	VolumeGen_put32(superblock, EXT_SYSTEM_BLOCK_FREE_OFFSET, free_blocks_total);
+	VolumeGen_put32(superblock, EXT_SYSTEM_INODE_FREE_OFFSET, free_inodes_total);
+	VolumeGen_put32(superblock, EXT_SYSTEM_BLOCK_FIRST_OFFSET, ext->first_data_block);
+	VolumeGen_put32(superblock, EXT_SYSTEM_BLOCK_SIZE_OFFSET, ext->block_size == 1024 ? 0 : ext->block_size == 2048 ? 1 : 2);
+	VolumeGen_put32(superblock, GEN_EXT_LOG_FRAG_SIZE_OFFSET, ext->block_size == 1024 ? 0 : ext->block_size == 2048 ? 1 : 2);
+	VolumeGen_put32(superblock, EXT_SYSTEM_BLOCK_GROUP_OFFSET, ext->blocks_per_group);
+	VolumeGen_put32(superblock, EXT_SYSTEM_BLOCK_FRAGS_OFFSET, ext->blocks_per_group);
+	VolumeGen_put32(superblock, EXT_SYSTEM_INODE_GROUP_OFFSET, ext->inodes_per_group);
+	VolumeGen_put32(superblock, EXT_SYSTEM_VOLUME_WRITE_OFFSET, GEN_TIMESTAMP);
+	VolumeGen_put16(superblock, GEN_EXT_MAX_MOUNT_OFFSET, 0xFFFF);
+	VolumeGen_put16(superblock, EXT_SYSTEM_MAGIC_WORD_OFFSET, EXT_SYSTEM_MAGIC_WORD);
+	VolumeGen_put16(superblock, GEN_EXT_STATE_OFFSET, GEN_EXT_STATE_CLEAN);
+	VolumeGen_put16(superblock, GEN_EXT_ERRORS_OFFSET, GEN_EXT_ERRORS_CONTINUE);
+	VolumeGen_put32(superblock, EXT_SYSTEM_VOLUME_CHECKED_OFFSET, GEN_TIMESTAMP);
+	VolumeGen_put32(superblock, GEN_EXT_REV_LEVEL_OFFSET, GEN_EXT_DYNAMIC_REV);
+	VolumeGen_put32(superblock, EXT_SYSTEM_INODE_FIRST_OFFSET, GEN_EXT_FIRST_INODE);
+	VolumeGen_put16(superblock, EXT_SYSTEM_INODE_OFFSET, GEN_EXT_INODE_SIZE);
+	VolumeGen_put32(superblock, GEN_EXT_FEATURE_INCOMPAT_OFFSET, GEN_EXT_FEATURE_FILETYPE);
+	for (int i = 0; i < GEN_EXT_UUID_SIZE; i++){
+		superblock[GEN_EXT_UUID_OFFSET + i] = (unsigned char) ((options->seed >> ((i % 8) * 8)) ^ (0x5A + i * 37));
+	}
+	memcpy(superblock + EXT_SYSTEM_VOLUME_NAME_OFFSET, "bench", 5);
+
+	for (unsigned int group = 0; group < ext->groups && error == 0; group++){
+		start = VolumeGen_extGroupStart(ext, group);
+		VolumeGen_put16(superblock, GEN_EXT_GROUP_NUMBER_OFFSET, group);
+		// The superblock of the first group is always 1024 bytes after the start of the volume
+		error = VolumeGen_write(fd, group == 0 ? EXT_SYSTEM_SUPERBLOCK_OFFSET : (unsigned long long) start * ext->block_size, superblock, sizeof(superblock));
+		if (error == 0){
+			error = VolumeGen_write(fd, (unsigned long long) (start + 1) * ext->block_size, gdt, (size_t) ext->gdt_blocks * ext->block_size);
+		}
+	}
+	free(gdt);
+	free(bitmap);
+	return error;
+}
+
+
+/***********************************************
+*
+* @Purpose: Generates an Ext2 volume
+* @Parameters: int fd, file descriptor of the image
+*              const GenOptions *options, options of the volume
+*              const GenTree *tree, folders of the volume
+* @Return: size of the volume in bytes, 0 on error
+*
+************************************************/
+static unsigned long long VolumeGen_ext(int fd, const GenOptions *options, const GenTree *tree){
+	unsigned long long size = 0;
+	unsigned int start, metadata;
+	InodeTableEntry *inode;
+	int error;
+	GenExt ext;
+
+	memset(&ext, 0, sizeof(GenExt));
+	if (VolumeGen_extLayout(options, tree, &ext) < 0){
+		fprintf(stderr, "The files and folders are too big for the generator\n");
+		return 0;
+	}
+	ext.inodes = (unsigned char *) calloc(ext.inodes_count, GEN_EXT_INODE_SIZE);
+	error = ext.inodes == NULL || VolumeGen_initAllocator(&ext.blocks, ext.blocks_count) < 0 ? -1 : 0;
+	if (error == 0){
+		// The superblock, the group descriptors, the bitmaps and the inode table of every group are in use
+		for (unsigned int i = 0; i < ext.first_data_block; i++){
+			VolumeGen_markUsed(&ext.blocks, i);
+		}
+		metadata = 1 + ext.gdt_blocks + 2 + ext.inode_table_blocks;
+		for (unsigned int group = 0; group < ext.groups; group++){
+			start = VolumeGen_extGroupStart(&ext, group);
+			for (unsigned int i = 0; i < metadata; i++){
+				VolumeGen_markUsed(&ext.blocks, (unsigned long long) start + i);
+			}
+		}
+		error = VolumeGen_extFolder(fd, options, tree, &ext, 0);
+	}
+	if (error == 0){
+		// lost+found, with a block for its "." and ".." entries
+		unsigned char *block = (unsigned char *) calloc(1, ext.block_size);
+		unsigned int data_block;
+
+		inode = VolumeGen_extInode(&ext, GEN_EXT_LOST_FOUND_INODE);
+		VolumeGen_extInitInode(inode, GEN_EXT_MODE_LOST_FOUND, 2, ext.block_size);
+		error = block == NULL ? -1 : VolumeGen_extAllocate(fd, &ext, inode, 1, 0, &data_block);
+		if (error == 0){
+			VolumeGen_put32(block, 0, GEN_EXT_LOST_FOUND_INODE);
+			VolumeGen_put16(block, 4, 12);
+			block[6] = 1;
+			block[7] = EXT2_FT_DIR;
+			block[8] = '.';
+			VolumeGen_put32(block, 12, EXT_SYSTEM_ROOT_INODE);
+			VolumeGen_put16(block, 16, ext.block_size - 12);
+			block[18] = 2;
+			block[19] = EXT2_FT_DIR;
+			memcpy(block + 20, "..", 2);
+			error = VolumeGen_write(fd, (unsigned long long) data_block * ext.block_size, block, ext.block_size);
+		}
+		free(block);
+	}
+	if (error == 0){
+		error = VolumeGen_extWriteGroups(fd, options, tree, &ext);
+	}
+	if (error == 0){
+		size = (unsigned long long) ext.blocks_count * ext.block_size;
+		error = ftruncate(fd, (off_t) size);
+	}
+	free(ext.inodes);
+	free(ext.blocks.used);
+	return error == 0 ? size : 0;
+}
+
+
+int main(int argc, char *argv[]){
+	unsigned long long size;
+	GenOptions options;
+	GenTree tree;
+	int fd;
+
+	if (VolumeGen_parseOptions(argc, argv, &options) < 0){
+		fprintf(stderr, GEN_USAGE);
+		return 1;
+	}
+	if (VolumeGen_buildTree(&options, &tree) < 0){
+		fprintf(stderr, "Unable to build a tree of folders with depth %d and fan-out %d\n", options.depth, options.fanout);
+		VolumeGen_freeTree(&tree);
+		return 1;
+	}
+	fd = open(options.image, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0){
+		fprintf(stderr, "Unable to create %s\n", options.image);
+		VolumeGen_freeTree(&tree);
+		return 1;
+	}
+	size = options.is_fat ? VolumeGen_fat(fd, &options, &tree) : VolumeGen_ext(fd, &options, &tree);
+	close(fd);
+	if (size > 0 && options.list != NULL && VolumeGen_writeList(&options, &tree) < 0){
+		fprintf(stderr, "Unable to write the list of files %s\n", options.list);
+		size = 0;
+	}
+	if (size > 0){
+		printf("%s volume %s: %d files in %d folders, %llu bytes\n", options.is_fat ? "FAT16" : "Ext2", options.image, options.files, tree.folder_count, size);
+	}
+	VolumeGen_freeTree(&tree);
+	return size > 0 ? 0 : 1;
+}
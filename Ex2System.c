@@ -8,22 +8,37 @@
 #include <string.h>
 #include <strings.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <sys/types.h>
 #include <unistd.h>
 #include <stdio.h>
 #include <time.h>
+#include <errno.h>
 
+#include "VolumeIO.h"
+#include "NameIndex.h"
+#include "TargetSet.h"
+#include "Ext2Hash.h"
 #include "Ex2System.h"
 
-int isFound = 0;
-int isDelete = 0;
+static int Ext2System_walkDirectory(ExtFileSystem *fs, unsigned int dir_inode, char *path, size_t path_len, FileEntryVisitor visitor, void *context);
+static NameIndex *Ext2System_loadIndex(ExtFileSystem *fs);
+static void Ext2System_findIndexed(TargetSet *targets, NameIndex *index);
+static int Ext2System_deleteIndexed(TargetSet *targets, ExtFileSystem *fs, NameIndex *index);
+static void Ext2System_printNotFound(TargetSet *targets);
+static void Ext2System_resolvePaths(TargetSet *targets, ExtFileSystem *fs, int is_delete);
+static void Ext2System_extract(TargetSet *targets, ExtFileSystem *fs);
+static void Ext2System_list(ExtFileSystem *fs);
+static void Ext2System_scan(ExtFileSystem *fs);
+static void Ext2System_scanFolder(ExtFindOperation *operation, ExtFindNode *node, unsigned int dir_inode, unsigned char *scratch, int worker);
 
 
 /***********************************************
 *
-* @Purpose: Returns an integer corresponding to the operation string, /info -> 0, /find -> 1, /delete -> 2, else -> -1
+* @Purpose: Returns an integer corresponding to the operation string, /info -> 0, /find -> 1, /delete -> 2,
+*           /extract -> 3, /ls -> 4, /scan -> 5, else -> -1
 * @Parameters: char *operation: operation to be done on the Ext2 filesystem
-*              Valid operations: /info, /find, /delete
+*              Valid operations: /info, /find, /delete, /extract, /ls, /scan
 *
 * @Return: An integer corresponding to the operation string
 *
@@ -35,6 +50,12 @@ int EXT2SYSTEM_getOperationNumber(char *operation){
 		return 1;
 	}else if(strcmp(operation,"/delete") == 0){
 		return 2;
+	}else if(strcmp(operation,"/extract") == 0){
+		return 3;
+	}else if(strcmp(operation,"/ls") == 0){
+		return 4;
+	}else if(strcmp(operation,"/scan") == 0){
+		return 5;
 	}
 	return -1;
 }
@@ -42,15 +63,14 @@ int EXT2SYSTEM_getOperationNumber(char *operation){
 
 /***********************************************
 *
-* @Purpose: Determine if the volume specidied by fd is an Ext2 volume
-* @Parameters: int fd, file descriptor of the volume read
+* @Purpose: Determine if the volume specidied by volume_io is an Ext2 volume
+* @Parameters: VolumeIO *volume_io, block I/O handle of the volume read
 * @Return: 1 if it is ext, else 0
 *
 ************************************************/
-int Ex2System_isExt (int fd) {
-	int buffer;
-	lseek(fd, EXT_SYSTEM_SUPERBLOCK_OFFSET + EXT_SYSTEM_MAGIC_WORD_OFFSET, SEEK_SET);
-	read(fd, &buffer, EXT_SYSTEM_MAGIC_WORD_SIZE);
+int Ex2System_isExt (VolumeIO *volume_io) {
+	unsigned short buffer = 0;
+	VolumeIO_read(volume_io, EXT_SYSTEM_SUPERBLOCK_OFFSET + EXT_SYSTEM_MAGIC_WORD_OFFSET, &buffer, EXT_SYSTEM_MAGIC_WORD_SIZE);
 	return buffer == EXT_SYSTEM_MAGIC_WORD;
 }
 
@@ -73,28 +93,23 @@ void EX2System_printInode(ExtInodeData inode){
 /***********************************************
 *
 * @Purpose: Reads the inode metadata information from the volume file
-* @Parameters: int fd, file descriptor of the volume read
+* @Parameters: VolumeIO *volume_io, block I/O handle of the volume read
 * @Return:  ExtInodeData structure containing the information about an inode
 *
 ************************************************/
-ExtInodeData Ex2System_readInode (int fd) {
+ExtInodeData Ex2System_readInode (VolumeIO *volume_io) {
 	ExtInodeData inode;
 
 	//get the inode size
-	lseek(fd, EXT_SYSTEM_INODE_OFFSET + EXT_SYSTEM_SUPERBLOCK_OFFSET, SEEK_SET);
-	read(fd, &(inode.s_inode_size), EXT_SYSTEM_INODE_SIZE);
+	VolumeIO_read(volume_io, EXT_SYSTEM_INODE_OFFSET + EXT_SYSTEM_SUPERBLOCK_OFFSET, &(inode.s_inode_size), EXT_SYSTEM_INODE_SIZE);
 	//get the inode number of nodes
-	lseek(fd, EXT_SYSTEM_INODE_COUNT_OFFSET + EXT_SYSTEM_SUPERBLOCK_OFFSET , SEEK_SET);
-	read(fd, &(inode.s_inodes_count), EXT_SYSTEM_INODE_COUNT_SIZE);
+	VolumeIO_read(volume_io, EXT_SYSTEM_INODE_COUNT_OFFSET + EXT_SYSTEM_SUPERBLOCK_OFFSET , &(inode.s_inodes_count), EXT_SYSTEM_INODE_COUNT_SIZE);
 	//get the first inode
-	lseek(fd, EXT_SYSTEM_INODE_FIRST_OFFSET + EXT_SYSTEM_SUPERBLOCK_OFFSET , SEEK_SET);
-	read(fd, &(inode.s_first_ino), EXT_SYSTEM_INODE_FIRST_SIZE);
+	VolumeIO_read(volume_io, EXT_SYSTEM_INODE_FIRST_OFFSET + EXT_SYSTEM_SUPERBLOCK_OFFSET , &(inode.s_first_ino), EXT_SYSTEM_INODE_FIRST_SIZE);
 	//get the inode group
-	lseek(fd, EXT_SYSTEM_INODE_GROUP_OFFSET + EXT_SYSTEM_SUPERBLOCK_OFFSET , SEEK_SET);
-	read(fd, &(inode.s_inodes_per_group), EXT_SYSTEM_INODE_GROUP_SIZE);
+	VolumeIO_read(volume_io, EXT_SYSTEM_INODE_GROUP_OFFSET + EXT_SYSTEM_SUPERBLOCK_OFFSET , &(inode.s_inodes_per_group), EXT_SYSTEM_INODE_GROUP_SIZE);
 	//get the free inodes
-	lseek(fd, EXT_SYSTEM_INODE_FREE_OFFSET + EXT_SYSTEM_SUPERBLOCK_OFFSET , SEEK_SET);
-	read(fd, &(inode.s_free_inodes_count), EXT_SYSTEM_INODE_FREE_SIZE);
+	VolumeIO_read(volume_io, EXT_SYSTEM_INODE_FREE_OFFSET + EXT_SYSTEM_SUPERBLOCK_OFFSET , &(inode.s_free_inodes_count), EXT_SYSTEM_INODE_FREE_SIZE);
 	//EX2System_printInode(inode);
 
 
@@ -119,35 +134,28 @@ void EX2System_printBlock(ExtBlockData block){
 /***********************************************
 *
 * @Purpose: Reads the blcok metadata information from the volume file
-* @Parameters: int fd, file descriptor of the volume read
+* @Parameters: VolumeIO *volume_io, block I/O handle of the volume read
 * @Return:  ExtBlockData structure containing the information about a block
 *
 ************************************************/
-ExtBlockData Ex2System_readBlock (int fd) {
+ExtBlockData Ex2System_readBlock (VolumeIO *volume_io) {
 	ExtBlockData block;
 	//read the block size
-	lseek(fd, EXT_SYSTEM_BLOCK_SIZE_OFFSET + EXT_SYSTEM_SUPERBLOCK_OFFSET, SEEK_SET);
-	read(fd, &(block.s_log_block_size), EXT_SYSTEM_BLOCK_SIZE_SIZE);
+	VolumeIO_read(volume_io, EXT_SYSTEM_BLOCK_SIZE_OFFSET + EXT_SYSTEM_SUPERBLOCK_OFFSET, &(block.s_log_block_size), EXT_SYSTEM_BLOCK_SIZE_SIZE);
 	block.s_log_block_size = 1024 << block.s_log_block_size;	// shifting as it says in the page 11 of the manual
 
 	//read the reserved blocks
-	lseek(fd, EXT_SYSTEM_BLOCK_RESERVED_OFFSET + EXT_SYSTEM_SUPERBLOCK_OFFSET, SEEK_SET);
-	read(fd, &(block.s_r_blocks_count), EXT_SYSTEM_BLOCK_RESERVED_SIZE);
+	VolumeIO_read(volume_io, EXT_SYSTEM_BLOCK_RESERVED_OFFSET + EXT_SYSTEM_SUPERBLOCK_OFFSET, &(block.s_r_blocks_count), EXT_SYSTEM_BLOCK_RESERVED_SIZE);
 	//read the free blocks
-	lseek(fd, EXT_SYSTEM_BLOCK_FREE_OFFSET + EXT_SYSTEM_SUPERBLOCK_OFFSET, SEEK_SET);
-	read(fd, &(block.s_free_blocks_count), EXT_SYSTEM_BLOCK_FREE_SIZE);
+	VolumeIO_read(volume_io, EXT_SYSTEM_BLOCK_FREE_OFFSET + EXT_SYSTEM_SUPERBLOCK_OFFSET, &(block.s_free_blocks_count), EXT_SYSTEM_BLOCK_FREE_SIZE);
 	//read the total blocks
-	lseek(fd, EXT_SYSTEM_BLOCK_N_TOTALBLOCKS_OFFSET + EXT_SYSTEM_SUPERBLOCK_OFFSET, SEEK_SET);
-	read(fd, &(block.s_blocks_count), EXT_SYSTEM_BLOCK_N_TOTALBLOCKS_SIZE);
+	VolumeIO_read(volume_io, EXT_SYSTEM_BLOCK_N_TOTALBLOCKS_OFFSET + EXT_SYSTEM_SUPERBLOCK_OFFSET, &(block.s_blocks_count), EXT_SYSTEM_BLOCK_N_TOTALBLOCKS_SIZE);
 	//read the first block
-	lseek(fd, EXT_SYSTEM_BLOCK_FIRST_OFFSET + EXT_SYSTEM_SUPERBLOCK_OFFSET, SEEK_SET);
-	read(fd, &(block.s_first_data_block), EXT_SYSTEM_BLOCK_FIRST_SIZE);
+	VolumeIO_read(volume_io, EXT_SYSTEM_BLOCK_FIRST_OFFSET + EXT_SYSTEM_SUPERBLOCK_OFFSET, &(block.s_first_data_block), EXT_SYSTEM_BLOCK_FIRST_SIZE);
 	//read the group blocks
-	lseek(fd, EXT_SYSTEM_BLOCK_GROUP_OFFSET + EXT_SYSTEM_SUPERBLOCK_OFFSET, SEEK_SET);
-	read(fd, &(block.s_blocks_per_group), EXT_SYSTEM_BLOCK_GROUP_SIZE);
+	VolumeIO_read(volume_io, EXT_SYSTEM_BLOCK_GROUP_OFFSET + EXT_SYSTEM_SUPERBLOCK_OFFSET, &(block.s_blocks_per_group), EXT_SYSTEM_BLOCK_GROUP_SIZE);
 	//read the fragmented groups
-	lseek(fd, EXT_SYSTEM_BLOCK_FRAGS_OFFSET + EXT_SYSTEM_SUPERBLOCK_OFFSET, SEEK_SET);
-	read(fd, &(block.s_frags_per_group), EXT_SYSTEM_BLOCK_FRAGS_SIZE);
+	VolumeIO_read(volume_io, EXT_SYSTEM_BLOCK_FRAGS_OFFSET + EXT_SYSTEM_SUPERBLOCK_OFFSET, &(block.s_frags_per_group), EXT_SYSTEM_BLOCK_FRAGS_SIZE);
 
 	return block;
 }
@@ -191,46 +199,232 @@ void EX2System_printVolume(ExtVolumeData volume){
 /***********************************************
 *
 * @Purpose: Reads the Volume metadata information from the volume file
-* @Parameters: int fd, file descriptor of the volume read
+* @Parameters: VolumeIO *volume_io, block I/O handle of the volume read
 * @Return:  ExtVolumeData structure containing the information about the volume
 *
 ************************************************/
-ExtVolumeData Ex2System_readVolume(int fd) {
+ExtVolumeData Ex2System_readVolume(VolumeIO *volume_io) {
 	ExtVolumeData volume;
 
 	//read the volume name
-	lseek(fd, EXT_SYSTEM_VOLUME_NAME_OFFSET + EXT_SYSTEM_SUPERBLOCK_OFFSET, SEEK_SET);
-	read(fd, &(volume.s_volume_name), EXT_SYSTEM_VOLUME_NAME_RBYTES);
+	VolumeIO_read(volume_io, EXT_SYSTEM_VOLUME_NAME_OFFSET + EXT_SYSTEM_SUPERBLOCK_OFFSET, &(volume.s_volume_name), EXT_SYSTEM_VOLUME_NAME_RBYTES);
 	//read the last_check
-	lseek(fd, EXT_SYSTEM_VOLUME_CHECKED_OFFSET + EXT_SYSTEM_SUPERBLOCK_OFFSET, SEEK_SET);
-	read(fd, &(volume.s_lastcheck), EXT_SYSTEM_VOLUME_CHECKED_RBYTES);
+	VolumeIO_read(volume_io, EXT_SYSTEM_VOLUME_CHECKED_OFFSET + EXT_SYSTEM_SUPERBLOCK_OFFSET, &(volume.s_lastcheck), EXT_SYSTEM_VOLUME_CHECKED_RBYTES);
 	//read the last write
-	lseek(fd, EXT_SYSTEM_VOLUME_WRITE_OFFSET + EXT_SYSTEM_SUPERBLOCK_OFFSET, SEEK_SET);
-	read(fd, &(volume.s_wtime), EXT_SYSTEM_VOLUME_WRITE_RBYTES);
+	VolumeIO_read(volume_io, EXT_SYSTEM_VOLUME_WRITE_OFFSET + EXT_SYSTEM_SUPERBLOCK_OFFSET, &(volume.s_wtime), EXT_SYSTEM_VOLUME_WRITE_RBYTES);
 	//read the last mount
-	lseek(fd, EXT_SYSTEM_VOLUME_MOUNT_OFFSET + EXT_SYSTEM_SUPERBLOCK_OFFSET, SEEK_SET);
-	read(fd, &(volume.s_mtime), EXT_SYSTEM_VOLUME_MOUNT_RBYTES);
+	VolumeIO_read(volume_io, EXT_SYSTEM_VOLUME_MOUNT_OFFSET + EXT_SYSTEM_SUPERBLOCK_OFFSET, &(volume.s_mtime), EXT_SYSTEM_VOLUME_MOUNT_RBYTES);
 	return volume;
 }
 
 
+/***********************************************
+*
+* @Purpose: Opens an Ext2 volume: reads the superblock data and the whole block group descriptor table once,
+*           so that all the later lookups share them
+* @Parameters: VolumeIO *volume_io, block I/O handle of the volume
+* @Return:  pointer to the ExtFileSystem structure, NULL if there is not enough memory
+*
+************************************************/
+ExtFileSystem *Ext2System_open(VolumeIO *volume_io){
+	ExtFileSystem *fs = (ExtFileSystem *) calloc(1, sizeof(ExtFileSystem));
+	unsigned int features = 0, flags = 0;
+	if (fs == NULL) return NULL;
+
+	fs->volume_io = volume_io;
+	fs->threads = 1;
+	fs->output_fd = STDOUT_FILENO;
+	fs->list_format = LIST_OUTPUT_JSON;
+	Ext2System_initScanFilter(&fs->scan_filter);
+	pthread_mutex_init(&fs->inode_lock, NULL);
+	// Reading EXT2 info filesystem data in all cases
+	fs->inode = Ex2System_readInode (volume_io);
+	fs->block = Ex2System_readBlock (volume_io);
+	fs->volume = Ex2System_readVolume(volume_io);
+	// Revision 0 volumes do not store the inode size, it is always 128
+	fs->inode_size = fs->inode.s_inode_size != 0 ? fs->inode.s_inode_size : EXT_SYSTEM_REV0_INODE_SIZE;
+	// Data needed to look up names through the directory indexes
+	VolumeIO_read(volume_io, EXT_SYSTEM_SUPERBLOCK_OFFSET + EXT_SYSTEM_FEATURE_COMPAT_OFFSET, &features, sizeof(features));
+	VolumeIO_read(volume_io, EXT_SYSTEM_SUPERBLOCK_OFFSET + EXT_SYSTEM_HASH_SEED_OFFSET, fs->hash_seed, sizeof(fs->hash_seed));
+	VolumeIO_read(volume_io, EXT_SYSTEM_SUPERBLOCK_OFFSET + EXT_SYSTEM_FLAGS_OFFSET, &flags, sizeof(flags));
+	fs->dir_index = (features & EXT_SYSTEM_FEATURE_DIR_INDEX) != 0;
+	fs->unsigned_hash = (flags & EXT_SYSTEM_FLAGS_UNSIGNED_HASH) != 0;
+
+	if (Ext2System_readGroupDescriptors(fs) < 0 || Ext2System_setInodeCache(fs, EXT_SYSTEM_INODE_CACHE_BLOCKS, 1) < 0){
+		Ext2System_close(fs);
+		return NULL;
+	}
+	return fs;
+}
+
+
+/***********************************************
+*
+* @Purpose: Sets up the cache of inode table blocks. Any block already cached is dropped
+* @Parameters: ExtFileSystem *fs, volume whose cache is set up
+*              int blocks, number of inode table blocks kept in memory (rounded to a power of 2, 0 disables the cache)
+*              int prefetch, 1 to read the following block of the inode table together with the one needed
+* @Return:  0 on success, -1 if there is not enough memory
+*
+************************************************/
+int Ext2System_setInodeCache(ExtFileSystem *fs, int blocks, int prefetch){
+	ExtInodeCache *cache = &fs->inode_cache;
+	int slots = 1;
+
+	free(cache->tags);
+	free(cache->data);
+	bzero(cache, sizeof(ExtInodeCache));
+	cache->prefetch = prefetch;
+	if (blocks <= 0) return 0;
+
+	// Power of 2 so that consecutive table blocks go to consecutive slots
+	while (slots < blocks){
+		slots <<= 1;
+	}
+	cache->tags = (unsigned long long *) calloc(slots, sizeof(unsigned long long));
+	cache->data = (unsigned char *) malloc((size_t) slots * fs->block.s_log_block_size);
+	if (cache->tags == NULL || cache->data == NULL){
+		free(cache->tags);
+		free(cache->data);
+		cache->tags = NULL;
+		cache->data = NULL;
+		return -1;
+	}
+	cache->slots = slots;
+	return 0;
+}
+
+
+/***********************************************
+*
+* @Purpose: Loads one or two consecutive blocks of an inode table into the cache with a single read
+* @Parameters: ExtFileSystem *fs, volume whose cache is filled
+*              unsigned long long block_number, first inode table block to be loaded
+*              unsigned int count, number of blocks to be loaded (1 or 2)
+* @Return:  0 on success, -1 if the blocks could not be read
+*
+************************************************/
+static int Ext2System_loadInodeBlocks(ExtFileSystem *fs, unsigned long long block_number, unsigned int count){
+	ExtInodeCache *cache = &fs->inode_cache;
+	unsigned int block_size = fs->block.s_log_block_size;
+	unsigned int first_slot = block_number & (cache->slots - 1);
+	unsigned char buffer_stack[2 * EXT_SYSTEM_MAX_STACK_BLOCK];
+	unsigned char *buffer = buffer_stack;
+
+	// Consecutive slots are contiguous in memory unless the second one wraps around
+	if (count == 2 && first_slot + 1 < (unsigned int) cache->slots){
+		buffer = cache->data + (size_t) first_slot * block_size;
+	}else if (count * block_size > sizeof(buffer_stack)){
+		count = 1;
+		buffer = cache->data + (size_t) first_slot * block_size;
+	}
+	// A read into the slots overwrites their blocks, which must not be served if it fails halfway
+	if (buffer != buffer_stack){
+		for (unsigned int i = 0; i < count; i++){
+			cache->tags[(block_number + i) & (cache->slots - 1)] = 0;
+		}
+	}
+	if (VolumeIO_read(fs->volume_io, block_number * block_size, buffer, (size_t) count * block_size) != (ssize_t) count * block_size){
+		return -1;
+	}
+	for (unsigned int i = 0; i < count; i++){
+		unsigned int slot = (block_number + i) & (cache->slots - 1);
+		if (buffer == buffer_stack){
+			memcpy(cache->data + (size_t) slot * block_size, buffer + (size_t) i * block_size, block_size);
+		}
+		// Tags store the block number plus one, so that 0 means empty
+		cache->tags[slot] = block_number + i + 1;
+	}
+	return 0;
+}
+
+
+/***********************************************
+*
+* @Purpose: Gives access to the inode table entry of an inode, through the cache of inode table blocks.
+*           The pointer is only valid until the cache is used again, Ext2System_findAndGetInode() copies the entry
+*           and can be called from several threads
+* @Parameters: ExtFileSystem *fs, volume where the inode is
+*              unsigned int inode_number, number of the inode
+*              void *scratch, buffer of fs->inode_size bytes used when the entry cannot be served from memory
+* @Return:  pointer to the entry, NULL if the inode number is not valid or it cannot be read
+*
+************************************************/
+const unsigned char *Ext2System_getInodeEntry(ExtFileSystem *fs, unsigned int inode_number, void *scratch){
+	ExtInodeCache *cache = &fs->inode_cache;
+	unsigned int block_size = fs->block.s_log_block_size;
+	unsigned long long inode_position = Ext2System_getInodePosition(fs, inode_number);
+	unsigned long long block_number = inode_position / block_size;
+	unsigned int slot;
+
+	if (inode_position == 0) return NULL;
+	// Mapped volumes and disabled caches go straight to the volume
+	if (cache->slots == 0 || VolumeIO_isMapped(fs->volume_io)){
+		return (const unsigned char *) VolumeIO_view(fs->volume_io, inode_position, fs->inode_size, scratch);
+	}
+
+	slot = block_number & (cache->slots - 1);
+	if (cache->tags[slot] == block_number + 1){
+		cache->hits++;
+	}else{
+		unsigned int group = (inode_number - 1) / fs->inode.s_inodes_per_group;
+		unsigned long long table_end = fs->groups[group].bg_inode_table + ((unsigned long long) fs->inode.s_inodes_per_group * fs->inode_size + block_size - 1) / block_size;
+		// Inodes created together are usually in the next block too, so it is read in the same request
+		unsigned int count = (cache->prefetch && block_number + 1 < table_end && cache->tags[(block_number + 1) & (cache->slots - 1)] != block_number + 2) ? 2 : 1;
+		cache->misses++;
+		if (Ext2System_loadInodeBlocks(fs, block_number, count) < 0){
+			return (const unsigned char *) VolumeIO_view(fs->volume_io, inode_position, fs->inode_size, scratch);
+		}
+	}
+	return cache->data + (size_t) slot * block_size + inode_position % block_size;
+}
+
+
+/***********************************************
+*
+* @Purpose: Prints in screen the hit and miss counters of the inode table cache
+* @Parameters: ExtFileSystem *fs, volume whose counters are printed
+* @Return:  -
+*
+************************************************/
+void Ext2System_printCacheStats(ExtFileSystem *fs){
+	ExtInodeCache *cache = &fs->inode_cache;
+	unsigned long long total = cache->hits + cache->misses;
+	printf("\nInode cache: %d blocks of %d bytes%s\n", cache->slots, fs->block.s_log_block_size, cache->prefetch ? ", prefetching the next block" : "");
+	printf("Hits: %llu\nMisses: %llu\n", cache->hits, cache->misses);
+	printf("Hit ratio: %.2f%%\n", total == 0 ? 0.0 : 100.0 * cache->hits / total);
+}
+
+
+/***********************************************
+*
+* @Purpose: Frees the data of an Ext2 volume. The block I/O handle is not closed
+* @Parameters: ExtFileSystem *fs, volume to be freed
+* @Return:  -
+*
+************************************************/
+void Ext2System_close(ExtFileSystem *fs){
+	if (fs == NULL) return;
+	free(fs->inode_cache.tags);
+	free(fs->inode_cache.data);
+	free(fs->groups);
+	pthread_mutex_destroy(&fs->inode_lock);
+	free(fs);
+}
+
+
 /***********************************************
 *
 * @Purpose: Executes the action according to operation and filename on an Ext2 filesystem
-* @Parameters: int fd, file descriptor of the volume read
+* @Parameters: ExtFileSystem *fs, Ext2 volume opened with Ext2System_open
 *              char* operation, operation to be executed /find, /delete,/info
-*              char *file, file with which the action is executed
+*              TargetSet *targets, names of the files with which the action is executed, all of them in a single walk
 * @Return:  -
 *
 ************************************************/
-void EX2SYSTEM_executeOperation(char * operation, char* file, int volume_fd){
-	ExtInodeData inode;
-	ExtBlockData block;
-	ExtVolumeData volume;
-	// Reading EXT2 info filesystem data in all cases
-	inode = Ex2System_readInode (volume_fd);
-	block = Ex2System_readBlock (volume_fd);
-	volume = Ex2System_readVolume(volume_fd);
+void EX2SYSTEM_executeOperation(char * operation, TargetSet *targets, ExtFileSystem *fs){
+	VolumeIO *volume_io = fs->volume_io;
+	NameIndex *index;
 
 	// Perform the action according to the operation
 	switch(EXT2SYSTEM_getOperationNumber(operation)){
@@ -239,29 +433,82 @@ void EX2SYSTEM_executeOperation(char * operation, char* file, int volume_fd){
 			break;
 		case 0:
 			// /info Print the data read from the volume
-			EX2System_printInode(inode);
-			EX2System_printBlock(block);
-			EX2System_printVolume(volume);
+			EX2System_printInode(fs->inode);
+			EX2System_printBlock(fs->block);
+			EX2System_printVolume(fs->volume);
+			if (fs->check_bitmaps){
+				Ext2System_checkBitmaps(fs);
+			}
 			break;
 		// /find
 		case 1:
-			printf("You selected to find file: %s in EXT2 volume\n\n", file);
-			// Finding the file and showing its size
-			EX2System_findFile(file, volume_fd, block, inode,2);
-			if(Ext2System_isFound() == 0){
-				printf("Sorry, the file %s does not exist in the file system\n", file);
+			if (targets->count == 1){
+				printf("You selected to find file: %s in EXT2 volume\n\n", targets->targets[0].name);
+			}else{
+				printf("You selected to find %d files in EXT2 volume\n\n", targets->count);
+			}
+			// The tree walk jumps between inodes and directory blocks, so read-ahead is not useful
+			VolumeIO_advise(volume_io, 0, 0, VOLUME_IO_ADVICE_RANDOM);
+			// Absolute paths are resolved a folder at a time, only the bare names need the index or a walk
+			OpStats_startPhase(fs->stats, OP_STATS_PHASE_PATHS);
+			Ext2System_resolvePaths(targets, fs, 0);
+			if (TargetSet_hasNames(targets)){
+				// Finding the file and showing its size, through the name index when there is one
+				OpStats_startPhase(fs->stats, OP_STATS_PHASE_INDEX);
+				index = Ext2System_loadIndex(fs);
+				if (index != NULL){
+					Ext2System_findIndexed(targets, index);
+					NameIndex_close(index);
+				}else{
+					OpStats_startPhase(fs->stats, OP_STATS_PHASE_WALK);
+					EX2System_findFile(targets, fs, 0);
+				}
 			}
+			OpStats_endPhase(fs->stats);
+			Ext2System_printNotFound(targets);
 			break;
 		// /delte
 		case 2:
-			//printf("%s\n", file);
-			// Setting the flag to delete the file if found
-			isDelete = 1;
-			// Finding and deleting the file
-			EX2System_findFile(file, volume_fd, block, inode,2);
-			if(Ext2System_isFound() == 0){
-				printf("Sorry, the file %s does not exist in the file system\n", file);
+			VolumeIO_advise(volume_io, 0, 0, VOLUME_IO_ADVICE_RANDOM);
+			// The entries deleted are kept in the block cache and written together at the end
+			VolumeIO_beginBatch(volume_io);
+			OpStats_startPhase(fs->stats, OP_STATS_PHASE_PATHS);
+			Ext2System_resolvePaths(targets, fs, 1);
+			if (TargetSet_hasNames(targets)){
+				// Finding and deleting the file. An index that does not match the volume is removed and the volume is walked
+				OpStats_startPhase(fs->stats, OP_STATS_PHASE_INDEX);
+				index = Ext2System_loadIndex(fs);
+				if (index != NULL && Ext2System_deleteIndexed(targets, fs, index) == 0){
+					NameIndex_remove(index, fs->index_path);
+					index = NULL;
+				}
+				if (index != NULL){
+					NameIndex_close(index);
+				}else{
+					OpStats_startPhase(fs->stats, OP_STATS_PHASE_WALK);
+					EX2System_findFile(targets, fs, 1);
+				}
 			}
+			// Writing the directory blocks changed, sorted by their position, and flushing them to the disk at once
+			OpStats_startPhase(fs->stats, OP_STATS_PHASE_SYNC);
+			VolumeIO_flush(volume_io);
+			OpStats_endPhase(fs->stats);
+			Ext2System_printNotFound(targets);
+			break;
+		// /extract
+		case 3:
+			VolumeIO_advise(volume_io, 0, 0, VOLUME_IO_ADVICE_RANDOM);
+			Ext2System_extract(targets, fs);
+			Ext2System_printNotFound(targets);
+			break;
+		// /ls
+		case 4:
+			VolumeIO_advise(volume_io, 0, 0, VOLUME_IO_ADVICE_RANDOM);
+			Ext2System_list(fs);
+			break;
+		// /scan
+		case 5:
+			Ext2System_scan(fs);
 			break;
 
 	}
@@ -270,224 +517,2103 @@ void EX2SYSTEM_executeOperation(char * operation, char* file, int volume_fd){
 
 /***********************************************
 *
-* @Purpose: Reads the blcok metadata information from the volume file
-* @Parameters: int fd, file descriptor of the volume read
-* @Return:  ExtBlockData structure containing the information about a block
+* @Purpose: Shows the names of the targets for which no file has been found
+* @Parameters: TargetSet *targets, names looked for
+* @Return:  -
+*
+************************************************/
+static void Ext2System_printNotFound(TargetSet *targets){
+	for (int i = 0; i < targets->count; i++){
+		if (targets->targets[i].found == 0){
+			printf("Sorry, the file %s does not exist in the file system\n", targets->targets[i].name);
+		}
+	}
+}
+
+
+/***********************************************
+*
+* @Purpose: Sets the number of threads that walk the folders of the volume for /find and /delete
+* @Parameters: ExtFileSystem *fs, Ext2 volume
+*              int threads, number of threads, 1 walks the folders recursively in the calling thread
+* @Return:  -
+*
+************************************************/
+void Ext2System_setThreads(ExtFileSystem *fs, int threads){
+	fs->threads = threads < 1 ? 1 : threads;
+}
+
+
+/***********************************************
+*
+* @Purpose: Shows the file found for a target, or that it has been deleted, and counts it
+* @Parameters: ExtFindOperation *operation, operation being executed
+*              Target *target, target found
+*              const char *name, name of the file found for a pattern, NULL to show the name of the target
+*              unsigned long long size, size of the file found
+* @Return:  -
+*
+************************************************/
+static void Ext2System_reportFile(ExtFindOperation *operation, Target *target, const char *name, unsigned long long size){
+	if (name == NULL) name = target->name;
+	if (operation->is_delete == 1){
+		printf("File %s deleted\n", name);
+	}else{
+		printf("The file %s has %llu bytes\n", name, size);
+	}
+	TargetSet_setFound(operation->targets, target);
+}
+
+
+/***********************************************
+*
+* @Purpose: Creates the results of a folder that is going to be walked by a worker thread
+* @Parameters: ExtFindOperation *operation, operation being executed
+*              unsigned int inode, inode of the folder
+* @Return:  the results, NULL if there is not enough memory
+*
+************************************************/
+static ExtFindNode *Ext2System_createFindNode(ExtFindOperation *operation, unsigned int inode){
+	ExtFindNode *node = (ExtFindNode *) calloc(1, sizeof(ExtFindNode));
+	if (node == NULL) return NULL;
+	node->operation = operation;
+	node->inode = inode;
+	return node;
+}
+
+
+/***********************************************
+*
+* @Purpose: Adds a file found or a subfolder to the results of a folder
+* @Parameters: ExtFindNode *node, results of the folder
+*              Target *target, target of the file found, NULL for a subfolder
+*              const char *name, name of the file found for a pattern (not '\0' terminated), NULL otherwise
+*              size_t name_len, length of the name
+*              unsigned long long size, size of the file found
+*              ExtFindNode *folder, results of the subfolder, NULL for a file
+* @Return:  0 on success, -1 if there is not enough memory
+*
+************************************************/
+static int Ext2System_addFindItem(ExtFindNode *node, Target *target, const char *name, size_t name_len, unsigned long long size, ExtFindNode *folder){
+	char *copy = NULL;
+
+	if (name != NULL){
+		// The directory block the name is in is not kept until the results are shown
+		copy = strndup(name, name_len);
+		if (copy == NULL) return -1;
+	}
+	if (node->count == node->capacity){
+		int capacity = node->capacity == 0 ? 8 : node->capacity * 2;
+		ExtFindItem *items = (ExtFindItem *) realloc(node->items, capacity * sizeof(ExtFindItem));
+		if (items == NULL){
+			free(copy);
+			return -1;
+		}
+		node->items = items;
+		node->capacity = capacity;
+	}
+	node->items[node->count].target = target;
+	node->items[node->count].name = copy;
+	node->items[node->count].size = size;
+	node->items[node->count].folder = folder;
+	node->count++;
+	return 0;
+}
+
+
+/***********************************************
+*
+* @Purpose: Shows the results of a folder and of its subfolders in the order of the directory entries, which is
+*           the order of the recursive walk, and frees them
+* @Parameters: ExtFindNode *node, results of the folder
+* @Return:  -
+*
+************************************************/
+static void Ext2System_reportFindNode(ExtFindNode *node){
+	for (int i = 0; i < node->count; i++){
+		if (node->items[i].folder != NULL){
+			Ext2System_reportFindNode(node->items[i].folder);
+		}else{
+			Ext2System_reportFile(node->operation, node->items[i].target, node->items[i].name, node->items[i].size);
+			free(node->items[i].name);
+		}
+	}
+	free(node->items);
+	free(node);
+}
+
+
+/***********************************************
+*
+* @Purpose: Reads ahead what the traversal needs to go into the subfolders of an extent of directory blocks:
+*           first the inodes of all of them together, and then their direct blocks together, so that the reads
+*           are in flight at the same time instead of being done one after the other
+* @Parameters: ExtFileSystem *fs, volume
+*              const unsigned char *blocks, directory blocks of the extent
+*              unsigned int count, number of blocks of the extent
+* @Return:  -
+*
+************************************************/
+static void Ext2System_prefetchFolders(ExtFileSystem *fs, const unsigned char *blocks, unsigned int count){
+	unsigned int block_size = fs->block.s_log_block_size;
+	VolumeIORange ranges[EXT_SYSTEM_MAX_PREFETCH];
+	unsigned int inodes[EXT_SYSTEM_MAX_PREFETCH];
+	DirBlockParser parser;
+	DirEntryView directory_entry;
+	InodeTableEntry inode_entry;
+	unsigned long long position, total;
+	int folders = 0, ranges_count = 0;
+
+	if (VolumeIO_canPrefetch(fs->volume_io) == 0) return;
+	for (unsigned int i = 0; i < count && folders < EXT_SYSTEM_MAX_PREFETCH; i++){
+		Ext2System_initDirBlock(&parser, blocks + (size_t) i * block_size, block_size);
+		while (folders < EXT_SYSTEM_MAX_PREFETCH && Ext2System_nextDirEntry(&parser, &directory_entry)){
+			if (Ext2System_isDirectory(&directory_entry) == 0) continue;
+			position = Ext2System_getInodePosition(fs, directory_entry.inode);
+			if (position == 0) continue;
+			inodes[folders] = directory_entry.inode;
+			ranges[folders].offset = position;
+			ranges[folders].size = fs->inode_size;
+			folders++;
+		}
+	}
+	if (folders == 0) return;
+	VolumeIO_prefetch(fs->volume_io, ranges, folders);
+
+	// The inodes are in the cache now, so their block pointers can be followed
+	for (int i = 0; i < folders && ranges_count < EXT_SYSTEM_MAX_PREFETCH; i++){
+		inode_entry = Ext2System_findAndGetInode(fs, inodes[i]);
+		total = (Ext2System_getInodeSize(&inode_entry) + block_size - 1) / block_size;
+		for (unsigned int j = 0; j < total && j < EXT_SYSTEM_DIRECT_BLOCKS && ranges_count < EXT_SYSTEM_MAX_PREFETCH; j++){
+			if (inode_entry.i_block[j] == 0) continue;
+			ranges[ranges_count].offset = (off_t) inode_entry.i_block[j] * block_size;
+			ranges[ranges_count].size = block_size;
+			ranges_count++;
+		}
+	}
+	if (ranges_count > 0) VolumeIO_prefetch(fs->volume_io, ranges, ranges_count);
+}
+
+
+/***********************************************
+*
+* @Purpose: Task of the worker threads, walks a folder with the buffer of the worker
+* @Parameters: void *argument, ExtFindNode of the folder
+*              int worker, number of the worker running the task
+* @Return:  -
+*
+************************************************/
+static void Ext2System_scanTask(void *argument, int worker){
+	ExtFindNode *node = (ExtFindNode *) argument;
+	Ext2System_scanFolder(node->operation, node, node->inode, node->operation->scratch[worker], worker);
+}
+
+
+/***********************************************
+*
+* @Purpose: Looks for the files with any of the target names in a folder, deleting them for /delete.
+*           Without worker threads the results are shown at once and the subfolders are walked recursively;
+*           otherwise they are kept in the node of the folder and every subfolder becomes a new task
+* @Parameters: ExtFindOperation *operation, operation being executed
+*              ExtFindNode *node, results of the folder, NULL when walking recursively
+*              unsigned int dir_inode, inode of the folder
+*              unsigned char *scratch, buffer of one extent of directory blocks, NULL to allocate one
+*              int worker, number of the worker running the task
+* @Return:  -
 *
 ************************************************/
-void EX2System_findFile(char* filename, int volume_fd, ExtBlockData block, ExtInodeData inode, unsigned int root_inode){
-	BlockGroupDescriptorTable bg_descriptor_table;
+static void Ext2System_scanFolder(ExtFindOperation *operation, ExtFindNode *node, unsigned int dir_inode, unsigned char *scratch, int worker){
+	ExtFileSystem *fs = operation->fs;
+	VolumeIO *volume_io = fs->volume_io;
+	unsigned int block_size = fs->block.s_log_block_size;
 	InodeTableEntry inode_entry;
-	DirEntry directory_entry;
-	directory_entry.file_type = EXT2_FT_INIT;
-	unsigned int dir_entry_block_position = 0;
-	unsigned short ptr_inode_name = 0;
-	unsigned short prev_dir_len = 0;
-
-	// Filling the block group descriptor table that contains info about the inode bitmaps and tables
-	Ext2System_fillBlockGroupDescriptorTable(volume_fd, block.s_log_block_size, &bg_descriptor_table );
-
-	// Finding the inode entry from the table given the block descriptor and the current root inode ( for recusive calls, the root needs to be changed)
-	inode_entry = Ext2System_findAndGetInode(root_inode,&bg_descriptor_table, block, inode, volume_fd );
-	/*
-	printf("%s\n%d\n", filename, block.s_log_block_size);
-
-	printf("Inode size: %d\n", inode_entry.i_size);
-	printf("Inode blocks: %d\n", inode_entry.i_blocks);
-	for (int i = 0; i < 15; i++){
-		printf("Block num %d: %d\n", i, inode_entry.i_block[i]);
-	}*/
-
-	// Iterating through the 12 direct blocks of the inode
-	for(int i = 0; i < 12 && ptr_inode_name < inode_entry.i_size; i++){
-		if(inode_entry.i_block[i] != 0){
-			// Computing the position of the directory entry
-			dir_entry_block_position = inode_entry.i_block[i] * block.s_log_block_size;
-			// Iterating through the linked list of directory entries until the entry type is Unknown (i.e. until the last one from the list)
-			for(int j = 0; directory_entry.file_type != EXT2_FT_UNKNOWN && ptr_inode_name < inode_entry.i_size; j++ ){
-					prev_dir_len = directory_entry.rec_len;
-					// Reading the directory entry
-					directory_entry = Ext2System_readDirEntry(volume_fd, &ptr_inode_name,  dir_entry_block_position);
-					// Safe checking that the pointer to the next inode name does not go beyond the size of the inode
-					if (ptr_inode_name > inode_entry.i_size)	break;
-					// Checking if the name is the same and it is not a directory
-					if(strcmp(directory_entry.name,filename) == 0 && Ext2System_isDirectory(directory_entry.name, directory_entry.file_type) == 0){
-							if(isDelete == 1){
-									Ext2System_deleteEntry(ptr_inode_name,dir_entry_block_position, prev_dir_len, directory_entry, volume_fd);
-							}else{
-								//printf("Inode for this file: %d\n", directory_entry.inode);
-								// finding the inode in the file system to get its size, instead of first inode, here its the inode from the directory entry
-								InodeTableEntry aux_inode = Ext2System_findAndGetInode(directory_entry.inode, &bg_descriptor_table,  block,  inode,  volume_fd );
-								printf("The file %s has %d bytes\n", directory_entry.name, aux_inode.i_size);
-								//printf("Inode size: %d bytes\n", aux_inode.i_size);
-							}
-							isFound = 1;
+	ExtBlockMap block_map;
+	ExtExtent extent;
+	DirBlockParser parser;
+	DirEntryView directory_entry;
+	unsigned long long dir_entry_block_position = 0;
+	unsigned long long size;
+	Target *target;
+	char found_name[EXT_SYSTEM_MAX_NAME + 1];
+	ExtFindNode *child;
+	const unsigned char *dir_blocks;
+	unsigned char *buffer = scratch;
+	unsigned long long decoded = 0;
+
+	// Finding the inode entry of the folder
+	inode_entry = Ext2System_findAndGetInode(fs, dir_inode);
+
+	// The recursive walk needs a buffer per recursion level, the workers reuse their own one
+	if (buffer == NULL){
+		buffer = (unsigned char *) malloc((size_t) EXT_SYSTEM_MAX_EXTENT_BLOCKS * block_size);
+		if (buffer == NULL) return;
+	}
+	if (Ext2System_initBlockMap(&block_map, fs, &inode_entry) < 0){
+		if (buffer != scratch) free(buffer);
+		return;
+	}
+
+	// Iterating through all the blocks of the directory (direct and indirect), a run of contiguous blocks at a time
+	while (Ext2System_nextExtent(&block_map, &extent, EXT_SYSTEM_MAX_EXTENT_BLOCKS)){
+		// Holes do not have directory entries
+		if (extent.physical == 0) continue;
+		dir_blocks = (const unsigned char *) VolumeIO_view(volume_io, extent.physical * block_size, (size_t) extent.count * block_size, buffer);
+		if (dir_blocks == NULL) continue;
+		Ext2System_prefetchFolders(fs, dir_blocks, extent.count);
+		for (unsigned int i = 0; i < extent.count; i++){
+			// Computing the position of the directory block, the entries never cross a block
+			dir_entry_block_position = (extent.physical + i) * block_size;
+			Ext2System_initDirBlock(&parser, dir_blocks + (size_t) i * block_size, block_size);
+			// Iterating through the linked list of directory entries of the block
+			while (Ext2System_nextDirEntry(&parser, &directory_entry)){
+				decoded++;
+				// Checking if the name is one of the targets, or matches one of the patterns, and it is not a directory
+				target = TargetSet_match(operation->targets, directory_entry.name, directory_entry.name_len);
+				if (target != NULL && Ext2System_isDirectory(&directory_entry) == 0 && Ext2System_isDotEntry(&directory_entry) == 0){
+					size = 0;
+					// The file of a pattern is shown with its own name, taken before the entry is deleted
+					if (target->is_pattern){
+						memcpy(found_name, directory_entry.name, directory_entry.name_len);
+						found_name[directory_entry.name_len] = '\0';
+					}
+					if (operation->is_delete == 1){
+						Ext2System_deleteEntry(volume_io, dir_entry_block_position, &parser, &directory_entry);
+					}else{
+						// The size is in the inode of the entry
+						InodeTableEntry aux_inode = Ext2System_findAndGetInode(fs, directory_entry.inode);
+						size = Ext2System_getInodeSize(&aux_inode);
+					}
+					if (node == NULL){
+						Ext2System_reportFile(operation, target, target->is_pattern ? found_name : NULL, size);
+					}else{
+						Ext2System_addFindItem(node, target, target->is_pattern ? found_name : NULL, directory_entry.name_len, size, NULL);
+					}
+				}
+				if (Ext2System_isDirectory(&directory_entry) == 1){
+					if (node == NULL){
+						Ext2System_scanFolder(operation, NULL, directory_entry.inode, NULL, worker);
+						continue;
 					}
-					// Recursive calls when it is a directory
-					if(Ext2System_isDirectory(directory_entry.name, directory_entry.file_type) == 1){
-						//printf("\nDepth\n\n");
-						EX2System_findFile(filename, volume_fd, block, inode, directory_entry.inode);
+					// The subfolder keeps its place among the results even if another worker walks it
+					child = Ext2System_createFindNode(operation, directory_entry.inode);
+					if (child == NULL || Ext2System_addFindItem(node, NULL, NULL, 0, 0, child) < 0){
+						free(child);
+						continue;
 					}
+					if (WorkPool_submit(operation->pool, worker, Ext2System_scanTask, child) < 0){
+						// Walking it here with a buffer of its own, the buffer of the worker is still in use
+						Ext2System_scanFolder(operation, child, child->inode, NULL, worker);
+					}
+				}
 			}
 		}
 	}
-	//printf("\nBack\n\n");
+	Ext2System_freeBlockMap(&block_map);
+	if (buffer != scratch) free(buffer);
+	OpStats_addFolder(fs->stats);
+	OpStats_addEntries(fs->stats, decoded);
 }
 
 
+/***********************************************
+*
+* @Purpose: Looks for the files with any of the target names in the whole volume, showing their size or
+*           deleting them. All the files with a name are found, not only the first one. With several threads
+*           every folder is walked by a task of a work stealing pool, and the results are shown at the end
+*           in the same order as the recursive walk
+* @Parameters: TargetSet *targets, names of the files looked for
+*              ExtFileSystem *fs, Ext2 volume
+*              int is_delete, 1 to delete the files found, 0 to show their size
+* @Return:  -
+*
+************************************************/
+void EX2System_findFile(TargetSet *targets, ExtFileSystem *fs, int is_delete){
+	ExtFindOperation operation;
+	ExtFindNode *root = NULL;
+	size_t scratch_size = (size_t) EXT_SYSTEM_MAX_EXTENT_BLOCKS * fs->block.s_log_block_size;
+	int threads = 0;
+
+	bzero(&operation, sizeof(ExtFindOperation));
+	operation.fs = fs;
+	operation.targets = targets;
+	operation.is_delete = is_delete;
+
+	if (fs->threads > 1){
+		operation.scratch = (unsigned char **) calloc(fs->threads, sizeof(unsigned char *));
+		if (operation.scratch != NULL){
+			for (threads = 0; threads < fs->threads; threads++){
+				operation.scratch[threads] = (unsigned char *) malloc(scratch_size);
+				if (operation.scratch[threads] == NULL) break;
+			}
+		}
+		root = Ext2System_createFindNode(&operation, EXT_SYSTEM_ROOT_INODE);
+		if (threads == fs->threads && root != NULL){
+			operation.pool = WorkPool_create(threads);
+		}
+	}
+
+	if (operation.pool != NULL && WorkPool_submit(operation.pool, WORK_POOL_NO_WORKER, Ext2System_scanTask, root) == 0){
+		WorkPool_wait(operation.pool);
+		Ext2System_reportFindNode(root);
+		root = NULL;
+	}else{
+		// Without threads, or if they could not be started, the folders are walked recursively
+		Ext2System_scanFolder(&operation, NULL, EXT_SYSTEM_ROOT_INODE, NULL, WORK_POOL_NO_WORKER);
+	}
+
+	WorkPool_destroy(operation.pool);
+	free(root);
+	for (int i = 0; i < threads; i++){
+		free(operation.scratch[i]);
+	}
+	free(operation.scratch);
+}
 
 
 /***********************************************
 *
-* @Purpose: Reads and fills the information of the block group descriptor table
-* @Parameters: int fd, file descriptor of the volume read
-*              unsigned int block_size, size of one block of the Ext2 system read
-*              BlockGroupDescriptorTable *bg_descriptor_table, block group descriptor table to be filled
-* @Return:  -
+* @Purpose: Walks all the entries of the volume, folders first visited and then entered, calling a visitor
+*           for every one of them with its path
+* @Parameters: ExtFileSystem *fs, Ext2 volume
+*              FileEntryVisitor visitor, function called for every entry
+*              void *context, data passed to the visitor
+* @Return: FILE_ENTRY_STOP if the visitor ended the walk, FILE_ENTRY_CONTINUE otherwise
 *
 ************************************************/
-void Ext2System_fillBlockGroupDescriptorTable(int fd, unsigned int block_size, 	BlockGroupDescriptorTable *bg_descriptor_table ){
-	// block descriptor table starts at block 2, that is, offset = size superblock + one block
-	lseek(fd, EXT_SYSTEM_SUPERBLOCK_OFFSET + block_size, SEEK_SET);
-	read(fd, bg_descriptor_table, (int)sizeof(BlockGroupDescriptorTable)); // Reading the whole structure of the block descriptor table
-	/*
-	printf("Size: %d", (int)sizeof(BlockGroupDescriptorTable));
-	printf("\n\n\n\n");
-	printf("block_num_block_bitmap: %d\nblock_num_inode_bitmap: %d\n", bg_descriptor_table->bg_block_bitmap, bg_descriptor_table->bg_inode_bitmap);
-	printf("block_num_first_indode_table_block: %d\nnum_free_blocks_group: %hu\n", bg_descriptor_table->bg_inode_table, bg_descriptor_table->bg_free_blocks_count);
-	printf("num_free_inodes_group: %hu\nnum_dir_group: %hu\n", bg_descriptor_table->bg_free_inodes_count, bg_descriptor_table->bg_used_dirs_count);
-	printf("alignment_to_word: %hu\n", bg_descriptor_table->bg_pad);
-	printf("\n\n\n\n");*/
+int Ext2System_walk(ExtFileSystem *fs, FileEntryVisitor visitor, void *context){
+	char path[FILE_ENTRY_MAX_PATH];
 
+	path[0] = '\0';
+	return Ext2System_walkDirectory(fs, EXT_SYSTEM_ROOT_INODE, path, 0, visitor, context);
 }
 
 
 /***********************************************
 *
-* @Purpose: Function that gets the inode number from the inode table, (the formulas come from the page 22/34 of the documentation),
-*           and returns the inode entry  from the inode table
-* @Parameters: unsigned int first_inode, root inode from where this inode is located
-*              int fd, file descriptor of the volume read
-*              BlockGroupDescriptorTable *bg_descriptor_table, structure with the infomation of the block group descriptor
-*              ExtBlockData block, structure with the information about a block
-*              ExtInodeData inode, structure with the information about an inode
-* @Return:  InodeTableEntry with the data from the inode entry from the inode table
+* @Purpose: Recursive part of Ext2System_walk, walks the entries of a folder
+* @Parameters: ExtFileSystem *fs, Ext2 volume
+*              unsigned int dir_inode, inode of the folder
+*              char *path, FILE_ENTRY_MAX_PATH bytes holding the path of the folder, the names are appended to it
+*              size_t path_len, length of the path of the folder
+*              FileEntryVisitor visitor, function called for every entry
+*              void *context, data passed to the visitor
+* @Return: FILE_ENTRY_STOP if the visitor ended the walk, FILE_ENTRY_CONTINUE otherwise
 *
 ************************************************/
-InodeTableEntry Ext2System_findAndGetInode(unsigned int first_inode, BlockGroupDescriptorTable *bg_descriptor_table, ExtBlockData block, ExtInodeData inode, int volume_fd ){
-	unsigned int inode_number = (first_inode - 1) % inode.s_inodes_per_group;																					// Inode number (from formula)
+static int Ext2System_walkDirectory(ExtFileSystem *fs, unsigned int dir_inode, char *path, size_t path_len, FileEntryVisitor visitor, void *context){
+	unsigned int block_size = fs->block.s_log_block_size;
+	InodeTableEntry inode_entry;
+	ExtBlockMap block_map;
+	ExtExtent extent;
+	DirBlockParser parser;
+	DirEntryView directory_entry;
+	FileEntry entry;
+	const unsigned char *dir_blocks;
+	unsigned char *scratch;
+	int result = FILE_ENTRY_CONTINUE;
+	unsigned long long decoded = 0;
+
+	inode_entry = Ext2System_findAndGetInode(fs, dir_inode);
+	// Buffer holding one extent of directory blocks when the volume is not mapped, one per recursion level
+	scratch = (unsigned char *) malloc((size_t) EXT_SYSTEM_MAX_EXTENT_BLOCKS * block_size);
+	if (scratch == NULL) return FILE_ENTRY_CONTINUE;
+	if (Ext2System_initBlockMap(&block_map, fs, &inode_entry) < 0){
+		free(scratch);
+		return FILE_ENTRY_CONTINUE;
+	}
 
-	unsigned int block_group_number  = (first_inode - 1) / inode.s_inodes_per_group; 							// Block group number (from formula)
-	unsigned int block_group_offset  = block_group_number * block.s_blocks_per_group * block.s_log_block_size; 				// block offset as block group * blocks per group * block size
+	memset(&entry, 0, sizeof(entry));
+	entry.path = path;
+	entry.name = path + path_len + 1;
+	while (result != FILE_ENTRY_STOP && Ext2System_nextExtent(&block_map, &extent, EXT_SYSTEM_MAX_EXTENT_BLOCKS)){
+		if (extent.physical == 0) continue;
+		dir_blocks = (const unsigned char *) VolumeIO_view(fs->volume_io, extent.physical * block_size, (size_t) extent.count * block_size, scratch);
+		if (dir_blocks == NULL) continue;
+		Ext2System_prefetchFolders(fs, dir_blocks, extent.count);
+		for (unsigned int i = 0; i < extent.count && result != FILE_ENTRY_STOP; i++){
+			Ext2System_initDirBlock(&parser, dir_blocks + (size_t) i * block_size, block_size);
+			while (result != FILE_ENTRY_STOP && Ext2System_nextDirEntry(&parser, &directory_entry)){
+				decoded++;
+				// Skipping the "." and ".." entries and the names that do not fit in the path
+				if (Ext2System_isDotEntry(&directory_entry) || path_len + 1 + directory_entry.name_len >= FILE_ENTRY_MAX_PATH) continue;
+				path[path_len] = '/';
+				memcpy(path + path_len + 1, directory_entry.name, directory_entry.name_len);
+				path[path_len + 1 + directory_entry.name_len] = '\0';
+
+				inode_entry = Ext2System_findAndGetInode(fs, directory_entry.inode);
+				entry.id = directory_entry.inode;
+				// Symbolic links, devices, FIFOs and sockets are neither files nor folders
+				if ((inode_entry.i_mode & EXT_SYSTEM_MODE_TYPE_MASK) == EXT_SYSTEM_MODE_REGULAR){
+					entry.type = FILE_ENTRY_FILE;
+				}else if ((inode_entry.i_mode & EXT_SYSTEM_MODE_TYPE_MASK) == EXT_SYSTEM_MODE_DIRECTORY){
+					entry.type = FILE_ENTRY_DIRECTORY;
+				}else{
+					entry.type = FILE_ENTRY_OTHER;
+				}
+				entry.size = Ext2System_getInodeSize(&inode_entry);
+				entry.mtime = inode_entry.i_mtime;
+				entry.atime = inode_entry.i_atime;
+				entry.aux_position = (extent.physical + i) * block_size;
+				entry.position = entry.aux_position + directory_entry.offset;
+				result = visitor(&entry, context);
+				if (result == FILE_ENTRY_CONTINUE && entry.type == FILE_ENTRY_DIRECTORY){
+					result = Ext2System_walkDirectory(fs, directory_entry.inode, path, path_len + 1 + directory_entry.name_len, visitor, context);
+				}
+			}
+		}
+	}
+	path[path_len] = '\0';
+	Ext2System_freeBlockMap(&block_map);
+	free(scratch);
+	OpStats_addFolder(fs->stats);
+	OpStats_addEntries(fs->stats, decoded);
+	return result == FILE_ENTRY_STOP ? FILE_ENTRY_STOP : FILE_ENTRY_CONTINUE;
+}
 
-	// Pointing to the exact position: position of the block group + position of the table + position in the table
-	unsigned int global_inode_position = block_group_offset + bg_descriptor_table->bg_inode_table * block.s_log_block_size + inode_number * inode.s_inode_size;
 
+/***********************************************
+*
+* @Purpose: Walker passed to the name index to build it
+* @Parameters: void *fs, ExtFileSystem of the volume
+*              FileEntryVisitor visitor, function called for every entry
+*              void *context, data passed to the visitor
+* @Return: FILE_ENTRY_STOP if the visitor ended the walk, FILE_ENTRY_CONTINUE otherwise
+*
+************************************************/
+static int Ext2System_indexWalker(void *fs, FileEntryVisitor visitor, void *context){
+	return Ext2System_walk((ExtFileSystem *) fs, visitor, context);
+}
 
-	InodeTableEntry inode_entry;
-	//printf("global inode pos: %d\n", global_inode_position);
-	//printf("first inode: %d\ninode number: ", first_inode);
-
-	// Read the entry in the inode table
-	lseek(volume_fd, global_inode_position, SEEK_SET);
-	read(volume_fd, &inode_entry, sizeof(InodeTableEntry));
-	/*
-	printf("Inode size: %d\n", inode_entry.i_size);
-	printf("Inode blocks: %d\n", inode_entry.i_blocks);
-	for (int i = 0; i < 15; i++){
-		printf("Block num %d: %d\n", i, inode_entry.i_block[i]);
-	}*/
 
-	return inode_entry;
+/***********************************************
+*
+* @Purpose: Sets the name index file used by /find and /delete. It is built the first time it is needed
+* @Parameters: ExtFileSystem *fs, Ext2 volume
+*              const char *index_path, path of the index file, NULL to walk the volume every time
+* @Return: -
+*
+************************************************/
+void Ext2System_setIndex(ExtFileSystem *fs, const char *index_path){
+	fs->index_path = index_path;
 }
 
 
 /***********************************************
 *
-* @Purpose: Reads the directory entry given the pointer to the position and the pointer to the directory
-* @Parameters: int fd, file descriptor of the volume read
-*              unsigned short *ptr_inode_name, pointer to the entry inside the directory entry
-*              int dir_entry_block_position, pointer to the directory entry
-* @Return:  DirEntry structure containing the information about the directory entry read
+* @Purpose: Sets the statistics where the folders and entries read by the operation are counted
+* @Parameters: ExtFileSystem *fs, Ext2 volume
+*              OpStats *stats, statistics of the operation, NULL not to collect them
+* @Return: -
 *
 ************************************************/
-DirEntry Ext2System_readDirEntry(int volume_fd, unsigned short *ptr_inode_name, int dir_entry_block_position){
-	DirEntry directory_entry;
-	lseek(volume_fd, dir_entry_block_position + *ptr_inode_name, SEEK_SET);
-	read(volume_fd, &directory_entry.inode, sizeof(int));
-	read(volume_fd, &directory_entry.rec_len, sizeof(short));
-	read(volume_fd, &directory_entry.name_len, sizeof(char));
-	read(volume_fd, &directory_entry.file_type, sizeof(char));
-	read(volume_fd, directory_entry.name, directory_entry.name_len);
-	directory_entry.name[(int)directory_entry.name_len] = '\0';
-	//printf("File name: %s, file type: %d\n", directory_entry.name,directory_entry.file_type );
-	// Pointing to the next directory entry
-	*ptr_inode_name = *ptr_inode_name + directory_entry.rec_len;
-	return directory_entry;
+void Ext2System_setStats(ExtFileSystem *fs, OpStats *stats){
+	fs->stats = stats;
 }
 
 
 /***********************************************
 *
-* @Purpose: Checks if the file specified is a directory given its name and type
-* @Parameters: int file_type, file type
-*              char *filename, name of the inode
-* @Return:  integer with 1 if it is a directory, 0 otherwise
+* @Purpose: Sets whether /info counts the free blocks and inodes from the bitmaps of the groups
+* @Parameters: ExtFileSystem *fs, Ext2 volume
+*              int check_bitmaps, 1 to count them, 0 to show the counts of the superblock only
+* @Return: -
+*
+************************************************/
+void Ext2System_setBitmapCheck(ExtFileSystem *fs, int check_bitmaps){
+	fs->check_bitmaps = check_bitmaps;
+}
+
+
+/***********************************************
+*
+* @Purpose: Sets the file /extract writes to
+* @Parameters: ExtFileSystem *fs, Ext2 volume
+*              int output_fd, descriptor of the file, written at its current position
+* @Return: -
+*
+************************************************/
+void Ext2System_setOutput(ExtFileSystem *fs, int output_fd){
+	fs->output_fd = output_fd;
+}
+
+
+/***********************************************
+*
+* @Purpose: Sets the format of the lines written by /ls
+* @Parameters: ExtFileSystem *fs, volume
+*              int list_format, LIST_OUTPUT_JSON or LIST_OUTPUT_TSV
+* @Return: -
+*
+************************************************/
+void Ext2System_setListFormat(ExtFileSystem *fs, int list_format){
+	fs->list_format = list_format;
+}
+
+
+/***********************************************
+*
+* @Purpose: Sets the conditions of /scan so that every inode meets them
+* @Parameters: SimdInodeFilter *filter, conditions
+* @Return: -
 *
 ************************************************/
-int Ext2System_isDirectory(char *filename, int file_type){
-	return file_type == EXT2_FT_DIR && strcmp (filename, "..") != 0 && strcmp (filename, ".") != 0;
+void Ext2System_initScanFilter(SimdInodeFilter *filter){
+	filter->min_size = 0;
+	filter->max_size = ULLONG_MAX;
+	filter->min_mtime = 0;
+	filter->max_mtime = UINT_MAX;
+	filter->min_links = 0;
+	filter->max_links = EXT_SYSTEM_MAX_LINKS;
+	filter->mode_mask = 0;
+	filter->mode_value = 0;
 }
 
 
 /***********************************************
 *
-* @Purpose: Checks if the file has been found or not
-* @Parameters: -
+* @Purpose: Narrows an inclusive range with a comparison. A range that cannot be met is left as [1, 0]
+* @Parameters: unsigned long long *min, lower bound of the range
+*              unsigned long long *max, upper bound of the range
+*              char comparison, '<', '>' or '=' (the last one also for '<=' and '>=' together with or_equal)
+*              int or_equal, 1 for '<=' and '>='
+*              unsigned long long value, value compared
+*              unsigned long long limit, largest value the field can hold
+* @Return: -
+*
+************************************************/
+static void Ext2System_narrowRange(unsigned long long *min, unsigned long long *max, char comparison, int or_equal, unsigned long long value,
+		unsigned long long limit){
+	int empty = 0;
+
+	if (comparison == '<' && !or_equal){
+		if (value == 0) empty = 1;
+		value--;
+	}else if (comparison == '>' && !or_equal){
+		if (value == ULLONG_MAX) empty = 1;
+		value++;
+	}
+	if (comparison != '>' && value < *max) *max = value;
+	if (comparison != '<' && value > *min) *min = value;
+	if (*max > limit) *max = limit;
+	if (empty || *min > *max){
+		*min = 1;
+		*max = 0;
+	}
+}
+
+
+/***********************************************
 *
-* @Return:  returns the value of the global variable isFound
+* @Purpose: Reads the value of a size, in bytes or with a K, M, G or T suffix (powers of 1024)
+* @Parameters: const char *text, value
+*              unsigned long long *value, size read
+* @Return: 0 on success, -1 if the text is not a size
 *
 ************************************************/
-int Ext2System_isFound(){
-	return isFound;
+static int Ext2System_parseSize(const char *text, unsigned long long *value){
+	const char *suffixes = "KMGT";
+	const char *suffix;
+	char *end;
+	int shift = 0;
+
+	if (*text < '0' || *text > '9') return -1;
+	errno = 0;
+	*value = strtoull(text, &end, 10);
+	if (errno != 0) return -1;
+	if (*end != '\0'){
+		suffix = strchr(suffixes, *end);
+		if (suffix == NULL || end[1] != '\0') return -1;
+		shift = 10 * (int) (suffix - suffixes + 1);
+		if (*value > (ULLONG_MAX >> shift)) return -1;
+	}
+	*value <<= shift;
+	return 0;
 }
 
 
-// Linked list: prev->curr->"next"
-// Here we read the prev  dir entry, and point to the "next" dir entry skipping the curr, as the curr is the one to be deleted
-void Ext2System_deleteEntry(unsigned short ptr_next_inode_name, unsigned int dir_entry_block_position, unsigned short prev_dir_len, DirEntry directory_entry, int volume_fd){
-	DirEntry aux_dir_entry;
-	unsigned int ptr_prev_dir_entry = ptr_next_inode_name - directory_entry.rec_len - prev_dir_len;
-	unsigned int ptr_curr_dir_entry = ptr_next_inode_name - directory_entry.rec_len;
+/***********************************************
+*
+* @Purpose: Adds a condition to the ones /scan checks. A condition is a field, a comparison and a value:
+*           size (bytes, or with a K, M, G or T suffix), mtime (seconds since 1970) and links take <, <=, >, >=
+*           and =, type (file, dir or link) and mode (permission bits in octal) only take =. The conditions add up,
+*           so size>1M size<10M keeps the sizes in between
+* @Parameters: SimdInodeFilter *filter, conditions, set up with Ext2System_initScanFilter
+*              const char *condition, condition added, for example "size>=100M" or "type=file"
+* @Return: 0 on success, -1 if the condition cannot be understood
+*
+************************************************/
+int Ext2System_parseScanFilter(SimdInodeFilter *filter, const char *condition){
+	size_t field_len = strcspn(condition, "<>=");
+	const char *value = condition + field_len;
+	char comparison = *value, *end;
+	unsigned long long number, min, max;
+	unsigned int mask, bits;
+	int or_equal = 0;
+
+	if (field_len == 0 || comparison == '\0') return -1;
+	value++;
+	if (comparison != '=' && *value == '='){
+		or_equal = 1;
+		value++;
+	}
+	if (*value == '\0') return -1;
+
+	if (field_len == strlen("type") && strncmp(condition, "type", field_len) == 0){
+		if (comparison != '=') return -1;
+		mask = EXT_SYSTEM_MODE_TYPE_MASK;
+		if (strcmp(value, "file") == 0){
+			bits = EXT_SYSTEM_MODE_REGULAR;
+		}else if (strcmp(value, "dir") == 0){
+			bits = EXT_SYSTEM_MODE_DIRECTORY;
+		}else if (strcmp(value, "link") == 0){
+			bits = EXT_SYSTEM_MODE_SYMLINK;
+		}else{
+			return -1;
+		}
+	}else if (field_len == strlen("mode") && strncmp(condition, "mode", field_len) == 0){
+		if (comparison != '=' || *value < '0' || *value > '7') return -1;
+		number = strtoull(value, &end, 8);
+		if (*end != '\0' || number > EXT_SYSTEM_MODE_PERMISSIONS) return -1;
+		mask = EXT_SYSTEM_MODE_PERMISSIONS;
+		bits = (unsigned int) number;
+	}else{
+		if (Ext2System_parseSize(value, &number) < 0) return -1;
+		if (field_len == strlen("size") && strncmp(condition, "size", field_len) == 0){
+			Ext2System_narrowRange(&filter->min_size, &filter->max_size, comparison, or_equal, number, ULLONG_MAX);
+			return 0;
+		}
+		// Only the sizes take a suffix
+		if (value[strlen(value) - 1] < '0' || value[strlen(value) - 1] > '9') return -1;
+		if (field_len == strlen("mtime") && strncmp(condition, "mtime", field_len) == 0){
+			min = filter->min_mtime;
+			max = filter->max_mtime;
+			Ext2System_narrowRange(&min, &max, comparison, or_equal, number, UINT_MAX);
+			filter->min_mtime = (unsigned int) min;
+			filter->max_mtime = (unsigned int) max;
+		}else if (field_len == strlen("links") && strncmp(condition, "links", field_len) == 0){
+			min = filter->min_links;
+			max = filter->max_links;
+			Ext2System_narrowRange(&min, &max, comparison, or_equal, number, EXT_SYSTEM_MAX_LINKS);
+			filter->min_links = (unsigned int) min;
+			filter->max_links = (unsigned int) max;
+		}else{
+			return -1;
+		}
+		return 0;
+	}
+
+	// Two types, or two sets of permissions, cannot hold at once: no inode has to match
+	if ((filter->mode_mask & mask) != 0 && (filter->mode_value & mask) != bits){
+		filter->min_links = 1;
+		filter->max_links = 0;
+	}
+	filter->mode_mask |= mask;
+	filter->mode_value = (filter->mode_value & ~mask) | bits;
+	return 0;
+}
 
 
-	printf("File %s deleted\n", directory_entry.name);
+/***********************************************
+*
+* @Purpose: Sets the conditions the inodes listed by /scan meet
+* @Parameters: ExtFileSystem *fs, volume
+*              const SimdInodeFilter *filter, conditions read with Ext2System_parseScanFilter
+* @Return: -
+*
+************************************************/
+void Ext2System_setScanFilter(ExtFileSystem *fs, const SimdInodeFilter *filter){
+	fs->scan_filter = *filter;
+}
 
-	// Reading the prev dir entry
-	lseek(volume_fd, dir_entry_block_position + ptr_prev_dir_entry, SEEK_SET);
-	read(volume_fd, &aux_dir_entry.inode, sizeof(int));
-	read(volume_fd, &aux_dir_entry.rec_len, sizeof(short));
-	read(volume_fd, &aux_dir_entry.name_len, sizeof(char));
-	read(volume_fd, &aux_dir_entry.file_type, sizeof(char));
-	read(volume_fd, aux_dir_entry.name, aux_dir_entry.name_len);
-	aux_dir_entry.name[(int)aux_dir_entry.name_len] = '\0';
 
+/***********************************************
+*
+* @Purpose: Counts the free blocks and inodes of every group from its bitmaps and shows them, together with the
+*           groups whose descriptor has other counts and the differences with the counts of the superblock
+* @Parameters: ExtFileSystem *fs, Ext2 volume
+* @Return: -
+*
+************************************************/
+void Ext2System_checkBitmaps(ExtFileSystem *fs){
+	unsigned int block_size = fs->block.s_log_block_size;
+	unsigned long long data_blocks = fs->block.s_blocks_count - fs->block.s_first_data_block;
+	unsigned long long free_blocks = 0, free_inodes = 0, blocks, used;
+	unsigned int group_free_blocks, group_free_inodes;
+	const unsigned char *bitmap;
+	unsigned char *scratch;
+	int mismatches = 0, unreadable = 0;
+
+	scratch = (unsigned char *) malloc(block_size);
+	if (scratch == NULL) return;
+	printf("\nINFO BITMAPS\nGroups: %u\nCounted with: %s\n", fs->group_count, Simd_getLevelName());
+	for (unsigned int group = 0; group < fs->group_count; group++){
+		// The last group can be shorter, and its bitmap has the bits after its last block set
+		blocks = data_blocks - (unsigned long long) group * fs->block.s_blocks_per_group;
+		if (blocks > fs->block.s_blocks_per_group) blocks = fs->block.s_blocks_per_group;
+		if (blocks > (unsigned long long) block_size * 8 || fs->inode.s_inodes_per_group > block_size * 8){
+			unreadable++;
+			continue;
+		}
 
-	// The previous directory entry size must be equal to the its size plus the current one that we want to delete
-	aux_dir_entry.rec_len = aux_dir_entry.rec_len + directory_entry.rec_len;
-	// Write the new rec_len field
-	lseek(volume_fd, dir_entry_block_position + ptr_prev_dir_entry + sizeof(int), SEEK_SET);
-	write(volume_fd, &aux_dir_entry.rec_len, sizeof(short));
+		bitmap = (const unsigned char *) VolumeIO_view(fs->volume_io, (off_t) fs->groups[group].bg_block_bitmap * block_size, block_size, scratch);
+		if (bitmap == NULL){
+			unreadable++;
+			continue;
+		}
+		used = Simd_countBits(bitmap, blocks);
+		group_free_blocks = (unsigned int) (blocks - used);
 
+		bitmap = (const unsigned char *) VolumeIO_view(fs->volume_io, (off_t) fs->groups[group].bg_inode_bitmap * block_size, block_size, scratch);
+		if (bitmap == NULL){
+			unreadable++;
+			continue;
+		}
+		used = Simd_countBits(bitmap, fs->inode.s_inodes_per_group);
+		group_free_inodes = (unsigned int) (fs->inode.s_inodes_per_group - used);
+
+		free_blocks += group_free_blocks;
+		free_inodes += group_free_inodes;
+		if (group_free_blocks != fs->groups[group].bg_free_blocks_count || group_free_inodes != fs->groups[group].bg_free_inodes_count){
+			printf("Group %u: %u free blocks and %u free inodes, the descriptor says %u and %u\n", group, group_free_blocks,
+					group_free_inodes, fs->groups[group].bg_free_blocks_count, fs->groups[group].bg_free_inodes_count);
+			mismatches++;
+		}
+	}
+	free(scratch);
+
+	printf("Free blocks: %llu (superblock: %u)\nFree inodes: %llu (superblock: %u)\n", free_blocks, fs->block.s_free_blocks_count,
+			free_inodes, fs->inode.s_free_inodes_count);
+	if (unreadable > 0){
+		printf("%d groups could not be counted\n", unreadable);
+	}else if (mismatches == 0 && free_blocks == fs->block.s_free_blocks_count && free_inodes == fs->inode.s_free_inodes_count){
+		printf("The bitmaps match the superblock and the group descriptors\n");
+	}else{
+		printf("The bitmaps do not match the counts of the volume: %d groups differ from their descriptor\n", mismatches);
+	}
+}
 
-	// Going to the curr dir position and deleting all the entries there
-	lseek(volume_fd, dir_entry_block_position + ptr_curr_dir_entry, SEEK_SET);
-	bzero( &aux_dir_entry.inode, sizeof(int));
-	bzero( &aux_dir_entry.rec_len, sizeof(short));
-	bzero( aux_dir_entry.name, aux_dir_entry.name_len);
-	bzero( &aux_dir_entry.name_len, sizeof(char));
-	bzero( &aux_dir_entry.file_type, sizeof(char));
-	write(volume_fd, &aux_dir_entry, sizeof(int) + sizeof(short) + sizeof(char) + sizeof(char));
 
+/***********************************************
+*
+* @Purpose: Gets the name index of the volume, building it if it does not match the last write of the volume
+* @Parameters: ExtFileSystem *fs, Ext2 volume
+* @Return: the index, NULL if no index is used or it cannot be built
+*
+************************************************/
+static NameIndex *Ext2System_loadIndex(ExtFileSystem *fs){
+	if (fs->index_path == NULL) return NULL;
+	return NameIndex_load(fs->index_path, NAME_INDEX_FS_EXT2, fs->volume.s_wtime, Ext2System_indexWalker, fs);
+}
+
+
+/***********************************************
+*
+* @Purpose: Finds the next record of the name index of a target: the files with its name, or the files whose
+*           name matches it for a pattern. As in the walk, a file is taken by its name or by the first pattern it
+*           matches, so that it is not shown twice
+* @Parameters: Target *target, target looked for
+*              TargetSet *targets, set of the target
+*              NameIndex *index, index of the volume
+*              NameIndexRecord *previous, record returned by the previous call, NULL to get the first one
+* @Return: the next record, NULL if there are no more
+*
+************************************************/
+static NameIndexRecord *Ext2System_nextIndexed(Target *target, TargetSet *targets, NameIndex *index, NameIndexRecord *previous){
+	NameIndexRecord *record = previous;
+	const char *name;
+
+	if (!target->is_pattern){
+		return NameIndex_find(index, target->name, previous);
+	}
+	while ((record = NameIndex_findPattern(index, target->pattern, target->upper_pattern, record)) != NULL){
+		name = NameIndex_getString(index, record->name);
+		if (TargetSet_match(targets, name, strlen(name)) == target) return record;
+	}
+	return NULL;
+}
+
+
+/***********************************************
+*
+* @Purpose: Finds files through the name index, showing the size of every file with each of the names
+* @Parameters: TargetSet *targets, names of the files
+*              NameIndex *index, index of the volume
+* @Return: -
+*
+************************************************/
+static void Ext2System_findIndexed(TargetSet *targets, NameIndex *index){
+	NameIndexRecord *record;
+	Target *target;
+
+	for (int i = 0; i < targets->count; i++){
+		target = &targets->targets[i];
+		record = NULL;
+		while ((record = Ext2System_nextIndexed(target, targets, index, record)) != NULL){
+			printf("The file %s has %llu bytes\n", target->is_pattern ? NameIndex_getString(index, record->name) : target->name, record->size);
+			TargetSet_setFound(targets, target);
+		}
+	}
+}
+
+
+/***********************************************
+*
+* @Purpose: Deletes the files with the target names found through the name index, and marks them as deleted in it
+* @Parameters: TargetSet *targets, names of the files
+*              ExtFileSystem *fs, Ext2 volume
+*              NameIndex *index, index of the volume
+* @Return: 1 on success, 0 if an entry of the index does not match the volume
+*
+************************************************/
+static int Ext2System_deleteIndexed(TargetSet *targets, ExtFileSystem *fs, NameIndex *index){
+	NameIndexRecord *record;
+	Target *target;
+	const char *name;
+
+	for (int i = 0; i < targets->count; i++){
+		target = &targets->targets[i];
+		record = NULL;
+		while ((record = Ext2System_nextIndexed(target, targets, index, record)) != NULL){
+			name = target->is_pattern ? NameIndex_getString(index, record->name) : target->name;
+			if (Ext2System_deleteAt(fs, record->aux_position, record->position - record->aux_position, record->id, name) == 0){
+				return 0;
+			}
+			printf("File %s deleted\n", name);
+			NameIndex_markDeleted(index, record);
+			TargetSet_setFound(targets, target);
+		}
+	}
+	return 1;
+}
+
+
+/***********************************************
+*
+* @Purpose: Deletes the directory entry at a known position, after checking that it is the expected one
+* @Parameters: ExtFileSystem *fs, Ext2 volume
+*              unsigned long long block_position, position of the directory block
+*              unsigned int offset, offset of the entry in the block
+*              unsigned int inode_number, inode the entry must point to
+*              const char *name, name the entry must have
+* @Return: 1 if the entry has been deleted, 0 if it is not in the block
+*
+************************************************/
+int Ext2System_deleteAt(ExtFileSystem *fs, unsigned long long block_position, unsigned int offset, unsigned int inode_number, const char *name){
+	unsigned int block_size = fs->block.s_log_block_size;
+	size_t name_len = strlen(name);
+	DirBlockParser parser;
+	DirEntryView directory_entry;
+	unsigned char *block;
+	int deleted = 0;
+
+	block = (unsigned char *) malloc(block_size);
+	if (block == NULL) return 0;
+	// The block is parsed from the start, the previous entry is needed to delete
+	if (VolumeIO_read(fs->volume_io, block_position, block, block_size) == (ssize_t) block_size){
+		Ext2System_initDirBlock(&parser, block, block_size);
+		while (Ext2System_nextDirEntry(&parser, &directory_entry) && directory_entry.offset <= offset){
+			if (directory_entry.offset == offset && directory_entry.inode == inode_number && directory_entry.name_len == name_len &&
+					memcmp(directory_entry.name, name, name_len) == 0){
+				Ext2System_deleteEntry(fs->volume_io, block_position, &parser, &directory_entry);
+				deleted = 1;
+				break;
+			}
+		}
+	}
+	free(block);
+	return deleted;
+}
+
+
+/***********************************************
+*
+* @Purpose: Looks for a name among the entries of a directory block
+* @Parameters: OpStats *stats, statistics where the entries decoded are counted, NULL if they are not collected
+*              const unsigned char *data, content of the directory block
+*              unsigned int block_size, size of the block
+*              const char *name, name looked for, it does not need to end with '\0'
+*              size_t name_len, length of the name
+*              DirEntryView *directory_entry, filled with the entry found
+* @Return:  1 if the name is in the block, 0 otherwise
+*
+************************************************/
+static int Ext2System_findInDirBlock(OpStats *stats, const unsigned char *data, unsigned int block_size, const char *name, size_t name_len, DirEntryView *directory_entry){
+	DirBlockParser parser;
+	unsigned long long decoded = 0;
+	int found = 0;
+
+	Ext2System_initDirBlock(&parser, data, block_size);
+	while (found == 0 && Ext2System_nextDirEntry(&parser, directory_entry)){
+		decoded++;
+		found = directory_entry->name_len == name_len && memcmp(directory_entry->name, name, name_len) == 0;
+	}
+	OpStats_addEntries(stats, decoded);
+	return found;
+}
+
+
+/***********************************************
+*
+* @Purpose: Fills the result of a lookup with the entry found
+* @Parameters: ExtDirLookup *result, result to be filled
+*              const DirEntryView *directory_entry, entry found
+*              unsigned long long block_position, position of the directory block of the entry
+* @Return:  -
+*
+************************************************/
+static void Ext2System_setLookup(ExtDirLookup *result, const DirEntryView *directory_entry, unsigned long long block_position){
+	result->inode = directory_entry->inode;
+	result->file_type = directory_entry->file_type;
+	result->block_position = block_position;
+	result->offset = directory_entry->offset;
+}
+
+
+/***********************************************
+*
+* @Purpose: Looks for a name reading all the blocks of a directory, a run of contiguous blocks at a time
+* @Parameters: ExtBlockMap *block_map, blocks of the directory
+*              const char *name, name looked for
+*              size_t name_len, length of the name
+*              unsigned char *scratch, buffer of EXT_SYSTEM_MAX_EXTENT_BLOCKS blocks
+*              ExtDirLookup *result, filled with the entry found
+* @Return:  1 if the name has been found, 0 otherwise
+*
+************************************************/
+static int Ext2System_lookupLinear(ExtBlockMap *block_map, const char *name, size_t name_len, unsigned char *scratch, ExtDirLookup *result){
+	ExtFileSystem *fs = block_map->fs;
+	unsigned int block_size = fs->block.s_log_block_size;
+	DirEntryView directory_entry;
+	ExtExtent extent;
+	const unsigned char *dir_blocks;
+
+	while (Ext2System_nextExtent(block_map, &extent, EXT_SYSTEM_MAX_EXTENT_BLOCKS)){
+		if (extent.physical == 0) continue;
+		dir_blocks = (const unsigned char *) VolumeIO_view(fs->volume_io, extent.physical * block_size, (size_t) extent.count * block_size, scratch);
+		if (dir_blocks == NULL) continue;
+		for (unsigned int i = 0; i < extent.count; i++){
+			if (Ext2System_findInDirBlock(fs->stats, dir_blocks + (size_t) i * block_size, block_size, name, name_len, &directory_entry)){
+				Ext2System_setLookup(result, &directory_entry, (extent.physical + i) * block_size);
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
+
+
+/***********************************************
+*
+* @Purpose: Reads a block of a directory given its position inside the directory
+* @Parameters: ExtBlockMap *block_map, blocks of the directory
+*              unsigned int logical, position of the block inside the directory
+*              unsigned char *buffer, buffer of one block used when the volume is not mapped
+*              unsigned long long *position, filled with the position of the block in the volume
+* @Return:  pointer to the content of the block, NULL if it is a hole, it is out of the directory or it cannot be read
+*
+************************************************/
+static const unsigned char *Ext2System_readDirBlock(ExtBlockMap *block_map, unsigned int logical, unsigned char *buffer, unsigned long long *position){
+	unsigned int block_size = block_map->fs->block.s_log_block_size;
+	unsigned int physical;
+
+	if (logical >= block_map->total) return NULL;
+	physical = Ext2System_mapBlock(block_map, logical);
+	if (physical == 0) return NULL;
+	*position = (unsigned long long) physical * block_size;
+	return (const unsigned char *) VolumeIO_view(block_map->fs->volume_io, *position, block_size, buffer);
+}
+
+
+/***********************************************
+*
+* @Purpose: Gets the hash or the block of an entry of an index block. The hash of the first entry holds the
+*           limit and the count of entries instead
+* @Parameters: const unsigned char *entries, entries of the index block
+*              unsigned int position, entry
+*              int offset, 0 for the hash and 4 for the block
+* @Return:  the value read
+*
+************************************************/
+static unsigned int Ext2System_getDxValue(const unsigned char *entries, unsigned int position, int offset){
+	unsigned int value;
+	memcpy(&value, entries + (size_t) position * EXT_SYSTEM_DX_ENTRY_SIZE + offset, sizeof(unsigned int));
+	return value;
+}
+
+
+/***********************************************
+*
+* @Purpose: Checks the header of the entries of an index block, so that no entry is read out of the block
+* @Parameters: const unsigned char *entries, entries of the index block
+*              unsigned int available, number of bytes of the block from the entries to its end
+*              unsigned int *count, filled with the number of entries used
+* @Return:  1 if the entries can be used, 0 otherwise
+*
+************************************************/
+static int Ext2System_getDxCount(const unsigned char *entries, unsigned int available, unsigned int *count){
+	unsigned short limit_value, count_value;
+
+	memcpy(&limit_value, entries, sizeof(unsigned short));
+	memcpy(&count_value, entries + sizeof(unsigned short), sizeof(unsigned short));
+	*count = count_value;
+	return count_value > 0 && count_value <= limit_value && (unsigned int) limit_value * EXT_SYSTEM_DX_ENTRY_SIZE <= available;
+}
+
+
+/***********************************************
+*
+* @Purpose: Looks for a name through the hash tree of an indexed directory. Only the leaf block where the hash
+*           of the name goes is read, and the next ones while their entries continue the same hash
+* @Parameters: ExtBlockMap *block_map, blocks of the directory
+*              const char *name, name looked for
+*              size_t name_len, length of the name
+*              unsigned char *buffer, buffer of EXT_SYSTEM_DX_MAX_LEVELS + 1 blocks
+*              ExtDirLookup *result, filled with the entry found
+* @Return:  1 if the name has been found, 0 if it is not in the directory, EXT_SYSTEM_LOOKUP_NO_INDEX if the index
+*           cannot be used
+*
+************************************************/
+static int Ext2System_lookupIndexed(ExtBlockMap *block_map, const char *name, size_t name_len, unsigned char *buffer, ExtDirLookup *result){
+	ExtFileSystem *fs = block_map->fs;
+	unsigned int block_size = fs->block.s_log_block_size;
+	const unsigned char *nodes[EXT_SYSTEM_DX_MAX_LEVELS];
+	const unsigned char *entries[EXT_SYSTEM_DX_MAX_LEVELS];
+	unsigned int counts[EXT_SYSTEM_DX_MAX_LEVELS];
+	unsigned int positions[EXT_SYSTEM_DX_MAX_LEVELS];
+	unsigned int hash, block, low, high, middle, levels, offset;
+	unsigned long long position;
+	const unsigned char *leaf;
+	DirEntryView directory_entry;
+	int version, level;
+
+	// dx_root_info: reserved_zero (4), hash_version (1), info_length (1), indirect_levels (1) and unused_flags (1)
+	nodes[0] = Ext2System_readDirBlock(block_map, 0, buffer, &position);
+	if (nodes[0] == NULL) return EXT_SYSTEM_LOOKUP_NO_INDEX;
+	memcpy(&offset, nodes[0] + EXT_SYSTEM_DX_ROOT_INFO_OFFSET, sizeof(unsigned int));
+	version = nodes[0][EXT_SYSTEM_DX_ROOT_INFO_OFFSET + 4];
+	levels = nodes[0][EXT_SYSTEM_DX_ROOT_INFO_OFFSET + 6];
+	if (offset != 0 || nodes[0][EXT_SYSTEM_DX_ROOT_INFO_OFFSET + 5] != EXT_SYSTEM_DX_ROOT_INFO_LENGTH || levels >= EXT_SYSTEM_DX_MAX_LEVELS){
+		return EXT_SYSTEM_LOOKUP_NO_INDEX;
+	}
+	// The signed or unsigned variant depends on the platform that created the volume, stored in s_flags
+	if (fs->unsigned_hash && version <= EXT2_HASH_TEA){
+		version += EXT2_HASH_UNSIGNED_DELTA;
+	}
+	if (!Ext2Hash_isValidVersion(version)) return EXT_SYSTEM_LOOKUP_NO_INDEX;
+	hash = Ext2Hash_compute(name, name_len, version, fs->hash_seed);
+
+	// Descending from the root: at every level, the last entry whose hash is not greater than the hash of the name
+	offset = EXT_SYSTEM_DX_ROOT_INFO_OFFSET + EXT_SYSTEM_DX_ROOT_INFO_LENGTH;
+	for (level = 0; level <= (int) levels; level++){
+		if (level > 0){
+			block = Ext2System_getDxValue(entries[level - 1], positions[level - 1], 4) & EXT_SYSTEM_DX_BLOCK_MASK;
+			nodes[level] = Ext2System_readDirBlock(block_map, block, buffer + (size_t) level * block_size, &position);
+			if (nodes[level] == NULL) return EXT_SYSTEM_LOOKUP_NO_INDEX;
+			offset = EXT_SYSTEM_DX_NODE_ENTRIES_OFFSET;
+		}
+		entries[level] = nodes[level] + offset;
+		if (!Ext2System_getDxCount(entries[level], block_size - offset, &counts[level])) return EXT_SYSTEM_LOOKUP_NO_INDEX;
+		low = 1;
+		high = counts[level];
+		while (low < high){
+			middle = low + (high - low) / 2;
+			if (Ext2System_getDxValue(entries[level], middle, 0) > hash){
+				high = middle;
+			}else{
+				low = middle + 1;
+			}
+		}
+		positions[level] = low - 1;
+	}
+
+	while (1){
+		block = Ext2System_getDxValue(entries[levels], positions[levels], 4) & EXT_SYSTEM_DX_BLOCK_MASK;
+		leaf = Ext2System_readDirBlock(block_map, block, buffer + (size_t) EXT_SYSTEM_DX_MAX_LEVELS * block_size, &position);
+		if (leaf == NULL) return EXT_SYSTEM_LOOKUP_NO_INDEX;
+		if (Ext2System_findInDirBlock(fs->stats, leaf, block_size, name, name_len, &directory_entry)){
+			Ext2System_setLookup(result, &directory_entry, position);
+			return 1;
+		}
+		// Names with the same hash can continue in the next leaf, whose hash then has the lowest bit set
+		for (level = levels; level >= 0 && positions[level] + 1 >= counts[level]; level--);
+		if (level < 0) return 0;
+		positions[level]++;
+		if ((Ext2System_getDxValue(entries[level], positions[level], 0) & ~1U) != hash) return 0;
+		for (level++; level <= (int) levels; level++){
+			block = Ext2System_getDxValue(entries[level - 1], positions[level - 1], 4) & EXT_SYSTEM_DX_BLOCK_MASK;
+			nodes[level] = Ext2System_readDirBlock(block_map, block, buffer + (size_t) level * block_size, &position);
+			if (nodes[level] == NULL) return EXT_SYSTEM_LOOKUP_NO_INDEX;
+			entries[level] = nodes[level] + EXT_SYSTEM_DX_NODE_ENTRIES_OFFSET;
+			if (!Ext2System_getDxCount(entries[level], block_size - EXT_SYSTEM_DX_NODE_ENTRIES_OFFSET, &counts[level])) return EXT_SYSTEM_LOOKUP_NO_INDEX;
+			positions[level] = 0;
+		}
+	}
+}
+
+
+/***********************************************
+*
+* @Purpose: Looks for a name in a directory. Indexed directories are looked up through their hash tree,
+*           reading a block per level of the tree and the leaf, and the rest are scanned entirely
+* @Parameters: ExtFileSystem *fs, Ext2 volume
+*              unsigned int dir_inode, inode of the directory
+*              const char *name, name looked for, it does not need to end with '\0'
+*              size_t name_len, length of the name
+*              ExtDirLookup *result, filled with the entry found
+* @Return:  1 if the name has been found, 0 if it is not in the directory, -1 if there is not enough memory
+*
+************************************************/
+int Ext2System_lookup(ExtFileSystem *fs, unsigned int dir_inode, const char *name, size_t name_len, ExtDirLookup *result){
+	unsigned int block_size = fs->block.s_log_block_size;
+	InodeTableEntry inode_entry = Ext2System_findAndGetInode(fs, dir_inode);
+	ExtBlockMap block_map;
+	unsigned char *buffer;
+	int found = EXT_SYSTEM_LOOKUP_NO_INDEX;
+
+	if ((inode_entry.i_mode & EXT_SYSTEM_MODE_TYPE_MASK) != EXT_SYSTEM_MODE_DIRECTORY) return 0;
+	// Big enough for the path of the tree and its leaf, and for a run of blocks of the linear scan
+	buffer = (unsigned char *) malloc((size_t) EXT_SYSTEM_MAX_EXTENT_BLOCKS * block_size);
+	if (buffer == NULL) return -1;
+	if (Ext2System_initBlockMap(&block_map, fs, &inode_entry) < 0){
+		free(buffer);
+		return -1;
+	}
+	OpStats_addFolder(fs->stats);
+	if (fs->dir_index && (inode_entry.i_flags & EXT_SYSTEM_INDEX_FL)){
+		found = Ext2System_lookupIndexed(&block_map, name, name_len, buffer, result);
+	}
+	// Directories without index, or with an index that does not look right, are read from the first block
+	if (found == EXT_SYSTEM_LOOKUP_NO_INDEX){
+		block_map.logical = 0;
+		found = Ext2System_lookupLinear(&block_map, name, name_len, buffer, result);
+	}
+	Ext2System_freeBlockMap(&block_map);
+	free(buffer);
+	return found;
+}
+
+
+/***********************************************
+*
+* @Purpose: Resolves an absolute path a component at a time, looking each one up in the directory found for
+*           the previous one from the root inode. It stops at the first component that is missing
+* @Parameters: ExtFileSystem *fs, Ext2 volume
+*              const char *path, absolute path of the file
+*              ExtDirLookup *result, filled with the directory entry of the file
+*              const char **name, set to the last component of the path
+* @Return:  1 if the path names a file that is not a directory, 0 otherwise, -1 if there is not enough memory
+*
+************************************************/
+static int Ext2System_resolvePath(ExtFileSystem *fs, const char *path, ExtDirLookup *result, const char **name){
+	unsigned int dir_inode = EXT_SYSTEM_ROOT_INODE;
+	const char *component;
+	size_t length = 0;
+	int found = 0;
+
+	// The lookup fails when the inode of a middle component is not a directory
+	component = TargetSet_nextComponent(path, &length);
+	while (component != NULL){
+		found = Ext2System_lookup(fs, dir_inode, component, length, result);
+		if (found != 1) return found;
+		*name = component;
+		dir_inode = result->inode;
+		component = TargetSet_nextComponent(component + length, &length);
+	}
+	// A path ending with a separator names a directory
+	if (found != 1 || (*name)[length] != '\0' || result->file_type == EXT2_FT_DIR) return 0;
+	return 1;
+}
+
+
+/***********************************************
+*
+* @Purpose: Shows the size of the files named by the targets that are absolute paths, or deletes them.
+*           The files deleted are marked in the name index, when it is up to date, so that it stays valid
+* @Parameters: TargetSet *targets, names looked for, the ones that are not absolute paths are skipped
+*              ExtFileSystem *fs, Ext2 volume
+*              int is_delete, 1 to delete the files, 0 to show their size
+* @Return:  -
+*
+************************************************/
+static void Ext2System_resolvePaths(TargetSet *targets, ExtFileSystem *fs, int is_delete){
+	InodeTableEntry inode_entry;
+	ExtDirLookup result;
+	NameIndex *index = NULL;
+	const char *name = NULL;
+	Target *target;
+
+	if (targets->path_count == 0) return;
+	if (is_delete == 1 && fs->index_path != NULL){
+		index = NameIndex_open(fs->index_path, NAME_INDEX_FS_EXT2, fs->volume.s_wtime);
+	}
+	for (int i = 0; i < targets->count; i++){
+		target = &targets->targets[i];
+		if (target->is_path == 0 || Ext2System_resolvePath(fs, target->name, &result, &name) != 1) continue;
+		if (is_delete == 1){
+			if (Ext2System_deleteAt(fs, result.block_position, result.offset, result.inode, name) == 0) continue;
+			printf("File %s deleted\n", target->name);
+			if (index != NULL){
+				NameIndex_markDeletedAt(index, name, result.block_position + result.offset);
+			}
+		}else{
+			inode_entry = Ext2System_findAndGetInode(fs, result.inode);
+			printf("The file %s has %llu bytes\n", target->name, Ext2System_getInodeSize(&inode_entry));
+		}
+		TargetSet_setFound(targets, target);
+	}
+	NameIndex_close(index);
+}
+
+
+/***********************************************
+*
+* @Purpose: Visitor of the walk of /extract, stops at the first entry whose name matches the target
+* @Parameters: const FileEntry *entry, entry visited
+*              void *context, ExtExtractMatch filled with the file found
+* @Return: FILE_ENTRY_STOP when the file is found, FILE_ENTRY_CONTINUE otherwise
+*
+************************************************/
+static int Ext2System_extractVisitor(const FileEntry *entry, void *context){
+	ExtExtractMatch *match = (ExtExtractMatch *) context;
+
+	if (entry->type == FILE_ENTRY_DIRECTORY || strcmp(entry->name, match->target->name) != 0) return FILE_ENTRY_CONTINUE;
+	match->found = 1;
+	match->inode = entry->id;
+	return FILE_ENTRY_STOP;
+}
+
+
+/***********************************************
+*
+* @Purpose: Finds the file /extract copies: an absolute path is resolved a directory at a time, and a name is
+*           looked up in the name index when there is one or found by a walk of the volume
+* @Parameters: ExtFileSystem *fs, Ext2 volume
+*              ExtExtractMatch *match, target looked for, filled with the file found
+* @Return:  1 if the file has been found, 0 otherwise
+*
+************************************************/
+static int Ext2System_locateFile(ExtFileSystem *fs, ExtExtractMatch *match){
+	NameIndexRecord *record;
+	ExtDirLookup result;
+	NameIndex *index;
+	const char *name = NULL;
+
+	if (match->target->is_path){
+		OpStats_startPhase(fs->stats, OP_STATS_PHASE_PATHS);
+		if (Ext2System_resolvePath(fs, match->target->name, &result, &name) == 1){
+			match->found = 1;
+			match->inode = result.inode;
+		}
+		return match->found;
+	}
+	OpStats_startPhase(fs->stats, OP_STATS_PHASE_INDEX);
+	index = Ext2System_loadIndex(fs);
+	if (index != NULL){
+		record = NameIndex_find(index, match->target->name, NULL);
+		if (record != NULL){
+			match->found = 1;
+			match->inode = record->id;
+		}
+		NameIndex_close(index);
+		return match->found;
+	}
+	OpStats_startPhase(fs->stats, OP_STATS_PHASE_WALK);
+	Ext2System_walk(fs, Ext2System_extractVisitor, match);
+	return match->found;
+}
+
+
+/***********************************************
+*
+* @Purpose: Writes zeros to a file, for the holes of a sparse file
+* @Parameters: int out_fd, descriptor written at its current position
+*              unsigned long long size, number of zeros
+* @Return:  number of bytes written, -1 on error
+*
+************************************************/
+static long long Ext2System_writeZeros(int out_fd, unsigned long long size){
+	char *zeros = (char *) calloc(1, VOLUME_IO_COPY_BUFFER_SIZE);
+	unsigned long long written = 0;
+	size_t chunk;
+	ssize_t bytes;
+
+	if (zeros == NULL) return -1;
+	while (written < size){
+		chunk = size - written < VOLUME_IO_COPY_BUFFER_SIZE ? size - written : VOLUME_IO_COPY_BUFFER_SIZE;
+		bytes = write(out_fd, zeros, chunk);
+		if (bytes <= 0) break;
+		written += bytes;
+	}
+	free(zeros);
+	return written < size ? -1 : (long long) written;
+}
+
+
+/***********************************************
+*
+* @Purpose: Copies the data of a regular file to another file following its block map. Every run of blocks that
+*           are contiguous in the volume is copied with a single call, without going through the block cache,
+*           and the holes are written as zeros
+* @Parameters: ExtFileSystem *fs, Ext2 volume
+*              const InodeTableEntry *inode_entry, inode of the file
+*              int out_fd, descriptor written at its current position
+* @Return:  number of bytes copied, less than the size of the file if the volume ends before, -1 on error
+*
+************************************************/
+long long Ext2System_copyFile(ExtFileSystem *fs, const InodeTableEntry *inode_entry, int out_fd){
+	unsigned int block_size = fs->block.s_log_block_size;
+	unsigned long long size = Ext2System_getInodeSize(inode_entry);
+	unsigned long long run_size;
+	long long copied = 0, bytes;
+	ExtBlockMap block_map;
+	ExtExtent extent;
+
+	if (Ext2System_initBlockMap(&block_map, fs, inode_entry) < 0) return -1;
+	while ((unsigned long long) copied < size && Ext2System_nextExtent(&block_map, &extent, UINT_MAX)){
+		run_size = (unsigned long long) extent.count * block_size;
+		if (run_size > size - copied) run_size = size - copied;
+		if (extent.physical == 0){
+			bytes = Ext2System_writeZeros(out_fd, run_size);
+		}else{
+			bytes = VolumeIO_copyTo(fs->volume_io, extent.physical * block_size, run_size, out_fd);
+		}
+		if (bytes < 0){
+			copied = -1;
+			break;
+		}
+		copied += bytes;
+		if ((unsigned long long) bytes < run_size) break;
+	}
+	Ext2System_freeBlockMap(&block_map);
+	return copied;
+}
+
+
+/***********************************************
+*
+* @Purpose: Copies the file named by the first target to the output of the volume
+* @Parameters: TargetSet *targets, name or absolute path of the file
+*              ExtFileSystem *fs, Ext2 volume
+* @Return:  -
+*
+************************************************/
+static void Ext2System_extract(TargetSet *targets, ExtFileSystem *fs){
+	InodeTableEntry inode_entry;
+	ExtExtractMatch match;
+	unsigned long long size;
+	long long copied;
+
+	if (targets->count == 0) return;
+	memset(&match, 0, sizeof(match));
+	match.target = &targets->targets[0];
+	if (Ext2System_locateFile(fs, &match) == 0){
+		OpStats_endPhase(fs->stats);
+		return;
+	}
+	TargetSet_setFound(targets, match.target);
+	inode_entry = Ext2System_findAndGetInode(fs, match.inode);
+	if ((inode_entry.i_mode & EXT_SYSTEM_MODE_TYPE_MASK) != EXT_SYSTEM_MODE_REGULAR){
+		OpStats_endPhase(fs->stats);
+		printf("The file %s is not a regular file\n", match.target->name);
+		return;
+	}
+	size = Ext2System_getInodeSize(&inode_entry);
+	// The text printed so far has to come before the data when both go to the standard output
+	fflush(stdout);
+	OpStats_startPhase(fs->stats, OP_STATS_PHASE_COPY);
+	copied = Ext2System_copyFile(fs, &inode_entry, fs->output_fd);
+	OpStats_endPhase(fs->stats);
+	if (copied < 0){
+		printf("Unable to write the file %s\n", match.target->name);
+	}else if ((unsigned long long) copied < size){
+		printf("The file %s is damaged, only %lld of its %llu bytes have been extracted\n", match.target->name, copied, size);
+	}else if (fs->output_fd != STDOUT_FILENO){
+		printf("File %s extracted, %llu bytes\n", match.target->name, size);
+	}
+}
+
+
+/***********************************************
+*
+* @Purpose: Lists every file and folder of the volume (/ls), walking the whole tree and writing a line per entry
+*           with its path, type, size, timestamps and inode
+* @Parameters: ExtFileSystem *fs, volume
+* @Return: -
+*
+************************************************/
+static void Ext2System_list(ExtFileSystem *fs){
+	ListOutput *output = ListOutput_create(fs->output_fd, fs->list_format, "inode");
+
+	if (output == NULL){
+		printf("Unable to list the volume\n");
+		return;
+	}
+	// The text printed so far has to come before the listing when both go to the standard output
+	fflush(stdout);
+	OpStats_startPhase(fs->stats, OP_STATS_PHASE_WALK);
+	Ext2System_walk(fs, ListOutput_addEntry, output);
+	OpStats_endPhase(fs->stats);
+	if (ListOutput_close(output) < 0){
+		printf("Unable to write the listing of the volume\n");
+	}
+}
+
+
+/***********************************************
+*
+* @Purpose: Tells if any of a range of inodes of a group is in use
+* @Parameters: const unsigned char *bitmap, inode bitmap of the group
+*              unsigned int first, first inode of the range, counted from the start of the group
+*              unsigned int count, number of inodes of the range
+* @Return: 1 if an inode of the range is in use, 0 otherwise
+*
+************************************************/
+static int Ext2System_hasUsedInodes(const unsigned char *bitmap, unsigned int first, unsigned int count){
+	for (unsigned int i = first; i < first + count; i++){
+		if (bitmap[i >> 3] & (1 << (i & 7))) return 1;
+	}
+	return 0;
+}
+
+
+/***********************************************
+*
+* @Purpose: Adds an inode that meets the conditions of /scan to the matches
+* @Parameters: ExtScan *scan, matches of the sweep
+*              unsigned int inode_number, number of the inode
+*              const unsigned char *inode, content of the inode in the inode table
+* @Return: 0 on success, -1 if there is not enough memory
+*
+************************************************/
+static int Ext2System_addScanMatch(ExtScan *scan, unsigned int inode_number, const unsigned char *inode){
+	InodeTableEntry inode_entry;
+	ExtScanMatch *matches;
+	ExtScanMatch *match;
+
+	if (scan->count == scan->capacity){
+		scan->capacity = scan->capacity == 0 ? 256 : scan->capacity * 2;
+		matches = (ExtScanMatch *) realloc(scan->matches, scan->capacity * sizeof(ExtScanMatch));
+		if (matches == NULL) return -1;
+		scan->matches = matches;
+	}
+	memcpy(&inode_entry, inode, sizeof(InodeTableEntry));
+	match = &scan->matches[scan->count++];
+	match->inode = inode_number;
+	if ((inode_entry.i_mode & EXT_SYSTEM_MODE_TYPE_MASK) == EXT_SYSTEM_MODE_REGULAR){
+		match->type = FILE_ENTRY_FILE;
+	}else if ((inode_entry.i_mode & EXT_SYSTEM_MODE_TYPE_MASK) == EXT_SYSTEM_MODE_DIRECTORY){
+		match->type = FILE_ENTRY_DIRECTORY;
+	}else{
+		match->type = FILE_ENTRY_OTHER;
+	}
+	match->links = inode_entry.i_links_count;
+	match->size = Ext2System_getInodeSize(&inode_entry);
+	match->mtime = inode_entry.i_mtime;
+	match->atime = inode_entry.i_atime;
+	// A folder is only listed once, through its entry in its parent, whatever its number of links
+	scan->remaining += match->type == FILE_ENTRY_DIRECTORY ? 1 : match->links;
+	return 0;
+}
+
+
+/***********************************************
+*
+* @Purpose: Reads the inode table of a group in runs of consecutive blocks, skipping the blocks whose inodes are
+*           all free according to the bitmap, and keeps the inodes in use that meet the conditions of /scan
+* @Parameters: ExtFileSystem *fs, Ext2 volume
+*              unsigned int group, group swept
+*              ExtScan *scan, matches of the sweep, the ones of the group are added in order
+*              unsigned char *buffer, room for a block of the bitmap and EXT_SYSTEM_SCAN_RUN_BLOCKS of the table
+*              unsigned char *matched, a byte for every inode of EXT_SYSTEM_SCAN_RUN_BLOCKS blocks of the table
+* @Return: 0 on success, -1 if the group could not be read, -2 if there is not enough memory
+*
+************************************************/
+static int Ext2System_sweepGroup(ExtFileSystem *fs, unsigned int group, ExtScan *scan, unsigned char *buffer, unsigned char *matched){
+	unsigned int block_size = fs->block.s_log_block_size;
+	unsigned int per_group = fs->inode.s_inodes_per_group;
+	unsigned int per_block = block_size / fs->inode_size;
+	unsigned int table_blocks = (per_group + per_block - 1) / per_block;
+	unsigned int first_inode = fs->inode.s_first_ino != 0 ? fs->inode.s_first_ino : EXT_SYSTEM_REV0_FIRST_INODE;
+	unsigned int block = 0, run, first, count, number;
+	const unsigned char *bitmap, *table;
+
+	if (per_group > block_size * 8) return -1;
+	bitmap = (const unsigned char *) VolumeIO_view(fs->volume_io, (off_t) fs->groups[group].bg_inode_bitmap * block_size, block_size, buffer);
+	if (bitmap == NULL) return -1;
+	if (Simd_countBits(bitmap, per_group) == 0) return 0;
+	VolumeIO_advise(fs->volume_io, (off_t) fs->groups[group].bg_inode_table * block_size, (size_t) table_blocks * block_size,
+			VOLUME_IO_ADVICE_SEQUENTIAL);
+
+	while (block < table_blocks){
+		first = block * per_block;
+		if (!Ext2System_hasUsedInodes(bitmap, first, per_group - first < per_block ? per_group - first : per_block)){
+			block++;
+			continue;
+		}
+		// Run of blocks holding inodes in use, read at once
+		run = 1;
+		while (block + run < table_blocks && run < EXT_SYSTEM_SCAN_RUN_BLOCKS){
+			first = (block + run) * per_block;
+			if (!Ext2System_hasUsedInodes(bitmap, first, per_group - first < per_block ? per_group - first : per_block)) break;
+			run++;
+		}
+		first = block * per_block;
+		count = run * per_block;
+		if (count > per_group - first) count = per_group - first;
+		table = (const unsigned char *) VolumeIO_view(fs->volume_io, ((off_t) fs->groups[group].bg_inode_table + block) * block_size,
+				(size_t) run * block_size, buffer + block_size);
+		if (table == NULL) return -1;
+		if (Simd_filterInodes(table, count, fs->inode_size, &fs->scan_filter, matched) > 0){
+			for (unsigned int i = 0; i < count; i++){
+				// The free inodes keep the fields they had, only the bitmap tells if they are in use
+				if (!matched[i] || !(bitmap[(first + i) >> 3] & (1 << ((first + i) & 7)))) continue;
+				number = group * per_group + first + i + 1;
+				if (number != EXT_SYSTEM_ROOT_INODE && number < first_inode) continue;
+				if (Ext2System_addScanMatch(scan, number, table + (size_t) i * fs->inode_size) < 0) return -2;
+			}
+		}
+		block += run;
+	}
+	return 0;
+}
+
+
+/***********************************************
+*
+* @Purpose: Compares the inode looked for with the one of a match, for bsearch()
+* @Parameters: const void *key, inode number looked for
+*              const void *match, ExtScanMatch
+* @Return: negative, 0 or positive as the inode is before, equal or after the one of the match
+*
+************************************************/
+static int Ext2System_compareScanMatch(const void *key, const void *match){
+	unsigned int inode = *(const unsigned int *) key;
+	unsigned int other = ((const ExtScanMatch *) match)->inode;
+	return inode < other ? -1 : inode > other;
+}
+
+
+/***********************************************
+*
+* @Purpose: Adds a match of /scan to the listing with one of its paths
+* @Parameters: ExtScan *scan, matches of the sweep
+*              ExtScanMatch *match, inode listed
+*              char *path, path of the inode
+*              size_t name_start, position of the name of the inode in the path
+* @Return: FILE_ENTRY_STOP once all the matches have been listed or if the listing cannot be written,
+*          FILE_ENTRY_CONTINUE otherwise
+*
+************************************************/
+static int Ext2System_listScanMatch(ExtScan *scan, ExtScanMatch *match, char *path, size_t name_start){
+	FileEntry entry;
+
+	memset(&entry, 0, sizeof(entry));
+	entry.path = path;
+	entry.name = path + name_start;
+	entry.id = match->inode;
+	entry.type = match->type;
+	entry.size = match->size;
+	entry.mtime = match->mtime;
+	entry.atime = match->atime;
+	if (ListOutput_addEntry(&entry, scan->output) == FILE_ENTRY_STOP) return FILE_ENTRY_STOP;
+	scan->remaining--;
+	return scan->remaining == 0 ? FILE_ENTRY_STOP : FILE_ENTRY_CONTINUE;
+}
+
+
+/***********************************************
+*
+* @Purpose: Walks the folders to find the paths of the matches of /scan. Unlike Ext2System_walkDirectory only the
+*           inodes of the folders are read, the fields of the matches were taken from the inode tables already
+* @Parameters: ExtFileSystem *fs, Ext2 volume
+*              ExtScan *scan, matches of the sweep
+*              unsigned int dir_inode, inode of the folder
+*              char *path, FILE_ENTRY_MAX_PATH bytes holding the path of the folder, the names are appended to it
+*              size_t path_len, length of the path of the folder
+* @Return: FILE_ENTRY_STOP once all the matches have been listed or if the listing cannot be written,
+*          FILE_ENTRY_CONTINUE otherwise
+*
+************************************************/
+static int Ext2System_scanPaths(ExtFileSystem *fs, ExtScan *scan, unsigned int dir_inode, char *path, size_t path_len){
+	unsigned int block_size = fs->block.s_log_block_size;
+	InodeTableEntry inode_entry;
+	ExtBlockMap block_map;
+	ExtExtent extent;
+	DirBlockParser parser;
+	DirEntryView directory_entry;
+	ExtScanMatch *match;
+	const unsigned char *dir_blocks;
+	unsigned char *scratch;
+	int result = FILE_ENTRY_CONTINUE;
+	unsigned long long decoded = 0;
+
+	inode_entry = Ext2System_findAndGetInode(fs, dir_inode);
+	scratch = (unsigned char *) malloc((size_t) EXT_SYSTEM_MAX_EXTENT_BLOCKS * block_size);
+	if (scratch == NULL) return FILE_ENTRY_CONTINUE;
+	if (Ext2System_initBlockMap(&block_map, fs, &inode_entry) < 0){
+		free(scratch);
+		return FILE_ENTRY_CONTINUE;
+	}
+
+	while (result != FILE_ENTRY_STOP && Ext2System_nextExtent(&block_map, &extent, EXT_SYSTEM_MAX_EXTENT_BLOCKS)){
+		if (extent.physical == 0) continue;
+		dir_blocks = (const unsigned char *) VolumeIO_view(fs->volume_io, extent.physical * block_size, (size_t) extent.count * block_size, scratch);
+		if (dir_blocks == NULL) continue;
+		Ext2System_prefetchFolders(fs, dir_blocks, extent.count);
+		for (unsigned int i = 0; i < extent.count && result != FILE_ENTRY_STOP; i++){
+			Ext2System_initDirBlock(&parser, dir_blocks + (size_t) i * block_size, block_size);
+			while (result != FILE_ENTRY_STOP && Ext2System_nextDirEntry(&parser, &directory_entry)){
+				decoded++;
+				if (Ext2System_isDotEntry(&directory_entry) || path_len + 1 + directory_entry.name_len >= FILE_ENTRY_MAX_PATH) continue;
+				path[path_len] = '/';
+				memcpy(path + path_len + 1, directory_entry.name, directory_entry.name_len);
+				path[path_len + 1 + directory_entry.name_len] = '\0';
+
+				match = (ExtScanMatch *) bsearch(&directory_entry.inode, scan->matches, scan->count, sizeof(ExtScanMatch), Ext2System_compareScanMatch);
+				if (match != NULL){
+					result = Ext2System_listScanMatch(scan, match, path, path_len + 1);
+				}
+				if (result == FILE_ENTRY_CONTINUE && Ext2System_isDirectory(&directory_entry)){
+					result = Ext2System_scanPaths(fs, scan, directory_entry.inode, path, path_len + 1 + directory_entry.name_len);
+				}
+			}
+		}
+	}
+	path[path_len] = '\0';
+	Ext2System_freeBlockMap(&block_map);
+	free(scratch);
+	OpStats_addFolder(fs->stats);
+	OpStats_addEntries(fs->stats, decoded);
+	return result;
+}
+
+
+/***********************************************
+*
+* @Purpose: Lists the inodes that meet the conditions of /scan (/scan). The inode tables are read group by group
+*           in long sequential runs and the conditions are checked on every inode at once with Simd_filterInodes,
+*           so that the inodes of the files that do not match are never read one at a time. The folders are walked
+*           afterwards, only to find the paths of the matches, and the walk ends as soon as all of them are listed
+* @Parameters: ExtFileSystem *fs, Ext2 volume
+* @Return: -
+*
+************************************************/
+static void Ext2System_scan(ExtFileSystem *fs){
+	unsigned int block_size = fs->block.s_log_block_size;
+	unsigned int root = EXT_SYSTEM_ROOT_INODE;
+	char path[FILE_ENTRY_MAX_PATH];
+	unsigned char *buffer, *matched;
+	ExtScanMatch *match;
+	ExtScan scan;
+	int unreadable = 0, result = 0, listed = FILE_ENTRY_CONTINUE;
+
+	if (fs->inode_size < SIMD_INODE_MIN_SIZE){
+		printf("Unable to scan inodes of %u bytes\n", fs->inode_size);
+		return;
+	}
+	memset(&scan, 0, sizeof(scan));
+	buffer = (unsigned char *) malloc((size_t) (EXT_SYSTEM_SCAN_RUN_BLOCKS + 1) * block_size);
+	matched = (unsigned char *) malloc((size_t) EXT_SYSTEM_SCAN_RUN_BLOCKS * (block_size / fs->inode_size));
+	scan.output = ListOutput_create(fs->output_fd, fs->list_format, "inode");
+	if (buffer == NULL || matched == NULL || scan.output == NULL){
+		printf("Unable to scan the volume\n");
+		free(buffer);
+		free(matched);
+		ListOutput_close(scan.output);
+		return;
+	}
+
+	OpStats_startPhase(fs->stats, OP_STATS_PHASE_SCAN);
+	for (unsigned int group = 0; group < fs->group_count && result != -2; group++){
+		result = Ext2System_sweepGroup(fs, group, &scan, buffer, matched);
+		if (result == -1) unreadable++;
+	}
+	free(buffer);
+	free(matched);
+	if (result == -2) printf("Not enough memory to keep all the inodes found\n");
+	if (unreadable > 0) printf("%d groups could not be scanned\n", unreadable);
+
+	// The text printed so far has to come before the listing when both go to the standard output
+	fflush(stdout);
+	if (scan.count > 0){
+		// The tree walk jumps between inodes and directory blocks, so read-ahead is not useful
+		VolumeIO_advise(fs->volume_io, 0, 0, VOLUME_IO_ADVICE_RANDOM);
+		OpStats_startPhase(fs->stats, OP_STATS_PHASE_WALK);
+		path[0] = '\0';
+		// The root folder has no entry in any folder, it is listed as "/"
+		match = (ExtScanMatch *) bsearch(&root, scan.matches, scan.count, sizeof(ExtScanMatch), Ext2System_compareScanMatch);
+		if (match != NULL){
+			strcpy(path, "/");
+			listed = Ext2System_listScanMatch(&scan, match, path, 1);
+			path[0] = '\0';
+		}
+		if (listed == FILE_ENTRY_CONTINUE){
+			Ext2System_scanPaths(fs, &scan, EXT_SYSTEM_ROOT_INODE, path, 0);
+		}
+	}
+	OpStats_endPhase(fs->stats);
+	free(scan.matches);
+	if (ListOutput_close(scan.output) < 0){
+		printf("Unable to write the listing of the volume\n");
+	}
+}
+
+
+/***********************************************
+*
+* @Purpose: Prepares the iterator over the data blocks of an inode
+* @Parameters: ExtBlockMap *block_map, iterator to be initialized
+*              ExtFileSystem *fs, volume where the inode is
+*              const InodeTableEntry *inode_entry, inode whose blocks are iterated
+* @Return:  0 on success, -1 if there is not enough memory
+*
+************************************************/
+int Ext2System_initBlockMap(ExtBlockMap *block_map, ExtFileSystem *fs, const InodeTableEntry *inode_entry){
+	unsigned int block_size = fs->block.s_log_block_size;
+	unsigned long long size = Ext2System_getInodeSize(inode_entry);
+
+	bzero(block_map, sizeof(ExtBlockMap));
+	block_map->fs = fs;
+	memcpy(block_map->i_block, inode_entry->i_block, sizeof(block_map->i_block));
+	block_map->total = (size + block_size - 1) / block_size;
+	block_map->per_block = block_size / sizeof(unsigned int);
+	for (int i = 0; i < EXT_SYSTEM_INDIRECT_LEVELS; i++){
+		block_map->table[i] = (unsigned int *) malloc(block_size);
+		if (block_map->table[i] == NULL){
+			Ext2System_freeBlockMap(block_map);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+
+/***********************************************
+*
+* @Purpose: Frees the buffers of a block map iterator
+* @Parameters: ExtBlockMap *block_map, iterator to be freed
+* @Return:  -
+*
+************************************************/
+void Ext2System_freeBlockMap(ExtBlockMap *block_map){
+	for (int i = 0; i < EXT_SYSTEM_INDIRECT_LEVELS; i++){
+		free(block_map->table[i]);
+		block_map->table[i] = NULL;
+	}
+}
+
+
+/***********************************************
+*
+* @Purpose: Gets an entry of an indirect block, keeping the last indirect block read at every depth
+* @Parameters: ExtBlockMap *block_map, iterator with the indirect block buffers
+*              int depth, depth of the indirect block in the path (0 is the one pointed by the inode)
+*              unsigned int indirect_block, block number of the indirect block
+*              unsigned long long index, entry of the indirect block
+* @Return:  block number stored in the entry, 0 if it is a hole or it cannot be read
+*
+************************************************/
+static unsigned int Ext2System_getIndirectEntry(ExtBlockMap *block_map, int depth, unsigned int indirect_block, unsigned long long index){
+	unsigned int block_size = block_map->fs->block.s_log_block_size;
+	if (indirect_block == 0) return 0;
+	if (block_map->loaded[depth] != indirect_block){
+		if (VolumeIO_read(block_map->fs->volume_io, (unsigned long long) indirect_block * block_size, block_map->table[depth], block_size) != (ssize_t) block_size){
+			block_map->loaded[depth] = 0;
+			return 0;
+		}
+		block_map->loaded[depth] = indirect_block;
+	}
+	return block_map->table[depth][index];
+}
+
+
+/***********************************************
+*
+* @Purpose: Translates a logical block of the inode to its block in the volume, following the single,
+*           double and triple indirect blocks when needed
+* @Parameters: ExtBlockMap *block_map, iterator of the inode
+*              unsigned long long logical, logical block number
+* @Return:  block number in the volume, 0 if it is a hole
+*
+************************************************/
+unsigned int Ext2System_mapBlock(ExtBlockMap *block_map, unsigned long long logical){
+	unsigned long long per_block = block_map->per_block;
+	unsigned int indirect;
+
+	// Direct blocks
+	if (logical < EXT_SYSTEM_DIRECT_BLOCKS){
+		return block_map->i_block[logical];
+	}
+	logical -= EXT_SYSTEM_DIRECT_BLOCKS;
+	// Single indirect block
+	if (logical < per_block){
+		return Ext2System_getIndirectEntry(block_map, 0, block_map->i_block[EXT_SYSTEM_DIRECT_BLOCKS], logical);
+	}
+	logical -= per_block;
+	// Double indirect block
+	if (logical < per_block * per_block){
+		indirect = Ext2System_getIndirectEntry(block_map, 0, block_map->i_block[EXT_SYSTEM_DIRECT_BLOCKS + 1], logical / per_block);
+		return Ext2System_getIndirectEntry(block_map, 1, indirect, logical % per_block);
+	}
+	logical -= per_block * per_block;
+	// Triple indirect block
+	if (logical < per_block * per_block * per_block){
+		indirect = Ext2System_getIndirectEntry(block_map, 0, block_map->i_block[EXT_SYSTEM_DIRECT_BLOCKS + 2], logical / (per_block * per_block));
+		indirect = Ext2System_getIndirectEntry(block_map, 1, indirect, (logical / per_block) % per_block);
+		return Ext2System_getIndirectEntry(block_map, 2, indirect, logical % per_block);
+	}
+	return 0;
+}
+
+
+/***********************************************
+*
+* @Purpose: Gets the next run of logical blocks that are contiguous in the volume, so that they can be read at once.
+*           Holes are returned as runs whose physical block is 0
+* @Parameters: ExtBlockMap *block_map, iterator of the inode
+*              ExtExtent *extent, filled with the run found
+*              unsigned int max_blocks, maximum number of blocks of the run
+* @Return:  1 if a run has been found, 0 when all the blocks of the inode have been iterated
+*
+************************************************/
+int Ext2System_nextExtent(ExtBlockMap *block_map, ExtExtent *extent, unsigned int max_blocks){
+	unsigned int physical;
+	if (block_map->logical >= block_map->total) return 0;
+
+	extent->logical = block_map->logical;
+	extent->physical = Ext2System_mapBlock(block_map, block_map->logical);
+	extent->count = 1;
+	block_map->logical++;
+	// Extending the run while the next logical block is the next block of the volume (or the hole continues)
+	while (block_map->logical < block_map->total && extent->count < max_blocks){
+		physical = Ext2System_mapBlock(block_map, block_map->logical);
+		if ((extent->physical == 0 && physical != 0) || (extent->physical != 0 && physical != extent->physical + extent->count)){
+			break;
+		}
+		extent->count++;
+		block_map->logical++;
+	}
+	return 1;
+}
+
+
+/***********************************************
+*
+* @Purpose: Gets the size in bytes of an inode, including the upper 32 bits of the regular files bigger than 4 GiB
+* @Parameters: const InodeTableEntry *inode_entry, inode whose size is returned
+* @Return:  size in bytes
+*
+************************************************/
+unsigned long long Ext2System_getInodeSize(const InodeTableEntry *inode_entry){
+	unsigned long long size = inode_entry->i_size;
+	// For regular files i_dir_acl holds the upper 32 bits of the size
+	if ((inode_entry->i_mode & EXT_SYSTEM_MODE_TYPE_MASK) == EXT_SYSTEM_MODE_REGULAR){
+		size |= (unsigned long long) inode_entry->i_dir_acl << 32;
+	}
+	return size;
+}
+
+
+/***********************************************
+*
+* @Purpose: Reads the whole block group descriptor table with a single read and keeps it in a contiguous array
+*           indexed by group number
+* @Parameters: ExtFileSystem *fs, volume whose descriptor table is read
+* @Return:  0 on success, -1 if there is not enough memory or the table cannot be read
+*
+************************************************/
+int Ext2System_readGroupDescriptors(ExtFileSystem *fs){
+	unsigned int block_size = fs->block.s_log_block_size;
+	unsigned char *table;
+	size_t table_size;
+	// The descriptor table starts at the block that follows the superblock
+	unsigned long long table_position = (unsigned long long)(fs->block.s_first_data_block + 1) * block_size;
+
+	if (fs->block.s_blocks_per_group == 0 || fs->inode.s_inodes_per_group == 0) return -1;
+	fs->group_count = (fs->block.s_blocks_count - fs->block.s_first_data_block + fs->block.s_blocks_per_group - 1) / fs->block.s_blocks_per_group;
+	table_size = (size_t) fs->group_count * EXT_SYSTEM_GROUP_DESC_SIZE;
+
+	table = (unsigned char *) malloc(table_size);
+	fs->groups = (BlockGroupDescriptorTable *) malloc(sizeof(BlockGroupDescriptorTable) * fs->group_count);
+	if (table == NULL || fs->groups == NULL){
+		free(table);
+		return -1;
+	}
+	VolumeIO_advise(fs->volume_io, table_position, table_size, VOLUME_IO_ADVICE_SEQUENTIAL);
+	if (VolumeIO_read(fs->volume_io, table_position, table, table_size) != (ssize_t) table_size){
+		free(table);
+		return -1;
+	}
+	// Every descriptor takes EXT_SYSTEM_GROUP_DESC_SIZE bytes, but only the first fields are kept
+	for (unsigned int i = 0; i < fs->group_count; i++){
+		memcpy(&fs->groups[i], table + (size_t) i * EXT_SYSTEM_GROUP_DESC_SIZE, sizeof(BlockGroupDescriptorTable));
+	}
+	free(table);
+	return 0;
+}
+
+
+/***********************************************
+*
+* @Purpose: Computes the position of an inode in the volume, (the formulas come from the page 22/34 of the documentation)
+* @Parameters: ExtFileSystem *fs, volume where the inode is
+*              unsigned int inode_number, number of the inode (the first one is 1)
+* @Return:  position of the inode entry in the inode table of its group, 0 if the inode number is not valid
+*
+************************************************/
+unsigned long long Ext2System_getInodePosition(ExtFileSystem *fs, unsigned int inode_number){
+	unsigned int block_group_number  = (inode_number - 1) / fs->inode.s_inodes_per_group; 			// Block group number (from formula)
+	unsigned int inode_index = (inode_number - 1) % fs->inode.s_inodes_per_group;				// Inode index inside the group (from formula)
+
+	if (inode_number == 0 || block_group_number >= fs->group_count) return 0;
+	// Position of the inode table of the group + position in the table
+	return (unsigned long long) fs->groups[block_group_number].bg_inode_table * fs->block.s_log_block_size + (unsigned long long) inode_index * fs->inode_size;
+}
+
+
+/***********************************************
+*
+* @Purpose: Function that returns the inode entry of an inode number from the inode table of its group
+* @Parameters: ExtFileSystem *fs, volume where the inode is
+*              unsigned int inode_number, number of the inode to be read
+* @Return:  InodeTableEntry with the data from the inode entry from the inode table, all zeros if it is not valid
+*
+************************************************/
+InodeTableEntry Ext2System_findAndGetInode(ExtFileSystem *fs, unsigned int inode_number){
+	InodeTableEntry inode_entry;
+	InodeTableEntry scratch;
+	const unsigned char *entry;
+
+	bzero(&inode_entry, sizeof(InodeTableEntry));
+	// The entry is copied before another thread can replace its block in the cache
+	pthread_mutex_lock(&fs->inode_lock);
+	entry = Ext2System_getInodeEntry(fs, inode_number, &scratch);
+	if (entry != NULL){
+		// Copying the entry from the inode table
+		memcpy(&inode_entry, entry, sizeof(InodeTableEntry));
+	}
+	pthread_mutex_unlock(&fs->inode_lock);
+	return inode_entry;
+}
+
+
+/***********************************************
+*
+* @Purpose: Prepares the parser of a directory block already loaded in memory
+* @Parameters: DirBlockParser *parser, parser to be initialized
+*              const unsigned char *data, content of the directory block
+*              unsigned int size, size of the directory block
+* @Return:  -
+*
+************************************************/
+void Ext2System_initDirBlock(DirBlockParser *parser, const unsigned char *data, unsigned int size){
+	parser->data = data;
+	parser->size = size;
+	parser->offset = 0;
+	parser->last_offset = EXT_SYSTEM_DIR_NO_ENTRY;
+}
+
+
+/***********************************************
+*
+* @Purpose: Gets the next used directory entry of the block as a view over the block, without copying the name.
+*           Entries with inode 0 (unused) are skipped
+* @Parameters: DirBlockParser *parser, parser of the directory block
+*              DirEntryView *directory_entry, filled with the entry found
+* @Return:  1 if an entry has been found, 0 at the end of the block or if the block is corrupted
+*
+************************************************/
+int Ext2System_nextDirEntry(DirBlockParser *parser, DirEntryView *directory_entry){
+	while (parser->offset + EXT_SYSTEM_DIR_ENTRY_HEADER_SIZE <= parser->size){
+		const unsigned char *header = parser->data + parser->offset;
+		// Fixed part of the entry: inode (4), rec_len (2), name_len (1) and file_type (1)
+		memcpy(&directory_entry->inode, header, sizeof(int));
+		memcpy(&directory_entry->rec_len, header + sizeof(int), sizeof(short));
+		directory_entry->name_len = header[6];
+		directory_entry->file_type = header[7];
+		directory_entry->name = (const char *) header + EXT_SYSTEM_DIR_ENTRY_HEADER_SIZE;
+		directory_entry->offset = parser->offset;
+		directory_entry->prev_offset = parser->last_offset;
+
+		// A record that does not fit in the block ends the parsing
+		if (directory_entry->rec_len < EXT_SYSTEM_DIR_ENTRY_HEADER_SIZE || parser->offset + directory_entry->rec_len > parser->size ||
+				EXT_SYSTEM_DIR_ENTRY_HEADER_SIZE + directory_entry->name_len > directory_entry->rec_len){
+			parser->offset = parser->size;
+			return 0;
+		}
+		parser->last_offset = parser->offset;
+		parser->offset += directory_entry->rec_len;
+		if (directory_entry->inode != 0){
+			return 1;
+		}
+	}
+	return 0;
+}
+
+
+/***********************************************
+*
+* @Purpose: Checks if the directory entry is the "." or the ".." entry of a folder
+* @Parameters: const DirEntryView *directory_entry, directory entry checked
+* @Return:  integer with 1 if it is one of them, 0 otherwise
+*
+************************************************/
+int Ext2System_isDotEntry(const DirEntryView *directory_entry){
+	if (directory_entry->name_len == 1 && directory_entry->name[0] == '.') return 1;
+	return directory_entry->name_len == 2 && directory_entry->name[0] == '.' && directory_entry->name[1] == '.';
+}
+
+
+/***********************************************
+*
+* @Purpose: Checks if the directory entry is a directory different from . and ..
+* @Parameters: const DirEntryView *directory_entry, directory entry checked
+* @Return:  integer with 1 if it is a directory, 0 otherwise
+*
+************************************************/
+int Ext2System_isDirectory(const DirEntryView *directory_entry){
+	if (directory_entry->file_type != EXT2_FT_DIR) return 0;
+	// Skipping the "." and ".." entries
+	return Ext2System_isDotEntry(directory_entry) == 0;
+}
+
+
+/***********************************************
+*
+* @Purpose: Deletes a directory entry. The previous entry of the block is extended to cover the deleted one,
+*           or the inode is set to 0 if it is the first entry of the block
+* @Parameters: VolumeIO *volume_io, block I/O handle of the volume
+*              unsigned long long dir_entry_block_position, position of the directory block in the volume
+*              DirBlockParser *parser, parser of the directory block, updated so that it can keep going
+*              const DirEntryView *directory_entry, entry to be deleted
+* @Return:  -
+*
+************************************************/
+void Ext2System_deleteEntry(VolumeIO *volume_io, unsigned long long dir_entry_block_position, DirBlockParser *parser, const DirEntryView *directory_entry){
+	// Linked list: prev->curr->"next"
+	// Here we point the prev dir entry to the "next" dir entry skipping the curr, as the curr is the one to be deleted
+	unsigned short prev_rec_len;
+	unsigned int curr_rec_len = directory_entry->rec_len;
+	unsigned int unused_inode = 0;
+	char empty_header[EXT_SYSTEM_DIR_ENTRY_HEADER_SIZE];
+
+	if (directory_entry->prev_offset == EXT_SYSTEM_DIR_NO_ENTRY){
+		// The first entry of a block cannot be merged, it is marked as unused
+		VolumeIO_write(volume_io, dir_entry_block_position + directory_entry->offset, &unused_inode, sizeof(int));
+		return;
+	}
+
+	// The previous directory entry size must be equal to the its size plus the current one that we want to delete
+	// It is read from the volume as the parsed block may be a copy that misses earlier deletions
+	VolumeIO_read(volume_io, dir_entry_block_position + directory_entry->prev_offset + sizeof(int), &prev_rec_len, sizeof(short));
+	prev_rec_len = prev_rec_len + curr_rec_len;
+	// Write the new rec_len field
+	VolumeIO_write(volume_io, dir_entry_block_position + directory_entry->prev_offset + sizeof(int), &prev_rec_len, sizeof(short));
+
+	// Going to the curr dir position and deleting its fixed part
+	bzero(empty_header, sizeof(empty_header));
+	VolumeIO_write(volume_io, dir_entry_block_position + directory_entry->offset, empty_header, sizeof(empty_header));
 
+	// The entry following the deleted one now comes after the previous one
+	parser->last_offset = directory_entry->prev_offset;
 }
@@ -8,7 +8,49 @@
 #ifndef EXSYSTEM_H
     #define EXSYSTEM_H
 
+    #include <pthread.h>
+
+    #include "VolumeIO.h"
+    #include "FileEntry.h"
+    #include "ListOutput.h"
+    #include "TargetSet.h"
+    #include "WorkPool.h"
+    #include "OpStats.h"
+    #include "Simd.h"
+
     #define EXT_SYSTEM_SUPERBLOCK_OFFSET 1024
+    #define EXT_SYSTEM_ROOT_INODE 2
+    // Size of one entry of the block group descriptor table in the volume
+    #define EXT_SYSTEM_GROUP_DESC_SIZE 32
+    // Inode size of the revision 0 volumes, that leave s_inode_size to 0
+    #define EXT_SYSTEM_REV0_INODE_SIZE 128
+    // Number of inode table blocks kept in memory by default
+    #define EXT_SYSTEM_INODE_CACHE_BLOCKS 64
+    // Largest block size whose prefetch can use a temporary buffer in the stack
+    #define EXT_SYSTEM_MAX_STACK_BLOCK 4096
+
+    // Block map constants
+    #define EXT_SYSTEM_DIRECT_BLOCKS 12
+    #define EXT_SYSTEM_INDIRECT_LEVELS 3
+    // Maximum number of contiguous blocks read at once
+    #define EXT_SYSTEM_MAX_EXTENT_BLOCKS 32
+    // Maximum number of inodes, and of directory blocks, of the subfolders of an extent prefetched together
+    #define EXT_SYSTEM_MAX_PREFETCH 64
+    // Longest name of a directory entry
+    #define EXT_SYSTEM_MAX_NAME 255
+    // Maximum number of inode table blocks read at once by /scan
+    #define EXT_SYSTEM_SCAN_RUN_BLOCKS 64
+
+    // Inode mode constants
+    #define EXT_SYSTEM_MODE_TYPE_MASK 0xF000
+    #define EXT_SYSTEM_MODE_REGULAR 0x8000
+    #define EXT_SYSTEM_MODE_DIRECTORY 0x4000
+    #define EXT_SYSTEM_MODE_SYMLINK 0xA000
+    #define EXT_SYSTEM_MODE_PERMISSIONS 07777
+    // Largest value of i_links_count
+    #define EXT_SYSTEM_MAX_LINKS 0xFFFF
+    // First inode that is not reserved in the revision 0 volumes, that leave s_first_ino to 0
+    #define EXT_SYSTEM_REV0_FIRST_INODE 11
 
     // Magic word constants
     #define EXT_SYSTEM_MAGIC_WORD 0xEF53
@@ -53,11 +95,33 @@
     #define EXT_SYSTEM_VOLUME_WRITE_OFFSET 48
     #define EXT_SYSTEM_VOLUME_WRITE_RBYTES 4
 
+    // Directory index (HTree) constants
+    #define EXT_SYSTEM_FEATURE_COMPAT_OFFSET 92
+    #define EXT_SYSTEM_FEATURE_DIR_INDEX 0x0020
+    #define EXT_SYSTEM_HASH_SEED_OFFSET 236
+    #define EXT_SYSTEM_FLAGS_OFFSET 352
+    #define EXT_SYSTEM_FLAGS_UNSIGNED_HASH 0x0002
+    // i_flags bit of the directories with an index
+    #define EXT_SYSTEM_INDEX_FL 0x1000
+    // dx_root_info after the "." and ".." entries of the first block, and the entries after it
+    #define EXT_SYSTEM_DX_ROOT_INFO_OFFSET 24
+    #define EXT_SYSTEM_DX_ROOT_INFO_LENGTH 8
+    // Entries of the inner index blocks, after an empty directory entry that covers the whole block
+    #define EXT_SYSTEM_DX_NODE_ENTRIES_OFFSET 8
+    #define EXT_SYSTEM_DX_ENTRY_SIZE 8
+    #define EXT_SYSTEM_DX_MAX_LEVELS 3
+    #define EXT_SYSTEM_DX_BLOCK_MASK 0x0FFFFFFF
+    // Result of a lookup in an index that cannot be used, the directory is scanned instead
+    #define EXT_SYSTEM_LOOKUP_NO_INDEX -2
+
+    // Directory entry constants
+    #define EXT_SYSTEM_DIR_ENTRY_HEADER_SIZE 8
+    #define EXT_SYSTEM_DIR_NO_ENTRY 0xFFFFFFFF
+
     // Inode file types
     #define EXT2_FT_UNKNOWN 0
     #define EXT2_FT_REG_FILE 1
     #define EXT2_FT_DIR 2
-    #define EXT2_FT_INIT -1
 
     typedef struct Inode{
     	unsigned short s_inode_size;         // 16bit value indicating the size of the inode structure
@@ -99,6 +163,38 @@
     }BlockGroupDescriptorTable;
 
 
+    typedef struct ExtInodeCache{
+      int slots;                                // Number of cached inode table blocks (power of 2), 0 if disabled
+      int prefetch;                             // 1 if the next inode table block is read together with the one needed
+      unsigned long long *tags;                 // Block number + 1 held by every slot, 0 if the slot is empty
+      unsigned char *data;                      // Content of the cached blocks, one block per slot
+      unsigned long long hits;                  // Number of inodes served from the cache
+      unsigned long long misses;                // Number of inodes that needed a read
+    }ExtInodeCache;
+
+    typedef struct ExtFileSystem{
+      VolumeIO *volume_io;                      // Block I/O handle of the volume
+      ExtInodeData inode;                       // Inode data of the superblock
+      ExtBlockData block;                       // Block data of the superblock
+      ExtVolumeData volume;                     // Volume data of the superblock
+      unsigned int inode_size;                  // Size of one entry of the inode tables
+      unsigned int group_count;                 // Number of block groups
+      BlockGroupDescriptorTable *groups;        // Block group descriptor table, one entry per group
+      ExtInodeCache inode_cache;                // Cache of inode table blocks
+      pthread_mutex_t inode_lock;               // Protects the cache of inode table blocks from the worker threads
+      const char *index_path;                   // Name index file used by /find and /delete, NULL if none
+      int threads;                              // Number of threads walking the folders for /find and /delete
+      OpStats *stats;                           // Statistics of the operation, NULL when --stats is not given
+      int check_bitmaps;                        // 1 if /info counts the free blocks and inodes from the bitmaps (--bitmaps)
+      int output_fd;                            // Descriptor /extract and /ls write to, the standard output by default
+      int list_format;                          // Format of the lines of /ls and /scan, LIST_OUTPUT_JSON or LIST_OUTPUT_TSV
+      SimdInodeFilter scan_filter;              // Conditions the inodes listed by /scan meet
+      int dir_index;                            // 1 if the volume has the dir_index feature, so the index of the directories can be used
+      unsigned int hash_seed[4];                // Seed of the directory index hashes (s_hash_seed)
+      int unsigned_hash;                        // 1 if the index hashes take the characters as unsigned (s_flags)
+    }ExtFileSystem;
+
+
     typedef struct InodeTableEntry{
       unsigned short i_mode;                     // 16bit value used to indicate the format of the described file and the access rights
       unsigned short i_uid;                      // 16bit user id associated with the file
@@ -121,33 +217,139 @@
     }InodeTableEntry;
 
 
-    typedef struct DirEntry{
-      char name_len;                               // 8bit unsigned value indicating how many bytes of character data are contained in the name
-      char file_type;                              // 8bit unsigned value used to indicate file type.
-    	unsigned int inode;                          // 32bit inode number of the file entry. A value of 0 indicate that the entry is not used.
-    	unsigned short rec_len;                      // 16bit unsigned displacement to the next directory entry from the start of the current directory entry
-    	char name[256];                              // Name of the entry. The ISO-Latin-1 character set is expected in most system. The name must be no longer than 255 bytes after encoding
-    }DirEntry;
+    typedef struct ExtExtent{
+      unsigned long long logical;                  // First logical block of the run
+      unsigned long long physical;                 // Block of the volume holding the first logical block, 0 for a hole
+      unsigned int count;                          // Number of blocks of the run
+    }ExtExtent;
+
+    typedef struct ExtBlockMap{
+      ExtFileSystem *fs;                           // Volume where the inode is
+      unsigned int i_block[15];                    // Block pointers of the inode
+      unsigned long long logical;                  // Next logical block to be mapped
+      unsigned long long total;                    // Number of logical blocks of the inode
+      unsigned int per_block;                      // Number of block numbers that fit in one indirect block
+      unsigned int *table[EXT_SYSTEM_INDIRECT_LEVELS];  // Last indirect block read at every depth
+      unsigned int loaded[EXT_SYSTEM_INDIRECT_LEVELS];  // Block number of the indirect block held at every depth, 0 if none
+    }ExtBlockMap;
+
+    typedef struct DirEntryView{
+      unsigned int inode;                          // 32bit inode number of the file entry. A value of 0 indicate that the entry is not used.
+      unsigned short rec_len;                      // 16bit unsigned displacement to the next directory entry from the start of the current directory entry
+      unsigned char name_len;                      // 8bit unsigned value indicating how many bytes of character data are contained in the name
+      unsigned char file_type;                     // 8bit unsigned value used to indicate file type.
+      const char *name;                            // Name of the entry inside the directory block, it is not '\0' terminated
+      unsigned int offset;                         // Position of the entry inside the directory block
+      unsigned int prev_offset;                    // Position of the previous entry of the block, EXT_SYSTEM_DIR_NO_ENTRY for the first one
+    }DirEntryView;
+
+    typedef struct ExtDirLookup{
+      unsigned int inode;                          // Inode of the entry found
+      unsigned char file_type;                     // Type of the entry found
+      unsigned long long block_position;           // Position of the directory block holding the entry
+      unsigned int offset;                         // Position of the entry inside the block
+    }ExtDirLookup;
+
+    typedef struct ExtExtractMatch{
+      Target *target;                              // Name of the file extracted
+      int found;                                   // 1 once a file with the name has been found
+      unsigned int inode;                          // Inode of the file found
+    }ExtExtractMatch;
+
+    typedef struct ExtFindNode ExtFindNode;
+
+    typedef struct ExtFindItem{
+      Target *target;                              // Target of the file found, NULL when the item is a subfolder
+      char *name;                                  // Name of the file found for a pattern, NULL for a plain name
+      unsigned long long size;                     // Size of the file found
+      ExtFindNode *folder;                         // Results of the subfolder, NULL when the item is a file
+    }ExtFindItem;
+
+    struct ExtFindNode{
+      struct ExtFindOperation *operation;          // Operation the folder is walked for
+      unsigned int inode;                          // Inode of the folder
+      ExtFindItem *items;                          // Files found and subfolders, in the order of their directory entries
+      int count;                                   // Number of items
+      int capacity;                                // Number of items allocated
+    };
+
+    typedef struct ExtFindOperation{
+      ExtFileSystem *fs;                           // Volume walked
+      TargetSet *targets;                          // Names looked for
+      int is_delete;                               // 1 to delete the files found, 0 to show their size
+      WorkPool *pool;                              // Threads walking the folders, NULL to walk them recursively in order
+      unsigned char **scratch;                     // Buffer of one extent of directory blocks for every worker
+    }ExtFindOperation;
+
+    typedef struct ExtScanMatch{
+      unsigned int inode;                          // Inode that meets the conditions of /scan
+      int type;                                    // FILE_ENTRY_FILE, FILE_ENTRY_DIRECTORY or FILE_ENTRY_OTHER, from i_mode
+      unsigned int links;                          // Number of hard links, names still to be listed for a file
+      unsigned int mtime;                          // Last modification, in seconds since 1970
+      unsigned int atime;                          // Last access, in seconds since 1970
+      unsigned long long size;                     // Size in bytes
+    }ExtScanMatch;
+
+    typedef struct ExtScan{
+      ExtScanMatch *matches;                       // Inodes that meet the conditions, sorted by their number
+      unsigned int count;                          // Number of matches
+      unsigned int capacity;                       // Number of matches allocated
+      unsigned long long remaining;                // Names of the matches not found yet by the walk of the folders
+      ListOutput *output;                          // Listing the matches are written to
+    }ExtScan;
+
+    typedef struct DirBlockParser{
+      const unsigned char *data;                   // Content of the directory block (mapping of the volume or buffer)
+      unsigned int size;                           // Size of the directory block
+      unsigned int offset;                         // Position of the next entry to be parsed
+      unsigned int last_offset;                    // Position of the last entry parsed
+    }DirBlockParser;
 
 
 
 
 
-    int Ex2System_isExt (int fd);
-    ExtInodeData Ex2System_readInode (int fd);
-    ExtBlockData Ex2System_readBlock (int fd);
-    ExtVolumeData Ex2System_readVolume(int fd);
+    int Ex2System_isExt (VolumeIO *volume_io);
+    ExtInodeData Ex2System_readInode (VolumeIO *volume_io);
+    ExtBlockData Ex2System_readBlock (VolumeIO *volume_io);
+    ExtVolumeData Ex2System_readVolume(VolumeIO *volume_io);
     void EX2System_printVolume(ExtVolumeData volume);
     void EX2System_printBlock(ExtBlockData block);
     void EX2System_printInode(ExtInodeData inode);
-    void EX2SYSTEM_executeOperation(char * operation, char* file, int volume_fd);
-    void EX2System_findFile(char* filename, int volume_fd, ExtBlockData block, ExtInodeData inode, unsigned int root_inode);
-    void Ext2System_fillBlockGroupDescriptorTable(int fd, unsigned int block_size, 	BlockGroupDescriptorTable *bg_descriptor_table );
-    InodeTableEntry Ext2System_findAndGetInode(unsigned int first_inode, BlockGroupDescriptorTable *bg_descriptor_table, ExtBlockData block, ExtInodeData inode, int volume_fd );
-    DirEntry Ext2System_readDirEntry(int volume_fd, unsigned short *len, int dir_entry_block_position);
-    int Ext2System_isDirectory(char *filename, int file_type);
-    int Ext2System_isFound();
-    void Ext2System_deleteEntry(unsigned short ptr_next_inode_name, unsigned int dir_entry_block_position, unsigned short prev_dir_len, DirEntry directory_entry, int volume_fd);
+    ExtFileSystem *Ext2System_open(VolumeIO *volume_io);
+    void Ext2System_close(ExtFileSystem *fs);
+    int Ext2System_setInodeCache(ExtFileSystem *fs, int blocks, int prefetch);
+    const unsigned char *Ext2System_getInodeEntry(ExtFileSystem *fs, unsigned int inode_number, void *scratch);
+    void Ext2System_printCacheStats(ExtFileSystem *fs);
+    void EX2SYSTEM_executeOperation(char * operation, TargetSet *targets, ExtFileSystem *fs);
+    void Ext2System_setThreads(ExtFileSystem *fs, int threads);
+    void EX2System_findFile(TargetSet *targets, ExtFileSystem *fs, int is_delete);
+    int Ext2System_walk(ExtFileSystem *fs, FileEntryVisitor visitor, void *context);
+    void Ext2System_setIndex(ExtFileSystem *fs, const char *index_path);
+    void Ext2System_setStats(ExtFileSystem *fs, OpStats *stats);
+    void Ext2System_setBitmapCheck(ExtFileSystem *fs, int check_bitmaps);
+    void Ext2System_checkBitmaps(ExtFileSystem *fs);
+    void Ext2System_setOutput(ExtFileSystem *fs, int output_fd);
+    void Ext2System_setListFormat(ExtFileSystem *fs, int list_format);
+    void Ext2System_initScanFilter(SimdInodeFilter *filter);
+    int Ext2System_parseScanFilter(SimdInodeFilter *filter, const char *condition);
+    void Ext2System_setScanFilter(ExtFileSystem *fs, const SimdInodeFilter *filter);
+    long long Ext2System_copyFile(ExtFileSystem *fs, const InodeTableEntry *inode_entry, int out_fd);
+    int Ext2System_lookup(ExtFileSystem *fs, unsigned int dir_inode, const char *name, size_t name_len, ExtDirLookup *result);
+    int Ext2System_deleteAt(ExtFileSystem *fs, unsigned long long block_position, unsigned int offset, unsigned int inode_number, const char *name);
+    int Ext2System_readGroupDescriptors(ExtFileSystem *fs);
+    unsigned long long Ext2System_getInodePosition(ExtFileSystem *fs, unsigned int inode_number);
+    InodeTableEntry Ext2System_findAndGetInode(ExtFileSystem *fs, unsigned int inode_number);
+    int Ext2System_initBlockMap(ExtBlockMap *block_map, ExtFileSystem *fs, const InodeTableEntry *inode_entry);
+    void Ext2System_freeBlockMap(ExtBlockMap *block_map);
+    unsigned int Ext2System_mapBlock(ExtBlockMap *block_map, unsigned long long logical);
+    int Ext2System_nextExtent(ExtBlockMap *block_map, ExtExtent *extent, unsigned int max_blocks);
+    unsigned long long Ext2System_getInodeSize(const InodeTableEntry *inode_entry);
+    void Ext2System_initDirBlock(DirBlockParser *parser, const unsigned char *data, unsigned int size);
+    int Ext2System_nextDirEntry(DirBlockParser *parser, DirEntryView *directory_entry);
+    int Ext2System_isDotEntry(const DirEntryView *directory_entry);
+    int Ext2System_isDirectory(const DirEntryView *directory_entry);
+    void Ext2System_deleteEntry(VolumeIO *volume_io, unsigned long long dir_entry_block_position, DirBlockParser *parser, const DirEntryView *directory_entry);
 
 
 
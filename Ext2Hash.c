@@ -0,0 +1,209 @@
+/***********************************************
+*
+* @Purpose: Name hashes of the Ext2 directory indexes (HTree), as computed by the Linux Ext2/3/4 drivers
+* @Author: Óscar Cubeles Ollé
+* @Creation Date: October 2026
+*
+************************************************/
+#include <string.h>
+
+#include "Ext2Hash.h"
+
+#define EXT2_HASH_ROTATE(value, bits) (((value) << (bits)) | ((value) >> (32 - (bits))))
+#define EXT2_HASH_F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define EXT2_HASH_G(x, y, z) (((x) & (y)) + (((x) ^ (y)) & (z)))
+#define EXT2_HASH_H(x, y, z) ((x) ^ (y) ^ (z))
+#define EXT2_HASH_ROUND(f, a, b, c, d, x, s) (a += f(b, c, d) + (x), a = EXT2_HASH_ROTATE(a, s))
+
+
+/***********************************************
+*
+* @Purpose: Checks whether a hash version is known
+* @Parameters: int version, hash version, including the unsigned variants
+* @Return: 1 if it can be computed, 0 otherwise
+*
+************************************************/
+int Ext2Hash_isValidVersion(int version){
+	return version >= EXT2_HASH_LEGACY && version <= EXT2_HASH_TEA_UNSIGNED;
+}
+
+
+/***********************************************
+*
+* @Purpose: Legacy hash of the first indexed directories
+* @Parameters: const char *name, name to be hashed
+*              size_t name_len, length of the name
+*              int is_unsigned, 1 to take the characters as unsigned
+* @Return: the hash
+*
+************************************************/
+static unsigned int Ext2Hash_legacy(const char *name, size_t name_len, int is_unsigned){
+	unsigned int hash, hash0 = 0x12A3FE2D, hash1 = 0x37ABE8F9;
+	int character;
+
+	for (size_t i = 0; i < name_len; i++){
+		character = is_unsigned ? (int) (unsigned char) name[i] : (int) (signed char) name[i];
+		hash = hash1 + (hash0 ^ (unsigned int) (character * 7152373));
+		if (hash & 0x80000000){
+			hash -= 0x7FFFFFFF;
+		}
+		hash1 = hash0;
+		hash0 = hash;
+	}
+	return hash0 << 1;
+}
+
+
+/***********************************************
+*
+* @Purpose: Packs up to 4 * words characters of a name in words, padding them with the length of the name
+* @Parameters: const char *name, characters to be packed
+*              size_t name_len, number of characters left in the name
+*              unsigned int *words, filled with the packed characters
+*              int count, number of words to be filled
+*              int is_unsigned, 1 to take the characters as unsigned
+* @Return: -
+*
+************************************************/
+static void Ext2Hash_packName(const char *name, size_t name_len, unsigned int *words, int count, int is_unsigned){
+	unsigned int pad, value;
+	int character;
+
+	pad = (unsigned int) name_len | ((unsigned int) name_len << 8);
+	pad |= pad << 16;
+	value = pad;
+	if (name_len > (size_t) count * 4){
+		name_len = (size_t) count * 4;
+	}
+	for (size_t i = 0; i < name_len; i++){
+		character = is_unsigned ? (int) (unsigned char) name[i] : (int) (signed char) name[i];
+		value = (unsigned int) character + (value << 8);
+		if (i % 4 == 3){
+			*words++ = value;
+			value = pad;
+			count--;
+		}
+	}
+	if (--count >= 0){
+		*words++ = value;
+	}
+	while (--count >= 0){
+		*words++ = pad;
+	}
+}
+
+
+/***********************************************
+*
+* @Purpose: Mixes 8 words into the state with the three rounds of half MD4
+* @Parameters: unsigned int state[4], state of the hash
+*              const unsigned int in[8], words to be mixed
+* @Return: -
+*
+************************************************/
+static void Ext2Hash_halfMd4(unsigned int state[4], const unsigned int in[8]){
+	unsigned int a = state[0], b = state[1], c = state[2], d = state[3];
+
+	EXT2_HASH_ROUND(EXT2_HASH_F, a, b, c, d, in[0], 3);
+	EXT2_HASH_ROUND(EXT2_HASH_F, d, a, b, c, in[1], 7);
+	EXT2_HASH_ROUND(EXT2_HASH_F, c, d, a, b, in[2], 11);
+	EXT2_HASH_ROUND(EXT2_HASH_F, b, c, d, a, in[3], 19);
+	EXT2_HASH_ROUND(EXT2_HASH_F, a, b, c, d, in[4], 3);
+	EXT2_HASH_ROUND(EXT2_HASH_F, d, a, b, c, in[5], 7);
+	EXT2_HASH_ROUND(EXT2_HASH_F, c, d, a, b, in[6], 11);
+	EXT2_HASH_ROUND(EXT2_HASH_F, b, c, d, a, in[7], 19);
+
+	EXT2_HASH_ROUND(EXT2_HASH_G, a, b, c, d, in[1] + EXT2_HASH_MD4_K2, 3);
+	EXT2_HASH_ROUND(EXT2_HASH_G, d, a, b, c, in[3] + EXT2_HASH_MD4_K2, 5);
+	EXT2_HASH_ROUND(EXT2_HASH_G, c, d, a, b, in[5] + EXT2_HASH_MD4_K2, 9);
+	EXT2_HASH_ROUND(EXT2_HASH_G, b, c, d, a, in[7] + EXT2_HASH_MD4_K2, 13);
+	EXT2_HASH_ROUND(EXT2_HASH_G, a, b, c, d, in[0] + EXT2_HASH_MD4_K2, 3);
+	EXT2_HASH_ROUND(EXT2_HASH_G, d, a, b, c, in[2] + EXT2_HASH_MD4_K2, 5);
+	EXT2_HASH_ROUND(EXT2_HASH_G, c, d, a, b, in[4] + EXT2_HASH_MD4_K2, 9);
+	EXT2_HASH_ROUND(EXT2_HASH_G, b, c, d, a, in[6] + EXT2_HASH_MD4_K2, 13);
+
+	EXT2_HASH_ROUND(EXT2_HASH_H, a, b, c, d, in[3] + EXT2_HASH_MD4_K3, 3);
+	EXT2_HASH_ROUND(EXT2_HASH_H, d, a, b, c, in[7] + EXT2_HASH_MD4_K3, 9);
+	EXT2_HASH_ROUND(EXT2_HASH_H, c, d, a, b, in[2] + EXT2_HASH_MD4_K3, 11);
+	EXT2_HASH_ROUND(EXT2_HASH_H, b, c, d, a, in[6] + EXT2_HASH_MD4_K3, 15);
+	EXT2_HASH_ROUND(EXT2_HASH_H, a, b, c, d, in[1] + EXT2_HASH_MD4_K3, 3);
+	EXT2_HASH_ROUND(EXT2_HASH_H, d, a, b, c, in[5] + EXT2_HASH_MD4_K3, 9);
+	EXT2_HASH_ROUND(EXT2_HASH_H, c, d, a, b, in[0] + EXT2_HASH_MD4_K3, 11);
+	EXT2_HASH_ROUND(EXT2_HASH_H, b, c, d, a, in[4] + EXT2_HASH_MD4_K3, 15);
+
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+}
+
+
+/***********************************************
+*
+* @Purpose: Mixes 4 words into the first two words of the state with 16 rounds of TEA
+* @Parameters: unsigned int state[4], state of the hash
+*              const unsigned int in[4], words to be mixed
+* @Return: -
+*
+************************************************/
+static void Ext2Hash_tea(unsigned int state[4], const unsigned int in[4]){
+	unsigned int sum = 0;
+	unsigned int b0 = state[0], b1 = state[1];
+
+	for (int i = 0; i < 16; i++){
+		sum += EXT2_HASH_TEA_DELTA;
+		b0 += ((b1 << 4) + in[0]) ^ (b1 + sum) ^ ((b1 >> 5) + in[1]);
+		b1 += ((b0 << 4) + in[2]) ^ (b0 + sum) ^ ((b0 >> 5) + in[3]);
+	}
+	state[0] += b0;
+	state[1] += b1;
+}
+
+
+/***********************************************
+*
+* @Purpose: Computes the hash that sorts a name in a directory index. The lowest bit is always 0, the index uses
+*           it to mark the blocks that continue a run of equal hashes
+* @Parameters: const char *name, name to be hashed, it does not need to end with '\0'
+*              size_t name_len, length of the name
+*              int version, hash version, including the unsigned variants
+*              const unsigned int seed[4], hash seed of the superblock, all zeros to use the default one
+* @Return: the hash
+*
+************************************************/
+unsigned int Ext2Hash_compute(const char *name, size_t name_len, int version, const unsigned int seed[4]){
+	unsigned int state[4] = {EXT2_HASH_DEFAULT_SEED};
+	unsigned int in[8];
+	unsigned int hash = 0;
+	int is_unsigned = version >= EXT2_HASH_LEGACY_UNSIGNED;
+
+	if (seed != NULL && (seed[0] | seed[1] | seed[2] | seed[3]) != 0){
+		memcpy(state, seed, sizeof(state));
+	}
+	switch (is_unsigned ? version - EXT2_HASH_UNSIGNED_DELTA : version){
+		case EXT2_HASH_LEGACY:
+			hash = Ext2Hash_legacy(name, name_len, is_unsigned);
+			break;
+		case EXT2_HASH_HALF_MD4:
+			// 32 characters at a time
+			for (size_t done = 0; done < name_len; done += 32){
+				Ext2Hash_packName(name + done, name_len - done, in, 8, is_unsigned);
+				Ext2Hash_halfMd4(state, in);
+			}
+			hash = state[1];
+			break;
+		case EXT2_HASH_TEA:
+			// 16 characters at a time
+			for (size_t done = 0; done < name_len; done += 16){
+				Ext2Hash_packName(name + done, name_len - done, in, 4, is_unsigned);
+				Ext2Hash_tea(state, in);
+			}
+			hash = state[0];
+			break;
+	}
+	hash &= ~1U;
+	if (hash == (EXT2_HASH_EOF << 1)){
+		hash = (EXT2_HASH_EOF - 1) << 1;
+	}
+	return hash;
+}
@@ -0,0 +1,36 @@
+/***********************************************
+*
+* @Purpose: Name hashes of the Ext2 directory indexes (HTree): legacy, half MD4 and TEA, in their signed and
+*           unsigned char variants
+* @Author: Óscar Cubeles Ollé
+* @Creation Date: October 2026
+*
+************************************************/
+#ifndef EXT2HASH_H
+    #define EXT2HASH_H
+
+    #include <sys/types.h>
+
+    // Hash versions stored in the root of the directory indexes
+    #define EXT2_HASH_LEGACY 0
+    #define EXT2_HASH_HALF_MD4 1
+    #define EXT2_HASH_TEA 2
+    #define EXT2_HASH_LEGACY_UNSIGNED 3
+    #define EXT2_HASH_HALF_MD4_UNSIGNED 4
+    #define EXT2_HASH_TEA_UNSIGNED 5
+    // Distance between a hash version and its unsigned char variant
+    #define EXT2_HASH_UNSIGNED_DELTA 3
+
+    // Seed used when the superblock does not have one
+    #define EXT2_HASH_DEFAULT_SEED 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476
+    // Value reserved to the end of the directory, replaced by the previous one
+    #define EXT2_HASH_EOF 0x7FFFFFFFU
+    // Constants of the half MD4 rounds and of TEA
+    #define EXT2_HASH_MD4_K2 013240474631U
+    #define EXT2_HASH_MD4_K3 015666365641U
+    #define EXT2_HASH_TEA_DELTA 0x9E3779B9
+
+
+    int Ext2Hash_isValidVersion(int version);
+    unsigned int Ext2Hash_compute(const char *name, size_t name_len, int version, const unsigned int seed[4]);
+#endif
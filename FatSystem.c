@@ -11,20 +11,31 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <pthread.h>
 
-
+#include "VolumeIO.h"
+#include "NameIndex.h"
+#include "TargetSet.h"
+#include "Simd.h"
 #include "FatSystem.h"
 
-int fat_isFound = 0;
-int fat_isDelete = 0;
-char *uppercase_name;
+static int FatSystem_walkDirectory(FatFileSystem *fs, unsigned int first_cluster, char *path, size_t path_len, FileEntryVisitor visitor, void *context);
+static int FatSystem_walkEntries(FatFileSystem *fs, unsigned long long initial_address, size_t size, char *buffer, FatLongName *long_name,
+		char *path, size_t path_len, FileEntryVisitor visitor, void *context);
+static NameIndex *FatSystem_loadIndex(FatFileSystem *fs);
+static int FatSystem_deleteIndexed(Target *target, TargetSet *targets, FatFileSystem *fs, NameIndex *index);
+static NameIndexRecord *FatSystem_nextPatternRecord(Target *target, TargetSet *targets, NameIndex *index, NameIndexRecord *previous);
+static void FatSystem_resolvePaths(TargetSet *targets, FatFileSystem *fs, int is_delete);
+static void FatSystem_extract(TargetSet *targets, FatFileSystem *fs);
+static void FatSystem_list(FatFileSystem *fs);
 
 
 /***********************************************
 *
-* @Purpose: Returns an integer corresponding to the operation string, /info -> 0, /find -> 1, /delete -> 2, else -> -1
-* @Parameters: char *operation: operation to be done on the Ext2 filesystem
-*              Valid operations: /info, /find, /delete
+* @Purpose: Returns an integer corresponding to the operation string, /info -> 0, /find -> 1, /delete -> 2,
+*           /extract -> 3, /ls -> 4, /scan -> 5, else -> -1
+* @Parameters: char *operation: operation to be done on the FAT16 filesystem
+*              Valid operations: /info, /find, /delete, /extract, /ls, /scan
 *
 * @Return: An integer corresponding to the operation string
 *
@@ -36,6 +47,12 @@ int FatSystem_getOperationNumber(char *operation){
 		return 1;
 	}else if(strcmp(operation,"/delete") == 0){
 		return 2;
+	}else if(strcmp(operation,"/extract") == 0){
+		return 3;
+	}else if(strcmp(operation,"/ls") == 0){
+		return 4;
+	}else if(strcmp(operation,"/scan") == 0){
+		return 5;
 	}
 	return -1;
 }
@@ -43,44 +60,174 @@ int FatSystem_getOperationNumber(char *operation){
 
 /***********************************************
 *
-* @Purpose: Executes the action according to operation and filename on a FAT16 filesystem
-* @Parameters: int volume_fd, file descriptor of the volume read
-*              char* operation, operation to be executed /find, /delete,/info
-*              char *file, file with which the action is executed
+* @Purpose: Opens a FAT16 volume: reads the boot sector data and loads the first FAT in memory, so that
+*           cluster chains are followed without reading the volume
+* @Parameters: VolumeIO *volume_io, block I/O handle of the volume
+* @Return:  pointer to the FatFileSystem structure, NULL if there is not enough memory or the FAT cannot be read
+*
+************************************************/
+FatFileSystem *FatSystem_open(VolumeIO *volume_io){
+	FatFileSystem *fs = (FatFileSystem *) calloc(1, sizeof(FatFileSystem));
+	FatSystem fat_system;
+	unsigned int total_sectors, root_dir_sectors, first_data_sector, fat_entries;
+	size_t fat_size;
+
+	if (fs == NULL) return NULL;
+	fat_system = FatSystem_readSystem(volume_io);
+	fs->volume_io = volume_io;
+	fs->fat_system = fat_system;
+	fs->threads = 1;
+	fs->output_fd = STDOUT_FILENO;
+	fs->list_format = LIST_OUTPUT_JSON;
+	if (fat_system.BPB_BytsPerSec == 0 || fat_system.BPB_SecPerClus == 0 || fat_system.BPB_FATSz16 == 0){
+		free(fs);
+		return NULL;
+	}
+
+	// Layout of the volume (formulas from the page 13 of the manual)
+	total_sectors = fat_system.BPB_TotSec16 != 0 ? fat_system.BPB_TotSec16 : fat_system.BPB_TotSec32;
+	root_dir_sectors = ((fat_system.BPB_RootEntCnt * FAT_SYSTEM_DIR_ENTRY_SIZE) + (fat_system.BPB_BytsPerSec - 1)) / fat_system.BPB_BytsPerSec;
+	first_data_sector = fat_system.BPB_RsvdSecCnt + (fat_system.BPB_NumFATs * fat_system.BPB_FATSz16) + root_dir_sectors;
+	fs->fat_position = (unsigned long long) fat_system.BPB_RsvdSecCnt * fat_system.BPB_BytsPerSec;
+	fs->root_position = FatSystem_calculateRootDirectory(fat_system);
+	fs->first_data_position = (unsigned long long) first_data_sector * fat_system.BPB_BytsPerSec;
+	fs->cluster_size = (unsigned int) fat_system.BPB_SecPerClus * fat_system.BPB_BytsPerSec;
+	fs->cluster_count = total_sectors > first_data_sector ? (total_sectors - first_data_sector) / fat_system.BPB_SecPerClus : 0;
+
+	// Loading the first FAT, with a 16 bit entry per cluster (the first two are reserved)
+	fat_size = (size_t) fat_system.BPB_FATSz16 * fat_system.BPB_BytsPerSec;
+	fat_entries = fat_size / sizeof(unsigned short);
+	if (fs->cluster_count + FAT_SYSTEM_FIRST_CLUSTER > fat_entries){
+		fs->cluster_count = fat_entries - FAT_SYSTEM_FIRST_CLUSTER;
+	}
+	fs->fat = (unsigned short *) malloc(fat_size);
+	if (fs->fat == NULL){
+		free(fs);
+		return NULL;
+	}
+	VolumeIO_advise(volume_io, fs->fat_position, fat_size, VOLUME_IO_ADVICE_SEQUENTIAL);
+	if (VolumeIO_read(volume_io, fs->fat_position, fs->fat, fat_size) != (ssize_t) fat_size){
+		FatSystem_close(fs);
+		return NULL;
+	}
+	return fs;
+}
+
+
+/***********************************************
+*
+* @Purpose: Frees the data of a FAT16 volume. The block I/O handle is not closed
+* @Parameters: FatFileSystem *fs, volume to be freed
 * @Return:  -
 *
 ************************************************/
-void FatSystem_executeOperation(char * operation, char* file, int volume_fd){
-  FatSystem fat_system;
-	unsigned int root_address = 0;
-	fat_system = FatSystem_readSystem(volume_fd);
+void FatSystem_close(FatFileSystem *fs){
+	if (fs == NULL) return;
+	free(fs->fat);
+	free(fs);
+}
 
-	// Converting the name in the correct format
-	//printf("%s\n", file);
 
-	//printf("%s\n", file);
+/***********************************************
+*
+* @Purpose: Executes the action according to operation and filename on a FAT16 filesystem
+* @Parameters: FatFileSystem *fs, FAT16 volume opened with FatSystem_open
+*              char* operation, operation to be executed /find, /delete,/info
+*              TargetSet *targets, names of the files with which the action is executed, all of them in a single walk
+* @Return:  -
+*
+************************************************/
+void FatSystem_executeOperation(char * operation, TargetSet *targets, FatFileSystem *fs){
+	VolumeIO *volume_io = fs->volume_io;
+	NameIndexRecord *record;
+	NameIndex *index;
+	Target *target;
+	int need_walk = 0, stale = 0, result;
 
 	switch(FatSystem_getOperationNumber(operation)){
 		case 0:
 			// Reading and writing FAT16 info filesystem data
-      FatSystem_displayFatInfo(fat_system);
+      FatSystem_displayFatInfo(fs->fat_system);
+			FatSystem_displayFatStats(fs);
 			break;
 		case 1:
-			root_address = FatSystem_calculateRootDirectory(fat_system);
-			FatSystem_fileToUpper(file);
-			FatSystem_findFile(file, volume_fd, root_address,fat_system);
-			if(fat_isFound == 0){
-				printf("Sorry, there is no file %s in the filesystem\n", file);
+			// The tree walk jumps between directories, so read-ahead is not useful
+			VolumeIO_advise(volume_io, 0, 0, VOLUME_IO_ADVICE_RANDOM);
+			// Absolute paths are resolved a folder at a time, only the bare names need the index or a walk
+			OpStats_startPhase(fs->stats, OP_STATS_PHASE_PATHS);
+			FatSystem_resolvePaths(targets, fs, 0);
+			// Through the name index when there is one, the first file found by the walk is the first one of the index
+			OpStats_startPhase(fs->stats, OP_STATS_PHASE_INDEX);
+			index = TargetSet_hasNames(targets) ? FatSystem_loadIndex(fs) : NULL;
+			if (index != NULL){
+				for (int i = 0; i < targets->count; i++){
+					target = &targets->targets[i];
+					if (target->is_pattern){
+						// All the files of a pattern, shown with their own name
+						record = NULL;
+						while ((record = FatSystem_nextPatternRecord(target, targets, index, record)) != NULL){
+							printf("File: %s found! It has %llu bytes\n", NameIndex_getString(index, record->name), record->size);
+							TargetSet_setFound(targets, target);
+						}
+						continue;
+					}
+					record = NameIndex_find(index, target->name, NULL);
+					if (record != NULL){
+						printf("File: %s found! It has %llu bytes\n", target->name, record->size);
+						TargetSet_setFound(targets, target);
+					}
+				}
+				NameIndex_close(index);
+			}else if (TargetSet_hasNames(targets)){
+				OpStats_startPhase(fs->stats, OP_STATS_PHASE_WALK);
+				FatSystem_findFile(targets, fs, 0);
 			}
+			OpStats_endPhase(fs->stats);
+			FatSystem_printNotFound(targets);
 			break;
 		case 2:
-			fat_isDelete = 1;
-			FatSystem_fileToUpper(file);
-			root_address = FatSystem_calculateRootDirectory(fat_system);
-			FatSystem_findFile(file, volume_fd, root_address,fat_system);
-			if(fat_isFound == 0){
-				printf("Sorry, there is no file %s in the filesystem\n", file);
+			VolumeIO_advise(volume_io, 0, 0, VOLUME_IO_ADVICE_RANDOM);
+			// The entries deleted are kept in the block cache and written together at the end
+			VolumeIO_beginBatch(volume_io);
+			// The files that cannot be deleted through the index are deleted by a walk. An index that does not
+			// match the volume is removed
+			OpStats_startPhase(fs->stats, OP_STATS_PHASE_PATHS);
+			FatSystem_resolvePaths(targets, fs, 1);
+			OpStats_startPhase(fs->stats, OP_STATS_PHASE_INDEX);
+			index = TargetSet_hasNames(targets) ? FatSystem_loadIndex(fs) : NULL;
+			need_walk = index == NULL && TargetSet_hasNames(targets);
+			for (int i = 0; index != NULL && i < targets->count && stale == 0; i++){
+				result = FatSystem_deleteIndexed(&targets->targets[i], targets, fs, index);
+				need_walk |= result <= 0;
+				stale = result < 0;
+			}
+			if (stale){
+				NameIndex_remove(index, fs->index_path);
+				index = NULL;
+			}
+			if (need_walk){
+				OpStats_startPhase(fs->stats, OP_STATS_PHASE_WALK);
+				FatSystem_findFile(targets, fs, 1);
 			}
+			NameIndex_close(index);
+			// Writing the directory blocks changed, sorted by their position, and flushing them to the disk at once
+			OpStats_startPhase(fs->stats, OP_STATS_PHASE_SYNC);
+			VolumeIO_flush(volume_io);
+			OpStats_endPhase(fs->stats);
+			FatSystem_printNotFound(targets);
+			break;
+		case 3:
+			VolumeIO_advise(volume_io, 0, 0, VOLUME_IO_ADVICE_RANDOM);
+			FatSystem_extract(targets, fs);
+			FatSystem_printNotFound(targets);
+			break;
+		case 4:
+			VolumeIO_advise(volume_io, 0, 0, VOLUME_IO_ADVICE_RANDOM);
+			FatSystem_list(fs);
+			break;
+		case 5:
+			// FAT16 has no inode tables to sweep, its directory entries are only reached by walking the folders
+			printf("The /scan operation needs an Ext2 volume, use /ls to list a FAT16 volume\n");
 			break;
 		default :
 			printf("Unknown operation %s\n", operation);
@@ -91,35 +238,30 @@ void FatSystem_executeOperation(char * operation, char* file, int volume_fd){
 
 /***********************************************
 *
-* @Purpose: Converts a string of characters to uppercase
-* @Parameters: char *file: string to be converted to upper case
+* @Purpose: Shows the names of the targets for which no file has been found
+* @Parameters: TargetSet *targets, names looked for
 * @Return:  -
 *
 ************************************************/
-void FatSystem_fileToUpper(char *file){
-	uppercase_name = (char *)malloc((int)strlen(file));
-	strcpy(uppercase_name, file);
-	//printf("%s\n", uppercase_name);
-	//printf("File name len: %d\n", (int)strlen(file));
-	for (int i = 0; uppercase_name[i]!='\0'; i++) {
-		 if(uppercase_name[i] >= 'a' && file[i] <= 'z') {
-				uppercase_name[i] = uppercase_name[i] -'a'+'A';
-		 }
+void FatSystem_printNotFound(TargetSet *targets){
+	for (int i = 0; i < targets->count; i++){
+		if (targets->targets[i].found == 0){
+			printf("Sorry, there is no file %s in the filesystem\n", targets->targets[i].name);
+		}
 	}
 }
 
 
 /***********************************************
 *
-* @Purpose: Determine if the volume specidied by fd is a FAT16 volume
-* @Parameters: int fd, file descriptor of the volume read
+* @Purpose: Determine if the volume specidied by volume_io is a FAT16 volume
+* @Parameters: VolumeIO *volume_io, block I/O handle of the volume read
 * @Return: 1 if it is ext, else 0
 *
 ************************************************/
-int FatSystem_isFatSystem(int fd){
-  	char * buff = (char *) malloc (sizeof(char) * FAT_SYSTEM_SYSTYPE_SIZE);
-  	lseek(fd, FAT_SYSTEM_SYSTYPE_OFFSET, SEEK_SET);
-  	read (fd, buff, FAT_SYSTEM_SYSTYPE_SIZE);
+int FatSystem_isFatSystem(VolumeIO *volume_io){
+  	char * buff = (char *) calloc (FAT_SYSTEM_SYSTYPE_SIZE + 1, sizeof(char));
+  	VolumeIO_read(volume_io, FAT_SYSTEM_SYSTYPE_OFFSET, buff, FAT_SYSTEM_SYSTYPE_SIZE);
   	if (strcmp(buff, FAT_SYSYTEM_NAME) == 0) {
       free(buff);
   		return 1;
@@ -132,39 +274,34 @@ int FatSystem_isFatSystem(int fd){
 /***********************************************
 *
 * @Purpose: Reads the FAT16 filesystem metadata information from the volume file
-* @Parameters: int fd, file descriptor of the volume read
+* @Parameters: VolumeIO *volume_io, block I/O handle of the volume read
 * @Return:  FatSystem structure containing the information about an FAT16 filesystem
 *
 ************************************************/
-FatSystem FatSystem_readSystem(int fd){
+FatSystem FatSystem_readSystem(VolumeIO *volume_io){
   FatSystem fat_system;
   // The system is always FAT16
   strcpy(fat_system.system_type, "FAT16");
   // Reserved Factors
-  lseek(fd, FAT_SYSTEM_RESERVED_SECTORS_OFFSET, SEEK_SET);
-	read(fd, &(fat_system.BPB_RsvdSecCnt), FAT_SYSTEM_RESERVED_SECTORS_SIZE);
+  VolumeIO_read(volume_io, FAT_SYSTEM_RESERVED_SECTORS_OFFSET, &(fat_system.BPB_RsvdSecCnt), FAT_SYSTEM_RESERVED_SECTORS_SIZE);
   // printf("Buffer reserved sectors: %d\n", fat_system.num_reserved_sectors);
   // Name
-  lseek(fd, FAT_SYSTEM_NAME_OFFSET, SEEK_SET);
-	read(fd, &(fat_system.BS_OEMName),FAT_SYSTEM_NAME_SIZE);
+  VolumeIO_read(volume_io, FAT_SYSTEM_NAME_OFFSET, &(fat_system.BS_OEMName), FAT_SYSTEM_NAME_SIZE);
   // label
-  lseek(fd, FAT_SYSTEM_LABEL_OFFSET, SEEK_SET);
-	read(fd, &(fat_system.BS_VolLab), FAT_SYSTEM_LABEL_SIZE);
+  VolumeIO_read(volume_io, FAT_SYSTEM_LABEL_OFFSET, &(fat_system.BS_VolLab), FAT_SYSTEM_LABEL_SIZE);
   // Sectors per cluster
-  lseek(fd, FAT_SYSTEM_SECTOR_CLUSTER_OFFSET, SEEK_SET);
-	read(fd, &fat_system.BPB_SecPerClus,FAT_SYSTEM_SECTOR_CLUSTER_SIZE);
+  VolumeIO_read(volume_io, FAT_SYSTEM_SECTOR_CLUSTER_OFFSET, &fat_system.BPB_SecPerClus, FAT_SYSTEM_SECTOR_CLUSTER_SIZE);
   // Number of fats
-  lseek(fd, FAT_SYSTEM_NUM_FATS_OFFSET, SEEK_SET);
-	read(fd, &(fat_system.BPB_NumFATs),FAT_SYSTEM_NUM_FATS_SIZE);
+  VolumeIO_read(volume_io, FAT_SYSTEM_NUM_FATS_OFFSET, &(fat_system.BPB_NumFATs), FAT_SYSTEM_NUM_FATS_SIZE);
   // Number of sectors
-  lseek(fd, FAT_SYSTEM_SECTORS_PER_FAT_OFFSET, SEEK_SET);
-	read(fd, &(fat_system.BPB_FATSz16),FAT_SYSTEM_SECTORS_PER_FAT_SIZE);
+  VolumeIO_read(volume_io, FAT_SYSTEM_SECTORS_PER_FAT_OFFSET, &(fat_system.BPB_FATSz16), FAT_SYSTEM_SECTORS_PER_FAT_SIZE);
   // Max root entries
-	lseek(fd, FAT_SYSTEM_MAX_ROOT_OFFSET, SEEK_SET);
-	read(fd, &(fat_system.BPB_RootEntCnt),FAT_SYSTEM_MAX_ROOT_SIZE);
+	VolumeIO_read(volume_io, FAT_SYSTEM_MAX_ROOT_OFFSET, &(fat_system.BPB_RootEntCnt), FAT_SYSTEM_MAX_ROOT_SIZE);
   // Plain size
-	lseek(fd, FAT_SYSTEM_SIZE_OFFSET, SEEK_SET);
-	read(fd, &(fat_system.BPB_BytsPerSec),FAT_SYSTEM_SIZE_SIZE);
+	VolumeIO_read(volume_io, FAT_SYSTEM_SIZE_OFFSET, &(fat_system.BPB_BytsPerSec), FAT_SYSTEM_SIZE_SIZE);
+  // Total sectors (16 bit count, or 32 bit count when the 16 bit one is 0)
+	VolumeIO_read(volume_io, FAT_SYSTEM_TOTAL_SECTORS16_OFFSET, &(fat_system.BPB_TotSec16), FAT_SYSTEM_TOTAL_SECTORS16_SIZE);
+	VolumeIO_read(volume_io, FAT_SYSTEM_TOTAL_SECTORS32_OFFSET, &(fat_system.BPB_TotSec32), FAT_SYSTEM_TOTAL_SECTORS32_SIZE);
   return fat_system;
 }
 
@@ -190,6 +327,33 @@ void FatSystem_displayFatInfo (FatSystem fat_system) {
 }
 
 
+/***********************************************
+*
+* @Purpose: Prints in screen the usage of the clusters, counted from the FAT loaded in memory without reading the
+*           data region. Every chain has one end of chain entry, and a break is a link to a cluster that is not
+*           the next one of the volume, so the breaks per chain measure the fragmentation of the files
+* @Parameters: FatFileSystem *fs, FAT16 volume
+* @Return: -
+*
+************************************************/
+void FatSystem_displayFatStats(FatFileSystem *fs){
+	SimdFatCounts counts;
+	unsigned long long invalid;
+
+	Simd_countFat16(fs->fat, FAT_SYSTEM_FIRST_CLUSTER, fs->cluster_count, fs->cluster_count + FAT_SYSTEM_FIRST_CLUSTER - 1, &counts);
+	invalid = fs->cluster_count - counts.free - counts.bad - counts.ends - counts.links;
+	printf("\tClusters: %u\n", fs->cluster_count);
+	printf("\tFree clusters: %llu (%.1f%%)\n", counts.free, fs->cluster_count > 0 ? 100.0 * counts.free / fs->cluster_count : 0.0);
+	printf("\tBad clusters: %llu\n", counts.bad);
+	printf("\tChains: %llu\n", counts.ends);
+	printf("\tFragmentation: %.2f breaks per chain (%llu breaks)\n", counts.ends > 0 ? (double) counts.breaks / counts.ends : 0.0, counts.breaks);
+	if (invalid > 0){
+		printf("\tInvalid entries: %llu\n", invalid);
+	}
+	printf("\tCounted with: %s\n", Simd_getLevelName());
+}
+
+
 /***********************************************
 *
 * @Purpose: Calculates the address position of the root directory entry
@@ -212,226 +376,1500 @@ int FatSystem_calculateRootDirectory(FatSystem fat_system){
 
 /***********************************************
 *
-* @Purpose: Calculates the address position of the next folder directory entry (formulas from the page 13 of the manual)
-* @Parameters: FatSystem fat_system, structure containing the information about the FAY16 filesystem
-*              FatDirEntry directory_entry, directory entry of current directory entry
-* @Return: returns the numeric address position where the first directory entry is located
+* @Purpose: Calculates the address position of a cluster of the data region (formulas from the page 13 of the manual)
+* @Parameters: FatFileSystem *fs, FAT16 volume
+*              unsigned int cluster, cluster number (the first one is 2)
+* @Return: returns the numeric address position where the cluster starts
 *
 ************************************************/
-int FatSystem_calculateFirstSectorOfCluster(FatDirEntry directory_entry, FatSystem fat_system){
-		//RootDirSectors = ((BPB_RootEntCnt * 32) + (BPB_BytsPerSec – 1)) / BPB_BytsPerSec;
-		//FirstDataSector = BPB_ResvdSecCnt + (BPB_NumFATs * FATSz) + RootDirSectors;
-		//FirstSectorofCluster = ((N – 2) * BPB_SecPerClus) + FirstDataSector;
-		unsigned int root_dir_sectors = ((fat_system.BPB_RootEntCnt * 32) + (fat_system.BPB_BytsPerSec - 1)) / fat_system.BPB_BytsPerSec;
-		unsigned int first_data_sector = fat_system.BPB_RsvdSecCnt + (fat_system.BPB_NumFATs * fat_system.BPB_FATSz16) + root_dir_sectors;
-		unsigned int first_sectorof_cluster = (directory_entry.DIR_FstClusLO - 2) * fat_system.BPB_SecPerClus + first_data_sector;
-		// sector number * bytes per sector
-		first_sectorof_cluster = first_sectorof_cluster * fat_system.BPB_BytsPerSec;
-		//printf("\n\nFirst sector of cluster = %d\n\n", first_sectorof_cluster);
-		return first_sectorof_cluster;
+unsigned long long FatSystem_getClusterPosition(FatFileSystem *fs, unsigned int cluster){
+	//FirstSectorofCluster = ((N – 2) * BPB_SecPerClus) + FirstDataSector;
+	return fs->first_data_position + (unsigned long long)(cluster - FAT_SYSTEM_FIRST_CLUSTER) * fs->cluster_size;
 }
 
 
 /***********************************************
 *
-* @Purpose: Recursive function that finds looks for a file in  a FAT16 filesystem
-* @Parameters: FatSystem fat_system, structure containing the information about the FAY16 filesystem
-*              char *file, name of the file to be found in the filesystem volume file
-*							 int volume_fd, filde descriptor for the volume filesystem file
-*              unsigned int initial_address, address where the function starts to look for directory entries. In the first  call, it must be the address of the root directory
-* @Return: returns the numeric address position where the first directory entry is located
+* @Purpose: Prepares the iterator over the cluster chain that starts at a cluster
+* @Parameters: FatFileSystem *fs, FAT16 volume
+*              FatChain *chain, iterator to be initialized
+*              unsigned int first_cluster, first cluster of the chain
+* @Return: -
 *
 ************************************************/
-void FatSystem_findFile(char *file, int volume_fd, unsigned int initial_address, FatSystem fat_system){
-	unsigned int entry_pointer = initial_address;
-	FatDirEntry directory_entry;
-	char long_name[50];
-	//printf("File to be found: %s\n", file);
-	// No need to iterate recursively if the file has been found already
-	if(fat_isFound == 1) return;
+void FatSystem_initChain(FatFileSystem *fs, FatChain *chain, unsigned int first_cluster){
+	chain->fs = fs;
+	chain->cluster = first_cluster;
+	chain->visited = 0;
+}
 
-	// Iterating through all the directory entries
-	for(int i = 0; i < fat_system.BPB_RootEntCnt; i++ ){
-		lseek (volume_fd, entry_pointer, SEEK_SET);
-		read(volume_fd, &directory_entry, FAT_SYSTEM_DIR_ENTRY_SIZE);
-		//stoping the loop if we reach 0x00, which is the end of the directory entries
-		if (directory_entry.DIR_Name[0] == 0x00) {
-			break;
-		}
-		// Parsing the name (in FAT16 the names have a weird format)
-		//printf("Original file name: %s\n", file);
-		//printf("Before parsing: %s, size: %d, type: %d\n", directory_entry.DIR_Name, directory_entry.DIR_FileSize, directory_entry.DIR_Attr);
-		FatSystem_parseFileName(&directory_entry, entry_pointer, volume_fd, long_name);
-		//printf("Parsed name: %s, size: %d, type: %d\n\n\n", directory_entry.DIR_Name, directory_entry.DIR_FileSize, directory_entry.DIR_Attr);
-		//printf("(Long name, Filename, Dir_name, uppercase_name): (%s, %s,%s,%s)\n", long_name, file, directory_entry.DIR_Name, uppercase_name);
-		if((strcmp(directory_entry.DIR_Name,uppercase_name) == 0 || strcmp(long_name, file) == 0) && FatSystem_isFile(directory_entry) == 1){
-			if(fat_isDelete == 1){
-				FatSystem_deleteEntry(entry_pointer, volume_fd, file);
-			}else{
-				printf("File: %s found! It has %d bytes\n", file, directory_entry.DIR_FileSize );
-			}
-			fat_isFound = 1;
+
+/***********************************************
+*
+* @Purpose: Checks whether a cluster number points to a cluster of the data region
+* @Parameters: FatFileSystem *fs, FAT16 volume
+*              unsigned int cluster, cluster number
+* @Return: 1 if it is a data cluster, 0 otherwise (free, reserved, bad or end of chain)
+*
+************************************************/
+int FatSystem_isDataCluster(FatFileSystem *fs, unsigned int cluster){
+	return cluster >= FAT_SYSTEM_FIRST_CLUSTER && cluster < fs->cluster_count + FAT_SYSTEM_FIRST_CLUSTER;
+}
+
+
+/***********************************************
+*
+* @Purpose: Gets the next run of consecutive clusters of a chain, following the FAT loaded in memory
+* @Parameters: FatChain *chain, iterator of the chain
+*              unsigned int *first_cluster, filled with the first cluster of the run
+*              unsigned int *count, filled with the number of clusters of the run
+*              unsigned int max_clusters, maximum number of clusters of the run
+* @Return: 1 if a run has been found, 0 at the end of the chain
+*
+************************************************/
+int FatSystem_nextRun(FatChain *chain, unsigned int *first_cluster, unsigned int *count, unsigned int max_clusters){
+	FatFileSystem *fs = chain->fs;
+	unsigned int next;
+
+	// End of chain, bad cluster or a value out of the volume. A chain longer than the number of clusters has a loop
+	if (FatSystem_isDataCluster(fs, chain->cluster) == 0 || chain->visited >= fs->cluster_count) return 0;
+	*first_cluster = chain->cluster;
+	*count = 1;
+	chain->visited++;
+	next = fs->fat[chain->cluster];
+	// Extending the run while the next cluster of the chain is the next cluster of the volume
+	while (next == *first_cluster + *count && *count < max_clusters && FatSystem_isDataCluster(fs, next) && chain->visited < fs->cluster_count){
+		(*count)++;
+		chain->visited++;
+		next = fs->fat[next];
+	}
+	chain->cluster = next;
+	return 1;
+}
+
+
+/***********************************************
+*
+* @Purpose: Sets the number of threads that scan the folders of the root directory for /find and /delete
+* @Parameters: FatFileSystem *fs, FAT16 volume
+*              int threads, number of threads, 1 scans the folders recursively in the calling thread
+* @Return: -
+*
+************************************************/
+void FatSystem_setThreads(FatFileSystem *fs, int threads){
+	fs->threads = threads < 1 ? 1 : threads;
+}
+
+
+/***********************************************
+*
+* @Purpose: Creates the scan of a folder, starting with the targets already found by the operation
+* @Parameters: FatFindOperation *operation, operation being executed
+*              int ordinal, position of the folder among the folders of the root, FAT_SYSTEM_ROOT_SCAN for the root
+*              unsigned int first_cluster, first cluster of the folder
+* @Return: the scan, NULL if there is not enough memory
+*
+************************************************/
+static FatFindScan *FatSystem_createScan(FatFindOperation *operation, int ordinal, unsigned int first_cluster){
+	TargetSet *targets = operation->targets;
+	FatFindScan *scan = (FatFindScan *) calloc(1, sizeof(FatFindScan));
+
+	if (scan == NULL) return NULL;
+	scan->found = (int *) calloc(targets->count > 0 ? targets->count : 1, sizeof(int));
+	if (scan->found == NULL){
+		free(scan);
+		return NULL;
+	}
+	for (int i = 0; i < targets->count; i++){
+		scan->found[i] = targets->targets[i].found;
+		// The absolute paths are resolved before the walk, it does not need to look for them
+		if (targets->targets[i].is_path && scan->found[i] == 0){
+			scan->found[i] = 1;
 		}
-		// If it is a valid folder, recusively call the function
-		if(FatSystem_isValidFolder(directory_entry) == 1){
-			initial_address = FatSystem_calculateFirstSectorOfCluster(directory_entry, fat_system);
-			//printf("\nDepth\n\n");
-			FatSystem_findFile(file, volume_fd, initial_address,fat_system);
+		// The patterns are never done, the scan goes on until the end of the volume
+		if (scan->found[i] > 0 && !targets->targets[i].is_pattern){
+			scan->found_count++;
 		}
-		// Pointing to the next directory entry
-		entry_pointer = entry_pointer + FAT_SYSTEM_DIR_ENTRY_SIZE;
 	}
-	//printf("\nBack\n\n");
+	scan->operation = operation;
+	scan->ordinal = ordinal;
+	scan->first_cluster = first_cluster;
+	return scan;
 }
 
 
 /***********************************************
 *
-* @Purpose: Parses the file name from the directory entry to convert it to normal format and not FAT16 format
-* @Parameters: FatSystem *directory_entry, structure containing the directory entry with the file name in FAT16 format
-* @Return:-
+* @Purpose: Frees a scan together with the scans of the folders of the root it started
+* @Parameters: FatFindScan *scan, scan to be freed
+* @Return: -
 *
 ************************************************/
-void FatSystem_parseFileName(FatDirEntry *directory_entry, unsigned int entry_pointer, int volume_fd, char long_name[50]){
-	int i = 0, j = 0, is_first = 1;
-	// Checking that there is no error with the file name
-	if(directory_entry->DIR_Name[0] == 0x20){
-		printf("Invalid name: %s\n", directory_entry->DIR_Name);
-		return;
+static void FatSystem_freeScan(FatFindScan *scan){
+	if (scan == NULL) return;
+	for (int i = 0; i < scan->count; i++){
+		FatSystem_freeScan(scan->items[i].folder);
+	}
+	free(scan->items);
+	free(scan->found);
+	free(scan);
+}
+
+
+/***********************************************
+*
+* @Purpose: Adds a file found or a folder of the root to the items of a scan
+* @Parameters: FatFindScan *scan, scan
+*              Target *target, target matched by the file, NULL for a folder
+*              unsigned int file_size, size of the file
+*              unsigned long long entry_pointer, address of the directory entry of the file
+*              const char *short_name, decoded 8.3 name of the file, NULL for a folder
+*              FatLongName *long_name, long name of the file, NULL if it has none
+*              FatFindScan *folder, scan of the folder, NULL for a file
+* @Return: 0 on success, -1 if there is not enough memory
+*
+************************************************/
+static int FatSystem_addItem(FatFindScan *scan, Target *target, unsigned int file_size, unsigned long long entry_pointer, const char *short_name,
+		FatLongName *long_name, FatFindScan *folder){
+	FatFindItem *item;
+
+	if (scan->count == scan->capacity){
+		int capacity = scan->capacity == 0 ? 8 : scan->capacity * 2;
+		FatFindItem *items = (FatFindItem *) realloc(scan->items, capacity * sizeof(FatFindItem));
+		if (items == NULL) return -1;
+		scan->items = items;
+		scan->capacity = capacity;
+	}
+	item = &scan->items[scan->count++];
+	item->target = target;
+	item->file_size = file_size;
+	item->entry_pointer = entry_pointer;
+	item->short_name[0] = '\0';
+	if (short_name != NULL){
+		strcpy(item->short_name, short_name);
+	}
+	item->has_long_name = long_name != NULL;
+	if (long_name != NULL){
+		item->long_name = *long_name;
+	}
+	item->folder = folder;
+	return 0;
+}
+
+
+/***********************************************
+*
+* @Purpose: Tells the other scans that the folders of the root after this scan are not needed, since all the
+*           targets have a file found before them
+* @Parameters: FatFindScan *scan, scan that has found all the targets
+* @Return: -
+*
+************************************************/
+static void FatSystem_cancelAfter(FatFindScan *scan){
+	FatFindOperation *operation = scan->operation;
+	int position = scan->ordinal == FAT_SYSTEM_ROOT_SCAN ? scan->folders - 1 : scan->ordinal;
+
+	if (operation->pool == NULL) return;
+	pthread_mutex_lock(&operation->lock);
+	if (position < operation->cancel_after){
+		operation->cancel_after = position;
 	}
-	// Removing the white spaces from the string and putting a '.' if necessary
-	while (directory_entry->DIR_Name[i] && i < FAT_SYSTEM_DIR_NAME_SIZE){
-		if (directory_entry->DIR_Name[i] != ' ' ){
-			directory_entry->DIR_Name[j++] = directory_entry->DIR_Name[i];
-		}else if (is_first == 1 && FatSystem_noMoreChars(directory_entry->DIR_Name, i)){
-			directory_entry->DIR_Name[j++] = '.';
-			is_first = 0;
+	pthread_mutex_unlock(&operation->lock);
+}
+
+
+/***********************************************
+*
+* @Purpose: Checks whether a scan can stop because all the targets have a file found in the folders before it
+* @Parameters: FatFindScan *scan, scan
+* @Return: 1 if the scan is not needed any more, 0 otherwise
+*
+************************************************/
+static int FatSystem_isCancelled(FatFindScan *scan){
+	FatFindOperation *operation = scan->operation;
+	int cancelled;
+
+	if (operation->pool == NULL) return 0;
+	pthread_mutex_lock(&operation->lock);
+	// The root is past the folder that completed the targets once it has started the next one
+	if (scan->ordinal == FAT_SYSTEM_ROOT_SCAN){
+		cancelled = scan->folders > operation->cancel_after;
+	}else{
+		cancelled = scan->ordinal > operation->cancel_after;
+	}
+	pthread_mutex_unlock(&operation->lock);
+	return cancelled;
+}
+
+
+/***********************************************
+*
+* @Purpose: Shows the size of a file found for a target, or deletes it, and counts it. A file matched by several
+*           targets is deleted once
+* @Parameters: FatFindOperation *operation, operation being executed
+*              Target *target, target matched by the file
+*              unsigned int file_size, size of the file
+*              unsigned long long entry_pointer, address of the directory entry
+*              const char *short_name, decoded 8.3 name of the file
+*              FatLongName *long_name, long name of the file, NULL if it has none
+*              int *deleted, 1 if the file has already been deleted for another target
+* @Return: -
+*
+************************************************/
+static void FatSystem_reportFile(FatFindOperation *operation, Target *target, unsigned int file_size, unsigned long long entry_pointer, const char *short_name,
+		FatLongName *long_name, int *deleted){
+	// A pattern matches many names, the one of the file is shown instead
+	char *name = !target->is_pattern ? target->name : long_name != NULL ? long_name->name : (char *) short_name;
+
+	if(operation->is_delete == 1){
+		if (*deleted == 0){
+			FatSystem_deleteEntry(entry_pointer, operation->fs->volume_io, name, long_name);
+			*deleted = 1;
+		}else{
+			printf("File %s deleted in the filesystem\n", name);
 		}
-		i++;
+	}else{
+		printf("File: %s found! It has %u bytes\n", name, file_size);
 	}
-	directory_entry->DIR_Name[j] = '\0';
+	TargetSet_setFound(operation->targets, target);
+}
 
 
-	//TODO: Check for long names
-	/*
-	if(directory_entry->DIR_Attr == ATTR_LONG_NAME){
+/***********************************************
+*
+* @Purpose: Shows or deletes the files found by the parallel scans, in the order of the recursive walk. Only the
+*           first file of every name is taken, like in the recursive walk, and all the files of every pattern
+* @Parameters: FatFindScan *scan, scan whose items are reported
+*              unsigned long long *last_deleted, address of the last directory entry deleted
+* @Return: -
+*
+************************************************/
+static void FatSystem_reportScan(FatFindScan *scan, unsigned long long *last_deleted){
+	FatFindOperation *operation = scan->operation;
+	FatFindItem *item;
+	int deleted;
 
+	for (int i = 0; i < scan->count && !TargetSet_isComplete(operation->targets); i++){
+		item = &scan->items[i];
+		if (item->folder != NULL){
+			FatSystem_reportScan(item->folder, last_deleted);
+		}else if (item->target->found == 0 || item->target->is_pattern){
+			// The targets matched by the same file are consecutive items
+			deleted = item->entry_pointer == *last_deleted;
+			FatSystem_reportFile(operation, item->target, item->file_size, item->entry_pointer, item->short_name,
+					item->has_long_name ? &item->long_name : NULL, &deleted);
+			if (deleted) *last_deleted = item->entry_pointer;
+		}
 	}
+}
 
-	*/
-	int buff[] = {1,3,5,7,9,14,16,18,20,22,24,28,30};
-	char buff2[32];
-	lseek (volume_fd, entry_pointer - FAT_SYSTEM_DIR_ENTRY_SIZE, SEEK_SET);
-	read(volume_fd, &buff2, sizeof(buff2));
 
-	//printf("Buffer of the long name: ");
-	//for(int i = 0; i < 32; i++){
-	//	printf("%c", buff2[i]);
-	//}
-	//printf("\n");
+/***********************************************
+*
+* @Purpose: Task of the worker threads, scans a folder of the root and all its subfolders
+* @Parameters: void *argument, FatFindScan of the folder
+*              int worker, number of the worker running the task
+* @Return: -
+*
+************************************************/
+static void FatSystem_scanTask(void *argument, int worker){
+	FatFindScan *scan = (FatFindScan *) argument;
 
-	bzero(long_name, sizeof(char)*50);
-	for(int i = 0; i < 13; i++){
-		long_name[i] = buff2[buff[i]];
+	// The scans of the folders of the root do not start other tasks, so the worker is not needed
+	(void) worker;
+	if (FatSystem_isCancelled(scan) == 0){
+		FatSystem_scanFolder(scan, scan->first_cluster);
 	}
-	long_name[13] = '\0';
-	//printf("Long  in parsing name: %s\n", long_name);
+}
 
+
+/***********************************************
+*
+* @Purpose: Looks for the files with any of the target names in the whole FAT16 volume, showing their size or
+*           deleting them. Only the first file found with every name is taken. With several threads, every folder
+*           of the root is scanned by a task and the files found are reported at the end in the order of the
+*           recursive walk. Once the targets are complete, the folders of the root after them are not scanned
+* @Parameters: TargetSet *targets, names of the files to be found in the filesystem volume file
+*              FatFileSystem *fs, FAT16 volume
+*              int is_delete, 1 to delete the files found, 0 to show their size
+* @Return: -
+*
+************************************************/
+void FatSystem_findFile(TargetSet *targets, FatFileSystem *fs, int is_delete){
+	FatFindOperation operation;
+	FatFindScan *root;
+	unsigned long long last_deleted = 0;
+
+	bzero(&operation, sizeof(FatFindOperation));
+	operation.fs = fs;
+	operation.targets = targets;
+	operation.is_delete = is_delete;
+	operation.cancel_after = FAT_SYSTEM_NO_CANCEL;
+	pthread_mutex_init(&operation.lock, NULL);
+
+	root = FatSystem_createScan(&operation, FAT_SYSTEM_ROOT_SCAN, FAT_SYSTEM_ROOT_CLUSTER);
+	if (root != NULL){
+		// Without a pool the folders are scanned recursively and the files are reported as soon as they are found
+		if (fs->threads > 1){
+			operation.pool = WorkPool_create(fs->threads);
+		}
+		FatSystem_scanFolder(root, FAT_SYSTEM_ROOT_CLUSTER);
+		if (operation.pool != NULL){
+			WorkPool_wait(operation.pool);
+			FatSystem_reportScan(root, &last_deleted);
+			WorkPool_destroy(operation.pool);
+		}
+		FatSystem_freeScan(root);
+	}
+	pthread_mutex_destroy(&operation.lock);
 }
 
 
 /***********************************************
 *
-* @Purpose: Function used to check if there are more characters different from ' ' in a name starting from the position index of the string
-* @Parameters: char *name, string of character to be checked
-*              int index, value indicating from which position the parameter name is checked
-* @Return: returns 1 if the name does not have more characters apart from ' ', and 0 otherwise
+* @Purpose: Recursive function that looks for the files with any of the target names in a folder
+* @Parameters: FatFindScan *scan, scan the folder belongs to
+*              unsigned int first_cluster, first cluster of the directory, FAT_SYSTEM_ROOT_CLUSTER for the root directory
+* @Return: -
 *
 ************************************************/
-int FatSystem_noMoreChars(char *name, int index){
-	for(int i = index; i < FAT_SYSTEM_DIR_NAME_SIZE; i++){
-		if(name[i] != ' '){
-			return 1;
+void FatSystem_scanFolder(FatFindScan *scan, unsigned int first_cluster){
+	FatFileSystem *fs = scan->operation->fs;
+	FatChain chain;
+	FatLongName long_name;
+	unsigned int run_cluster, run_count;
+	size_t buffer_size;
+	char *buffer;
+	// No need to iterate recursively if all the files have been found already
+	if(scan->found_count == scan->operation->targets->count) return;
+
+	// Every level of the recursion has its own buffer, big enough for the root region or for a run of clusters
+	if (first_cluster == FAT_SYSTEM_ROOT_CLUSTER){
+		buffer_size = (size_t) fs->fat_system.BPB_RootEntCnt * FAT_SYSTEM_DIR_ENTRY_SIZE;
+	}else{
+		buffer_size = (size_t) FAT_SYSTEM_MAX_RUN_CLUSTERS * fs->cluster_size;
+	}
+	buffer = (char *) malloc(buffer_size);
+	if (buffer == NULL) return;
+	FatSystem_initLongName(&long_name);
+	OpStats_addFolder(fs->stats);
+
+	// The root directory has its own region with BPB_RootEntCnt entries
+	if (first_cluster == FAT_SYSTEM_ROOT_CLUSTER){
+		FatSystem_scanEntries(scan, fs->root_position, buffer_size, buffer, &long_name);
+	}else{
+		// The rest of directories are cluster chains, scanned a run of consecutive clusters at a time.
+		// A long name can start in a run and end in the next one, so its state is kept between runs
+		FatSystem_initChain(fs, &chain, first_cluster);
+		while (FatSystem_nextRun(&chain, &run_cluster, &run_count, FAT_SYSTEM_MAX_RUN_CLUSTERS)){
+			if (FatSystem_scanEntries(scan, FatSystem_getClusterPosition(fs, run_cluster), (size_t) run_count * fs->cluster_size, buffer, &long_name) == 0){
+				break;
+			}
 		}
 	}
-	return 0;
+	free(buffer);
 }
 
 
 /***********************************************
 *
-* @Purpose: Function that returns 1 if a directory entry is  a file, 0 otherwise
-* @Parameters: FatDirEntry directory_entry, directory entry whose type is checked
-* @Return:  returns 1 if a directory entry is  a file, 0 otherwise
+* @Purpose: Starts the scan of a folder of the root in the pool. If it cannot be queued it is scanned right away
+* @Parameters: FatFindScan *root, scan of the root directory
+*              unsigned int first_cluster, first cluster of the folder
+* @Return: -
 *
 ************************************************/
-int FatSystem_isFile(FatDirEntry directory_entry){
-	return directory_entry.DIR_Attr == FAT_SYSTEM_DIR_ENTRY_FILE;
+static void FatSystem_startFolder(FatFindScan *root, unsigned int first_cluster){
+	FatFindOperation *operation = root->operation;
+	FatFindScan *folder = FatSystem_createScan(operation, root->folders, first_cluster);
+
+	if (folder == NULL) return;
+	// The folder keeps its place among the items of the root, whatever the order the workers finish in
+	if (FatSystem_addItem(root, NULL, 0, 0, NULL, NULL, folder) < 0){
+		FatSystem_freeScan(folder);
+		return;
+	}
+	root->folders++;
+	if (WorkPool_submit(operation->pool, WORK_POOL_NO_WORKER, FatSystem_scanTask, folder) < 0){
+		FatSystem_scanFolder(folder, first_cluster);
+	}
 }
 
 
 /***********************************************
 *
-* @Purpose: Function that returns 1 if a directory entry is  a folder, 0 otherwise
-* @Parameters: FatDirEntry directory_entry, directory entry whose type is checked
-* @Return:  returns 1 if a directory entry is  a folder, 0 otherwise
+* @Purpose: Reads ahead the first run of clusters of every folder of a directory region, all of them in flight
+*           at the same time, so that the folders are found in the cache when the traversal goes into them
+* @Parameters: FatFileSystem *fs, FAT16 volume
+*              const char *region, directory entries of the region
+*              size_t size, number of bytes of the region
+* @Return: -
 *
 ************************************************/
-int FatSystem_isFolder(FatDirEntry directory_entry){
-	return directory_entry.DIR_Attr == FAT_SYSTEM_DIR_ENTRY_FOLDER;
+static void FatSystem_prefetchFolders(FatFileSystem *fs, const char *region, size_t size){
+	VolumeIORange ranges[FAT_SYSTEM_MAX_PREFETCH];
+	const FatDirEntry *directory_entry;
+	unsigned int run_cluster, run_count;
+	FatChain chain;
+	int count = 0;
+
+	if (VolumeIO_canPrefetch(fs->volume_io) == 0) return;
+	for (size_t offset = 0; offset + FAT_SYSTEM_DIR_ENTRY_SIZE <= size && count < FAT_SYSTEM_MAX_PREFETCH; offset += FAT_SYSTEM_DIR_ENTRY_SIZE){
+		directory_entry = (const FatDirEntry *) (region + offset);
+		if ((unsigned char) directory_entry->DIR_Name[0] == FAT_SYSTEM_DIR_END) break;
+		if ((unsigned char) directory_entry->DIR_Name[0] == FAT_SYSTEM_DIR_FREE || FatSystem_isValidFolder(*directory_entry) == 0) continue;
+		FatSystem_initChain(fs, &chain, directory_entry->DIR_FstClusLO);
+		if (FatSystem_nextRun(&chain, &run_cluster, &run_count, FAT_SYSTEM_MAX_RUN_CLUSTERS)){
+			ranges[count].offset = FatSystem_getClusterPosition(fs, run_cluster);
+			ranges[count].size = (size_t) run_count * fs->cluster_size;
+			count++;
+		}
+	}
+	if (count > 0) VolumeIO_prefetch(fs->volume_io, ranges, count);
 }
 
 
 /***********************************************
 *
-* @Purpose: Checks if the file has been found or not
-* @Parameters: -
+* @Purpose: Looks for the target files in a contiguous region of directory entries, going into the folders found.
+*           The whole region is read at once and its entries are decoded from memory. With a pool, the folders
+*           of the root are given to the workers instead
+* @Parameters: FatFindScan *scan, scan the region belongs to
+*              unsigned long long initial_address, address of the first directory entry of the region
+*              size_t size, size in bytes of the region
+*              char *buffer, at least size bytes where the region is read when the volume is not mapped
+*              FatLongName *long_name, long name being decoded, kept between the regions of a directory
+* @Return: 0 if the scan has to stop (end of the directory or all the files found), 1 otherwise
+*
+************************************************/
+int FatSystem_scanEntries(FatFindScan *scan, unsigned long long initial_address, size_t size, char *buffer, FatLongName *long_name){
+	FatFindOperation *operation = scan->operation;
+	const char *region;
+	const FatDirEntry *directory_entry;
+	unsigned long long entry_pointer;
+	char short_name[FAT_SYSTEM_SHORT_NAME_SIZE];
+	int has_long_name, result = 1;
+	size_t offset;
+
+	if (FatSystem_isCancelled(scan)) return 0;
+	region = (const char *) VolumeIO_view(operation->fs->volume_io, initial_address, size, buffer);
+	if (region == NULL) return 0;
+	FatSystem_prefetchFolders(operation->fs, region, size);
+	// Iterating through all the directory entries
+	for(offset = 0; offset + FAT_SYSTEM_DIR_ENTRY_SIZE <= size; offset += FAT_SYSTEM_DIR_ENTRY_SIZE){
+		directory_entry = (const FatDirEntry *) (region + offset);
+		entry_pointer = initial_address + offset;
+		//stoping the loop if we reach 0x00, which is the end of the directory entries
+		if ((unsigned char) directory_entry->DIR_Name[0] == FAT_SYSTEM_DIR_END) {
+			result = 0;
+			break;
+		}
+		// Free entries break any long name being decoded
+		if ((unsigned char) directory_entry->DIR_Name[0] == FAT_SYSTEM_DIR_FREE){
+			FatSystem_initLongName(long_name);
+			continue;
+		}
+		// Long name slots precede the short entry they belong to
+		if ((directory_entry->DIR_Attr & FAT_SYSTEM_ATTR_LONG_NAME_MASK) == FAT_SYSTEM_ATTR_LONG_NAME){
+			FatSystem_addLongNameSlot(long_name, (const unsigned char *) directory_entry, entry_pointer);
+			continue;
+		}
+		// Parsing the name (in FAT16 the names have a weird format)
+		FatSystem_decodeShortName(directory_entry, short_name);
+		has_long_name = FatSystem_hasLongName(long_name, directory_entry);
+		if(FatSystem_isFile(*directory_entry) == 1){
+			FatSystem_matchEntry(scan, directory_entry, entry_pointer, short_name, has_long_name ? long_name : NULL);
+			if (scan->found_count == operation->targets->count){
+				FatSystem_cancelAfter(scan);
+				result = 0;
+				break;
+			}
+		}
+		FatSystem_initLongName(long_name);
+		// If it is a valid folder, recusively call the function, or give it to a worker when it is in the root
+		if(FatSystem_isValidFolder(*directory_entry) == 1){
+			if (operation->pool != NULL && scan->ordinal == FAT_SYSTEM_ROOT_SCAN){
+				if (FatSystem_isCancelled(scan)){
+					result = 0;
+					break;
+				}
+				FatSystem_startFolder(scan, directory_entry->DIR_FstClusLO);
+			}else{
+				FatSystem_scanFolder(scan, directory_entry->DIR_FstClusLO);
+				if (scan->found_count == operation->targets->count || FatSystem_isCancelled(scan)){
+					result = 0;
+					break;
+				}
+			}
+		}
+	}
+	// The entry the loop stops at has been decoded too
+	OpStats_addEntries(operation->fs->stats, offset / FAT_SYSTEM_DIR_ENTRY_SIZE + (result == 0));
+	return result;
+}
+
+
+/***********************************************
 *
-* @Return:  returns the value of the global variable isFound
+* @Purpose: Shows or deletes a file if its long name is one of the targets, or its 8.3 name is one of them
+*           ignoring the case. Only the targets without a file found yet by the scan are taken into account.
+*           A file no name matches is taken for the first pattern that matches its long name, or its 8.3 name
+*           ignoring the case when it has no long name
+* @Parameters: FatFindScan *scan, scan the file belongs to
+*              const FatDirEntry *directory_entry, directory entry of the file
+*              unsigned long long entry_pointer, address of the directory entry
+*              const char *short_name, decoded 8.3 name of the file
+*              FatLongName *long_name, long name of the file, NULL if it has none
+* @Return: -
 *
 ************************************************/
-int FatSystem_isFound(){
-	return fat_isFound;
+void FatSystem_matchEntry(FatFindScan *scan, const FatDirEntry *directory_entry, unsigned long long entry_pointer, const char *short_name, FatLongName *long_name){
+	TargetSet *targets = scan->operation->targets;
+	unsigned int file_size = directory_entry->DIR_FileSize;
+	Target *target = NULL;
+	int deleted = 0, named = 0;
+
+	if (long_name != NULL){
+		target = TargetSet_findExact(targets, long_name->name, strlen(long_name->name));
+		if (target != NULL && scan->found[target - targets->targets] == 0){
+			FatSystem_reportTarget(scan, target, file_size, entry_pointer, short_name, long_name, &deleted);
+		}
+		named = target != NULL;
+		target = NULL;
+	}
+	while ((target = TargetSet_findCaseless(targets, short_name, strlen(short_name), target)) != NULL){
+		if (strcmp(target->upper_name, short_name) != 0) continue;
+		if (scan->found[target - targets->targets] == 0){
+			FatSystem_reportTarget(scan, target, file_size, entry_pointer, short_name, long_name, &deleted);
+		}
+		named = 1;
+	}
+	if (!named && targets->pattern_count > 0){
+		if (long_name != NULL){
+			target = TargetSet_findPattern(targets, long_name->name, strlen(long_name->name), 0, NULL);
+		}else{
+			target = TargetSet_findPattern(targets, short_name, strlen(short_name), 1, NULL);
+		}
+		if (target != NULL){
+			FatSystem_reportTarget(scan, target, file_size, entry_pointer, short_name, long_name, &deleted);
+		}
+	}
 }
 
 
 /***********************************************
 *
-* @Purpose: Checks if the directory entry is and if it is different than .. and .
-* @Parameters: -
+* @Purpose: Counts a file found by a scan for a target. The recursive scan shows it or deletes it at once,
+*           the parallel scans keep it to be reported in order when all of them finish
+* @Parameters: FatFindScan *scan, scan that found the file
+*              Target *target, target matched by the file
+*              unsigned int file_size, size of the file
+*              unsigned long long entry_pointer, address of the directory entry
+*              const char *short_name, decoded 8.3 name of the file
+*              FatLongName *long_name, long name of the file, NULL if it has none
+*              int *deleted, 1 if the file has already been deleted for another target
+* @Return: -
 *
-* @Return:  returns 1 if it is valid, 0 otherwise
+************************************************/
+void FatSystem_reportTarget(FatFindScan *scan, Target *target, unsigned int file_size, unsigned long long entry_pointer, const char *short_name,
+		FatLongName *long_name, int *deleted){
+	int index = target - scan->operation->targets->targets;
+
+	if (scan->operation->pool == NULL){
+		FatSystem_reportFile(scan->operation, target, file_size, entry_pointer, short_name, long_name, deleted);
+	}else if (FatSystem_addItem(scan, target, file_size, entry_pointer, short_name, long_name, NULL) < 0){
+		return;
+	}
+	if (scan->found[index] == 0 && !target->is_pattern){
+		scan->found_count++;
+	}
+	scan->found[index]++;
+}
+
+
+/***********************************************
+*
+* @Purpose: Looks for a name among the entries of a contiguous region of a directory. The long name is matched
+*           exactly and the 8.3 name ignoring the case, like the walk does
+* @Parameters: FatFileSystem *fs, FAT16 volume
+*              unsigned long long initial_address, address of the first directory entry of the region
+*              size_t size, size in bytes of the region
+*              char *buffer, at least size bytes where the region is read when the volume is not mapped
+*              const char *name, name looked for, it does not need to end with '\0'
+*              size_t name_len, length of the name
+*              FatDirLookup *result, filled with the entry found. Its long name is kept between the regions
+* @Return: FAT_SYSTEM_LOOKUP_FOUND, FAT_SYSTEM_LOOKUP_MISSING at the end of the directory or
+*          FAT_SYSTEM_LOOKUP_NEXT_REGION if the directory goes on
 *
 ************************************************/
-int FatSystem_isValidFolder(FatDirEntry directory_entry){
-	return (strcmp(directory_entry.DIR_Name,"..") != 0 && strcmp(directory_entry.DIR_Name,".") != 0 && FatSystem_isFolder(directory_entry) == 1);
+static int FatSystem_lookupEntries(FatFileSystem *fs, unsigned long long initial_address, size_t size, char *buffer,
+		const char *name, size_t name_len, FatDirLookup *result){
+	const char *region = (const char *) VolumeIO_view(fs->volume_io, initial_address, size, buffer);
+	const FatDirEntry *directory_entry;
+	FatLongName *long_name = &result->long_name;
+	int found = FAT_SYSTEM_LOOKUP_NEXT_REGION;
+	size_t offset;
+
+	if (region == NULL) return FAT_SYSTEM_LOOKUP_MISSING;
+	for(offset = 0; offset + FAT_SYSTEM_DIR_ENTRY_SIZE <= size; offset += FAT_SYSTEM_DIR_ENTRY_SIZE){
+		directory_entry = (const FatDirEntry *) (region + offset);
+		if ((unsigned char) directory_entry->DIR_Name[0] == FAT_SYSTEM_DIR_END) {
+			found = FAT_SYSTEM_LOOKUP_MISSING;
+			break;
+		}
+		if ((unsigned char) directory_entry->DIR_Name[0] == FAT_SYSTEM_DIR_FREE){
+			FatSystem_initLongName(long_name);
+			continue;
+		}
+		if ((directory_entry->DIR_Attr & FAT_SYSTEM_ATTR_LONG_NAME_MASK) == FAT_SYSTEM_ATTR_LONG_NAME){
+			FatSystem_addLongNameSlot(long_name, (const unsigned char *) directory_entry, initial_address + offset);
+			continue;
+		}
+		// The volume label is neither a file nor a folder
+		if (directory_entry->DIR_Attr & FAT_SYSTEM_ATTR_VOLUME_ID){
+			FatSystem_initLongName(long_name);
+			continue;
+		}
+		FatSystem_decodeShortName(directory_entry, result->short_name);
+		result->has_long_name = FatSystem_hasLongName(long_name, directory_entry);
+		if ((result->has_long_name && strlen(long_name->name) == name_len && memcmp(long_name->name, name, name_len) == 0) ||
+				(strlen(result->short_name) == name_len && strncasecmp(result->short_name, name, name_len) == 0)){
+			result->entry = *directory_entry;
+			result->entry_pointer = initial_address + offset;
+			found = FAT_SYSTEM_LOOKUP_FOUND;
+			break;
+		}
+		FatSystem_initLongName(long_name);
+	}
+	OpStats_addEntries(fs->stats, offset / FAT_SYSTEM_DIR_ENTRY_SIZE + (found != FAT_SYSTEM_LOOKUP_NEXT_REGION));
+	return found;
 }
 
 
 /***********************************************
 *
-* @Purpose: Deletes the directory entry in the file system
-* @Parameters: unsigned int dir_entry_pos: Position of the filesystem to be deleted
-*              int volume_fd: file descriptor  of the filesystem
+* @Purpose: Looks for a name in a directory, reading it region by region until the name is found
+* @Parameters: FatFileSystem *fs, FAT16 volume
+*              unsigned int first_cluster, first cluster of the directory, FAT_SYSTEM_ROOT_CLUSTER for the root directory
+*              const char *name, name looked for, it does not need to end with '\0'
+*              size_t name_len, length of the name
+*              FatDirLookup *result, filled with the entry found
+* @Return: 1 if the name has been found, 0 if it is not in the directory, -1 if there is not enough memory
 *
-* @Return:  returns 1 if it is valid, 0 otherwise
+************************************************/
+int FatSystem_lookup(FatFileSystem *fs, unsigned int first_cluster, const char *name, size_t name_len, FatDirLookup *result){
+	FatChain chain;
+	unsigned int run_cluster, run_count;
+	size_t buffer_size;
+	char *buffer;
+	int found = FAT_SYSTEM_LOOKUP_NEXT_REGION;
+
+	if (first_cluster == FAT_SYSTEM_ROOT_CLUSTER){
+		buffer_size = (size_t) fs->fat_system.BPB_RootEntCnt * FAT_SYSTEM_DIR_ENTRY_SIZE;
+	}else{
+		buffer_size = (size_t) FAT_SYSTEM_MAX_RUN_CLUSTERS * fs->cluster_size;
+	}
+	buffer = (char *) malloc(buffer_size);
+	if (buffer == NULL) return -1;
+	FatSystem_initLongName(&result->long_name);
+	OpStats_addFolder(fs->stats);
+
+	if (first_cluster == FAT_SYSTEM_ROOT_CLUSTER){
+		found = FatSystem_lookupEntries(fs, fs->root_position, buffer_size, buffer, name, name_len, result);
+	}else{
+		FatSystem_initChain(fs, &chain, first_cluster);
+		while (found == FAT_SYSTEM_LOOKUP_NEXT_REGION && FatSystem_nextRun(&chain, &run_cluster, &run_count, FAT_SYSTEM_MAX_RUN_CLUSTERS)){
+			found = FatSystem_lookupEntries(fs, FatSystem_getClusterPosition(fs, run_cluster), (size_t) run_count * fs->cluster_size, buffer, name, name_len, result);
+		}
+	}
+	free(buffer);
+	return found == FAT_SYSTEM_LOOKUP_FOUND;
+}
+
+
+/***********************************************
+*
+* @Purpose: Resolves an absolute path a component at a time, looking each one up in the folder found for the
+*           previous one from the root directory region. It stops at the first component that is missing
+* @Parameters: FatFileSystem *fs, FAT16 volume
+*              const char *path, absolute path of the file
+*              FatDirLookup *result, filled with the directory entry of the file
+* @Return: 1 if the path names a file, 0 otherwise, -1 if there is not enough memory
 *
 ************************************************/
-void FatSystem_deleteEntry(unsigned int dir_entry_pos, int volume_fd, char *name){
-	FatDirEntry directory_entry;
+static int FatSystem_resolvePath(FatFileSystem *fs, const char *path, FatDirLookup *result){
+	unsigned int first_cluster = FAT_SYSTEM_ROOT_CLUSTER;
+	const char *component, *last = NULL;
+	size_t length = 0;
+	int found = 0;
 
-	lseek (volume_fd, dir_entry_pos, SEEK_SET);
-	read(volume_fd, &directory_entry, FAT_SYSTEM_DIR_ENTRY_SIZE);
-	//printf("Dir to be deleted: %s", directory_entry.DIR_Name);
-	// Deleting all the directory entry
-	bzero(&directory_entry, sizeof(FatDirEntry));
-	// Setting the first byte to 0xE5 which tells that this directory entry is free
-	directory_entry.DIR_Name[0] = 0xE5;
-	// Writting the empty directory entry
-	lseek (volume_fd, dir_entry_pos, SEEK_SET);
-	write(volume_fd, &directory_entry, FAT_SYSTEM_DIR_ENTRY_SIZE);
-	//read(volume_fd, &directory_entry, FAT_SYSTEM_DIR_ENTRY_SIZE);
-	//printf("Dir to be deleted after memset: %s, Size: %d", directory_entry.DIR_Name, directory_entry.DIR_FileSize);
+	component = TargetSet_nextComponent(path, &length);
+	while (component != NULL){
+		found = FatSystem_lookup(fs, first_cluster, component, length, result);
+		if (found != 1) return found;
+		last = component;
+		component = TargetSet_nextComponent(component + length, &length);
+		// The components before the last one have to be folders. The ".." entries of the folders of the root point to cluster 0
+		if (component != NULL && FatSystem_isFolder(result->entry) == 0) return 0;
+		first_cluster = result->entry.DIR_FstClusLO;
+	}
+	// A path ending with a separator names a folder
+	if (found != 1 || last[length] != '\0' || FatSystem_isFile(result->entry) == 0) return 0;
+	return 1;
+}
+
+
+/***********************************************
+*
+* @Purpose: Shows the size of the files named by the targets that are absolute paths, or deletes them.
+*           The files deleted are marked in the name index, when it is up to date, so that it stays valid
+* @Parameters: TargetSet *targets, names looked for, the ones that are not absolute paths are skipped
+*              FatFileSystem *fs, FAT16 volume
+*              int is_delete, 1 to delete the files, 0 to show their size
+* @Return: -
+*
+************************************************/
+static void FatSystem_resolvePaths(TargetSet *targets, FatFileSystem *fs, int is_delete){
+	FatDirLookup result;
+	NameIndex *index = NULL;
+	Target *target;
+
+	if (targets->path_count == 0) return;
+	if (is_delete == 1 && fs->index_path != NULL){
+		index = NameIndex_open(fs->index_path, NAME_INDEX_FS_FAT16, FatSystem_getChecksum(fs));
+	}
+	for (int i = 0; i < targets->count; i++){
+		target = &targets->targets[i];
+		if (target->is_path == 0 || FatSystem_resolvePath(fs, target->name, &result) != 1) continue;
+		if (is_delete == 1){
+			FatSystem_deleteEntry(result.entry_pointer, fs->volume_io, target->name, result.has_long_name ? &result.long_name : NULL);
+			if (index != NULL){
+				NameIndex_markDeletedAt(index, result.has_long_name ? result.long_name.name : result.short_name, result.entry_pointer);
+			}
+		}else{
+			printf("File: %s found! It has %u bytes\n", target->name, result.entry.DIR_FileSize);
+		}
+		TargetSet_setFound(targets, target);
+	}
+	NameIndex_close(index);
+}
+
+
+/***********************************************
+*
+* @Purpose: Walks all the entries of the volume, folders first visited and then entered, calling a visitor
+*           for every one of them with its path
+* @Parameters: FatFileSystem *fs, FAT16 volume
+*              FileEntryVisitor visitor, function called for every entry
+*              void *context, data passed to the visitor
+* @Return: FILE_ENTRY_STOP if the visitor ended the walk, FILE_ENTRY_CONTINUE otherwise
+*
+************************************************/
+int FatSystem_walk(FatFileSystem *fs, FileEntryVisitor visitor, void *context){
+	char path[FILE_ENTRY_MAX_PATH];
+
+	path[0] = '\0';
+	return FatSystem_walkDirectory(fs, FAT_SYSTEM_ROOT_CLUSTER, path, 0, visitor, context);
+}
+
+
+/***********************************************
+*
+* @Purpose: Recursive part of FatSystem_walk, walks the entries of a folder region by region
+* @Parameters: FatFileSystem *fs, FAT16 volume
+*              unsigned int first_cluster, first cluster of the folder, FAT_SYSTEM_ROOT_CLUSTER for the root directory
+*              char *path, FILE_ENTRY_MAX_PATH bytes holding the path of the folder, the names are appended to it
+*              size_t path_len, length of the path of the folder
+*              FileEntryVisitor visitor, function called for every entry
+*              void *context, data passed to the visitor
+* @Return: FILE_ENTRY_STOP if the visitor ended the walk, FILE_ENTRY_CONTINUE otherwise
+*
+************************************************/
+static int FatSystem_walkDirectory(FatFileSystem *fs, unsigned int first_cluster, char *path, size_t path_len, FileEntryVisitor visitor, void *context){
+	FatChain chain;
+	FatLongName long_name;
+	unsigned int run_cluster, run_count;
+	size_t buffer_size;
+	char *buffer;
+	int result = FILE_ENTRY_CONTINUE;
+
+	if (first_cluster == FAT_SYSTEM_ROOT_CLUSTER){
+		buffer_size = (size_t) fs->fat_system.BPB_RootEntCnt * FAT_SYSTEM_DIR_ENTRY_SIZE;
+	}else{
+		buffer_size = (size_t) FAT_SYSTEM_MAX_RUN_CLUSTERS * fs->cluster_size;
+	}
+	buffer = (char *) malloc(buffer_size);
+	if (buffer == NULL) return FILE_ENTRY_CONTINUE;
+	FatSystem_initLongName(&long_name);
+	OpStats_addFolder(fs->stats);
+
+	if (first_cluster == FAT_SYSTEM_ROOT_CLUSTER){
+		result = FatSystem_walkEntries(fs, fs->root_position, buffer_size, buffer, &long_name, path, path_len, visitor, context);
+	}else{
+		FatSystem_initChain(fs, &chain, first_cluster);
+		while (result == FILE_ENTRY_CONTINUE && FatSystem_nextRun(&chain, &run_cluster, &run_count, FAT_SYSTEM_MAX_RUN_CLUSTERS)){
+			result = FatSystem_walkEntries(fs, FatSystem_getClusterPosition(fs, run_cluster), (size_t) run_count * fs->cluster_size, buffer, &long_name, path, path_len, visitor, context);
+		}
+	}
+	path[path_len] = '\0';
+	free(buffer);
+	return result == FILE_ENTRY_STOP ? FILE_ENTRY_STOP : FILE_ENTRY_CONTINUE;
+}
+
+
+/***********************************************
+*
+* @Purpose: Converts a date and a time of a directory entry to seconds since 1970. The volume does not store
+*           the time zone, so they are taken as UTC
+* @Parameters: unsigned short date, day (bits 0-4), month (bits 5-8) and years since 1980 (bits 9-15)
+*              unsigned short time, seconds / 2 (bits 0-4), minutes (bits 5-10) and hours (bits 11-15)
+* @Return: seconds since 1970, 0 if the date is not set or not valid
+*
+************************************************/
+static unsigned long long FatSystem_getTime(unsigned short date, unsigned short time){
+	unsigned int day = date & 0x1F, month = (date >> 5) & 0x0F, year = FAT_SYSTEM_EPOCH_YEAR + (date >> 9);
+	unsigned long long days;
+
+	if (day == 0 || month == 0 || month > 12) return 0;
+	// Days since 1970 counting the years from March, so that February 29 is the last day of the year
+	if (month <= 2) year--;
+	days = (unsigned long long) year * 365 + year / 4 - year / 100 + year / 400 + (153 * ((month + 9) % 12) + 2) / 5 + day - 1 - 719468;
+	return days * 86400 + (time >> 11) * 3600 + ((time >> 5) & 0x3F) * 60 + (time & 0x1F) * 2;
+}
+
+
+/***********************************************
+*
+* @Purpose: Walks a contiguous region of directory entries, read at once
+* @Parameters: FatFileSystem *fs, FAT16 volume
+*              unsigned long long initial_address, address of the first directory entry of the region
+*              size_t size, size in bytes of the region
+*              char *buffer, at least size bytes where the region is read when the volume is not mapped
+*              FatLongName *long_name, long name being decoded, kept between the regions of a directory
+*              char *path, path of the folder, the names are appended to it
+*              size_t path_len, length of the path of the folder
+*              FileEntryVisitor visitor, function called for every entry
+*              void *context, data passed to the visitor
+* @Return: FILE_ENTRY_STOP if the visitor ended the walk, FILE_ENTRY_SKIP at the end of the directory,
+*          FILE_ENTRY_CONTINUE otherwise
+*
+************************************************/
+static int FatSystem_walkEntries(FatFileSystem *fs, unsigned long long initial_address, size_t size, char *buffer, FatLongName *long_name,
+		char *path, size_t path_len, FileEntryVisitor visitor, void *context){
+	const char *region = (const char *) VolumeIO_view(fs->volume_io, initial_address, size, buffer);
+	const FatDirEntry *directory_entry;
+	char short_name[FAT_SYSTEM_SHORT_NAME_SIZE];
+	const char *name;
+	size_t name_len;
+	FileEntry entry;
+	int result, status = FILE_ENTRY_CONTINUE;
+	size_t offset;
+
+	if (region == NULL) return FILE_ENTRY_SKIP;
+	FatSystem_prefetchFolders(fs, region, size);
+	memset(&entry, 0, sizeof(entry));
+	entry.path = path;
+	entry.name = path + path_len + 1;
+	entry.short_name = short_name;
+	for(offset = 0; offset + FAT_SYSTEM_DIR_ENTRY_SIZE <= size; offset += FAT_SYSTEM_DIR_ENTRY_SIZE){
+		directory_entry = (const FatDirEntry *) (region + offset);
+		if ((unsigned char) directory_entry->DIR_Name[0] == FAT_SYSTEM_DIR_END) {
+			status = FILE_ENTRY_SKIP;
+			break;
+		}
+		if ((unsigned char) directory_entry->DIR_Name[0] == FAT_SYSTEM_DIR_FREE){
+			FatSystem_initLongName(long_name);
+			continue;
+		}
+		if ((directory_entry->DIR_Attr & FAT_SYSTEM_ATTR_LONG_NAME_MASK) == FAT_SYSTEM_ATTR_LONG_NAME){
+			FatSystem_addLongNameSlot(long_name, (const unsigned char *) directory_entry, initial_address + offset);
+			continue;
+		}
+		FatSystem_decodeShortName(directory_entry, short_name);
+		if (FatSystem_hasLongName(long_name, directory_entry)){
+			name = long_name->name;
+			entry.num_slots = long_name->num_slots;
+			// The slots can only be freed together with the entry if they are right before it
+			entry.aux_position = long_name->slots[0];
+			if (entry.aux_position + (unsigned long long) entry.num_slots * FAT_SYSTEM_DIR_ENTRY_SIZE != initial_address + offset){
+				entry.aux_position = 0;
+			}
+		}else{
+			name = short_name;
+			entry.num_slots = 0;
+			entry.aux_position = 0;
+		}
+		// Skipping the "." and ".." entries, the volume label and the names that do not fit in the path
+		name_len = strlen(name);
+		if (directory_entry->DIR_Name[0] == '.' || (directory_entry->DIR_Attr & FAT_SYSTEM_ATTR_VOLUME_ID) || path_len + 1 + name_len >= FILE_ENTRY_MAX_PATH){
+			FatSystem_initLongName(long_name);
+			continue;
+		}
+		path[path_len] = '/';
+		memcpy(path + path_len + 1, name, name_len + 1);
+		FatSystem_initLongName(long_name);
+
+		entry.id = directory_entry->DIR_FstClusLO;
+		entry.size = directory_entry->DIR_FileSize;
+		entry.mtime = FatSystem_getTime(directory_entry->DIR_WrtDate, directory_entry->DIR_WrtTime);
+		entry.atime = FatSystem_getTime(directory_entry->DIR_LstAccDate, 0);
+		entry.position = initial_address + offset;
+		if (FatSystem_isFile(*directory_entry)){
+			entry.type = FILE_ENTRY_FILE;
+		}else if (FatSystem_isFolder(*directory_entry)){
+			entry.type = FILE_ENTRY_DIRECTORY;
+		}else{
+			entry.type = FILE_ENTRY_OTHER;
+		}
+		result = visitor(&entry, context);
+		if (result == FILE_ENTRY_CONTINUE && entry.type == FILE_ENTRY_DIRECTORY){
+			result = FatSystem_walkDirectory(fs, entry.id, path, path_len + 1 + name_len, visitor, context);
+		}
+		if (result == FILE_ENTRY_STOP){
+			status = FILE_ENTRY_STOP;
+			break;
+		}
+	}
+	OpStats_addEntries(fs->stats, offset / FAT_SYSTEM_DIR_ENTRY_SIZE + (status != FILE_ENTRY_CONTINUE));
+	return status;
+}
+
+
+/***********************************************
+*
+* @Purpose: Walker passed to the name index to build it
+* @Parameters: void *fs, FatFileSystem of the volume
+*              FileEntryVisitor visitor, function called for every entry
+*              void *context, data passed to the visitor
+* @Return: FILE_ENTRY_STOP if the visitor ended the walk, FILE_ENTRY_CONTINUE otherwise
+*
+************************************************/
+static int FatSystem_indexWalker(void *fs, FileEntryVisitor visitor, void *context){
+	return FatSystem_walk((FatFileSystem *) fs, visitor, context);
+}
+
+
+/***********************************************
+*
+* @Purpose: Computes a checksum (FNV-1a) of the FAT loaded in memory, used to know if the volume has changed
+* @Parameters: FatFileSystem *fs, FAT16 volume
+* @Return: the checksum
+*
+************************************************/
+unsigned long long FatSystem_getChecksum(FatFileSystem *fs){
+	unsigned long long checksum = FAT_SYSTEM_FNV_OFFSET;
+	const unsigned char *fat = (const unsigned char *) fs->fat;
+	size_t fat_size = (size_t) fs->fat_system.BPB_FATSz16 * fs->fat_system.BPB_BytsPerSec;
+
+	for (size_t i = 0; i < fat_size; i++){
+		checksum = (checksum ^ fat[i]) * FAT_SYSTEM_FNV_PRIME;
+	}
+	return checksum;
+}
+
+
+/***********************************************
+*
+* @Purpose: Sets the name index file used by /find and /delete. It is built the first time it is needed
+* @Parameters: FatFileSystem *fs, FAT16 volume
+*              const char *index_path, path of the index file, NULL to walk the volume every time
+* @Return: -
+*
+************************************************/
+void FatSystem_setIndex(FatFileSystem *fs, const char *index_path){
+	fs->index_path = index_path;
+}
+
+
+/***********************************************
+*
+* @Purpose: Sets the statistics where the folders and entries read by the operation are counted
+* @Parameters: FatFileSystem *fs, FAT16 volume
+*              OpStats *stats, statistics of the operation, NULL not to collect them
+* @Return: -
+*
+************************************************/
+void FatSystem_setStats(FatFileSystem *fs, OpStats *stats){
+	fs->stats = stats;
+}
+
+
+/***********************************************
+*
+* @Purpose: Sets the file /extract writes to
+* @Parameters: FatFileSystem *fs, FAT16 volume
+*              int output_fd, descriptor of the file, written at its current position
+* @Return: -
+*
+************************************************/
+void FatSystem_setOutput(FatFileSystem *fs, int output_fd){
+	fs->output_fd = output_fd;
+}
+
+
+/***********************************************
+*
+* @Purpose: Sets the format of the lines written by /ls
+* @Parameters: FatFileSystem *fs, FAT16 volume
+*              int list_format, LIST_OUTPUT_JSON or LIST_OUTPUT_TSV
+* @Return: -
+*
+************************************************/
+void FatSystem_setListFormat(FatFileSystem *fs, int list_format){
+	fs->list_format = list_format;
+}
+
+
+/***********************************************
+*
+* @Purpose: Visitor of the walk of /extract, stops at the first file whose long name matches the target exactly
+*           or whose 8.3 name matches it ignoring the case, like /find does
+* @Parameters: const FileEntry *entry, entry visited
+*              void *context, FatExtractMatch filled with the file found
+* @Return: FILE_ENTRY_STOP when the file is found, FILE_ENTRY_CONTINUE otherwise
+*
+************************************************/
+static int FatSystem_extractVisitor(const FileEntry *entry, void *context){
+	FatExtractMatch *match = (FatExtractMatch *) context;
+
+	if (entry->type != FILE_ENTRY_FILE) return FILE_ENTRY_CONTINUE;
+	if (strcmp(entry->name, match->target->name) != 0 && strcasecmp(entry->short_name, match->target->name) != 0){
+		return FILE_ENTRY_CONTINUE;
+	}
+	match->found = 1;
+	match->first_cluster = entry->id;
+	match->size = entry->size;
+	return FILE_ENTRY_STOP;
+}
+
+
+/***********************************************
+*
+* @Purpose: Finds the file /extract copies: an absolute path is resolved a folder at a time, and a name is
+*           looked up in the name index when there is one or found by a walk of the volume
+* @Parameters: FatFileSystem *fs, FAT16 volume
+*              FatExtractMatch *match, target looked for, filled with the file found
+* @Return: 1 if the file has been found, 0 otherwise
+*
+************************************************/
+static int FatSystem_locateFile(FatFileSystem *fs, FatExtractMatch *match){
+	NameIndexRecord *record;
+	FatDirLookup result;
+	NameIndex *index;
+
+	if (match->target->is_path){
+		OpStats_startPhase(fs->stats, OP_STATS_PHASE_PATHS);
+		if (FatSystem_resolvePath(fs, match->target->name, &result) == 1){
+			match->found = 1;
+			match->first_cluster = result.entry.DIR_FstClusLO;
+			match->size = result.entry.DIR_FileSize;
+		}
+		return match->found;
+	}
+	OpStats_startPhase(fs->stats, OP_STATS_PHASE_INDEX);
+	index = FatSystem_loadIndex(fs);
+	if (index != NULL){
+		record = NameIndex_find(index, match->target->name, NULL);
+		if (record != NULL){
+			match->found = 1;
+			match->first_cluster = record->id;
+			match->size = record->size;
+		}
+		NameIndex_close(index);
+		return match->found;
+	}
+	OpStats_startPhase(fs->stats, OP_STATS_PHASE_WALK);
+	FatSystem_walk(fs, FatSystem_extractVisitor, match);
+	return match->found;
+}
+
+
+/***********************************************
+*
+* @Purpose: Copies the data of a file to another file following its cluster chain in the FAT loaded in memory.
+*           Every run of consecutive clusters is copied with a single call, without going through the block cache
+* @Parameters: FatFileSystem *fs, FAT16 volume
+*              unsigned int first_cluster, first cluster of the file
+*              unsigned long long size, size in bytes of the file
+*              int out_fd, descriptor written at its current position
+* @Return: number of bytes copied, less than size if the chain is shorter than the file, -1 on error
+*
+************************************************/
+long long FatSystem_copyFile(FatFileSystem *fs, unsigned int first_cluster, unsigned long long size, int out_fd){
+	unsigned long long copied = 0, run_size;
+	unsigned int run_cluster, run_count;
+	FatChain chain;
+	ssize_t bytes;
+
+	FatSystem_initChain(fs, &chain, first_cluster);
+	while (copied < size && FatSystem_nextRun(&chain, &run_cluster, &run_count, fs->cluster_count)){
+		run_size = (unsigned long long) run_count * fs->cluster_size;
+		if (run_size > size - copied) run_size = size - copied;
+		bytes = VolumeIO_copyTo(fs->volume_io, FatSystem_getClusterPosition(fs, run_cluster), run_size, out_fd);
+		if (bytes < 0) return -1;
+		copied += bytes;
+		if ((unsigned long long) bytes < run_size) break;
+	}
+	return copied;
+}
+
+
+/***********************************************
+*
+* @Purpose: Copies the file named by the first target to the output of the volume
+* @Parameters: TargetSet *targets, name or absolute path of the file
+*              FatFileSystem *fs, FAT16 volume
+* @Return: -
+*
+************************************************/
+static void FatSystem_extract(TargetSet *targets, FatFileSystem *fs){
+	FatExtractMatch match;
+	long long copied;
+
+	if (targets->count == 0) return;
+	memset(&match, 0, sizeof(match));
+	match.target = &targets->targets[0];
+	if (FatSystem_locateFile(fs, &match) == 0){
+		OpStats_endPhase(fs->stats);
+		return;
+	}
+	TargetSet_setFound(targets, match.target);
+	// The text printed so far has to come before the data when both go to the standard output
+	fflush(stdout);
+	OpStats_startPhase(fs->stats, OP_STATS_PHASE_COPY);
+	copied = FatSystem_copyFile(fs, match.first_cluster, match.size, fs->output_fd);
+	OpStats_endPhase(fs->stats);
+	if (copied < 0){
+		printf("Unable to write the file %s\n", match.target->name);
+	}else if ((unsigned long long) copied < match.size){
+		printf("The file %s is damaged, only %lld of its %llu bytes have been extracted\n", match.target->name, copied, match.size);
+	}else if (fs->output_fd != STDOUT_FILENO){
+		printf("File: %s extracted, %llu bytes\n", match.target->name, match.size);
+	}
+}
+
+
+/***********************************************
+*
+* @Purpose: Lists every file and folder of the volume (/ls), walking the whole tree and writing a line per entry
+*           with its path, type, size, timestamps and first cluster
+* @Parameters: FatFileSystem *fs, FAT16 volume
+* @Return: -
+*
+************************************************/
+static void FatSystem_list(FatFileSystem *fs){
+	ListOutput *output = ListOutput_create(fs->output_fd, fs->list_format, "cluster");
+
+	if (output == NULL){
+		printf("Unable to list the volume\n");
+		return;
+	}
+	// The text printed so far has to come before the listing when both go to the standard output
+	fflush(stdout);
+	OpStats_startPhase(fs->stats, OP_STATS_PHASE_WALK);
+	FatSystem_walk(fs, ListOutput_addEntry, output);
+	OpStats_endPhase(fs->stats);
+	if (ListOutput_close(output) < 0){
+		printf("Unable to write the listing of the volume\n");
+	}
+}
+
+
+/***********************************************
+*
+* @Purpose: Gets the name index of the volume, building it if it does not match the checksum of the FAT
+* @Parameters: FatFileSystem *fs, FAT16 volume
+* @Return: the index, NULL if no index is used or it cannot be built
+*
+************************************************/
+static NameIndex *FatSystem_loadIndex(FatFileSystem *fs){
+	if (fs->index_path == NULL) return NULL;
+	return NameIndex_load(fs->index_path, NAME_INDEX_FS_FAT16, FatSystem_getChecksum(fs), FatSystem_indexWalker, fs);
+}
+
+
+/***********************************************
+*
+* @Purpose: Deletes the file of a record of the name index, and marks it as deleted in it
+* @Parameters: Target *target, target matched by the file
+*              TargetSet *targets, set of the target
+*              FatFileSystem *fs, FAT16 volume
+*              NameIndex *index, index of the volume
+*              NameIndexRecord *record, record of the file
+* @Return: 1 on success, 0 if the file has to be deleted by a walk because its long name slots are not right
+*          before the entry, -1 if the entry of the index does not match the volume
+*
+************************************************/
+static int FatSystem_deleteRecord(Target *target, TargetSet *targets, FatFileSystem *fs, NameIndex *index, NameIndexRecord *record){
+	const char *name = target->is_pattern ? NameIndex_getString(index, record->name) : target->name;
+	FatDirEntry directory_entry;
+	FatLongName long_name;
+	char short_name[FAT_SYSTEM_SHORT_NAME_SIZE];
+	const char *record_short_name;
+
+	// Only the walk knows where the slots are, it deletes the same file as it is the first one with the name
+	if (record->num_slots > 0 && record->aux_position == 0){
+		NameIndex_markDeleted(index, record);
+		return 0;
+	}
+	if (VolumeIO_read(fs->volume_io, record->position, &directory_entry, FAT_SYSTEM_DIR_ENTRY_SIZE) != FAT_SYSTEM_DIR_ENTRY_SIZE){
+		return -1;
+	}
+	FatSystem_decodeShortName(&directory_entry, short_name);
+	record_short_name = (record->flags & NAME_INDEX_FLAG_CASELESS) ? NameIndex_getString(index, record->name) : NameIndex_getString(index, record->alt_name);
+	if (record_short_name == NULL || strcmp(short_name, record_short_name) != 0 || directory_entry.DIR_FstClusLO != record->id){
+		return -1;
+	}
+
+	FatSystem_initLongName(&long_name);
+	long_name.num_slots = record->num_slots;
+	for (unsigned int i = 0; i < record->num_slots && i < FAT_SYSTEM_MAX_LFN_SLOTS; i++){
+		long_name.slots[i] = record->aux_position + (unsigned long long) i * FAT_SYSTEM_DIR_ENTRY_SIZE;
+	}
+	FatSystem_deleteEntry(record->position, fs->volume_io, (char *) name, record->num_slots > 0 ? &long_name : NULL);
+	NameIndex_markDeleted(index, record);
+	TargetSet_setFound(targets, target);
+	return 1;
+}
+
+
+/***********************************************
+*
+* @Purpose: Finds the next record of the name index of a file taken by a pattern. As in the walk, a file is
+*           taken by a name target when its long name or its 8.3 name is one, and otherwise by the first pattern
+*           it matches, so that it is not shown twice
+* @Parameters: Target *target, pattern looked for
+*              TargetSet *targets, set of the target
+*              NameIndex *index, index of the volume
+*              NameIndexRecord *previous, record returned by the previous call, NULL to get the first one
+* @Return: the next record, NULL if there are no more
+*
+************************************************/
+static NameIndexRecord *FatSystem_nextPatternRecord(Target *target, TargetSet *targets, NameIndex *index, NameIndexRecord *previous){
+	NameIndexRecord *record = previous;
+	const char *name, *short_name;
+	Target *named;
+	int caseless, taken;
+
+	while ((record = NameIndex_findPattern(index, target->pattern, target->upper_pattern, record)) != NULL){
+		caseless = (record->flags & NAME_INDEX_FLAG_CASELESS) != 0;
+		name = NameIndex_getString(index, record->name);
+		short_name = caseless ? name : NameIndex_getString(index, record->alt_name);
+		taken = !caseless && TargetSet_findExact(targets, name, strlen(name)) != NULL;
+		named = NULL;
+		while (!taken && short_name != NULL && (named = TargetSet_findCaseless(targets, short_name, strlen(short_name), named)) != NULL){
+			taken = strcmp(named->upper_name, short_name) == 0;
+		}
+		if (!taken && TargetSet_findPattern(targets, name, strlen(name), caseless, NULL) == target) return record;
+	}
+	return NULL;
+}
+
+
+/***********************************************
+*
+* @Purpose: Deletes through the name index the first file with the name of a target, or all the files of a
+*           pattern, and marks them as deleted in it
+* @Parameters: Target *target, name of the file
+*              TargetSet *targets, set of the target
+*              FatFileSystem *fs, FAT16 volume
+*              NameIndex *index, index of the volume
+* @Return: 1 on success (also when there is no such file), 0 if a file has to be deleted by a walk because
+*          its long name slots are not right before the entry, -1 if the entry of the index does not match the volume
+*
+************************************************/
+static int FatSystem_deleteIndexed(Target *target, TargetSet *targets, FatFileSystem *fs, NameIndex *index){
+	NameIndexRecord *record = NULL;
+	int result = 1;
+
+	if (!target->is_pattern){
+		record = NameIndex_find(index, target->name, NULL);
+		return record == NULL ? 1 : FatSystem_deleteRecord(target, targets, fs, index, record);
+	}
+	while (result > 0 && (record = FatSystem_nextPatternRecord(target, targets, index, record)) != NULL){
+		result = FatSystem_deleteRecord(target, targets, fs, index, record);
+	}
+	return result;
+}
+
+
+/***********************************************
+*
+* @Purpose: Converts the 8.3 name of a directory entry to the normal format, "NAME.EXT" or "NAME" when
+*           there is no extension. The directory entry is not modified
+* @Parameters: const FatDirEntry *directory_entry, directory entry with the file name in FAT16 format
+*              char name[FAT_SYSTEM_SHORT_NAME_SIZE], filled with the name
+* @Return:-
+*
+************************************************/
+void FatSystem_decodeShortName(const FatDirEntry *directory_entry, char name[FAT_SYSTEM_SHORT_NAME_SIZE]){
+	int base_length = FAT_SYSTEM_DIR_BASE_SIZE, extension_length = FAT_SYSTEM_DIR_NAME_SIZE - FAT_SYSTEM_DIR_BASE_SIZE, j = 0;
+	const char *extension = directory_entry->DIR_Name + FAT_SYSTEM_DIR_BASE_SIZE;
+
+	// Both parts are padded with white spaces
+	while (base_length > 0 && directory_entry->DIR_Name[base_length - 1] == ' ') base_length--;
+	while (extension_length > 0 && extension[extension_length - 1] == ' ') extension_length--;
+	for (int i = 0; i < base_length; i++){
+		name[j++] = directory_entry->DIR_Name[i];
+	}
+	// A first byte of 0x05 stands for a real 0xE5 character
+	if (base_length > 0 && (unsigned char) name[0] == FAT_SYSTEM_DIR_KANJI){
+		name[0] = (char) FAT_SYSTEM_DIR_FREE;
+	}
+	if (extension_length > 0){
+		name[j++] = '.';
+		for (int i = 0; i < extension_length; i++){
+			name[j++] = extension[i];
+		}
+	}
+	name[j] = '\0';
+}
+
+
+/***********************************************
+*
+* @Purpose: Clears the state of the long name decoding
+* @Parameters: FatLongName *long_name, long name state
+* @Return:-
+*
+************************************************/
+void FatSystem_initLongName(FatLongName *long_name){
+	long_name->next_order = 0;
+	long_name->num_slots = 0;
+	long_name->checksum = 0;
+	long_name->name[0] = '\0';
+}
+
+
+/***********************************************
+*
+* @Purpose: Decodes a long name slot. The slots are stored from the last part of the name to the first one,
+*           each with 13 UCS-2 characters. Only the low byte of the characters is kept, '?' is used for the rest
+* @Parameters: FatLongName *long_name, long name state
+*              const unsigned char *slot, FAT_SYSTEM_DIR_ENTRY_SIZE bytes of the slot
+*              unsigned long long position, address of the slot in the volume
+* @Return:-
+*
+************************************************/
+void FatSystem_addLongNameSlot(FatLongName *long_name, const unsigned char *slot, unsigned long long position){
+	static const int char_offsets[FAT_SYSTEM_LFN_CHARS] = {1, 3, 5, 7, 9, 14, 16, 18, 20, 22, 24, 28, 30};
+	int order = slot[0] & FAT_SYSTEM_LFN_ORDER_MASK;
+	unsigned short character;
+	char *part;
+
+	// The first slot found has the last part of the name and tells how many slots there are
+	if (slot[0] & FAT_SYSTEM_LFN_LAST){
+		if (order == 0 || order > FAT_SYSTEM_MAX_LFN_SLOTS){
+			FatSystem_initLongName(long_name);
+			return;
+		}
+		memset(long_name->name, 0, sizeof(long_name->name));
+		long_name->next_order = order;
+		long_name->num_slots = 0;
+		long_name->checksum = slot[FAT_SYSTEM_LFN_CHECKSUM_OFFSET];
+	}
+	// Slots out of sequence or from another entry invalidate the name
+	if (long_name->next_order == 0 || order != long_name->next_order || slot[FAT_SYSTEM_LFN_CHECKSUM_OFFSET] != long_name->checksum){
+		FatSystem_initLongName(long_name);
+		return;
+	}
+	part = long_name->name + (order - 1) * FAT_SYSTEM_LFN_CHARS;
+	for (int i = 0; i < FAT_SYSTEM_LFN_CHARS; i++){
+		character = slot[char_offsets[i]] | (slot[char_offsets[i] + 1] << 8);
+		// The name ends with 0x0000 and is padded with 0xFFFF
+		if (character == 0x0000 || character == 0xFFFF) break;
+		part[i] = character < 0x100 ? (char) character : '?';
+	}
+	long_name->slots[long_name->num_slots++] = position;
+	long_name->next_order--;
+}
+
+
+/***********************************************
+*
+* @Purpose: Checks whether a complete long name has been decoded for a short directory entry
+* @Parameters: FatLongName *long_name, long name state
+*              const FatDirEntry *directory_entry, short entry that follows the slots
+* @Return: 1 if long_name->name is the long name of the entry, 0 otherwise
+*
+************************************************/
+int FatSystem_hasLongName(FatLongName *long_name, const FatDirEntry *directory_entry){
+	unsigned char checksum = 0;
+
+	if (long_name->num_slots == 0 || long_name->next_order != 0) return 0;
+	// Checksum of the 8.3 name stored in every slot
+	for (int i = 0; i < FAT_SYSTEM_DIR_NAME_SIZE; i++){
+		checksum = ((checksum & 1) << 7) + (checksum >> 1) + (unsigned char) directory_entry->DIR_Name[i];
+	}
+	return checksum == long_name->checksum;
+}
+
+
+/***********************************************
+*
+* @Purpose: Function that returns 1 if a directory entry is  a file, 0 otherwise
+* @Parameters: FatDirEntry directory_entry, directory entry whose type is checked
+* @Return:  returns 1 if a directory entry is  a file, 0 otherwise
+*
+************************************************/
+int FatSystem_isFile(FatDirEntry directory_entry){
+	return directory_entry.DIR_Attr == FAT_SYSTEM_DIR_ENTRY_FILE;
+}
+
+
+/***********************************************
+*
+* @Purpose: Function that returns 1 if a directory entry is  a folder, 0 otherwise
+* @Parameters: FatDirEntry directory_entry, directory entry whose type is checked
+* @Return:  returns 1 if a directory entry is  a folder, 0 otherwise
+*
+************************************************/
+int FatSystem_isFolder(FatDirEntry directory_entry){
+	return directory_entry.DIR_Attr == FAT_SYSTEM_DIR_ENTRY_FOLDER;
+}
+
+
+/***********************************************
+*
+* @Purpose: Checks if the directory entry is and if it is different than .. and .
+* @Parameters: -
+*
+* @Return:  returns 1 if it is valid, 0 otherwise
+*
+************************************************/
+int FatSystem_isValidFolder(FatDirEntry directory_entry){
+	// Only the . and .. entries can start with a '.'
+	return (directory_entry.DIR_Name[0] != '.' && FatSystem_isFolder(directory_entry) == 1);
+}
+
+
+/***********************************************
+*
+* @Purpose: Deletes the directory entry in the file system, together with the slots of its long name
+* @Parameters: unsigned long long dir_entry_pos: Position of the filesystem to be deleted
+*              VolumeIO *volume_io: file descriptor  of the filesystem
+*              char *name: name of the file, to be displayed
+*              FatLongName *long_name: long name of the entry, NULL if it has no long name
+*
+* @Return:  -
+*
+************************************************/
+void FatSystem_deleteEntry(unsigned long long dir_entry_pos, VolumeIO *volume_io, char *name, FatLongName *long_name){
+	FatDirEntry directory_entry;
+	unsigned char free_mark = FAT_SYSTEM_DIR_FREE;
+
+	// Deleting all the directory entry
+	bzero(&directory_entry, sizeof(FatDirEntry));
+	// Setting the first byte to 0xE5 which tells that this directory entry is free
+	directory_entry.DIR_Name[0] = FAT_SYSTEM_DIR_FREE;
+	// Writting the empty directory entry
+	VolumeIO_write(volume_io, dir_entry_pos, &directory_entry, FAT_SYSTEM_DIR_ENTRY_SIZE);
+	// The long name slots are freed too, otherwise they would be left orphaned
+	if (long_name != NULL){
+		for (int i = 0; i < long_name->num_slots; i++){
+			VolumeIO_write(volume_io, long_name->slots[i], &free_mark, sizeof(free_mark));
+		}
+	}
 
 	printf("File %s deleted in the filesystem\n", name);
 }
@@ -8,6 +8,15 @@
 #ifndef FATSYSTEM_H
     #define FATSYSTEM_H
 
+    #include <pthread.h>
+
+    #include "VolumeIO.h"
+    #include "FileEntry.h"
+    #include "ListOutput.h"
+    #include "TargetSet.h"
+    #include "WorkPool.h"
+    #include "OpStats.h"
+
     #define FAT_SYSYTEM_NAME "FAT16   "
     // System type size and offset
     #define FAT_SYSTEM_SYSTYPE_SIZE 8
@@ -36,12 +45,59 @@
     // System size size and offset
     #define FAT_SYSTEM_SIZE_OFFSET 11
     #define FAT_SYSTEM_SIZE_SIZE 2
+    // System total sectors size and offset
+    #define FAT_SYSTEM_TOTAL_SECTORS16_OFFSET 19
+    #define FAT_SYSTEM_TOTAL_SECTORS16_SIZE 2
+    #define FAT_SYSTEM_TOTAL_SECTORS32_OFFSET 32
+    #define FAT_SYSTEM_TOTAL_SECTORS32_SIZE 4
+
+    // First cluster of the data region
+    #define FAT_SYSTEM_FIRST_CLUSTER 2
+    // Cluster number used to refer to the fixed root directory region
+    #define FAT_SYSTEM_ROOT_CLUSTER 0
+    // Maximum number of consecutive clusters of a directory scanned at once
+    #define FAT_SYSTEM_MAX_RUN_CLUSTERS 16
+    // Maximum number of folders of a directory region whose first clusters are prefetched together
+    #define FAT_SYSTEM_MAX_PREFETCH 64
+    // Year of the dates of the directory entries whose year field is 0
+    #define FAT_SYSTEM_EPOCH_YEAR 1980
+    // Ordinal of the scan of the root directory, the folders of the root are numbered from 0
+    #define FAT_SYSTEM_ROOT_SCAN -1
+    // Value of cancel_after while no scan has found all the targets
+    #define FAT_SYSTEM_NO_CANCEL 0x7FFFFFFF
+    // Results of looking up a name in a region of a directory
+    #define FAT_SYSTEM_LOOKUP_MISSING 0
+    #define FAT_SYSTEM_LOOKUP_FOUND 1
+    #define FAT_SYSTEM_LOOKUP_NEXT_REGION 2
 
     #define FAT_SYSTEM_DIR_ENTRY_SIZE 32
     #define FAT_SYSTEM_DIR_NAME_SIZE 11
+    #define FAT_SYSTEM_DIR_BASE_SIZE 8
+    // Size of a decoded 8.3 name: "NAME.EXT" and the '\0'
+    #define FAT_SYSTEM_SHORT_NAME_SIZE 13
+
+    // Values of the first byte of the name
+    #define FAT_SYSTEM_DIR_END 0x00
+    #define FAT_SYSTEM_DIR_FREE 0xE5
+    #define FAT_SYSTEM_DIR_KANJI 0x05
+
+    // Long name slots
+    #define FAT_SYSTEM_ATTR_LONG_NAME 0x0F
+    #define FAT_SYSTEM_ATTR_LONG_NAME_MASK 0x3F
+    #define FAT_SYSTEM_LFN_LAST 0x40
+    #define FAT_SYSTEM_LFN_ORDER_MASK 0x1F
+    #define FAT_SYSTEM_LFN_CHECKSUM_OFFSET 13
+    #define FAT_SYSTEM_LFN_CHARS 13
+    #define FAT_SYSTEM_MAX_LFN_SLOTS 20
+    #define FAT_SYSTEM_LONG_NAME_SIZE (FAT_SYSTEM_MAX_LFN_SLOTS * FAT_SYSTEM_LFN_CHARS + 1)
 
     #define FAT_SYSTEM_DIR_ENTRY_FILE 0x20
     #define FAT_SYSTEM_DIR_ENTRY_FOLDER 0x10
+    #define FAT_SYSTEM_ATTR_VOLUME_ID 0x08
+
+    // FNV-1a parameters of the FAT checksum
+    #define FAT_SYSTEM_FNV_OFFSET 14695981039346656037ULL
+    #define FAT_SYSTEM_FNV_PRIME 1099511628211ULL
 
     // First one as unisgned short b.c. is the smalles block of 2 bytes
     typedef struct FatSystem {
@@ -53,9 +109,33 @@
       unsigned short BPB_FATSz16;             // This field is the FAT12/FAT16 16-bit count of sectors occupied by ONE FAT
       unsigned short BPB_RootEntCnt;          // For FAT12 and FAT16 volumes, this field contains the count of 32-byte directory entries in the root directory.
       unsigned short BPB_BytsPerSec;          // Count of bytes per sector
+      unsigned short BPB_TotSec16;            // 16-bit total count of sectors on the volume, 0 if BPB_TotSec32 is used
+      unsigned int BPB_TotSec32;              // 32-bit total count of sectors on the volume
       char system_type[6];
     } FatSystem;
 
+    typedef struct FatFileSystem{
+      VolumeIO *volume_io;                    // Block I/O handle of the volume
+      FatSystem fat_system;                   // Boot sector data
+      unsigned short *fat;                    // First FAT of the volume, one entry per cluster
+      unsigned int cluster_count;             // Number of clusters of the data region
+      unsigned int cluster_size;              // Size in bytes of a cluster
+      unsigned long long fat_position;        // Position of the first FAT
+      unsigned long long root_position;       // Position of the root directory region
+      unsigned long long first_data_position; // Position of the data region (cluster 2)
+      const char *index_path;                 // Name index file used by /find and /delete, NULL if none
+      int threads;                            // Number of threads scanning the folders of the root for /find and /delete
+      OpStats *stats;                         // Statistics of the operation, NULL when --stats is not given
+      int output_fd;                          // Descriptor /extract and /ls write to, the standard output by default
+      int list_format;                        // Format of the lines of /ls, LIST_OUTPUT_JSON or LIST_OUTPUT_TSV
+    } FatFileSystem;
+
+    typedef struct FatChain{
+      FatFileSystem *fs;                      // Volume of the chain
+      unsigned int cluster;                   // Next cluster of the chain
+      unsigned int visited;                   // Number of clusters already returned, to detect loops
+    } FatChain;
+
     typedef struct FatDirEntry{
       char DIR_Name[11];                      // Short name
       char DIR_Attr;                          // File attributes
@@ -71,19 +151,98 @@
       unsigned int DIR_FileSize;              // 32-bit DWORD holding this file’s size in bytes
     }FatDirEntry;
 
+    typedef struct FatLongName{
+      char name[FAT_SYSTEM_LONG_NAME_SIZE];   // Decoded long name
+      unsigned char checksum;                 // Checksum of the short name stored in the slots
+      int next_order;                         // Order of the next slot expected, 0 when the name is complete or not started
+      int num_slots;                          // Number of slots decoded
+      unsigned long long slots[FAT_SYSTEM_MAX_LFN_SLOTS]; // Address of every slot, used to delete them
+    } FatLongName;
+
+    typedef struct FatDirLookup{
+      FatDirEntry entry;                      // Directory entry found
+      unsigned long long entry_pointer;       // Address of the directory entry
+      char short_name[FAT_SYSTEM_SHORT_NAME_SIZE]; // Decoded 8.3 name of the entry
+      int has_long_name;                      // 1 if long_name holds the long name of the entry
+      FatLongName long_name;                  // Long name of the entry, with the address of its slots
+    } FatDirLookup;
+
+    typedef struct FatExtractMatch{
+      Target *target;                         // Name of the file extracted
+      int found;                              // 1 once a file with the name has been found
+      unsigned int first_cluster;             // First cluster of the file found
+      unsigned long long size;                // Size in bytes of the file found
+    } FatExtractMatch;
+
+    typedef struct FatFindScan FatFindScan;
+
+    typedef struct FatFindItem{
+      Target *target;                         // Target matched by the file, NULL when the item is a folder of the root
+      unsigned int file_size;                 // Size of the file
+      unsigned long long entry_pointer;       // Address of the directory entry of the file
+      char short_name[FAT_SYSTEM_SHORT_NAME_SIZE]; // Decoded 8.3 name of the file
+      int has_long_name;                      // 1 if long_name holds the long name of the file
+      FatLongName long_name;                  // Long name of the file, with the address of its slots
+      FatFindScan *folder;                    // Scan of the folder of the root, NULL when the item is a file
+    } FatFindItem;
+
+    typedef struct FatFindOperation{
+      FatFileSystem *fs;                      // Volume scanned
+      TargetSet *targets;                     // Names looked for
+      int is_delete;                          // 1 to delete the files found, 0 to show their size
+      WorkPool *pool;                         // Threads scanning the folders of the root, NULL to scan them recursively
+      pthread_mutex_t lock;                   // Protects cancel_after
+      int cancel_after;                       // Folders of the root after this position are not needed, all the targets are found before
+    } FatFindOperation;
+
+    struct FatFindScan{
+      FatFindOperation *operation;            // Operation the scan belongs to
+      int ordinal;                            // Position of the folder among the folders of the root, FAT_SYSTEM_ROOT_SCAN for the root
+      unsigned int first_cluster;             // First cluster of the folder scanned
+      int *found;                             // Number of files found by this scan for every target
+      int found_count;                        // Number of targets with a file found by this scan
+      int folders;                            // Number of folders of the root given to the workers (scan of the root only)
+      FatFindItem *items;                     // Files found and folders of the root, in the order of the recursive walk
+      int count;                              // Number of items
+      int capacity;                           // Number of items allocated
+    };
+
 
-    int FatSystem_isFatSystem(int fd);
-    FatSystem FatSystem_readSystem(int fd);
+    int FatSystem_isFatSystem(VolumeIO *volume_io);
+    FatSystem FatSystem_readSystem(VolumeIO *volume_io);
     void FatSystem_displayFatInfo (FatSystem fat_system);
+    void FatSystem_displayFatStats(FatFileSystem *fs);
     int FatSystem_getOperationNumber(char *operation);
-    void FatSystem_executeOperation(char * operation, char* file, int volume_fd);
+    FatFileSystem *FatSystem_open(VolumeIO *volume_io);
+    void FatSystem_close(FatFileSystem *fs);
+    void FatSystem_executeOperation(char * operation, TargetSet *targets, FatFileSystem *fs);
+    void FatSystem_printNotFound(TargetSet *targets);
     int FatSystem_calculateRootDirectory(FatSystem fat_system);
-    void FatSystem_findFile(char *file, int volume_fd, unsigned int initial_address, FatSystem fat_system);
-    void FatSystem_parseFileName(FatDirEntry *directory_entry, unsigned int entry_pointer, int volume_fd, char long_name[50]);
-    int FatSystem_noMoreChars(char *name, int index);
+    unsigned long long FatSystem_getClusterPosition(FatFileSystem *fs, unsigned int cluster);
+    void FatSystem_initChain(FatFileSystem *fs, FatChain *chain, unsigned int first_cluster);
+    int FatSystem_isDataCluster(FatFileSystem *fs, unsigned int cluster);
+    int FatSystem_nextRun(FatChain *chain, unsigned int *first_cluster, unsigned int *count, unsigned int max_clusters);
+    void FatSystem_setThreads(FatFileSystem *fs, int threads);
+    void FatSystem_findFile(TargetSet *targets, FatFileSystem *fs, int is_delete);
+    void FatSystem_scanFolder(FatFindScan *scan, unsigned int first_cluster);
+    int FatSystem_lookup(FatFileSystem *fs, unsigned int first_cluster, const char *name, size_t name_len, FatDirLookup *result);
+    int FatSystem_walk(FatFileSystem *fs, FileEntryVisitor visitor, void *context);
+    unsigned long long FatSystem_getChecksum(FatFileSystem *fs);
+    void FatSystem_setIndex(FatFileSystem *fs, const char *index_path);
+    void FatSystem_setStats(FatFileSystem *fs, OpStats *stats);
+    void FatSystem_setOutput(FatFileSystem *fs, int output_fd);
+    void FatSystem_setListFormat(FatFileSystem *fs, int list_format);
+    long long FatSystem_copyFile(FatFileSystem *fs, unsigned int first_cluster, unsigned long long size, int out_fd);
+    int FatSystem_scanEntries(FatFindScan *scan, unsigned long long initial_address, size_t size, char *buffer, FatLongName *long_name);
+    void FatSystem_matchEntry(FatFindScan *scan, const FatDirEntry *directory_entry, unsigned long long entry_pointer, const char *short_name, FatLongName *long_name);
+    void FatSystem_reportTarget(FatFindScan *scan, Target *target, unsigned int file_size, unsigned long long entry_pointer, const char *short_name,
+        FatLongName *long_name, int *deleted);
+    void FatSystem_decodeShortName(const FatDirEntry *directory_entry, char name[FAT_SYSTEM_SHORT_NAME_SIZE]);
+    void FatSystem_initLongName(FatLongName *long_name);
+    void FatSystem_addLongNameSlot(FatLongName *long_name, const unsigned char *slot, unsigned long long position);
+    int FatSystem_hasLongName(FatLongName *long_name, const FatDirEntry *directory_entry);
     int FatSystem_isFile(FatDirEntry directory_entry);
     int FatSystem_isFolder(FatDirEntry directory_entry);
     int FatSystem_isValidFolder(FatDirEntry directory_entry);
-    void FatSystem_deleteEntry(unsigned int dir_entry_pos, int volume_fd, char *name);
-    void FatSystem_fileToUpper(char *file);
+    void FatSystem_deleteEntry(unsigned long long dir_entry_pos, VolumeIO *volume_io, char *name, FatLongName *long_name);
 #endif
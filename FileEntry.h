@@ -0,0 +1,43 @@
+/***********************************************
+*
+* @Purpose: Description of a file or folder found while walking a volume, shared by the FAT16 and Ext2
+*           modules and by the features that work on any of them (like the name index)
+* @Author: Óscar Cubeles Ollé
+* @Creation Date: October 2026
+*
+************************************************/
+#ifndef FILEENTRY_H
+    #define FILEENTRY_H
+
+    // Maximum length of a path, including the '\0'
+    #define FILE_ENTRY_MAX_PATH 4096
+
+    // Types of entry
+    #define FILE_ENTRY_FILE 0
+    #define FILE_ENTRY_DIRECTORY 1
+    #define FILE_ENTRY_OTHER 2
+
+    // Values returned by the visitors
+    #define FILE_ENTRY_CONTINUE 0
+    #define FILE_ENTRY_STOP 1
+    #define FILE_ENTRY_SKIP 2
+
+    typedef struct FileEntry{
+      const char *name;                       // Name of the entry (the long name in FAT16 when it has one)
+      const char *short_name;                 // 8.3 name in FAT16, NULL in Ext2
+      const char *path;                       // Path from the root directory, starting with '/'
+      unsigned int id;                        // Inode number (Ext2) or first cluster (FAT16)
+      int type;                               // FILE_ENTRY_FILE, FILE_ENTRY_DIRECTORY or FILE_ENTRY_OTHER (FAT16 entries with other attributes, Ext2 links, devices...)
+      unsigned long long size;                // Size in bytes
+      unsigned long long mtime;               // Last modification, in seconds since 1970 (FAT16 stores the local time, taken as UTC)
+      unsigned long long atime;               // Last access, in seconds since 1970 (FAT16 only stores its date)
+      unsigned long long position;            // Address of the directory entry in the volume
+      unsigned long long aux_position;        // Ext2: address of the directory block. FAT16: address of the first long name
+                                              // slot, 0 if the slots are not right before the entry
+      unsigned int num_slots;                 // FAT16: number of long name slots of the entry
+    } FileEntry;
+
+    // Function called for every entry of a walk. Returns FILE_ENTRY_CONTINUE, FILE_ENTRY_STOP to end the walk
+    // or FILE_ENTRY_SKIP to not go into a folder
+    typedef int (*FileEntryVisitor)(const FileEntry *entry, void *context);
+#endif
@@ -0,0 +1,238 @@
+/***********************************************
+*
+* @Purpose: Listing of the entries of a volume (/ls), one line per entry as NDJSON or TSV, formatted into a
+*           large buffer that is written with a single write() every time it fills up
+* @Author: Óscar Cubeles Ollé
+* @Creation Date: October 2026
+*
+************************************************/
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "ListOutput.h"
+
+const char *LIST_OUTPUT_TYPE_NAMES[] = {LIST_OUTPUT_TYPES};
+static const char LIST_OUTPUT_HEX[] = "0123456789abcdef";
+
+
+/***********************************************
+*
+* @Purpose: Creates the listing written to a descriptor
+* @Parameters: int fd, descriptor the lines are written to, at its current position
+*              int format, LIST_OUTPUT_JSON or LIST_OUTPUT_TSV
+*              const char *id_name, name given to the id of the entries in JSON
+* @Return: the listing, NULL if there is not enough memory
+*
+************************************************/
+ListOutput *ListOutput_create(int fd, int format, const char *id_name){
+	ListOutput *output = (ListOutput *) calloc(1, sizeof(ListOutput));
+
+	if (output == NULL) return NULL;
+	output->buffer = (char *) malloc(LIST_OUTPUT_BUFFER_SIZE);
+	if (output->buffer == NULL){
+		free(output);
+		return NULL;
+	}
+	output->fd = fd;
+	output->format = format;
+	output->id_name = id_name;
+	return output;
+}
+
+
+/***********************************************
+*
+* @Purpose: Appends a number in decimal, without going through the formatting of stdio
+* @Parameters: char *cursor, position of the buffer where the digits are written
+*              unsigned long long value, number
+* @Return: position after the last digit
+*
+************************************************/
+static char *ListOutput_putNumber(char *cursor, unsigned long long value){
+	char digits[20];
+	int count = 0;
+
+	do{
+		digits[count++] = (char) ('0' + value % 10);
+		value /= 10;
+	}while (value != 0);
+	while (count > 0){
+		*cursor++ = digits[--count];
+	}
+	return cursor;
+}
+
+
+/***********************************************
+*
+* @Purpose: Appends a string with nothing to escape
+* @Parameters: char *cursor, position of the buffer where the string is written
+*              const char *text, string
+* @Return: position after the string
+*
+************************************************/
+static char *ListOutput_putText(char *cursor, const char *text){
+	size_t length = strlen(text);
+	memcpy(cursor, text, length);
+	return cursor + length;
+}
+
+
+/***********************************************
+*
+* @Purpose: Appends a path as the content of a JSON string. The quotes, the backslashes and the control characters
+*           are escaped, the rest of the bytes are copied as they are
+* @Parameters: char *cursor, position of the buffer where the path is written
+*              const char *path, path
+* @Return: position after the path
+*
+************************************************/
+static char *ListOutput_putJsonPath(char *cursor, const char *path){
+	unsigned char c;
+
+	for (; *path != '\0'; path++){
+		c = (unsigned char) *path;
+		if (c == '"' || c == '\\'){
+			*cursor++ = '\\';
+			*cursor++ = (char) c;
+		}else if (c == '\n'){
+			cursor = ListOutput_putText(cursor, "\\n");
+		}else if (c == '\t'){
+			cursor = ListOutput_putText(cursor, "\\t");
+		}else if (c < 0x20){
+			cursor = ListOutput_putText(cursor, "\\u00");
+			*cursor++ = LIST_OUTPUT_HEX[c >> 4];
+			*cursor++ = LIST_OUTPUT_HEX[c & 0x0F];
+		}else{
+			*cursor++ = (char) c;
+		}
+	}
+	return cursor;
+}
+
+
+/***********************************************
+*
+* @Purpose: Appends a path as a TSV field, escaping the tabs, the line breaks and the backslashes
+* @Parameters: char *cursor, position of the buffer where the path is written
+*              const char *path, path
+* @Return: position after the path
+*
+************************************************/
+static char *ListOutput_putTsvPath(char *cursor, const char *path){
+	for (; *path != '\0'; path++){
+		if (*path == '\t'){
+			cursor = ListOutput_putText(cursor, "\\t");
+		}else if (*path == '\n'){
+			cursor = ListOutput_putText(cursor, "\\n");
+		}else if (*path == '\r'){
+			cursor = ListOutput_putText(cursor, "\\r");
+		}else if (*path == '\\'){
+			cursor = ListOutput_putText(cursor, "\\\\");
+		}else{
+			*cursor++ = *path;
+		}
+	}
+	return cursor;
+}
+
+
+/***********************************************
+*
+* @Purpose: Adds the line of an entry to the listing. It is a FileEntryVisitor, so it can be given to the walks
+*           of the volumes directly. The buffer is written first if the line may not fit in it
+* @Parameters: const FileEntry *entry, entry listed
+*              void *output, ListOutput the line is added to
+* @Return: FILE_ENTRY_CONTINUE, FILE_ENTRY_STOP if the listing cannot be written
+*
+************************************************/
+int ListOutput_addEntry(const FileEntry *entry, void *output){
+	ListOutput *list = (ListOutput *) output;
+	size_t needed = strlen(entry->path) * LIST_OUTPUT_MAX_ESCAPE + LIST_OUTPUT_LINE_OVERHEAD + strlen(list->id_name);
+	const char *type = LIST_OUTPUT_TYPE_NAMES[entry->type];
+	char *cursor;
+
+	if (list->error) return FILE_ENTRY_STOP;
+	if (list->used + needed > LIST_OUTPUT_BUFFER_SIZE && ListOutput_flush(list) < 0) return FILE_ENTRY_STOP;
+	cursor = list->buffer + list->used;
+	if (list->format == LIST_OUTPUT_TSV){
+		// path, type, size, mtime, atime and id
+		cursor = ListOutput_putTsvPath(cursor, entry->path);
+		*cursor++ = '\t';
+		cursor = ListOutput_putText(cursor, type);
+		*cursor++ = '\t';
+		cursor = ListOutput_putNumber(cursor, entry->size);
+		*cursor++ = '\t';
+		cursor = ListOutput_putNumber(cursor, entry->mtime);
+		*cursor++ = '\t';
+		cursor = ListOutput_putNumber(cursor, entry->atime);
+		*cursor++ = '\t';
+		cursor = ListOutput_putNumber(cursor, entry->id);
+	}else{
+		cursor = ListOutput_putText(cursor, "{\"path\":\"");
+		cursor = ListOutput_putJsonPath(cursor, entry->path);
+		cursor = ListOutput_putText(cursor, "\",\"type\":\"");
+		cursor = ListOutput_putText(cursor, type);
+		cursor = ListOutput_putText(cursor, "\",\"size\":");
+		cursor = ListOutput_putNumber(cursor, entry->size);
+		cursor = ListOutput_putText(cursor, ",\"mtime\":");
+		cursor = ListOutput_putNumber(cursor, entry->mtime);
+		cursor = ListOutput_putText(cursor, ",\"atime\":");
+		cursor = ListOutput_putNumber(cursor, entry->atime);
+		cursor = ListOutput_putText(cursor, ",\"");
+		cursor = ListOutput_putText(cursor, list->id_name);
+		cursor = ListOutput_putText(cursor, "\":");
+		cursor = ListOutput_putNumber(cursor, entry->id);
+		*cursor++ = '}';
+	}
+	*cursor++ = '\n';
+	list->used = cursor - list->buffer;
+	list->entries++;
+	return FILE_ENTRY_CONTINUE;
+}
+
+
+/***********************************************
+*
+* @Purpose: Writes the lines of the buffer, with a single write() unless the descriptor takes part of them
+* @Parameters: ListOutput *output, listing
+* @Return: 0 on success, -1 if the lines could not be written
+*
+************************************************/
+int ListOutput_flush(ListOutput *output){
+	size_t done = 0;
+	ssize_t written;
+
+	if (output->error) return -1;
+	while (done < output->used){
+		written = write(output->fd, output->buffer + done, output->used - done);
+		if (written < 0 && errno == EINTR) continue;
+		if (written <= 0){
+			output->error = 1;
+			return -1;
+		}
+		done += written;
+	}
+	output->used = 0;
+	return 0;
+}
+
+
+/***********************************************
+*
+* @Purpose: Writes the lines left and frees the listing. The descriptor is not closed
+* @Parameters: ListOutput *output, listing
+* @Return: 0 if all the lines have been written, -1 otherwise
+*
+************************************************/
+int ListOutput_close(ListOutput *output){
+	int result;
+
+	if (output == NULL) return 0;
+	result = ListOutput_flush(output);
+	free(output->buffer);
+	free(output);
+	return result;
+}
@@ -0,0 +1,43 @@
+/***********************************************
+*
+* @Purpose: Listing of the entries of a volume (/ls), one line per entry as NDJSON or TSV. The lines are
+*           formatted by hand into a large buffer that is written with a single write() every time it fills up,
+*           so that listing millions of entries does not go through stdio a line at a time
+* @Author: Óscar Cubeles Ollé
+* @Creation Date: October 2026
+*
+************************************************/
+#ifndef LISTOUTPUT_H
+    #define LISTOUTPUT_H
+
+    #include <stddef.h>
+
+    #include "FileEntry.h"
+
+    // Formats of the lines
+    #define LIST_OUTPUT_JSON 0
+    #define LIST_OUTPUT_TSV 1
+    // Size of the buffer, written out when the next line may not fit
+    #define LIST_OUTPUT_BUFFER_SIZE (1 << 20)
+    // Room taken by a line besides its path: the keys, the type and 4 numbers of up to 20 digits
+    #define LIST_OUTPUT_LINE_OVERHEAD 192
+    // Longest escape of a byte of a path in JSON (\u00XX)
+    #define LIST_OUTPUT_MAX_ESCAPE 6
+    #define LIST_OUTPUT_TYPES "file", "dir", "other"
+
+    typedef struct ListOutput{
+      int fd;                                 // Descriptor the lines are written to
+      int format;                             // LIST_OUTPUT_JSON or LIST_OUTPUT_TSV
+      const char *id_name;                    // Name of the id of the entries in JSON, "cluster" or "inode"
+      char *buffer;                           // Lines not written yet
+      size_t used;                            // Bytes of the buffer in use
+      unsigned long long entries;             // Number of lines added
+      int error;                              // 1 if a write has failed, the rest of the lines are dropped
+    } ListOutput;
+
+
+    ListOutput *ListOutput_create(int fd, int format, const char *id_name);
+    int ListOutput_addEntry(const FileEntry *entry, void *output);
+    int ListOutput_flush(ListOutput *output);
+    int ListOutput_close(ListOutput *output);
+#endif
@@ -0,0 +1,513 @@
+/***********************************************
+*
+* @Purpose: Persistent name index of a volume, stored in a sidecar file next to the volume file
+* @Author: Óscar Cubeles Ollé
+* @Creation Date: October 2026
+*
+************************************************/
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "NameIndex.h"
+
+// FNV-1a parameters
+#define NAME_INDEX_FNV_OFFSET 2166136261u
+#define NAME_INDEX_FNV_PRIME 16777619u
+// Initial sizes of the builder arrays
+#define NAME_INDEX_INITIAL_RECORDS 256
+#define NAME_INDEX_INITIAL_STRINGS 4096
+
+
+/***********************************************
+*
+* @Purpose: Builds the path of the index file of a volume, the volume file name followed by NAME_INDEX_EXTENSION
+* @Parameters: const char *volume_name, path of the volume file
+* @Return: the path, to be freed by the caller, NULL if there is not enough memory
+*
+************************************************/
+char *NameIndex_getPath(const char *volume_name){
+	char *path = (char *) malloc(strlen(volume_name) + strlen(NAME_INDEX_EXTENSION) + 1);
+	if (path == NULL) return NULL;
+	strcpy(path, volume_name);
+	strcat(path, NAME_INDEX_EXTENSION);
+	return path;
+}
+
+
+/***********************************************
+*
+* @Purpose: Computes the hash of a name (FNV-1a), ignoring the case so that 8.3 names share the bucket of
+*           the names looked up
+* @Parameters: const char *name, name to be hashed
+* @Return: the hash of the name
+*
+************************************************/
+unsigned int NameIndex_hash(const char *name){
+	unsigned int hash = NAME_INDEX_FNV_OFFSET;
+	unsigned char character;
+
+	for (int i = 0; name[i] != '\0'; i++){
+		character = (unsigned char) name[i];
+		if (character >= 'a' && character <= 'z'){
+			character = character - 'a' + 'A';
+		}
+		hash = (hash ^ character) * NAME_INDEX_FNV_PRIME;
+	}
+	return hash;
+}
+
+
+/***********************************************
+*
+* @Purpose: Maps an index file and checks that it belongs to the volume in its current state
+* @Parameters: const char *path, path of the index file
+*              unsigned int fs_type, NAME_INDEX_FS_EXT2 or NAME_INDEX_FS_FAT16
+*              unsigned long long stamp, current stamp of the volume
+* @Return: the index, NULL if it does not exist, is corrupted or is out of date
+*
+************************************************/
+NameIndex *NameIndex_open(const char *path, unsigned int fs_type, unsigned long long stamp){
+	NameIndex *index;
+	NameIndexHeader *header;
+	struct stat info;
+	size_t expected_size;
+	int fd, writable = 1;
+
+	// The index can still be used to find files when it cannot be written
+	fd = open(path, O_RDWR);
+	if (fd < 0){
+		writable = 0;
+		fd = open(path, O_RDONLY);
+		if (fd < 0) return NULL;
+	}
+	if (fstat(fd, &info) < 0 || info.st_size < (off_t) sizeof(NameIndexHeader)){
+		close(fd);
+		return NULL;
+	}
+	index = (NameIndex *) calloc(1, sizeof(NameIndex));
+	if (index == NULL){
+		close(fd);
+		return NULL;
+	}
+	index->map_size = info.st_size;
+	index->writable = writable;
+	index->map = (char *) mmap(NULL, index->map_size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+	// The mapping keeps the file open
+	close(fd);
+	if (index->map == MAP_FAILED){
+		free(index);
+		return NULL;
+	}
+
+	// Checking the header and that the sizes match the ones of the file
+	header = (NameIndexHeader *) index->map;
+	index->header = header;
+	if (memcmp(header->magic, NAME_INDEX_MAGIC, NAME_INDEX_MAGIC_SIZE) != 0 || header->fs_type != fs_type || header->stamp != stamp ||
+			header->bucket_count == 0 || (header->bucket_count & (header->bucket_count - 1)) != 0){
+		NameIndex_close(index);
+		return NULL;
+	}
+	expected_size = sizeof(NameIndexHeader) + (size_t) header->bucket_count * sizeof(unsigned int) +
+			(size_t) header->record_count * sizeof(NameIndexRecord) + header->strings_size;
+	if (expected_size != index->map_size){
+		NameIndex_close(index);
+		return NULL;
+	}
+	index->buckets = (unsigned int *) (index->map + sizeof(NameIndexHeader));
+	index->records = (NameIndexRecord *) (index->buckets + header->bucket_count);
+	index->strings = (const char *) (index->records + header->record_count);
+	return index;
+}
+
+
+/***********************************************
+*
+* @Purpose: Gets the index of a volume, building it with a walk of the volume when it does not exist or
+*           is out of date
+* @Parameters: const char *path, path of the index file
+*              unsigned int fs_type, NAME_INDEX_FS_EXT2 or NAME_INDEX_FS_FAT16
+*              unsigned long long stamp, current stamp of the volume
+*              NameIndexWalker walker, function that walks the volume
+*              void *fs, volume passed to the walker
+* @Return: the index, NULL if it cannot be built or saved
+*
+************************************************/
+NameIndex *NameIndex_load(const char *path, unsigned int fs_type, unsigned long long stamp, NameIndexWalker walker, void *fs){
+	NameIndex *index = NameIndex_open(path, fs_type, stamp);
+	NameIndexBuilder builder;
+	int error;
+
+	if (index != NULL) return index;
+	NameIndex_initBuilder(&builder);
+	walker(fs, NameIndex_addEntry, &builder);
+	error = builder.error || NameIndex_save(&builder, path, fs_type, stamp) < 0;
+	NameIndex_freeBuilder(&builder);
+	if (error) return NULL;
+	return NameIndex_open(path, fs_type, stamp);
+}
+
+
+/***********************************************
+*
+* @Purpose: Unmaps an index, flushing the deletions marked
+* @Parameters: NameIndex *index, index to be closed
+* @Return: -
+*
+************************************************/
+void NameIndex_close(NameIndex *index){
+	if (index == NULL) return;
+	if (index->writable){
+		msync(index->map, index->map_size, MS_SYNC);
+	}
+	munmap(index->map, index->map_size);
+	free(index);
+}
+
+
+/***********************************************
+*
+* @Purpose: Closes an index that does not match the volume and removes its file, so that it is built again
+* @Parameters: NameIndex *index, index to be removed
+*              const char *path, path of the index file
+* @Return: -
+*
+************************************************/
+void NameIndex_remove(NameIndex *index, const char *path){
+	NameIndex_close(index);
+	unlink(path);
+}
+
+
+/***********************************************
+*
+* @Purpose: Gets a string of the string pool
+* @Parameters: NameIndex *index, index
+*              unsigned int offset, offset of the string, NAME_INDEX_NONE for no string
+* @Return: the string, NULL if the offset is NAME_INDEX_NONE or out of the pool
+*
+************************************************/
+const char *NameIndex_getString(NameIndex *index, unsigned int offset){
+	if (offset == NAME_INDEX_NONE || offset >= index->header->strings_size) return NULL;
+	return index->strings + offset;
+}
+
+
+/***********************************************
+*
+* @Purpose: Finds the records of the files with a name that have not been deleted, in the order of the walk
+* @Parameters: NameIndex *index, index
+*              const char *name, name of the file
+*              NameIndexRecord *previous, record returned by the previous call, NULL to get the first one
+* @Return: the next record with the name, NULL if there are no more
+*
+************************************************/
+NameIndexRecord *NameIndex_find(NameIndex *index, const char *name, NameIndexRecord *previous){
+	unsigned int hash = NameIndex_hash(name);
+	unsigned int current;
+	NameIndexRecord *record;
+	const char *record_name;
+
+	if (previous == NULL){
+		current = index->buckets[hash & (index->header->bucket_count - 1)];
+	}else{
+		current = previous->next;
+	}
+	while (current != NAME_INDEX_NONE && current < index->header->record_count){
+		record = &index->records[current];
+		current = record->next;
+		if (record->hash != hash || (record->flags & NAME_INDEX_FLAG_DELETED)) continue;
+		record_name = NameIndex_getString(index, record->name);
+		if (record_name == NULL) continue;
+		if ((record->flags & NAME_INDEX_FLAG_CASELESS) ? strcasecmp(record_name, name) == 0 : strcmp(record_name, name) == 0){
+			return record;
+		}
+	}
+	return NULL;
+}
+
+
+/***********************************************
+*
+* @Purpose: Finds the records of the files whose name matches a pattern that have not been deleted, in the order
+*           of the walk. The hash table cannot be used, every record is checked. A FAT16 file with a long name is
+*           matched by its long name only, its 8.3 record is skipped so that it is not found twice
+* @Parameters: NameIndex *index, index
+*              const NamePattern *pattern, pattern matched with the names
+*              const NamePattern *upper_pattern, pattern matched with the names compared ignoring the case
+*              NameIndexRecord *previous, record returned by the previous call, NULL to get the first one
+* @Return: the next record that matches, NULL if there are no more
+*
+************************************************/
+NameIndexRecord *NameIndex_findPattern(NameIndex *index, const NamePattern *pattern, const NamePattern *upper_pattern, NameIndexRecord *previous){
+	unsigned int current = previous == NULL ? 0 : (unsigned int) (previous - index->records) + 1;
+	NameIndexRecord *record;
+	const char *record_name;
+
+	for (; current < index->header->record_count; current++){
+		record = &index->records[current];
+		if (record->flags & NAME_INDEX_FLAG_DELETED) continue;
+		if ((record->flags & NAME_INDEX_FLAG_CASELESS) && record->alt_name != NAME_INDEX_NONE) continue;
+		record_name = NameIndex_getString(index, record->name);
+		if (record_name == NULL) continue;
+		if (NamePattern_match((record->flags & NAME_INDEX_FLAG_CASELESS) ? upper_pattern : pattern, record_name, strlen(record_name))){
+			return record;
+		}
+	}
+	return NULL;
+}
+
+
+/***********************************************
+*
+* @Purpose: Marks the file of a record as deleted, together with the record of its other name
+* @Parameters: NameIndex *index, index
+*              NameIndexRecord *record, record of the deleted file
+* @Return: -
+*
+************************************************/
+void NameIndex_markDeleted(NameIndex *index, NameIndexRecord *record){
+	const char *alt_name = NameIndex_getString(index, record->alt_name);
+	NameIndexRecord *alt_record = NULL;
+
+	if (index->writable == 0) return;
+	record->flags |= NAME_INDEX_FLAG_DELETED;
+	if (alt_name == NULL) return;
+	// The other name of the file has its own record, in the bucket of that name
+	while ((alt_record = NameIndex_find(index, alt_name, alt_record)) != NULL){
+		if (alt_record->position == record->position){
+			alt_record->flags |= NAME_INDEX_FLAG_DELETED;
+			break;
+		}
+	}
+}
+
+
+/***********************************************
+*
+* @Purpose: Marks as deleted the file with a name whose directory entry is at a position, for the files
+*           deleted without going through the index
+* @Parameters: NameIndex *index, index
+*              const char *name, name of the deleted file
+*              unsigned long long position, address of its directory entry
+* @Return: -
+*
+************************************************/
+void NameIndex_markDeletedAt(NameIndex *index, const char *name, unsigned long long position){
+	NameIndexRecord *record = NULL;
+
+	while ((record = NameIndex_find(index, name, record)) != NULL){
+		if (record->position == position){
+			NameIndex_markDeleted(index, record);
+			return;
+		}
+	}
+}
+
+
+/***********************************************
+*
+* @Purpose: Prepares an empty index to be built in memory
+* @Parameters: NameIndexBuilder *builder, builder to be initialized
+* @Return: -
+*
+************************************************/
+void NameIndex_initBuilder(NameIndexBuilder *builder){
+	memset(builder, 0, sizeof(NameIndexBuilder));
+}
+
+
+/***********************************************
+*
+* @Purpose: Frees the memory of an index built in memory
+* @Parameters: NameIndexBuilder *builder, builder to be freed
+* @Return: -
+*
+************************************************/
+void NameIndex_freeBuilder(NameIndexBuilder *builder){
+	free(builder->records);
+	free(builder->strings);
+	NameIndex_initBuilder(builder);
+}
+
+
+/***********************************************
+*
+* @Purpose: Adds a string to the string pool of the builder
+* @Parameters: NameIndexBuilder *builder, builder
+*              const char *string, string to be added
+* @Return: offset of the string, NAME_INDEX_NONE if there is not enough memory
+*
+************************************************/
+static unsigned int NameIndex_addString(NameIndexBuilder *builder, const char *string){
+	unsigned int length = strlen(string) + 1;
+	unsigned int offset = builder->strings_size;
+	unsigned int capacity = builder->strings_capacity;
+	char *strings;
+
+	if (offset + length > capacity){
+		capacity = capacity == 0 ? NAME_INDEX_INITIAL_STRINGS : capacity;
+		while (offset + length > capacity) capacity *= 2;
+		strings = (char *) realloc(builder->strings, capacity);
+		if (strings == NULL){
+			builder->error = 1;
+			return NAME_INDEX_NONE;
+		}
+		builder->strings = strings;
+		builder->strings_capacity = capacity;
+	}
+	memcpy(builder->strings + offset, string, length);
+	builder->strings_size += length;
+	return offset;
+}
+
+
+/***********************************************
+*
+* @Purpose: Adds a record to the builder
+* @Parameters: NameIndexBuilder *builder, builder
+*              const FileEntry *entry, file of the record
+*              unsigned int name, offset of the name looked up
+*              unsigned int alt_name, offset of the other name of the file, NAME_INDEX_NONE if none
+*              unsigned int path, offset of the path
+*              unsigned int flags, NAME_INDEX_FLAG_* values
+* @Return: 0 on success, -1 if there is not enough memory
+*
+************************************************/
+static int NameIndex_addRecord(NameIndexBuilder *builder, const FileEntry *entry, unsigned int name, unsigned int alt_name, unsigned int path, unsigned int flags){
+	NameIndexRecord *records, *record;
+	unsigned int capacity;
+
+	if (builder->record_count == builder->record_capacity){
+		capacity = builder->record_capacity == 0 ? NAME_INDEX_INITIAL_RECORDS : builder->record_capacity * 2;
+		records = (NameIndexRecord *) realloc(builder->records, (size_t) capacity * sizeof(NameIndexRecord));
+		if (records == NULL){
+			builder->error = 1;
+			return -1;
+		}
+		builder->records = records;
+		builder->record_capacity = capacity;
+	}
+	record = &builder->records[builder->record_count++];
+	memset(record, 0, sizeof(NameIndexRecord));
+	record->hash = NameIndex_hash(builder->strings + name);
+	record->next = NAME_INDEX_NONE;
+	record->name = name;
+	record->alt_name = alt_name;
+	record->path = path;
+	record->id = entry->id;
+	record->flags = flags;
+	record->num_slots = entry->num_slots;
+	record->size = entry->size;
+	record->position = entry->position;
+	record->aux_position = entry->aux_position;
+	return 0;
+}
+
+
+/***********************************************
+*
+* @Purpose: Visitor of the walk that builds the index, adds the files found. The FAT16 files get a record
+*           for the 8.3 name, compared ignoring the case, and another one for the long name if they have it
+* @Parameters: const FileEntry *entry, entry found by the walk
+*              void *builder, NameIndexBuilder where the files are added
+* @Return: FILE_ENTRY_CONTINUE, or FILE_ENTRY_STOP if there is not enough memory
+*
+************************************************/
+int NameIndex_addEntry(const FileEntry *entry, void *builder){
+	NameIndexBuilder *index_builder = (NameIndexBuilder *) builder;
+	unsigned int name, short_name, path;
+
+	// /find looks for every Ext2 entry that is not a folder, and only for the plain files of FAT16
+	if (entry->type == FILE_ENTRY_DIRECTORY || (entry->short_name != NULL && entry->type != FILE_ENTRY_FILE)) return FILE_ENTRY_CONTINUE;
+	path = NameIndex_addString(index_builder, entry->path);
+	// The name points inside the path
+	name = path + (unsigned int) (entry->name - entry->path);
+	if (index_builder->error) return FILE_ENTRY_STOP;
+
+	if (entry->short_name == NULL){
+		NameIndex_addRecord(index_builder, entry, name, NAME_INDEX_NONE, path, 0);
+	}else if (strcmp(entry->short_name, entry->name) == 0){
+		NameIndex_addRecord(index_builder, entry, name, NAME_INDEX_NONE, path, NAME_INDEX_FLAG_CASELESS);
+	}else{
+		short_name = NameIndex_addString(index_builder, entry->short_name);
+		if (index_builder->error) return FILE_ENTRY_STOP;
+		NameIndex_addRecord(index_builder, entry, name, short_name, path, 0);
+		NameIndex_addRecord(index_builder, entry, short_name, name, path, NAME_INDEX_FLAG_CASELESS);
+	}
+	return index_builder->error ? FILE_ENTRY_STOP : FILE_ENTRY_CONTINUE;
+}
+
+
+/***********************************************
+*
+* @Purpose: Writes the index built in memory to its file. It is written to a temporary file that replaces
+*           the index file at the end, so that a partial index is never used
+* @Parameters: NameIndexBuilder *builder, index built
+*              const char *path, path of the index file
+*              unsigned int fs_type, NAME_INDEX_FS_EXT2 or NAME_INDEX_FS_FAT16
+*              unsigned long long stamp, stamp of the volume
+* @Return: 0 on success, -1 on error
+*
+************************************************/
+int NameIndex_save(NameIndexBuilder *builder, const char *path, unsigned int fs_type, unsigned long long stamp){
+	NameIndexHeader header;
+	unsigned int *buckets;
+	unsigned int bucket;
+	char *temporary_path;
+	FILE *file;
+	int error;
+
+	// Twice as many buckets as records keeps the lists short
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, NAME_INDEX_MAGIC, NAME_INDEX_MAGIC_SIZE);
+	header.fs_type = fs_type;
+	header.bucket_count = 2;
+	while (header.bucket_count < builder->record_count * 2) header.bucket_count *= 2;
+	header.record_count = builder->record_count;
+	header.strings_size = builder->strings_size;
+	header.stamp = stamp;
+
+	buckets = (unsigned int *) malloc((size_t) header.bucket_count * sizeof(unsigned int));
+	temporary_path = (char *) malloc(strlen(path) + 2);
+	if (buckets == NULL || temporary_path == NULL){
+		free(buckets);
+		free(temporary_path);
+		return -1;
+	}
+	memset(buckets, 0xFF, (size_t) header.bucket_count * sizeof(unsigned int));
+	// Inserting from the last record to the first one keeps the lists in the order of the walk
+	for (unsigned int i = builder->record_count; i > 0; i--){
+		bucket = builder->records[i - 1].hash & (header.bucket_count - 1);
+		builder->records[i - 1].next = buckets[bucket];
+		buckets[bucket] = i - 1;
+	}
+
+	strcpy(temporary_path, path);
+	strcat(temporary_path, "~");
+	file = fopen(temporary_path, "wb");
+	if (file == NULL){
+		free(buckets);
+		free(temporary_path);
+		return -1;
+	}
+	error = fwrite(&header, sizeof(header), 1, file) != 1;
+	error |= fwrite(buckets, sizeof(unsigned int), header.bucket_count, file) != header.bucket_count;
+	error |= fwrite(builder->records, sizeof(NameIndexRecord), builder->record_count, file) != builder->record_count;
+	error |= fwrite(builder->strings, 1, builder->strings_size, file) != builder->strings_size;
+	error |= fclose(file) != 0;
+	if (error == 0){
+		error = rename(temporary_path, path) != 0;
+	}
+	if (error){
+		unlink(temporary_path);
+	}
+	free(buckets);
+	free(temporary_path);
+	return error ? -1 : 0;
+}
@@ -0,0 +1,96 @@
+/***********************************************
+*
+* @Purpose: Persistent name index of a volume, stored in a sidecar file next to the volume file.
+*           It is a hash table from file names to the files with that name, built once with a walk of the
+*           volume and mapped in memory afterwards, so that /find does not need to walk the volume again.
+*           The index keeps a stamp of the volume (Ext2 s_wtime or FAT16 checksum) and is rebuilt when it changes
+* @Author: Óscar Cubeles Ollé
+* @Creation Date: October 2026
+*
+************************************************/
+#ifndef NAMEINDEX_H
+    #define NAMEINDEX_H
+
+    #include "FileEntry.h"
+    #include "NamePattern.h"
+
+    #define NAME_INDEX_MAGIC "SHNIDX01"
+    #define NAME_INDEX_MAGIC_SIZE 8
+    #define NAME_INDEX_EXTENSION ".idx"
+    // Value used to mark the end of the bucket lists and the missing names
+    #define NAME_INDEX_NONE 0xFFFFFFFF
+
+    // Type of volume of the index
+    #define NAME_INDEX_FS_EXT2 1
+    #define NAME_INDEX_FS_FAT16 2
+
+    // Flags of the records
+    #define NAME_INDEX_FLAG_DELETED 0x1
+    // The name is compared ignoring the case (FAT16 8.3 names)
+    #define NAME_INDEX_FLAG_CASELESS 0x2
+
+    typedef struct NameIndexHeader{
+      char magic[NAME_INDEX_MAGIC_SIZE];      // NAME_INDEX_MAGIC
+      unsigned int fs_type;                   // NAME_INDEX_FS_EXT2 or NAME_INDEX_FS_FAT16
+      unsigned int bucket_count;              // Number of buckets of the hash table (power of 2)
+      unsigned int record_count;              // Number of records
+      unsigned int strings_size;              // Size in bytes of the string pool
+      unsigned long long stamp;               // Stamp of the volume when the index was built
+    } NameIndexHeader;
+
+    typedef struct NameIndexRecord{
+      unsigned int hash;                      // Hash of the name, ignoring the case
+      unsigned int next;                      // Next record of the bucket, NAME_INDEX_NONE at the end
+      unsigned int name;                      // Offset in the string pool of the name looked up
+      unsigned int alt_name;                  // Offset of the other name of the file (8.3 or long name), NAME_INDEX_NONE if none
+      unsigned int path;                      // Offset of the path of the file
+      unsigned int id;                        // Inode number or first cluster
+      unsigned int flags;                     // NAME_INDEX_FLAG_* values
+      unsigned int num_slots;                 // FAT16 long name slots
+      unsigned long long size;                // Size of the file in bytes
+      unsigned long long position;            // Address of the directory entry
+      unsigned long long aux_position;        // Directory block (Ext2) or first long name slot (FAT16)
+    } NameIndexRecord;
+
+    // Index mapped in memory. The file is laid out as the header, the buckets, the records and the string pool
+    typedef struct NameIndex{
+      char *map;                              // Mapping of the index file
+      size_t map_size;                        // Size of the mapping
+      int writable;                           // 1 if the mapping can be written (to mark deletions)
+      NameIndexHeader *header;                // Header of the index
+      unsigned int *buckets;                  // First record of every bucket
+      NameIndexRecord *records;               // Records, in the order the walk found them
+      const char *strings;                    // String pool
+    } NameIndex;
+
+    // Index being built in memory
+    typedef struct NameIndexBuilder{
+      NameIndexRecord *records;               // Records added
+      unsigned int record_count;              // Number of records added
+      unsigned int record_capacity;           // Number of records allocated
+      char *strings;                          // String pool
+      unsigned int strings_size;              // Bytes used of the string pool
+      unsigned int strings_capacity;          // Bytes allocated for the string pool
+      int error;                              // 1 if some allocation failed
+    } NameIndexBuilder;
+
+    // Walks a volume calling the visitor for every entry
+    typedef int (*NameIndexWalker)(void *fs, FileEntryVisitor visitor, void *context);
+
+
+    char *NameIndex_getPath(const char *volume_name);
+    NameIndex *NameIndex_open(const char *path, unsigned int fs_type, unsigned long long stamp);
+    NameIndex *NameIndex_load(const char *path, unsigned int fs_type, unsigned long long stamp, NameIndexWalker walker, void *fs);
+    void NameIndex_close(NameIndex *index);
+    void NameIndex_remove(NameIndex *index, const char *path);
+    NameIndexRecord *NameIndex_find(NameIndex *index, const char *name, NameIndexRecord *previous);
+    NameIndexRecord *NameIndex_findPattern(NameIndex *index, const NamePattern *pattern, const NamePattern *upper_pattern, NameIndexRecord *previous);
+    const char *NameIndex_getString(NameIndex *index, unsigned int offset);
+    void NameIndex_markDeleted(NameIndex *index, NameIndexRecord *record);
+    void NameIndex_markDeletedAt(NameIndex *index, const char *name, unsigned long long position);
+    unsigned int NameIndex_hash(const char *name);
+    void NameIndex_initBuilder(NameIndexBuilder *builder);
+    void NameIndex_freeBuilder(NameIndexBuilder *builder);
+    int NameIndex_addEntry(const FileEntry *entry, void *builder);
+    int NameIndex_save(NameIndexBuilder *builder, const char *path, unsigned int fs_type, unsigned long long stamp);
+#endif
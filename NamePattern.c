@@ -0,0 +1,529 @@
+/***********************************************
+*
+* @Purpose: Patterns of file names, compiled into a deterministic automaton: the glob or the regular expression
+*           is parsed into a nondeterministic automaton (Thompson) and its sets of states are turned into the
+*           states of the deterministic one (subset construction)
+* @Author: Óscar Cubeles Ollé
+* @Creation Date: October 2026
+*
+************************************************/
+#include <string.h>
+#include <stdlib.h>
+
+#include "NamePattern.h"
+
+static NamePatternFragment NamePattern_parseAlternation(NamePatternParser *parser);
+
+
+/***********************************************
+*
+* @Purpose: Tells whether a name looked for is a pattern: a regular expression when it starts with '^', a glob
+*           when it has a '*', a '?' or a '['
+* @Parameters: const char *text, name looked for
+* @Return: 1 if it is a pattern, 0 if it is a plain name
+*
+************************************************/
+int NamePattern_isPattern(const char *text){
+	return text[0] == NAME_PATTERN_REGEX_PREFIX || strpbrk(text, NAME_PATTERN_GLOB_CHARACTERS) != NULL;
+}
+
+
+/***********************************************
+*
+* @Purpose: Adds a state to the nondeterministic automaton. Past the limit the error is set and the spare state
+*           at the end of the array is returned, so that the parse can go on until it notices the error
+* @Parameters: NamePatternParser *parser, parse of the pattern
+*              int type, NAME_PATTERN_BYTE, NAME_PATTERN_SPLIT, NAME_PATTERN_EMPTY or NAME_PATTERN_MATCH
+* @Return: the number of the state
+*
+************************************************/
+static int NamePattern_addState(NamePatternParser *parser, int type){
+	NamePatternState *state;
+
+	if (parser->count == NAME_PATTERN_MAX_NFA_STATES){
+		parser->error = 1;
+		return NAME_PATTERN_MAX_NFA_STATES;
+	}
+	state = &parser->states[parser->count];
+	memset(state, 0, sizeof(NamePatternState));
+	state->type = type;
+	state->out = -1;
+	state->out2 = -1;
+	return parser->count++;
+}
+
+
+/***********************************************
+*
+* @Purpose: Creates the fragment of a byte out of a set of bytes, adding the other case of the letters when the
+*           pattern ignores the case
+* @Parameters: NamePatternParser *parser, parse of the pattern
+*              const unsigned char *bytes, set of bytes taken, a bit for every byte
+* @Return: the fragment
+*
+************************************************/
+static NamePatternFragment NamePattern_byteFragment(NamePatternParser *parser, const unsigned char *bytes){
+	NamePatternFragment fragment;
+	NamePatternState *state;
+
+	fragment.start = NamePattern_addState(parser, NAME_PATTERN_BYTE);
+	fragment.end = NamePattern_addState(parser, NAME_PATTERN_EMPTY);
+	state = &parser->states[fragment.start];
+	memcpy(state->bytes, bytes, sizeof(state->bytes));
+	if (parser->caseless){
+		for (int c = 'a'; c <= 'z'; c++){
+			if ((state->bytes[c >> 3] & (1 << (c & 7))) || (state->bytes[(c - 'a' + 'A') >> 3] & (1 << ((c - 'a' + 'A') & 7)))){
+				state->bytes[c >> 3] |= 1 << (c & 7);
+				state->bytes[(c - 'a' + 'A') >> 3] |= 1 << ((c - 'a' + 'A') & 7);
+			}
+		}
+	}
+	state->out = fragment.end;
+	return fragment;
+}
+
+
+/***********************************************
+*
+* @Purpose: Adds a range of bytes to a set of bytes
+* @Parameters: unsigned char *bytes, set of bytes, a bit for every byte
+*              int first, first byte of the range
+*              int last, last byte of the range
+* @Return: -
+*
+************************************************/
+static void NamePattern_addRange(unsigned char *bytes, int first, int last){
+	for (int c = first; c <= last; c++){
+		bytes[c >> 3] |= 1 << (c & 7);
+	}
+}
+
+
+/***********************************************
+*
+* @Purpose: Fills the set of bytes of an escape of a regular expression: \d digits, \w letters, digits and '_',
+*           \s spaces, any other character stands for itself
+* @Parameters: unsigned char *bytes, set of bytes, empty
+*              int c, character after the backslash
+*              int is_regex, 1 to take \d, \w and \s as classes
+* @Return: -
+*
+************************************************/
+static void NamePattern_addEscape(unsigned char *bytes, int c, int is_regex){
+	if (is_regex && c == 'd'){
+		NamePattern_addRange(bytes, '0', '9');
+	}else if (is_regex && c == 'w'){
+		NamePattern_addRange(bytes, '0', '9');
+		NamePattern_addRange(bytes, 'A', 'Z');
+		NamePattern_addRange(bytes, 'a', 'z');
+		NamePattern_addRange(bytes, '_', '_');
+	}else if (is_regex && c == 's'){
+		NamePattern_addRange(bytes, '\t', '\r');
+		NamePattern_addRange(bytes, ' ', ' ');
+	}else{
+		NamePattern_addRange(bytes, c, c);
+	}
+}
+
+
+/***********************************************
+*
+* @Purpose: Parses a bracket expression, after its '['. It is negated by a '!' or a '^' at its start, a ']'
+*           right after them is taken as a character and a '-' between two characters is a range
+* @Parameters: NamePatternParser *parser, parse of the pattern
+*              unsigned char *bytes, set of bytes filled with the ones of the expression, empty
+* @Return: -
+*
+************************************************/
+static void NamePattern_parseClass(NamePatternParser *parser, unsigned char *bytes){
+	const unsigned char *text = (const unsigned char *) parser->text;
+	int negated = 0, first = 1, c, last;
+
+	if (parser->position < parser->length && (text[parser->position] == '!' || text[parser->position] == '^')){
+		negated = 1;
+		parser->position++;
+	}
+	while (parser->position < parser->length && (first || text[parser->position] != ']')){
+		first = 0;
+		c = text[parser->position++];
+		if (c == NAME_PATTERN_ESCAPE && parser->position < parser->length){
+			c = text[parser->position++];
+			if (parser->is_regex && (c == 'd' || c == 'w' || c == 's')){
+				NamePattern_addEscape(bytes, c, 1);
+				continue;
+			}
+		}
+		last = c;
+		if (parser->position + 1 < parser->length && text[parser->position] == '-' && text[parser->position + 1] != ']'){
+			last = text[parser->position + 1];
+			parser->position += 2;
+			if (last == NAME_PATTERN_ESCAPE && parser->position < parser->length){
+				last = text[parser->position++];
+			}
+			if (last < c){
+				parser->error = 1;
+				return;
+			}
+		}
+		NamePattern_addRange(bytes, c, last);
+	}
+	// The expression has to be closed
+	if (parser->position == parser->length){
+		parser->error = 1;
+		return;
+	}
+	parser->position++;
+	if (negated){
+		for (int i = 0; i < NAME_PATTERN_ALPHABET / 8; i++){
+			bytes[i] = (unsigned char) ~bytes[i];
+		}
+	}
+}
+
+
+/***********************************************
+*
+* @Purpose: Makes a fragment repeat any number of times, none included
+* @Parameters: NamePatternParser *parser, parse of the pattern
+*              NamePatternFragment fragment, fragment repeated
+* @Return: the fragment of the repetition
+*
+************************************************/
+static NamePatternFragment NamePattern_star(NamePatternParser *parser, NamePatternFragment fragment){
+	NamePatternFragment result;
+
+	result.start = NamePattern_addState(parser, NAME_PATTERN_SPLIT);
+	result.end = NamePattern_addState(parser, NAME_PATTERN_EMPTY);
+	parser->states[result.start].out = fragment.start;
+	parser->states[result.start].out2 = result.end;
+	parser->states[fragment.end].out = result.start;
+	return result;
+}
+
+
+/***********************************************
+*
+* @Purpose: Parses a character, a bracket expression, a wildcard or a group of the pattern
+* @Parameters: NamePatternParser *parser, parse of the pattern
+* @Return: the fragment of the atom
+*
+************************************************/
+static NamePatternFragment NamePattern_parseAtom(NamePatternParser *parser){
+	unsigned char bytes[NAME_PATTERN_ALPHABET / 8];
+	NamePatternFragment fragment;
+	int c = (unsigned char) parser->text[parser->position++];
+
+	memset(bytes, 0, sizeof(bytes));
+	if ((!parser->is_regex && c == '*') || (!parser->is_regex && c == '?') || (parser->is_regex && c == '.')){
+		memset(bytes, 0xFF, sizeof(bytes));
+		fragment = NamePattern_byteFragment(parser, bytes);
+		return c == '*' ? NamePattern_star(parser, fragment) : fragment;
+	}
+	if (c == '['){
+		NamePattern_parseClass(parser, bytes);
+	}else if (parser->is_regex && c == '('){
+		fragment = NamePattern_parseAlternation(parser);
+		if (parser->position == parser->length || parser->text[parser->position] != ')'){
+			parser->error = 1;
+		}
+		parser->position++;
+		return fragment;
+	}else if (parser->is_regex && (c == '*' || c == '+' || c == '?')){
+		// A repetition needs something to repeat
+		parser->error = 1;
+	}else if (c == NAME_PATTERN_ESCAPE){
+		if (parser->position == parser->length){
+			parser->error = 1;
+		}else{
+			NamePattern_addEscape(bytes, (unsigned char) parser->text[parser->position++], parser->is_regex);
+		}
+	}else{
+		NamePattern_addRange(bytes, c, c);
+	}
+	return NamePattern_byteFragment(parser, bytes);
+}
+
+
+/***********************************************
+*
+* @Purpose: Parses an atom followed by the repetitions of the regular expressions: '*', '+' and '?'
+* @Parameters: NamePatternParser *parser, parse of the pattern
+* @Return: the fragment of the atom and its repetitions
+*
+************************************************/
+static NamePatternFragment NamePattern_parseRepeat(NamePatternParser *parser){
+	NamePatternFragment fragment = NamePattern_parseAtom(parser);
+	NamePatternFragment result;
+	char c;
+
+	while (parser->is_regex && parser->position < parser->length && !parser->error){
+		c = parser->text[parser->position];
+		if (c == '*'){
+			fragment = NamePattern_star(parser, fragment);
+		}else if (c == '+'){
+			// One time and then any number of times
+			result = NamePattern_star(parser, fragment);
+			fragment.end = result.end;
+		}else if (c == '?'){
+			result.start = NamePattern_addState(parser, NAME_PATTERN_SPLIT);
+			result.end = NamePattern_addState(parser, NAME_PATTERN_EMPTY);
+			parser->states[result.start].out = fragment.start;
+			parser->states[result.start].out2 = result.end;
+			parser->states[fragment.end].out = result.end;
+			fragment = result;
+		}else{
+			break;
+		}
+		parser->position++;
+	}
+	return fragment;
+}
+
+
+/***********************************************
+*
+* @Purpose: Parses a sequence of atoms, up to the end of the pattern or, in the regular expressions, up to a '|'
+*           or the ')' of the group
+* @Parameters: NamePatternParser *parser, parse of the pattern
+* @Return: the fragment of the sequence
+*
+************************************************/
+static NamePatternFragment NamePattern_parseConcat(NamePatternParser *parser){
+	NamePatternFragment fragment, next;
+	char c;
+
+	fragment.start = NamePattern_addState(parser, NAME_PATTERN_EMPTY);
+	fragment.end = fragment.start;
+	while (parser->position < parser->length && !parser->error){
+		c = parser->text[parser->position];
+		if (parser->is_regex && (c == '|' || c == ')')) break;
+		next = NamePattern_parseRepeat(parser);
+		parser->states[fragment.end].out = next.start;
+		fragment.end = next.end;
+	}
+	return fragment;
+}
+
+
+/***********************************************
+*
+* @Purpose: Parses the alternatives of a regular expression, separated by '|'
+* @Parameters: NamePatternParser *parser, parse of the pattern
+* @Return: the fragment of the alternatives
+*
+************************************************/
+static NamePatternFragment NamePattern_parseAlternation(NamePatternParser *parser){
+	NamePatternFragment fragment = NamePattern_parseConcat(parser);
+	NamePatternFragment other, result;
+
+	while (parser->position < parser->length && parser->text[parser->position] == '|' && !parser->error){
+		parser->position++;
+		other = NamePattern_parseConcat(parser);
+		result.start = NamePattern_addState(parser, NAME_PATTERN_SPLIT);
+		result.end = NamePattern_addState(parser, NAME_PATTERN_EMPTY);
+		parser->states[result.start].out = fragment.start;
+		parser->states[result.start].out2 = other.start;
+		parser->states[fragment.end].out = result.end;
+		parser->states[other.end].out = result.end;
+		fragment = result;
+	}
+	return fragment;
+}
+
+
+/***********************************************
+*
+* @Purpose: Adds to a set of states the ones reached from them without taking a byte
+* @Parameters: const NamePatternParser *parser, nondeterministic automaton
+*              unsigned long long *set, set of states, a bit for every state
+*              int *stack, room for a state number per state of the automaton
+* @Return: -
+*
+************************************************/
+static void NamePattern_closure(const NamePatternParser *parser, unsigned long long *set, int *stack){
+	const NamePatternState *state;
+	int top = 0, next[2];
+
+	for (int i = 0; i < parser->count; i++){
+		if (set[i >> 6] & (1ULL << (i & 63))) stack[top++] = i;
+	}
+	while (top > 0){
+		state = &parser->states[stack[--top]];
+		if (state->type != NAME_PATTERN_SPLIT && state->type != NAME_PATTERN_EMPTY) continue;
+		next[0] = state->out;
+		next[1] = state->type == NAME_PATTERN_SPLIT ? state->out2 : -1;
+		for (int i = 0; i < 2; i++){
+			if (next[i] >= 0 && !(set[next[i] >> 6] & (1ULL << (next[i] & 63)))){
+				set[next[i] >> 6] |= 1ULL << (next[i] & 63);
+				stack[top++] = next[i];
+			}
+		}
+	}
+}
+
+
+/***********************************************
+*
+* @Purpose: Builds the deterministic automaton of a nondeterministic one. Every state of the deterministic
+*           automaton is a set of states of the other one, the first one being the empty set (NAME_PATTERN_DEAD)
+* @Parameters: const NamePatternParser *parser, nondeterministic automaton
+*              int start, first state of the nondeterministic automaton
+*              NamePattern *pattern, filled with the deterministic automaton
+* @Return: 0 on success, -1 if there is not enough memory or the automaton needs too many states
+*
+************************************************/
+static int NamePattern_build(const NamePatternParser *parser, int start, NamePattern *pattern){
+	size_t words = (parser->count + 63) / 64;
+	unsigned long long *sets, *next;
+	int *stack, *members;
+	int member_count, found, result = 0;
+	const NamePatternState *state;
+
+	sets = (unsigned long long *) calloc((size_t) (NAME_PATTERN_MAX_DFA_STATES + 1) * words, sizeof(unsigned long long));
+	stack = (int *) malloc(parser->count * sizeof(int));
+	members = (int *) malloc(parser->count * sizeof(int));
+	pattern->transitions = (unsigned short *) calloc((size_t) NAME_PATTERN_MAX_DFA_STATES * NAME_PATTERN_ALPHABET, sizeof(unsigned short));
+	pattern->accepting = (unsigned char *) calloc(NAME_PATTERN_MAX_DFA_STATES, 1);
+	if (sets == NULL || stack == NULL || members == NULL || pattern->transitions == NULL || pattern->accepting == NULL){
+		free(sets);
+		free(stack);
+		free(members);
+		return -1;
+	}
+
+	// The dead state is the empty set, the set after the last state is where the next sets are computed
+	next = sets + (size_t) NAME_PATTERN_MAX_DFA_STATES * words;
+	sets[words + (start >> 6)] = 1ULL << (start & 63);
+	NamePattern_closure(parser, sets + words, stack);
+	pattern->start = 1;
+	pattern->state_count = 2;
+	for (int current = 1; current < pattern->state_count && result == 0; current++){
+		member_count = 0;
+		for (int i = 0; i < parser->count; i++){
+			if (!(sets[current * words + (i >> 6)] & (1ULL << (i & 63)))) continue;
+			if (parser->states[i].type == NAME_PATTERN_BYTE) members[member_count++] = i;
+			if (parser->states[i].type == NAME_PATTERN_MATCH) pattern->accepting[current] = 1;
+		}
+		for (int byte = 0; byte < NAME_PATTERN_ALPHABET && result == 0; byte++){
+			memset(next, 0, words * sizeof(unsigned long long));
+			found = 0;
+			for (int i = 0; i < member_count; i++){
+				state = &parser->states[members[i]];
+				if (state->bytes[byte >> 3] & (1 << (byte & 7))){
+					next[state->out >> 6] |= 1ULL << (state->out & 63);
+					found = 1;
+				}
+			}
+			if (!found) continue;
+			NamePattern_closure(parser, next, stack);
+			for (found = 1; found < pattern->state_count; found++){
+				if (memcmp(sets + found * words, next, words * sizeof(unsigned long long)) == 0) break;
+			}
+			if (found == pattern->state_count){
+				if (pattern->state_count == NAME_PATTERN_MAX_DFA_STATES){
+					result = -1;
+					break;
+				}
+				memcpy(sets + found * words, next, words * sizeof(unsigned long long));
+				pattern->state_count++;
+			}
+			pattern->transitions[current * NAME_PATTERN_ALPHABET + byte] = (unsigned short) found;
+		}
+	}
+	// Giving back the room of the states not used
+	next = (unsigned long long *) realloc(pattern->transitions, (size_t) pattern->state_count * NAME_PATTERN_ALPHABET * sizeof(unsigned short));
+	if (next != NULL) pattern->transitions = (unsigned short *) next;
+	free(sets);
+	free(stack);
+	free(members);
+	return result;
+}
+
+
+/***********************************************
+*
+* @Purpose: Compiles a pattern. A regular expression starts with '^' and matches the whole name, with or without
+*           a '$' at its end; it takes characters, '.', bracket expressions, \d \w \s, groups, '|', '*', '+' and
+*           '?'. A glob takes '*', '?' and bracket expressions. In both a backslash takes the next character as is
+* @Parameters: const char *text, pattern
+*              int flags, NAME_PATTERN_CASELESS to match the letters in both cases
+* @Return: the pattern, NULL if it is not valid, it is too complex or there is not enough memory
+*
+************************************************/
+NamePattern *NamePattern_compile(const char *text, int flags){
+	NamePatternParser parser;
+	NamePatternFragment fragment;
+	NamePattern *pattern;
+	size_t escapes = 0;
+	int match;
+
+	memset(&parser, 0, sizeof(parser));
+	parser.text = text;
+	parser.length = strlen(text);
+	parser.caseless = (flags & NAME_PATTERN_CASELESS) != 0;
+	if (text[0] == NAME_PATTERN_REGEX_PREFIX){
+		parser.is_regex = 1;
+		parser.text++;
+		parser.length--;
+		// A '$' at the end is the anchor unless it is escaped
+		while (escapes + 1 < parser.length && parser.text[parser.length - 2 - escapes] == NAME_PATTERN_ESCAPE) escapes++;
+		if (parser.length > 0 && parser.text[parser.length - 1] == NAME_PATTERN_REGEX_END && escapes % 2 == 0) parser.length--;
+	}
+	// One spare state past the limit, see NamePattern_addState
+	parser.states = (NamePatternState *) malloc((NAME_PATTERN_MAX_NFA_STATES + 1) * sizeof(NamePatternState));
+	pattern = (NamePattern *) calloc(1, sizeof(NamePattern));
+	if (parser.states == NULL || pattern == NULL){
+		free(parser.states);
+		free(pattern);
+		return NULL;
+	}
+
+	fragment = parser.is_regex ? NamePattern_parseAlternation(&parser) : NamePattern_parseConcat(&parser);
+	// A ')' without its '('
+	if (parser.position < parser.length) parser.error = 1;
+	match = NamePattern_addState(&parser, NAME_PATTERN_MATCH);
+	parser.states[fragment.end].out = match;
+	if (parser.error || NamePattern_build(&parser, fragment.start, pattern) < 0){
+		free(parser.states);
+		NamePattern_destroy(pattern);
+		return NULL;
+	}
+	free(parser.states);
+	return pattern;
+}
+
+
+/***********************************************
+*
+* @Purpose: Checks whether a name matches a pattern
+* @Parameters: const NamePattern *pattern, compiled pattern
+*              const char *name, name, it does not need to end with '\0'
+*              size_t name_len, length of the name
+* @Return: 1 if the whole name matches, 0 otherwise
+*
+************************************************/
+int NamePattern_match(const NamePattern *pattern, const char *name, size_t name_len){
+	const unsigned short *transitions = pattern->transitions;
+	unsigned int state = pattern->start;
+
+	for (size_t i = 0; i < name_len; i++){
+		state = transitions[state * NAME_PATTERN_ALPHABET + (unsigned char) name[i]];
+		if (state == NAME_PATTERN_DEAD) return 0;
+	}
+	return pattern->accepting[state];
+}
+
+
+/***********************************************
+*
+* @Purpose: Frees a compiled pattern
+* @Parameters: NamePattern *pattern, pattern to be freed
+* @Return: -
+*
+************************************************/
+void NamePattern_destroy(NamePattern *pattern){
+	if (pattern == NULL) return;
+	free(pattern->transitions);
+	free(pattern->accepting);
+	free(pattern);
+}
@@ -0,0 +1,73 @@
+/***********************************************
+*
+* @Purpose: Patterns of file names looked for by /find and /delete: globs (*.log, core.[0-9]*) and regular
+*           expressions anchored at both ends (^core\.[0-9]+$). A pattern is compiled once into a deterministic
+*           automaton with a transition per byte, so matching a name costs a table lookup per character and
+*           stops at the first character no name of the pattern can have
+* @Author: Óscar Cubeles Ollé
+* @Creation Date: October 2026
+*
+************************************************/
+#ifndef NAMEPATTERN_H
+    #define NAMEPATTERN_H
+
+    #include <stddef.h>
+
+    // First character of the regular expressions, the other names with a glob character are globs
+    #define NAME_PATTERN_REGEX_PREFIX '^'
+    #define NAME_PATTERN_REGEX_END '$'
+    #define NAME_PATTERN_GLOB_CHARACTERS "*?["
+    #define NAME_PATTERN_ESCAPE '\\'
+    // Flags of NamePattern_compile
+    #define NAME_PATTERN_CASELESS 0x1
+    // Largest automata built, a pattern needing more states is rejected
+    #define NAME_PATTERN_MAX_NFA_STATES 1024
+    #define NAME_PATTERN_MAX_DFA_STATES 1024
+    // Number of values of a byte, one transition for each of them
+    #define NAME_PATTERN_ALPHABET 256
+    // State from which no name can match, every transition of it leads to itself
+    #define NAME_PATTERN_DEAD 0
+
+    // Kinds of states of the nondeterministic automaton
+    #define NAME_PATTERN_BYTE 0
+    #define NAME_PATTERN_SPLIT 1
+    #define NAME_PATTERN_EMPTY 2
+    #define NAME_PATTERN_MATCH 3
+
+    typedef struct NamePatternState{
+      int type;                               // NAME_PATTERN_BYTE, NAME_PATTERN_SPLIT, NAME_PATTERN_EMPTY or NAME_PATTERN_MATCH
+      int out;                                // Next state, -1 while it is not known
+      int out2;                               // Second next state of a NAME_PATTERN_SPLIT
+      unsigned char bytes[NAME_PATTERN_ALPHABET / 8]; // Bytes a NAME_PATTERN_BYTE state takes, one bit each
+    } NamePatternState;
+
+    // Part of the nondeterministic automaton, its end is a NAME_PATTERN_EMPTY state whose next state is set later
+    typedef struct NamePatternFragment{
+      int start;                              // First state
+      int end;                                // Last state
+    } NamePatternFragment;
+
+    typedef struct NamePatternParser{
+      const char *text;                       // Pattern, without the anchors of the regular expressions
+      size_t length;                          // Length of the pattern
+      size_t position;                        // Next character parsed
+      int is_regex;                           // 1 for a regular expression, 0 for a glob
+      int caseless;                           // 1 to take the letters in both cases
+      NamePatternState *states;               // States of the nondeterministic automaton
+      int count;                              // Number of states
+      int error;                              // 1 if the pattern is not valid or needs too many states
+    } NamePatternParser;
+
+    typedef struct NamePattern{
+      unsigned short *transitions;            // Next state for every state and byte, NAME_PATTERN_ALPHABET per state
+      unsigned char *accepting;               // 1 for the states where a name matches if it ends
+      int state_count;                        // Number of states, NAME_PATTERN_DEAD included
+      int start;                              // State before the first byte of a name
+    } NamePattern;
+
+
+    int NamePattern_isPattern(const char *text);
+    NamePattern *NamePattern_compile(const char *text, int flags);
+    int NamePattern_match(const NamePattern *pattern, const char *name, size_t name_len);
+    void NamePattern_destroy(NamePattern *pattern);
+#endif
@@ -0,0 +1,166 @@
+/***********************************************
+*
+* @Purpose: Statistics of an operation on a volume. The file system modules count through a pointer that is NULL
+*           when --stats is not given, so the counting only costs a check of the pointer per folder
+* @Author: Óscar Cubeles Ollé
+* @Creation Date: October 2026
+*
+************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "OpStats.h"
+
+const char *OP_STATS_PHASE_NAMES[] = {OP_STATS_PHASES};
+
+
+/***********************************************
+*
+* @Purpose: Gives the time of the monotonic clock
+* @Parameters: -
+* @Return: the time in seconds
+*
+************************************************/
+static double OpStats_now(void){
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double) now.tv_sec + (double) now.tv_nsec / 1e9;
+}
+
+
+/***********************************************
+*
+* @Purpose: Creates the statistics of an operation, starting to count its time
+* @Parameters: -
+* @Return: pointer to the statistics, NULL if there is not enough memory
+*
+************************************************/
+OpStats *OpStats_create(void){
+	OpStats *stats = (OpStats *) calloc(1, sizeof(OpStats));
+
+	if (stats == NULL) return NULL;
+	stats->phase = OP_STATS_NO_PHASE;
+	stats->start = OpStats_now();
+	pthread_mutex_init(&stats->lock, NULL);
+	return stats;
+}
+
+
+/***********************************************
+*
+* @Purpose: Frees the statistics
+* @Parameters: OpStats *stats, statistics to be freed, it can be NULL
+* @Return: -
+*
+************************************************/
+void OpStats_destroy(OpStats *stats){
+	if (stats == NULL) return;
+	pthread_mutex_destroy(&stats->lock);
+	free(stats);
+}
+
+
+/***********************************************
+*
+* @Purpose: Counts a folder whose entries are read. It can be called from several threads
+* @Parameters: OpStats *stats, statistics, NULL if they are not collected
+* @Return: -
+*
+************************************************/
+void OpStats_addFolder(OpStats *stats){
+	if (stats == NULL) return;
+	pthread_mutex_lock(&stats->lock);
+	stats->folders++;
+	pthread_mutex_unlock(&stats->lock);
+}
+
+
+/***********************************************
+*
+* @Purpose: Counts the directory entries decoded in a region of a folder. It can be called from several threads
+* @Parameters: OpStats *stats, statistics, NULL if they are not collected
+*              unsigned long long entries, number of entries decoded
+* @Return: -
+*
+************************************************/
+void OpStats_addEntries(OpStats *stats, unsigned long long entries){
+	if (stats == NULL) return;
+	pthread_mutex_lock(&stats->lock);
+	stats->entries += entries;
+	pthread_mutex_unlock(&stats->lock);
+}
+
+
+/***********************************************
+*
+* @Purpose: Starts a phase of the operation, ending the one that was running. Only the thread running the
+*           operation changes the phase
+* @Parameters: OpStats *stats, statistics, NULL if they are not collected
+*              int phase, OP_STATS_PHASE_* phase started
+* @Return: -
+*
+************************************************/
+void OpStats_startPhase(OpStats *stats, int phase){
+	if (stats == NULL) return;
+	OpStats_endPhase(stats);
+	stats->phase = phase;
+	stats->phase_start = OpStats_now();
+}
+
+
+/***********************************************
+*
+* @Purpose: Ends the phase running, adding its time to the phase
+* @Parameters: OpStats *stats, statistics, NULL if they are not collected
+* @Return: -
+*
+************************************************/
+void OpStats_endPhase(OpStats *stats){
+	if (stats == NULL || stats->phase == OP_STATS_NO_PHASE) return;
+	stats->phase_time[stats->phase] += OpStats_now() - stats->phase_start;
+	stats->phase = OP_STATS_NO_PHASE;
+}
+
+
+/***********************************************
+*
+* @Purpose: Prints in screen the statistics of the operation and the system calls done on the volume file,
+*           as text or as a single line of JSON
+* @Parameters: OpStats *stats, statistics of the operation
+*              VolumeIO *volume, block I/O handle of the volume
+*              const char *operation, operation executed
+*              const char *filesystem, file system of the volume
+*              int format, OP_STATS_FORMAT_TEXT or OP_STATS_FORMAT_JSON
+* @Return: -
+*
+************************************************/
+void OpStats_print(OpStats *stats, VolumeIO *volume, const char *operation, const char *filesystem, int format){
+	VolumeIOCounters counters;
+	double total;
+
+	OpStats_endPhase(stats);
+	total = OpStats_now() - stats->start;
+	VolumeIO_getCounters(volume, &counters);
+	if (format == OP_STATS_FORMAT_JSON){
+		printf("{\"operation\":\"%s\",\"filesystem\":\"%s\",\"mapped\":%s,", operation, filesystem, VolumeIO_isMapped(volume) ? "true" : "false");
+		printf("\"read_calls\":%llu,\"write_calls\":%llu,\"sync_calls\":%llu,\"bytes_read\":%llu,\"bytes_written\":%llu,",
+				counters.read_calls, counters.write_calls, counters.sync_calls, counters.bytes_read, counters.bytes_written);
+		printf("\"cache_hits\":%llu,\"cache_misses\":%llu,", VolumeIO_getHits(volume), VolumeIO_getMisses(volume));
+		printf("\"folders\":%llu,\"entries\":%llu,\"phases_ms\":{", stats->folders, stats->entries);
+		for (int i = 0; i < OP_STATS_NUM_PHASES; i++){
+			printf("%s\"%s\":%.3f", i == 0 ? "" : ",", OP_STATS_PHASE_NAMES[i], stats->phase_time[i] * 1e3);
+		}
+		printf("},\"total_ms\":%.3f}\n", total * 1e3);
+		return;
+	}
+	printf("\nStatistics of %s on the %s volume%s\n", operation, filesystem, VolumeIO_isMapped(volume) ? " (mapped)" : "");
+	printf("Read calls: %llu\nWrite calls: %llu\nSync calls: %llu\n", counters.read_calls, counters.write_calls, counters.sync_calls);
+	printf("Bytes read: %llu\nBytes written: %llu\n", counters.bytes_read, counters.bytes_written);
+	printf("Folders visited: %llu\nEntries decoded: %llu\n", stats->folders, stats->entries);
+	for (int i = 0; i < OP_STATS_NUM_PHASES; i++){
+		printf("Time %s: %.3f ms\n", OP_STATS_PHASE_NAMES[i], stats->phase_time[i] * 1e3);
+	}
+	printf("Total time: %.3f ms\n", total * 1e3);
+}
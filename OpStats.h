@@ -0,0 +1,51 @@
+/***********************************************
+*
+* @Purpose: Statistics of an operation on a volume: folders visited, directory entries decoded and time spent in
+*           every phase, printed together with the system calls done by the block I/O layer (--stats)
+* @Author: Óscar Cubeles Ollé
+* @Creation Date: October 2026
+*
+************************************************/
+#ifndef OPSTATS_H
+    #define OPSTATS_H
+
+    #include <pthread.h>
+
+    #include "VolumeIO.h"
+
+    // Output formats of the statistics, 0 when they are not collected
+    #define OP_STATS_FORMAT_TEXT 1
+    #define OP_STATS_FORMAT_JSON 2
+
+    // Phases of an operation
+    #define OP_STATS_PHASE_OPEN 0
+    #define OP_STATS_PHASE_PATHS 1
+    #define OP_STATS_PHASE_INDEX 2
+    #define OP_STATS_PHASE_WALK 3
+    #define OP_STATS_PHASE_SYNC 4
+    #define OP_STATS_PHASE_COPY 5
+    #define OP_STATS_PHASE_SCAN 6
+    #define OP_STATS_NUM_PHASES 7
+    #define OP_STATS_PHASES "open", "paths", "index", "walk", "sync", "copy", "scan"
+    // Value of the running phase when there is none
+    #define OP_STATS_NO_PHASE -1
+
+    typedef struct OpStats{
+      unsigned long long folders;             // Folders whose entries have been read
+      unsigned long long entries;             // Directory entries decoded, including free entries and long name slots
+      double phase_time[OP_STATS_NUM_PHASES]; // Seconds spent in every phase
+      int phase;                              // Phase running, OP_STATS_NO_PHASE if none
+      double phase_start;                     // Time the running phase started
+      double start;                           // Time the statistics were created
+      pthread_mutex_t lock;                   // Protects the counters from the worker threads
+    } OpStats;
+
+
+    OpStats *OpStats_create(void);
+    void OpStats_destroy(OpStats *stats);
+    void OpStats_addFolder(OpStats *stats);
+    void OpStats_addEntries(OpStats *stats, unsigned long long entries);
+    void OpStats_startPhase(OpStats *stats, int phase);
+    void OpStats_endPhase(OpStats *stats);
+    void OpStats_print(OpStats *stats, VolumeIO *volume, const char *operation, const char *filesystem, int format);
+#endif
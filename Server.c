@@ -0,0 +1,500 @@
+/***********************************************
+*
+* @Purpose: Server mode (/serve). Requests and responses are frames made of their length (4 bytes in network
+*           byte order) and their content. A request holds the operation, the volume and the file names, one per
+*           line, and its response is the same text Shooter prints for the operation. The operations run one at a
+*           time, with the standard output sent to a memory file that becomes the response
+* @Author: Óscar Cubeles Ollé
+* @Creation Date: October 2026
+*
+************************************************/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+#include "NameIndex.h"
+#include "TargetSet.h"
+#include "Server.h"
+
+const char *SERVER_VALID_OPERATIONS[] = {SERVER_OPERATIONS};
+
+// Set by SIGINT and SIGTERM to stop serving
+static volatile sig_atomic_t Server_stopping = 0;
+
+
+/***********************************************
+*
+* @Purpose: Signal handler asking the server to stop after the request being answered
+* @Parameters: int signal_number, signal received
+* @Return: -
+*
+************************************************/
+static void Server_handleSignal(int signal_number){
+	(void) signal_number;
+	Server_stopping = 1;
+}
+
+
+/***********************************************
+*
+* @Purpose: Opens a volume and the file system in it, as Shooter does for a single operation
+* @Parameters: ServerVolume *volume, filled with the volume opened
+*              const char *name, path of the volume file
+*              ServerSettings *settings, options the volume is opened with
+* @Return: 0 if the volume has been opened, -1 otherwise
+*
+************************************************/
+static int Server_openVolume(ServerVolume *volume, const char *name, ServerSettings *settings){
+	memset(volume, 0, sizeof(ServerVolume));
+	volume->name = name;
+	volume->fd = open(name, O_RDWR | O_CLOEXEC);
+	if (volume->fd < 0) return -1;
+	volume->volume_io = VolumeIO_open(volume->fd, settings->cache_blocks);
+	if (volume->volume_io == NULL){
+		close(volume->fd);
+		return -1;
+	}
+	if (settings->use_mmap && VolumeIO_map(volume->volume_io) < 0){
+		printf("Unable to map the volume %s, using regular reads\n", name);
+	}
+	if (VolumeIO_setQueueDepth(volume->volume_io, settings->queue_depth, settings->use_uring) < 0){
+		printf("Unable to start the prefetch reads of the volume %s, reading one block at a time\n", name);
+	}
+	volume->index_path = NameIndex_getPath(name);
+
+	if (FatSystem_isFatSystem(volume->volume_io)){
+		volume->fat_fs = FatSystem_open(volume->volume_io);
+		if (volume->fat_fs != NULL){
+			FatSystem_setIndex(volume->fat_fs, settings->use_index ? volume->index_path : NULL);
+			FatSystem_setThreads(volume->fat_fs, settings->threads);
+			return 0;
+		}
+	}else if (Ex2System_isExt(volume->volume_io)){
+		volume->ext_fs = Ext2System_open(volume->volume_io);
+		if (volume->ext_fs != NULL && Ext2System_setInodeCache(volume->ext_fs, settings->inode_cache_blocks, settings->inode_prefetch) == 0){
+			Ext2System_setIndex(volume->ext_fs, settings->use_index ? volume->index_path : NULL);
+			Ext2System_setThreads(volume->ext_fs, settings->threads);
+			Ext2System_setBitmapCheck(volume->ext_fs, settings->check_bitmaps);
+			return 0;
+		}
+		Ext2System_close(volume->ext_fs);
+		volume->ext_fs = NULL;
+	}else{
+		printf("%s is not FAT16 nor EXT2 filesystems\n", name);
+	}
+	VolumeIO_close(volume->volume_io);
+	close(volume->fd);
+	free(volume->index_path);
+	return -1;
+}
+
+
+/***********************************************
+*
+* @Purpose: Closes a volume opened with Server_openVolume
+* @Parameters: ServerVolume *volume, volume to be closed
+* @Return: -
+*
+************************************************/
+static void Server_closeVolume(ServerVolume *volume){
+	if (volume->fat_fs != NULL) FatSystem_close(volume->fat_fs);
+	if (volume->ext_fs != NULL) Ext2System_close(volume->ext_fs);
+	VolumeIO_close(volume->volume_io);
+	close(volume->fd);
+	free(volume->index_path);
+}
+
+
+/***********************************************
+*
+* @Purpose: Creates the socket of the server. A socket left at the path by a previous server is replaced,
+*           any other file is kept
+* @Parameters: const char *socket_path, path of the socket
+* @Return: the socket listening, -1 if it cannot be created
+*
+************************************************/
+static int Server_listen(const char *socket_path){
+	struct sockaddr_un address;
+	struct stat status;
+	int listen_fd;
+
+	if (strlen(socket_path) >= sizeof(address.sun_path)){
+		printf("The socket path %s is too long\n", socket_path);
+		return -1;
+	}
+	if (lstat(socket_path, &status) == 0){
+		if (!S_ISSOCK(status.st_mode)){
+			printf("%s exists and it is not a socket\n", socket_path);
+			return -1;
+		}
+		unlink(socket_path);
+	}
+	listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (listen_fd < 0) return -1;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, socket_path);
+	if (bind(listen_fd, (struct sockaddr *) &address, sizeof(address)) < 0 || listen(listen_fd, SERVER_BACKLOG) < 0){
+		printf("Unable to listen on %s\n", socket_path);
+		close(listen_fd);
+		return -1;
+	}
+	return listen_fd;
+}
+
+
+/***********************************************
+*
+* @Purpose: Reads exactly size bytes from a client
+* @Parameters: int fd, socket of the client
+*              void *buffer, where the bytes are stored
+*              size_t size, number of bytes to be read
+* @Return: 1 if all the bytes have been read, 0 if the client closed the connection before the first one,
+*          -1 if it closed it in the middle, the read failed or it timed out
+*
+************************************************/
+static int Server_readAll(int fd, void *buffer, size_t size){
+	size_t done = 0;
+	ssize_t bytes;
+
+	while (done < size){
+		bytes = read(fd, (char *) buffer + done, size - done);
+		if (bytes < 0 && errno == EINTR) continue;
+		if (bytes <= 0) return bytes == 0 && done == 0 ? 0 : -1;
+		done += bytes;
+	}
+	return 1;
+}
+
+
+/***********************************************
+*
+* @Purpose: Writes exactly size bytes to a client
+* @Parameters: int fd, socket of the client
+*              const void *buffer, bytes to be written
+*              size_t size, number of bytes
+* @Return: 0 if all the bytes have been written, -1 otherwise
+*
+************************************************/
+static int Server_writeAll(int fd, const void *buffer, size_t size){
+	size_t done = 0;
+	ssize_t bytes;
+
+	while (done < size){
+		bytes = send(fd, (const char *) buffer + done, size - done, MSG_NOSIGNAL);
+		if (bytes < 0 && errno == EINTR) continue;
+		if (bytes <= 0) return -1;
+		done += bytes;
+	}
+	return 0;
+}
+
+
+/***********************************************
+*
+* @Purpose: Sends the output collected in the memory file as a frame, copied by the kernel to the socket
+* @Parameters: Server *server, server whose memory file is sent
+*              int client, socket of the client
+* @Return: 0 if the frame has been sent, -1 otherwise
+*
+************************************************/
+static int Server_sendOutput(Server *server, int client){
+	struct stat status;
+	unsigned int header;
+	off_t offset = 0;
+	ssize_t bytes;
+
+	if (fstat(server->output_fd, &status) < 0) return -1;
+	header = htonl((unsigned int) status.st_size);
+	if (Server_writeAll(client, &header, sizeof(header)) < 0) return -1;
+	while (offset < status.st_size){
+		bytes = sendfile(client, server->output_fd, &offset, status.st_size - offset);
+		if (bytes < 0 && errno == EINTR) continue;
+		if (bytes <= 0) return -1;
+	}
+	return 0;
+}
+
+
+/***********************************************
+*
+* @Purpose: Finds a volume served by the path given in the command line
+* @Parameters: Server *server, server
+*              const char *name, path of the volume
+* @Return: the volume, NULL if it is not served
+*
+************************************************/
+static ServerVolume *Server_findVolume(Server *server, const char *name){
+	for (int i = 0; i < server->volume_count; i++){
+		if (strcmp(server->volumes[i].name, name) == 0) return &server->volumes[i];
+	}
+	return NULL;
+}
+
+
+/***********************************************
+*
+* @Purpose: Executes the operation of a request, printing its output
+* @Parameters: Server *server, server
+*              char *request, content of the request ended with '\0', its fields are split in place
+* @Return: -
+*
+************************************************/
+static void Server_execute(Server *server, char *request){
+	char *fields[3] = {NULL, NULL, NULL};
+	char *cursor = request, *separator;
+	ServerVolume *volume;
+	TargetSet *targets;
+	int is_valid = 0, count = 0, error = 0;
+
+	// Operation and volume, the rest of the request are the file names
+	while (count < 2 && (separator = strchr(cursor, SERVER_FIELD_SEPARATOR)) != NULL){
+		*separator = '\0';
+		fields[count++] = cursor;
+		cursor = separator + 1;
+	}
+	fields[count] = cursor;
+	for (int i = 0; fields[0] != NULL && i < SERVER_NUM_OPERATIONS; i++){
+		is_valid |= strcmp(fields[0], SERVER_VALID_OPERATIONS[i]) == 0;
+	}
+	if (!is_valid){
+		printf("Invalid operation %s\n", fields[0] != NULL ? fields[0] : "");
+		return;
+	}
+	volume = fields[1] != NULL ? Server_findVolume(server, fields[1]) : NULL;
+	if (volume == NULL){
+		printf("Unknown volume %s\n", fields[1] != NULL ? fields[1] : "");
+		return;
+	}
+
+	// The names are taken as they are, the lists of names (@<file> and -) are files of the client
+	targets = TargetSet_create();
+	if (targets == NULL) return;
+	cursor = fields[2];
+	while (cursor != NULL && *cursor != '\0'){
+		separator = strchr(cursor, SERVER_FIELD_SEPARATOR);
+		if (separator != NULL) *separator = '\0';
+		if (*cursor != '\0' && (error = TargetSet_add(targets, cursor)) < 0) break;
+		cursor = separator != NULL ? separator + 1 : NULL;
+	}
+	if (error == TARGET_SET_INVALID_PATTERN){
+		printf("Invalid pattern %s\n", cursor);
+	}else if (strcmp(fields[0], "/info") != 0 && targets->count == 0){
+		printf("Invalid number of arguments\n");
+	}else{
+		// Without --index a deletion leaves the index out of date, so it is removed as Shooter does
+		if (strcmp(fields[0], "/delete") == 0 && !server->settings.use_index && volume->index_path != NULL){
+			unlink(volume->index_path);
+		}
+		if (volume->fat_fs != NULL){
+			FatSystem_executeOperation(fields[0], targets, volume->fat_fs);
+		}else{
+			EX2SYSTEM_executeOperation(fields[0], targets, volume->ext_fs);
+		}
+	}
+	TargetSet_destroy(targets);
+}
+
+
+/***********************************************
+*
+* @Purpose: Answers a request of a client. The output of the operation is collected in the memory file by
+*           pointing the standard output to it while the operation runs
+* @Parameters: Server *server, server
+*              int client, socket of the client, with data to be read
+* @Return: 1 if the request has been answered, 0 if the client closed the connection, -1 if the connection
+*          has to be closed
+*
+************************************************/
+static int Server_handleClient(Server *server, int client){
+	unsigned int header;
+	size_t size;
+	char *request;
+	int result;
+
+	result = Server_readAll(client, &header, sizeof(header));
+	if (result <= 0) return result;
+	size = ntohl(header);
+	if (size > SERVER_MAX_REQUEST) return -1;
+	request = (char *) malloc(size + 1);
+	if (request == NULL || Server_readAll(client, request, size) <= 0){
+		free(request);
+		return -1;
+	}
+	request[size] = '\0';
+
+	fflush(stdout);
+	if (ftruncate(server->output_fd, 0) < 0 || lseek(server->output_fd, 0, SEEK_SET) < 0 || dup2(server->output_fd, STDOUT_FILENO) < 0){
+		free(request);
+		return -1;
+	}
+	Server_execute(server, request);
+	fflush(stdout);
+	dup2(server->stdout_fd, STDOUT_FILENO);
+	free(request);
+	return Server_sendOutput(server, client) < 0 ? -1 : 1;
+}
+
+
+/***********************************************
+*
+* @Purpose: Accepts a new client, closing it right away if there are too many
+* @Parameters: Server *server, server
+* @Return: -
+*
+************************************************/
+static void Server_accept(Server *server){
+	struct timeval timeout = {SERVER_CLIENT_TIMEOUT, 0};
+	int client = accept4(server->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+
+	if (client < 0) return;
+	if (server->client_count == SERVER_MAX_CLIENTS){
+		close(client);
+		return;
+	}
+	// A client that stops in the middle of a request cannot hold the rest of them for long
+	setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+	server->clients[server->client_count++] = client;
+}
+
+
+/***********************************************
+*
+* @Purpose: Waits for connections and requests until SIGINT or SIGTERM is received
+* @Parameters: Server *server, server with its socket and volumes ready
+* @Return: -
+*
+************************************************/
+static void Server_loop(Server *server){
+	struct pollfd fds[SERVER_MAX_CLIENTS + 1];
+	int count;
+
+	while (!Server_stopping){
+		fds[0].fd = server->listen_fd;
+		fds[0].events = POLLIN;
+		for (int i = 0; i < server->client_count; i++){
+			fds[i + 1].fd = server->clients[i];
+			fds[i + 1].events = POLLIN;
+		}
+		count = server->client_count;
+		if (poll(fds, count + 1, -1) < 0){
+			if (errno == EINTR) continue;
+			break;
+		}
+		// Answering a request of every client ready, from the last one so that the closed ones can be removed
+		for (int i = count - 1; i >= 0; i--){
+			if (fds[i + 1].revents == 0) continue;
+			if (Server_handleClient(server, server->clients[i]) <= 0){
+				close(server->clients[i]);
+				server->clients[i] = server->clients[--server->client_count];
+			}
+		}
+		if (fds[0].revents & POLLIN){
+			Server_accept(server);
+		}
+	}
+}
+
+
+/***********************************************
+*
+* @Purpose: Opens the volumes, the memory file collecting the output and the socket of the server
+* @Parameters: Server *server, server to be started, with its settings
+*              const char *socket_path, path of the Unix domain socket
+*              char **volume_names, paths of the volume files
+*              int volume_count, number of volumes
+* @Return: 0 if the server can serve requests, -1 otherwise
+*
+************************************************/
+static int Server_start(Server *server, const char *socket_path, char **volume_names, int volume_count){
+	server->volumes = (ServerVolume *) calloc(volume_count, sizeof(ServerVolume));
+	if (server->volumes == NULL) return -1;
+	for (int i = 0; i < volume_count; i++){
+		if (Server_openVolume(&server->volumes[i], volume_names[i], &server->settings) < 0){
+			printf("Unable to open volume file %s\n", volume_names[i]);
+			return -1;
+		}
+		server->volume_count++;
+	}
+	server->output_fd = memfd_create("shooter-output", MFD_CLOEXEC);
+	server->stdout_fd = dup(STDOUT_FILENO);
+	if (server->output_fd < 0 || server->stdout_fd < 0) return -1;
+	server->listen_fd = Server_listen(socket_path);
+	return server->listen_fd < 0 ? -1 : 0;
+}
+
+
+/***********************************************
+*
+* @Purpose: Closes the clients, the socket, the memory file and the volumes of the server
+* @Parameters: Server *server, server to be stopped, started or not
+* @Return: -
+*
+************************************************/
+static void Server_stop(Server *server){
+	for (int i = 0; i < server->client_count; i++){
+		close(server->clients[i]);
+	}
+	if (server->listen_fd >= 0) close(server->listen_fd);
+	if (server->output_fd >= 0) close(server->output_fd);
+	if (server->stdout_fd >= 0) close(server->stdout_fd);
+	for (int i = 0; i < server->volume_count; i++){
+		Server_closeVolume(&server->volumes[i]);
+	}
+	free(server->volumes);
+}
+
+
+/***********************************************
+*
+* @Purpose: Opens the volumes and serves the requests of the clients until SIGINT or SIGTERM is received.
+*           The server has to be the only one writing the volumes, their metadata is read only once
+* @Parameters: const char *socket_path, path of the Unix domain socket
+*              char **volume_names, paths of the volume files
+*              int volume_count, number of volumes
+*              ServerSettings *settings, options the volumes are opened with
+* @Return: 0 if the server has run, -1 if it could not start
+*
+************************************************/
+int Server_run(const char *socket_path, char **volume_names, int volume_count, ServerSettings *settings){
+	struct sigaction action;
+	Server server;
+
+	memset(&server, 0, sizeof(server));
+	server.settings = *settings;
+	server.listen_fd = -1;
+	server.output_fd = -1;
+	server.stdout_fd = -1;
+	if (Server_start(&server, socket_path, volume_names, volume_count) < 0){
+		Server_stop(&server);
+		return -1;
+	}
+
+	// Without SA_RESTART, so that the signals interrupt the wait for requests
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = Server_handleSignal;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+	signal(SIGPIPE, SIG_IGN);
+
+	printf("Serving %d volume%s on %s\n", volume_count, volume_count == 1 ? "" : "s", socket_path);
+	fflush(stdout);
+	Server_loop(&server);
+	unlink(socket_path);
+	Server_stop(&server);
+	return 0;
+}
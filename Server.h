@@ -0,0 +1,67 @@
+/***********************************************
+*
+* @Purpose: Server mode (/serve). The volumes are opened once, keeping their metadata and caches in memory,
+*           and /info, /find and /delete requests of local clients are answered over a Unix domain socket
+* @Author: Óscar Cubeles Ollé
+* @Creation Date: October 2026
+*
+************************************************/
+#ifndef SERVER_H
+    #define SERVER_H
+
+    #include <signal.h>
+
+    #include "VolumeIO.h"
+    #include "FatSystem.h"
+    #include "Ex2System.h"
+
+    // Every frame starts with its length, a 4 byte unsigned integer in network byte order
+    #define SERVER_FRAME_HEADER_SIZE 4
+    // Maximum length of a request, a longer one closes the connection
+    #define SERVER_MAX_REQUEST (1 << 20)
+    // Separator of the fields of a request: operation, volume and the file names
+    #define SERVER_FIELD_SEPARATOR '\n'
+    // Maximum number of clients connected at the same time
+    #define SERVER_MAX_CLIENTS 64
+    // Pending connections queued by the socket
+    #define SERVER_BACKLOG 16
+    // Seconds a client can take to send the rest of a request once it has started it
+    #define SERVER_CLIENT_TIMEOUT 5
+    #define SERVER_OPERATIONS "/find", "/info", "/delete"
+    #define SERVER_NUM_OPERATIONS 3
+
+    typedef struct ServerSettings{
+      int cache_blocks;                       // Number of blocks of the block cache of every volume
+      int use_mmap;                           // 1 to access the volumes through a memory mapping
+      int inode_cache_blocks;                 // Number of inode table blocks cached for Ext2 volumes
+      int inode_prefetch;                     // 1 to read the next inode table block together with the one needed
+      int use_index;                          // 1 to use the name index file next to every volume
+      int threads;                            // Number of threads walking the folders of a volume
+      int check_bitmaps;                      // 1 if /info counts the free blocks and inodes of Ext2 volumes from their bitmaps
+      int queue_depth;                        // Number of reads of the subfolders prefetched in flight, 0 not to prefetch
+      int use_uring;                          // 1 to prefetch with io_uring when the kernel allows it, 0 to use a pool of threads
+    } ServerSettings;
+
+    typedef struct ServerVolume{
+      const char *name;                       // Path of the volume file given in the command line, used by the requests
+      int fd;                                 // File descriptor of the volume file
+      VolumeIO *volume_io;                    // Block I/O handle, its cache is kept between the requests
+      FatFileSystem *fat_fs;                  // FAT16 volume, NULL if the volume is Ext2
+      ExtFileSystem *ext_fs;                  // Ext2 volume, NULL if the volume is FAT16
+      char *index_path;                       // Path of the name index of the volume, NULL if it cannot be built
+    } ServerVolume;
+
+    typedef struct Server{
+      ServerSettings settings;                // Options the volumes are opened with
+      ServerVolume *volumes;                  // Volumes served
+      int volume_count;                       // Number of volumes
+      int listen_fd;                          // Socket accepting the connections
+      int clients[SERVER_MAX_CLIENTS];        // Sockets of the clients connected
+      int client_count;                       // Number of clients connected
+      int output_fd;                          // Memory file collecting the output of an operation
+      int stdout_fd;                          // Copy of the standard output, restored after every operation
+    } Server;
+
+
+    int Server_run(const char *socket_path, char **volume_names, int volume_count, ServerSettings *settings);
+#endif
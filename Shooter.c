@@ -3,20 +3,54 @@
 #include <stdlib.h>
 #include <fcntl.h>
 #include <signal.h>
+#include <unistd.h>
 
+#include "VolumeIO.h"
+#include "NameIndex.h"
+#include "TargetSet.h"
 #include "FatSystem.h"
 #include "Ex2System.h"
+#include "OpStats.h"
+#include "Server.h"
 
 
 #define ERROR_CODE_INPUT 0
 #define ERROR_CODE_OPERATION 1
 #define ERROR_CODE_VOLUME 2
-#define NUM_OPERATIONS 3
-#define ERROR_INPUT "\nInvalid number of arguments. The valid formats are:\n\n./shooter <operation> <volume_name>\n./shooter <operation> <volume> <file_name>\n"
-#define ERROR_OPERATION "\nInvalid Operation. The valid operations are: \n\n/find\n/delete\n/info\n"
-#define OPERATIONS "/find", "/info", "/delete"
+#define NUM_OPERATIONS 7
+#define ERROR_INPUT "\nInvalid number of arguments. The valid formats are:\n\n./shooter <operation> <volume_name>\n./shooter <operation> <volume> <file_name> [<file_name> ...]\n./shooter /extract <volume> <file_name> [<output_file>]\n./shooter /ls <volume> [<output_file>]\n./shooter /scan <volume> [<condition> ...]\n./shooter /serve <socket> <volume> [<volume> ...]\n\nA file name can also be @<list_file> with a name per line, or - to read the names from stdin.\nThe names of /find and /delete can be globs (*.log) or regular expressions starting with ^ (^core\\.[0-9]+$)\n"
+#define ERROR_OPERATION "\nInvalid Operation. The valid operations are: \n\n/find\n/delete\n/info\n/extract\n/ls\n/scan\n/serve\n"
+#define OPERATIONS "/find", "/info", "/delete", "/extract", "/ls", "/scan", "/serve"
 #define ERROR_FILE "Unable to open volume file"
 #define ERROR_CODES  ERROR_INPUT, ERROR_OPERATION, ERROR_FILE
+#define OPTION_CACHE "--cache="
+#define OPTION_CACHE_STATS "--cache-stats"
+#define OPTION_MMAP "--mmap"
+#define OPTION_INODE_CACHE "--inode-cache="
+#define OPTION_NO_PREFETCH "--no-prefetch"
+#define OPTION_INDEX "--index"
+#define OPTION_THREADS "--threads="
+#define OPTION_BITMAPS "--bitmaps"
+#define OPTION_QUEUE_DEPTH "--queue-depth="
+#define OPTION_NO_URING "--no-uring"
+#define OPTION_TSV "--tsv"
+#define OPTION_STATS "--stats"
+#define OPTION_STATS_JSON "--stats=json"
+
+typedef struct Options{
+  int cache_blocks;                 // Number of blocks of the block cache (--cache=<blocks>)
+  int show_cache_stats;             // Print the hit and miss counters of the block cache at the end (--cache-stats)
+  int use_mmap;                     // Access the volume through a memory mapping (--mmap)
+  int inode_cache_blocks;           // Number of inode table blocks cached for Ext2 volumes (--inode-cache=<blocks>)
+  int inode_prefetch;               // Read the next inode table block together with the one needed (disabled with --no-prefetch)
+  int use_index;                    // Use the name index file next to the volume for /find and /delete (--index)
+  int threads;                      // Number of threads walking the folders of the volume (--threads=<n>, 0 for one per CPU)
+  int check_bitmaps;                // Count the free blocks and inodes of Ext2 volumes from their bitmaps in /info (--bitmaps)
+  int queue_depth;                  // Number of reads of the subfolders prefetched in flight at the same time (--queue-depth=<n>, 0 not to prefetch)
+  int use_uring;                    // Prefetch with io_uring when the kernel allows it (disabled with --no-uring, a pool of threads is used)
+  int list_format;                  // Format of the lines of /ls, NDJSON by default or TSV (--tsv)
+  int stats_format;                 // Print the statistics of the operation at the end (--stats or --stats=json), 0 not to collect them
+} Options;
 
 const char* VALID_OPERATIONS[] ={OPERATIONS};
 const char* ERROR_STRINGS[] = {ERROR_CODES};
@@ -26,6 +60,8 @@ void DISPLAY_displayError(int errorCode);
 void DISPLAY_displayOperation(char *operation, char *volume_name);
 int isNotValidOperation(char *operation);
 int isNotValidInput(int argc, char *argv[]);
+int parseOptions(int argc, char *argv[], Options *options);
+int serve(char *socket_path, char **volume_names, int volume_count, Options *options);
 void handle_sigsegv()
 {
     printf("An error occurred. Invalid number of arguments\n");
@@ -34,8 +70,23 @@ void handle_sigsegv()
 int main(int argc, char *argv[]){
   char *operation;
   char *volume_name;
-  char *file;
+  TargetSet *targets;
   int volume_fd;
+  VolumeIO *volume_io;
+  Options options;
+  char *index_path = NULL;
+  OpStats *stats = NULL;
+  const char *filesystem = NULL;
+  int output_fd = STDOUT_FILENO;
+  int output_argument;
+  int error;
+  SimdInodeFilter scan_filter;
+
+  // Removing the options from the arguments
+  argc = parseOptions(argc, argv, &options);
+  if (argc < 0){
+    return 0;
+  }
 
   // Terminate the program if the number of arguments is not correct or the operation is invalid
   if (isNotValidInput(argc, argv)){
@@ -45,25 +96,155 @@ int main(int argc, char *argv[]){
   // Error handling signal
   signal(SIGSEGV, handle_sigsegv);
 
-  // Assigning the operation, volume and file values
+  // The server opens its volumes once and answers the operations of its clients until it is stopped
+  if (strcmp(argv[1], "/serve") == 0){
+    return serve(argv[2], argv + 3, argc - 3, &options);
+  }
+
+  // Assigning the operation, volume and file values. All the file names are resolved with a single walk
   operation = argv[1];
   volume_name = argv[2];
-  file = argv[3];
+  targets = TargetSet_create();
+  if (targets == NULL){
+    return 0;
+  }
+  // /extract copies a single file and /ls lists the whole volume, to the standard output or to the file given last
+  if (strcmp(operation, "/extract") == 0 || strcmp(operation, "/ls") == 0){
+    output_argument = strcmp(operation, "/extract") == 0 ? 4 : 3;
+    if (output_argument == 4 && TargetSet_add(targets, argv[3]) < 0){
+      TargetSet_destroy(targets);
+      return 0;
+    }
+    if (argc == output_argument + 1){
+      output_fd = open(argv[output_argument], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      if (output_fd < 0){
+        printf("Unable to create the file %s\n", argv[output_argument]);
+        TargetSet_destroy(targets);
+        return 0;
+      }
+    }
+    argc = 3;
+  }
+  // /scan takes conditions on the inodes instead of file names
+  Ext2System_initScanFilter(&scan_filter);
+  if (strcmp(operation, "/scan") == 0){
+    for (int i = 3; i < argc; i++){
+      if (Ext2System_parseScanFilter(&scan_filter, argv[i]) < 0){
+        printf("Invalid condition %s, the valid ones are size, mtime and links with <, <=, >, >= or =, type=file|dir|link and mode=<octal>\n", argv[i]);
+        TargetSet_destroy(targets);
+        return 0;
+      }
+    }
+    argc = 3;
+  }
+  for (int i = 3; i < argc; i++){
+    error = TargetSet_addArgument(targets, argv[i]);
+    if (error == TARGET_SET_INVALID_PATTERN){
+      printf("Invalid pattern %s, a glob takes * ? and [...], and a regular expression starts with ^\n", argv[i]);
+      TargetSet_destroy(targets);
+      return 0;
+    }
+    if (error < 0){
+      printf("Unable to read the file names of %s\n", argv[i]);
+      TargetSet_destroy(targets);
+      return 0;
+    }
+  }
 
   // Opening the volume
   volume_fd = open(volume_name, O_RDWR);
   if (volume_fd < 0){
     DISPLAY_displayError(ERROR_CODE_VOLUME);
+    TargetSet_destroy(targets);
+    return 0;
+  }
+  volume_io = VolumeIO_open(volume_fd, options.cache_blocks);
+  if (volume_io == NULL){
+    DISPLAY_displayError(ERROR_CODE_VOLUME);
+    close(volume_fd);
+    TargetSet_destroy(targets);
+    return 0;
+  }
+  // The volume keeps being read with pread() if it cannot be mapped
+  if (options.use_mmap && VolumeIO_map(volume_io) < 0){
+    printf("Unable to map the volume, using regular reads\n");
+  }
+  if (VolumeIO_setQueueDepth(volume_io, options.queue_depth, options.use_uring) < 0){
+    printf("Unable to start the prefetch reads, reading one block at a time\n");
+  }
+
+  // The name index lives next to the volume file. A deletion without it would leave it out of date with the same stamp,
+  // so it is removed and built again the next time it is used
+  index_path = NameIndex_getPath(volume_name);
+  if (!options.use_index && index_path != NULL){
+    if (strcmp(operation, "/delete") == 0){
+      unlink(index_path);
+    }
+    free(index_path);
+    index_path = NULL;
+  }
+
+  // The statistics count from here, the time to open the volume file and map it is left out
+  if (options.stats_format != 0){
+    stats = OpStats_create();
+    OpStats_startPhase(stats, OP_STATS_PHASE_OPEN);
   }
 
   // Checking which filesystem is it and performing the operation
-  if (FatSystem_isFatSystem(volume_fd)){
-    FatSystem_executeOperation(operation, file,volume_fd);
-  }else if (Ex2System_isExt (volume_fd)){
-    EX2SYSTEM_executeOperation(operation, file, volume_fd);
+  if (FatSystem_isFatSystem(volume_io)){
+    FatFileSystem *fat_fs = FatSystem_open(volume_io);
+    filesystem = "FAT16";
+    OpStats_endPhase(stats);
+    if (fat_fs == NULL){
+      DISPLAY_displayError(ERROR_CODE_VOLUME);
+    }else{
+      FatSystem_setIndex(fat_fs, index_path);
+      FatSystem_setThreads(fat_fs, options.threads);
+      FatSystem_setStats(fat_fs, stats);
+      FatSystem_setOutput(fat_fs, output_fd);
+      FatSystem_setListFormat(fat_fs, options.list_format);
+      FatSystem_executeOperation(operation, targets, fat_fs);
+    }
+    FatSystem_close(fat_fs);
+  }else if (Ex2System_isExt (volume_io)){
+    ExtFileSystem *ext_fs = Ext2System_open(volume_io);
+    filesystem = "EXT2";
+    if (ext_fs == NULL || Ext2System_setInodeCache(ext_fs, options.inode_cache_blocks, options.inode_prefetch) < 0){
+      OpStats_endPhase(stats);
+      DISPLAY_displayError(ERROR_CODE_VOLUME);
+    }else{
+      OpStats_endPhase(stats);
+      Ext2System_setIndex(ext_fs, index_path);
+      Ext2System_setThreads(ext_fs, options.threads);
+      Ext2System_setStats(ext_fs, stats);
+      Ext2System_setBitmapCheck(ext_fs, options.check_bitmaps);
+      Ext2System_setOutput(ext_fs, output_fd);
+      Ext2System_setListFormat(ext_fs, options.list_format);
+      Ext2System_setScanFilter(ext_fs, &scan_filter);
+      EX2SYSTEM_executeOperation(operation, targets, ext_fs);
+      if (options.show_cache_stats){
+        Ext2System_printCacheStats(ext_fs);
+      }
+    }
+    Ext2System_close(ext_fs);
   }else{
     printf("It is not FAT16 nor EXT2 filesystems\n");
   }
+
+  if (options.show_cache_stats){
+    VolumeIO_printStats(volume_io);
+  }
+  if (stats != NULL && filesystem != NULL){
+    OpStats_print(stats, volume_io, operation, filesystem, options.stats_format);
+  }
+  OpStats_destroy(stats);
+  VolumeIO_close(volume_io);
+  close(volume_fd);
+  if (output_fd != STDOUT_FILENO){
+    close(output_fd);
+  }
+  free(index_path);
+  TargetSet_destroy(targets);
   return 0;
 }
 
@@ -89,8 +270,11 @@ int isNotValidOperation(char *operation){
 
 
 int isNotValidInput(int argc, char *argv[]){
-  // The valid operation at least have three arguments
-  if (argc <= 2 || argc > 4){
+  // The valid operation at least have three arguments, /info and /ls at most four, /extract at most five, /find and /delete
+  // any number of files, /scan any number of conditions and /serve any number of volumes
+  if (argc <= 2 || (argc > 4 && strcmp(argv[1], "/find") != 0 && strcmp(argv[1], "/delete") != 0 && strcmp(argv[1], "/serve") != 0 &&
+      strcmp(argv[1], "/scan") != 0 &&
+      (strcmp(argv[1], "/extract") != 0 || argc > 5))){
     DISPLAY_displayError(ERROR_CODE_INPUT);
     return 1;
   }
@@ -100,9 +284,103 @@ int isNotValidInput(int argc, char *argv[]){
     return 1;
   }
 
-  if((strcmp(argv[1], "/find") == 0 || strcmp(argv[1], "/delete") == 0) && argc == 3){
+  if((strcmp(argv[1], "/find") == 0 || strcmp(argv[1], "/delete") == 0 || strcmp(argv[1], "/extract") == 0 || strcmp(argv[1], "/serve") == 0) && argc == 3){
     printf("Invalid number of arguments\n");
     return 1;
   }
   return 0;
 }
+
+
+int serve(char *socket_path, char **volume_names, int volume_count, Options *options){
+  ServerSettings settings;
+
+  settings.cache_blocks = options->cache_blocks;
+  settings.use_mmap = options->use_mmap;
+  settings.inode_cache_blocks = options->inode_cache_blocks;
+  settings.inode_prefetch = options->inode_prefetch;
+  settings.use_index = options->use_index;
+  settings.threads = options->threads;
+  settings.check_bitmaps = options->check_bitmaps;
+  settings.queue_depth = options->queue_depth;
+  settings.use_uring = options->use_uring;
+  if (Server_run(socket_path, volume_names, volume_count, &settings) < 0){
+    printf("Unable to start the server on %s\n", socket_path);
+  }
+  return 0;
+}
+
+
+int parseOptions(int argc, char *argv[], Options *options){
+  int remaining = 1;
+
+  options->cache_blocks = VOLUME_IO_DEFAULT_CACHE_BLOCKS;
+  options->show_cache_stats = 0;
+  options->use_mmap = 0;
+  options->inode_cache_blocks = EXT_SYSTEM_INODE_CACHE_BLOCKS;
+  options->inode_prefetch = 1;
+  options->use_index = 0;
+  options->threads = 1;
+  options->check_bitmaps = 0;
+  options->queue_depth = 0;
+  options->use_uring = 1;
+  options->list_format = LIST_OUTPUT_JSON;
+  options->stats_format = 0;
+
+  // Options start with "--" and can be anywhere, the rest of arguments keep their order
+  for(int i = 1; i < argc; i++){
+    if (strncmp(argv[i], OPTION_CACHE, strlen(OPTION_CACHE)) == 0){
+      options->cache_blocks = atoi(argv[i] + strlen(OPTION_CACHE));
+      if (options->cache_blocks < 0){
+        printf("Invalid cache size %s\n", argv[i] + strlen(OPTION_CACHE));
+        return -1;
+      }
+    }else if (strcmp(argv[i], OPTION_CACHE_STATS) == 0){
+      options->show_cache_stats = 1;
+    }else if (strcmp(argv[i], OPTION_MMAP) == 0){
+      options->use_mmap = 1;
+    }else if (strncmp(argv[i], OPTION_INODE_CACHE, strlen(OPTION_INODE_CACHE)) == 0){
+      options->inode_cache_blocks = atoi(argv[i] + strlen(OPTION_INODE_CACHE));
+      if (options->inode_cache_blocks < 0){
+        printf("Invalid inode cache size %s\n", argv[i] + strlen(OPTION_INODE_CACHE));
+        return -1;
+      }
+    }else if (strcmp(argv[i], OPTION_NO_PREFETCH) == 0){
+      options->inode_prefetch = 0;
+    }else if (strcmp(argv[i], OPTION_INDEX) == 0){
+      options->use_index = 1;
+    }else if (strncmp(argv[i], OPTION_THREADS, strlen(OPTION_THREADS)) == 0){
+      options->threads = atoi(argv[i] + strlen(OPTION_THREADS));
+      if (options->threads < 0){
+        printf("Invalid number of threads %s\n", argv[i] + strlen(OPTION_THREADS));
+        return -1;
+      }
+      if (options->threads == 0){
+        options->threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+      }
+    }else if (strcmp(argv[i], OPTION_BITMAPS) == 0){
+      options->check_bitmaps = 1;
+    }else if (strncmp(argv[i], OPTION_QUEUE_DEPTH, strlen(OPTION_QUEUE_DEPTH)) == 0){
+      options->queue_depth = atoi(argv[i] + strlen(OPTION_QUEUE_DEPTH));
+      if (options->queue_depth < 0 || options->queue_depth > ASYNC_READ_MAX_DEPTH){
+        printf("Invalid queue depth %s\n", argv[i] + strlen(OPTION_QUEUE_DEPTH));
+        return -1;
+      }
+    }else if (strcmp(argv[i], OPTION_NO_URING) == 0){
+      options->use_uring = 0;
+    }else if (strcmp(argv[i], OPTION_TSV) == 0){
+      options->list_format = LIST_OUTPUT_TSV;
+    }else if (strcmp(argv[i], OPTION_STATS) == 0){
+      options->stats_format = OP_STATS_FORMAT_TEXT;
+    }else if (strcmp(argv[i], OPTION_STATS_JSON) == 0){
+      options->stats_format = OP_STATS_FORMAT_JSON;
+    }else if (strncmp(argv[i], "--", 2) == 0){
+      printf("Unknown option %s\n", argv[i]);
+      return -1;
+    }else{
+      argv[remaining++] = argv[i];
+    }
+  }
+  argv[remaining] = NULL;
+  return remaining;
+}
@@ -0,0 +1,407 @@
+/***********************************************
+*
+* @Purpose: Vectorized kernels used to scan the metadata of the volumes, with a portable version of every one
+*           of them. The AVX2 and POPCNT versions are compiled with the target attribute, so the rest of the
+*           program does not need any -m flag, and they are only called when the CPU supports them
+* @Author: Óscar Cubeles Ollé
+* @Creation Date: October 2026
+*
+************************************************/
+#include <string.h>
+#include <pthread.h>
+
+#include "Simd.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+    #define SIMD_X86 1
+#endif
+
+typedef unsigned long long (*SimdCountBytes)(const unsigned char *data, size_t size);
+typedef void (*SimdCountFat16)(const unsigned short *fat, unsigned int first, unsigned int count, unsigned int last_cluster, SimdFatCounts *counts);
+typedef unsigned int (*SimdFilterInodes)(const unsigned char *table, unsigned int count, unsigned int inode_size, const SimdInodeFilter *filter,
+		unsigned char *matches);
+
+const char *SIMD_LEVEL_NAMES[] = {SIMD_LEVELS};
+
+static pthread_once_t Simd_once = PTHREAD_ONCE_INIT;
+static int Simd_level = SIMD_LEVEL_PORTABLE;
+static SimdCountBytes Simd_countBytes;
+static SimdCountFat16 Simd_countFat16Entries;
+static SimdFilterInodes Simd_filterInodeTable;
+
+
+/***********************************************
+*
+* @Purpose: Counts the bits set in a range of bytes, 8 bytes at a time with the SWAR method
+* @Parameters: const unsigned char *data, bytes to be counted
+*              size_t size, number of bytes
+* @Return: number of bits set
+*
+************************************************/
+static unsigned long long Simd_countBytesPortable(const unsigned char *data, size_t size){
+	unsigned long long total = 0, word;
+	size_t i = 0;
+
+	for (; i + sizeof(word) <= size; i += sizeof(word)){
+		memcpy(&word, data + i, sizeof(word));
+		word = word - ((word >> 1) & 0x5555555555555555ULL);
+		word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+		word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+		total += (word * 0x0101010101010101ULL) >> 56;
+	}
+	for (; i < size; i++){
+		total += __builtin_popcount(data[i]);
+	}
+	return total;
+}
+
+
+/***********************************************
+*
+* @Purpose: Classifies the entries of a range of clusters of a FAT16, one entry at a time
+* @Parameters: const unsigned short *fat, FAT loaded in memory
+*              unsigned int first, first cluster of the range
+*              unsigned int count, number of clusters of the range
+*              unsigned int last_cluster, last cluster of the volume, greater entries are not links
+*              SimdFatCounts *counts, counts incremented with the entries of the range
+* @Return: -
+*
+************************************************/
+static void Simd_countFat16Portable(const unsigned short *fat, unsigned int first, unsigned int count, unsigned int last_cluster,
+		SimdFatCounts *counts){
+	unsigned int cluster, next;
+
+	for (cluster = first; cluster < first + count; cluster++){
+		next = fat[cluster];
+		if (next == SIMD_FAT16_FREE){
+			counts->free++;
+		} else if (next == SIMD_FAT16_BAD){
+			counts->bad++;
+		} else if (next >= SIMD_FAT16_END){
+			counts->ends++;
+		} else if (next >= 2 && next <= last_cluster){
+			counts->links++;
+			counts->breaks += next != cluster + 1;
+		}
+	}
+}
+
+
+/***********************************************
+*
+* @Purpose: Checks the inodes of a piece of an inode table against a filter, one inode at a time. The conditions
+*           are combined without branches, so the compiler can vectorize the loop
+* @Parameters: const unsigned char *table, inodes, one after the other
+*              unsigned int count, number of inodes
+*              unsigned int inode_size, size of every inode, at least SIMD_INODE_MIN_SIZE
+*              const SimdInodeFilter *filter, conditions checked
+*              unsigned char *matches, set to 1 for the inodes that match and to 0 for the rest
+* @Return: number of inodes that match
+*
+************************************************/
+static unsigned int Simd_filterInodesPortable(const unsigned char *table, unsigned int count, unsigned int inode_size,
+		const SimdInodeFilter *filter, unsigned char *matches){
+	const unsigned char *inode;
+	unsigned short mode, links;
+	unsigned int size_low, size_high, mtime, total = 0;
+	unsigned long long size;
+
+	for (unsigned int i = 0; i < count; i++){
+		inode = table + (size_t) i * inode_size;
+		memcpy(&mode, inode + SIMD_INODE_MODE_OFFSET, sizeof(mode));
+		memcpy(&size_low, inode + SIMD_INODE_SIZE_OFFSET, sizeof(size_low));
+		memcpy(&mtime, inode + SIMD_INODE_MTIME_OFFSET, sizeof(mtime));
+		memcpy(&links, inode + SIMD_INODE_LINKS_OFFSET, sizeof(links));
+		memcpy(&size_high, inode + SIMD_INODE_SIZE_HIGH_OFFSET, sizeof(size_high));
+		size = size_low | ((unsigned long long) size_high << 32) * ((mode & SIMD_INODE_TYPE_MASK) == SIMD_INODE_REGULAR);
+		matches[i] = (size >= filter->min_size) & (size <= filter->max_size) & (mtime >= filter->min_mtime) & (mtime <= filter->max_mtime) &
+				(links >= filter->min_links) & (links <= filter->max_links) & ((mode & filter->mode_mask) == filter->mode_value);
+		total += matches[i];
+	}
+	return total;
+}
+
+
+#ifdef SIMD_X86
+/***********************************************
+*
+* @Purpose: Counts the bits set in a range of bytes, 8 bytes at a time with the POPCNT instruction
+* @Parameters: const unsigned char *data, bytes to be counted
+*              size_t size, number of bytes
+* @Return: number of bits set
+*
+************************************************/
+__attribute__((target("popcnt")))
+static unsigned long long Simd_countBytesPopcnt(const unsigned char *data, size_t size){
+	unsigned long long total = 0, word;
+	size_t i = 0;
+
+	for (; i + sizeof(word) <= size; i += sizeof(word)){
+		memcpy(&word, data + i, sizeof(word));
+		total += __builtin_popcountll(word);
+	}
+	for (; i < size; i++){
+		total += __builtin_popcount(data[i]);
+	}
+	return total;
+}
+
+
+/***********************************************
+*
+* @Purpose: Counts the bits set in a range of bytes, 32 bytes at a time with AVX2. The count of every nibble
+*           is looked up in a table with a shuffle, and the counts of the bytes are added with a sum of
+*           absolute differences into 4 64-bit totals
+* @Parameters: const unsigned char *data, bytes to be counted
+*              size_t size, number of bytes
+* @Return: number of bits set
+*
+************************************************/
+__attribute__((target("avx2,popcnt")))
+static unsigned long long Simd_countBytesAvx2(const unsigned char *data, size_t size){
+	const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+			0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+	const __m256i low_mask = _mm256_set1_epi8(0x0F);
+	__m256i totals = _mm256_setzero_si256();
+	__m256i bytes, counts;
+	unsigned long long lanes[4];
+	size_t i = 0;
+
+	for (; i + SIMD_AVX2_WIDTH <= size; i += SIMD_AVX2_WIDTH){
+		bytes = _mm256_loadu_si256((const __m256i *) (data + i));
+		counts = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, _mm256_and_si256(bytes, low_mask)),
+				_mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), low_mask)));
+		totals = _mm256_add_epi64(totals, _mm256_sad_epu8(counts, _mm256_setzero_si256()));
+	}
+	_mm256_storeu_si256((__m256i *) lanes, totals);
+	return lanes[0] + lanes[1] + lanes[2] + lanes[3] + Simd_countBytesPopcnt(data + i, size - i);
+}
+
+
+/***********************************************
+*
+* @Purpose: Classifies the entries of a range of clusters of a FAT16, 16 entries at a time with AVX2. The entries
+*           are compared as unsigned numbers through the minimum and the maximum, every comparison gives a mask
+*           of 2 bits per entry, and a link breaks the chain when it differs from the cluster number plus one
+* @Parameters: const unsigned short *fat, FAT loaded in memory
+*              unsigned int first, first cluster of the range
+*              unsigned int count, number of clusters of the range
+*              unsigned int last_cluster, last cluster of the volume, greater entries are not links
+*              SimdFatCounts *counts, counts incremented with the entries of the range
+* @Return: -
+*
+************************************************/
+__attribute__((target("avx2,popcnt")))
+static void Simd_countFat16Avx2(const unsigned short *fat, unsigned int first, unsigned int count, unsigned int last_cluster,
+		SimdFatCounts *counts){
+	const unsigned int width = SIMD_AVX2_WIDTH / sizeof(unsigned short);
+	const __m256i free_value = _mm256_set1_epi16((short) SIMD_FAT16_FREE);
+	const __m256i bad_value = _mm256_set1_epi16((short) SIMD_FAT16_BAD);
+	const __m256i end_value = _mm256_set1_epi16((short) SIMD_FAT16_END);
+	const __m256i first_link = _mm256_set1_epi16(2);
+	const __m256i last_link = _mm256_set1_epi16((short) last_cluster);
+	const __m256i step = _mm256_set1_epi16((short) width);
+	__m256i next_cluster = _mm256_add_epi16(_mm256_set1_epi16((short) (first + 1)),
+			_mm256_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+	__m256i entries, links;
+	unsigned int i = 0;
+
+	for (; i + width <= count; i += width){
+		entries = _mm256_loadu_si256((const __m256i *) (fat + first + i));
+		links = _mm256_and_si256(_mm256_cmpeq_epi16(_mm256_max_epu16(entries, first_link), entries),
+				_mm256_cmpeq_epi16(_mm256_min_epu16(entries, last_link), entries));
+		// Every entry sets 2 bits of the byte masks
+		counts->free += __builtin_popcount(_mm256_movemask_epi8(_mm256_cmpeq_epi16(entries, free_value))) / 2;
+		counts->bad += __builtin_popcount(_mm256_movemask_epi8(_mm256_cmpeq_epi16(entries, bad_value))) / 2;
+		counts->ends += __builtin_popcount(_mm256_movemask_epi8(_mm256_cmpeq_epi16(_mm256_max_epu16(entries, end_value), entries))) / 2;
+		counts->links += __builtin_popcount(_mm256_movemask_epi8(links)) / 2;
+		counts->breaks += __builtin_popcount(_mm256_movemask_epi8(_mm256_andnot_si256(_mm256_cmpeq_epi16(entries, next_cluster), links))) / 2;
+		next_cluster = _mm256_add_epi16(next_cluster, step);
+	}
+	Simd_countFat16Portable(fat, first + i, count - i, last_cluster, counts);
+}
+
+
+/***********************************************
+*
+* @Purpose: Checks the inodes of a piece of an inode table against a filter, 8 inodes at a time with AVX2. Every
+*           field of the 8 inodes is loaded with a gather, the unsigned comparisons are done through the minimum
+*           and the maximum, and the sizes are compared as pairs of 32-bit halves
+* @Parameters: const unsigned char *table, inodes, one after the other
+*              unsigned int count, number of inodes
+*              unsigned int inode_size, size of every inode, at least SIMD_INODE_MIN_SIZE
+*              const SimdInodeFilter *filter, conditions checked
+*              unsigned char *matches, set to 1 for the inodes that match and to 0 for the rest
+* @Return: number of inodes that match
+*
+************************************************/
+__attribute__((target("avx2,popcnt")))
+static unsigned int Simd_filterInodesAvx2(const unsigned char *table, unsigned int count, unsigned int inode_size,
+		const SimdInodeFilter *filter, unsigned char *matches){
+	const unsigned int width = SIMD_AVX2_WIDTH / sizeof(int);
+	const __m256i offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32((int) inode_size));
+	const __m256i low_half = _mm256_set1_epi32(0xFFFF);
+	const __m256i min_size_low = _mm256_set1_epi32((int) (unsigned int) filter->min_size);
+	const __m256i min_size_high = _mm256_set1_epi32((int) (unsigned int) (filter->min_size >> 32));
+	const __m256i max_size_low = _mm256_set1_epi32((int) (unsigned int) filter->max_size);
+	const __m256i max_size_high = _mm256_set1_epi32((int) (unsigned int) (filter->max_size >> 32));
+	const __m256i min_mtime = _mm256_set1_epi32((int) filter->min_mtime);
+	const __m256i max_mtime = _mm256_set1_epi32((int) filter->max_mtime);
+	const __m256i min_links = _mm256_set1_epi32((int) filter->min_links);
+	const __m256i max_links = _mm256_set1_epi32((int) filter->max_links);
+	const __m256i mode_mask = _mm256_set1_epi32((int) filter->mode_mask);
+	const __m256i mode_value = _mm256_set1_epi32((int) filter->mode_value);
+	const __m256i type_mask = _mm256_set1_epi32(SIMD_INODE_TYPE_MASK);
+	const __m256i regular = _mm256_set1_epi32(SIMD_INODE_REGULAR);
+	__m256i mode, size_low, size_high, mtime, links, equal, result;
+	const unsigned char *inode;
+	unsigned int i = 0, bits, total = 0;
+
+	for (; i + width <= count; i += width){
+		inode = table + (size_t) i * inode_size;
+		mode = _mm256_and_si256(_mm256_i32gather_epi32((const int *) (inode + SIMD_INODE_MODE_OFFSET), offsets, 1), low_half);
+		size_low = _mm256_i32gather_epi32((const int *) (inode + SIMD_INODE_SIZE_OFFSET), offsets, 1);
+		size_high = _mm256_i32gather_epi32((const int *) (inode + SIMD_INODE_SIZE_HIGH_OFFSET), offsets, 1);
+		mtime = _mm256_i32gather_epi32((const int *) (inode + SIMD_INODE_MTIME_OFFSET), offsets, 1);
+		links = _mm256_and_si256(_mm256_i32gather_epi32((const int *) (inode + SIMD_INODE_LINKS_OFFSET), offsets, 1), low_half);
+		// Only the regular files have the upper half of the size
+		size_high = _mm256_and_si256(size_high, _mm256_cmpeq_epi32(_mm256_and_si256(mode, type_mask), regular));
+
+		// size >= min_size: greater upper half, or the same upper half and a lower half not smaller
+		equal = _mm256_cmpeq_epi32(size_high, min_size_high);
+		result = _mm256_or_si256(_mm256_andnot_si256(equal, _mm256_cmpeq_epi32(_mm256_max_epu32(size_high, min_size_high), size_high)),
+				_mm256_and_si256(equal, _mm256_cmpeq_epi32(_mm256_max_epu32(size_low, min_size_low), size_low)));
+		// size <= max_size
+		equal = _mm256_cmpeq_epi32(size_high, max_size_high);
+		result = _mm256_and_si256(result, _mm256_or_si256(
+				_mm256_andnot_si256(equal, _mm256_cmpeq_epi32(_mm256_min_epu32(size_high, max_size_high), size_high)),
+				_mm256_and_si256(equal, _mm256_cmpeq_epi32(_mm256_min_epu32(size_low, max_size_low), size_low))));
+		result = _mm256_and_si256(result, _mm256_cmpeq_epi32(_mm256_max_epu32(mtime, min_mtime), mtime));
+		result = _mm256_and_si256(result, _mm256_cmpeq_epi32(_mm256_min_epu32(mtime, max_mtime), mtime));
+		result = _mm256_and_si256(result, _mm256_cmpeq_epi32(_mm256_max_epu32(links, min_links), links));
+		result = _mm256_and_si256(result, _mm256_cmpeq_epi32(_mm256_min_epu32(links, max_links), links));
+		result = _mm256_and_si256(result, _mm256_cmpeq_epi32(_mm256_and_si256(mode, mode_mask), mode_value));
+
+		bits = (unsigned int) _mm256_movemask_ps(_mm256_castsi256_ps(result));
+		for (unsigned int j = 0; j < width; j++){
+			matches[i + j] = (bits >> j) & 1;
+		}
+		total += __builtin_popcount(bits);
+	}
+	return total + Simd_filterInodesPortable(table + (size_t) i * inode_size, count - i, inode_size, filter, matches + i);
+}
+
+#endif
+
+
+/***********************************************
+*
+* @Purpose: Chooses the version of the kernels from the instructions the CPU supports
+* @Parameters: -
+* @Return: -
+*
+************************************************/
+static void Simd_init(void){
+	Simd_countBytes = Simd_countBytesPortable;
+	Simd_countFat16Entries = Simd_countFat16Portable;
+	Simd_filterInodeTable = Simd_filterInodesPortable;
+#ifdef SIMD_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("popcnt")){
+		Simd_level = SIMD_LEVEL_POPCNT;
+		Simd_countBytes = Simd_countBytesPopcnt;
+	}
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")){
+		Simd_level = SIMD_LEVEL_AVX2;
+		Simd_countBytes = Simd_countBytesAvx2;
+		Simd_countFat16Entries = Simd_countFat16Avx2;
+		Simd_filterInodeTable = Simd_filterInodesAvx2;
+	}
+#endif
+}
+
+
+/***********************************************
+*
+* @Purpose: Gives the instruction set used by the kernels
+* @Parameters: -
+* @Return: SIMD_LEVEL_PORTABLE, SIMD_LEVEL_POPCNT or SIMD_LEVEL_AVX2
+*
+************************************************/
+int Simd_getLevel(void){
+	pthread_once(&Simd_once, Simd_init);
+	return Simd_level;
+}
+
+
+/***********************************************
+*
+* @Purpose: Gives the name of the instruction set used by the kernels
+* @Parameters: -
+* @Return: name of the instruction set
+*
+************************************************/
+const char *Simd_getLevelName(void){
+	return SIMD_LEVEL_NAMES[Simd_getLevel()];
+}
+
+
+/***********************************************
+*
+* @Purpose: Counts the bits set among the first bits of a bitmap, taking the bits of every byte from the least
+*           significant one as the Ext2 bitmaps do
+* @Parameters: const void *data, bitmap
+*              size_t bits, number of bits counted
+* @Return: number of bits set
+*
+************************************************/
+unsigned long long Simd_countBits(const void *data, size_t bits){
+	const unsigned char *bytes = (const unsigned char *) data;
+	unsigned long long total;
+
+	pthread_once(&Simd_once, Simd_init);
+	total = Simd_countBytes(bytes, bits / 8);
+	if (bits % 8 != 0){
+		total += __builtin_popcount(bytes[bits / 8] & ((1U << (bits % 8)) - 1));
+	}
+	return total;
+}
+
+
+/***********************************************
+*
+* @Purpose: Classifies the entries of a range of clusters of a FAT16 loaded in memory: free, bad, end of chain
+*           and links to another cluster, counting the links that do not go to the next cluster of the volume
+* @Parameters: const unsigned short *fat, FAT loaded in memory
+*              unsigned int first, first cluster of the range
+*              unsigned int count, number of clusters of the range
+*              unsigned int last_cluster, last cluster of the volume, greater entries are not links
+*              SimdFatCounts *counts, filled with the counts of the range
+* @Return: -
+*
+************************************************/
+void Simd_countFat16(const unsigned short *fat, unsigned int first, unsigned int count, unsigned int last_cluster, SimdFatCounts *counts){
+	pthread_once(&Simd_once, Simd_init);
+	memset(counts, 0, sizeof(SimdFatCounts));
+	Simd_countFat16Entries(fat, first, count, last_cluster, counts);
+}
+
+
+/***********************************************
+*
+* @Purpose: Checks the inodes of a piece of an Ext2 inode table against a filter on their size, modification time,
+*           number of links and mode, without looking at whether they are in use
+* @Parameters: const unsigned char *table, inodes, one after the other
+*              unsigned int count, number of inodes
+*              unsigned int inode_size, size of every inode, at least SIMD_INODE_MIN_SIZE
+*              const SimdInodeFilter *filter, conditions checked
+*              unsigned char *matches, set to 1 for the inodes that match and to 0 for the rest
+* @Return: number of inodes that match
+*
+************************************************/
+unsigned int Simd_filterInodes(const unsigned char *table, unsigned int count, unsigned int inode_size, const SimdInodeFilter *filter,
+		unsigned char *matches){
+	pthread_once(&Simd_once, Simd_init);
+	return Simd_filterInodeTable(table, count, inode_size, filter, matches);
+}
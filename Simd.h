@@ -0,0 +1,65 @@
+/***********************************************
+*
+* @Purpose: Vectorized kernels used to scan the metadata of the volumes. The version of every kernel is chosen
+*           once at run time from the instructions the CPU supports, so the program keeps running on any x86-64
+*           CPU (and any other architecture through the portable versions)
+* @Author: Óscar Cubeles Ollé
+* @Creation Date: October 2026
+*
+************************************************/
+#ifndef SIMD_H
+    #define SIMD_H
+
+    #include <sys/types.h>
+
+    // Instruction sets the kernels can use, from the slowest to the fastest
+    #define SIMD_LEVEL_PORTABLE 0
+    #define SIMD_LEVEL_POPCNT 1
+    #define SIMD_LEVEL_AVX2 2
+    #define SIMD_LEVELS "portable", "popcnt", "avx2"
+    // Bytes processed by an iteration of the AVX2 kernels
+    #define SIMD_AVX2_WIDTH 32
+    // Values of the FAT16 entries that do not point to another cluster
+    #define SIMD_FAT16_FREE 0x0000
+    #define SIMD_FAT16_BAD 0xFFF7
+    #define SIMD_FAT16_END 0xFFF8
+    // Fields of an Ext2 inode read by the inode filter, as offsets in the inode
+    #define SIMD_INODE_MODE_OFFSET 0
+    #define SIMD_INODE_SIZE_OFFSET 4
+    #define SIMD_INODE_MTIME_OFFSET 16
+    #define SIMD_INODE_LINKS_OFFSET 26
+    #define SIMD_INODE_SIZE_HIGH_OFFSET 108
+    // Smallest inode holding all the fields read
+    #define SIMD_INODE_MIN_SIZE 128
+    // Type bits of i_mode, i_dir_acl only holds the upper 32 bits of the size of regular files
+    #define SIMD_INODE_TYPE_MASK 0xF000
+    #define SIMD_INODE_REGULAR 0x8000
+
+    typedef struct SimdFatCounts{
+      unsigned long long free;                // Entries of free clusters
+      unsigned long long bad;                 // Entries of bad clusters
+      unsigned long long ends;                // Entries ending a chain, one for every chain
+      unsigned long long links;               // Entries pointing to another cluster of the volume
+      unsigned long long breaks;              // Links to a cluster that is not the next one of the volume
+    } SimdFatCounts;
+
+    // An inode matches when all the conditions hold, the bounds are inclusive
+    typedef struct SimdInodeFilter{
+      unsigned long long min_size;            // Smallest size in bytes
+      unsigned long long max_size;            // Largest size in bytes
+      unsigned int min_mtime;                 // Earliest modification, in seconds since 1970
+      unsigned int max_mtime;                 // Latest modification, in seconds since 1970
+      unsigned int min_links;                 // Fewest hard links
+      unsigned int max_links;                 // Most hard links
+      unsigned int mode_mask;                 // Bits of i_mode compared, 0 to accept any mode
+      unsigned int mode_value;                // Value the bits of i_mode in mode_mask must have
+    } SimdInodeFilter;
+
+
+    int Simd_getLevel(void);
+    const char *Simd_getLevelName(void);
+    unsigned long long Simd_countBits(const void *data, size_t bits);
+    void Simd_countFat16(const unsigned short *fat, unsigned int first, unsigned int count, unsigned int last_cluster, SimdFatCounts *counts);
+    unsigned int Simd_filterInodes(const unsigned char *table, unsigned int count, unsigned int inode_size, const SimdInodeFilter *filter,
+        unsigned char *matches);
+#endif
@@ -0,0 +1,429 @@
+/***********************************************
+*
+* @Purpose: Set of file names looked for by /find and /delete. Plain names are kept in a hash table, the
+*           patterns in a list of their own
+* @Author: Óscar Cubeles Ollé
+* @Creation Date: October 2026
+*
+************************************************/
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "TargetSet.h"
+
+// FNV-1a parameters
+#define TARGET_SET_FNV_OFFSET 2166136261u
+#define TARGET_SET_FNV_PRIME 16777619u
+
+
+/***********************************************
+*
+* @Purpose: Creates an empty set of targets
+* @Parameters: -
+* @Return: the set, NULL if there is not enough memory
+*
+************************************************/
+TargetSet *TargetSet_create(){
+	TargetSet *set = (TargetSet *) calloc(1, sizeof(TargetSet));
+	if (set == NULL) return NULL;
+	set->capacity = TARGET_SET_INITIAL_TARGETS;
+	set->bucket_count = TARGET_SET_INITIAL_TARGETS * 2;
+	set->targets = (Target *) malloc(set->capacity * sizeof(Target));
+	set->buckets = (int *) malloc(set->bucket_count * sizeof(int));
+	if (set->targets == NULL || set->buckets == NULL){
+		TargetSet_destroy(set);
+		return NULL;
+	}
+	memset(set->buckets, 0xFF, set->bucket_count * sizeof(int));
+	set->patterns = TARGET_SET_NONE;
+	return set;
+}
+
+
+/***********************************************
+*
+* @Purpose: Frees a set of targets
+* @Parameters: TargetSet *set, set to be freed
+* @Return: -
+*
+************************************************/
+void TargetSet_destroy(TargetSet *set){
+	if (set == NULL) return;
+	for (int i = 0; i < set->count; i++){
+		free(set->targets[i].name);
+		free(set->targets[i].upper_name);
+		NamePattern_destroy(set->targets[i].pattern);
+		NamePattern_destroy(set->targets[i].upper_pattern);
+	}
+	free(set->targets);
+	free(set->buckets);
+	free(set);
+}
+
+
+/***********************************************
+*
+* @Purpose: Computes the hash of a name (FNV-1a), ignoring the case so that the 8.3 names share the bucket
+*           of the names looked up
+* @Parameters: const char *name, name to be hashed, it does not need to end with '\0'
+*              size_t name_len, length of the name
+* @Return: the hash of the name
+*
+************************************************/
+unsigned int TargetSet_hash(const char *name, size_t name_len){
+	unsigned int hash = TARGET_SET_FNV_OFFSET;
+	unsigned char character;
+
+	for (size_t i = 0; i < name_len; i++){
+		character = (unsigned char) name[i];
+		if (character >= 'a' && character <= 'z'){
+			character = character - 'a' + 'A';
+		}
+		hash = (hash ^ character) * TARGET_SET_FNV_PRIME;
+	}
+	return hash;
+}
+
+
+/***********************************************
+*
+* @Purpose: Doubles the number of buckets and places the targets again
+* @Parameters: TargetSet *set, set to be grown
+* @Return: 0 on success, -1 if there is not enough memory
+*
+************************************************/
+static int TargetSet_rehash(TargetSet *set){
+	int bucket_count = set->bucket_count * 2;
+	int *buckets = (int *) malloc(bucket_count * sizeof(int));
+	int bucket;
+
+	if (buckets == NULL) return -1;
+	memset(buckets, 0xFF, bucket_count * sizeof(int));
+	// Inserting from the last target keeps the lists in the order the targets were added
+	for (int i = set->count - 1; i >= 0; i--){
+		if (set->targets[i].is_pattern) continue;
+		bucket = set->targets[i].hash & (bucket_count - 1);
+		set->targets[i].next = buckets[bucket];
+		buckets[bucket] = i;
+	}
+	free(set->buckets);
+	set->buckets = buckets;
+	set->bucket_count = bucket_count;
+	return 0;
+}
+
+
+/***********************************************
+*
+* @Purpose: Compiles the pattern of a target and appends it to the list of patterns. Patterns already in the set
+*           are ignored
+* @Parameters: TargetSet *set, set
+*              Target *target, target being added, with its name set
+* @Return: 1 if it has been added, 0 if it was already in the set, -1 if there is not enough memory,
+*          TARGET_SET_INVALID_PATTERN if it cannot be compiled
+*
+************************************************/
+static int TargetSet_addPattern(TargetSet *set, Target *target){
+	int last = TARGET_SET_NONE;
+
+	for (int i = set->patterns; i != TARGET_SET_NONE; i = set->targets[i].next){
+		if (strcmp(set->targets[i].name, target->name) == 0) return 0;
+		last = i;
+	}
+	target->pattern = NamePattern_compile(target->name, 0);
+	target->upper_pattern = NamePattern_compile(target->name, NAME_PATTERN_CASELESS);
+	if (target->pattern == NULL || target->upper_pattern == NULL){
+		NamePattern_destroy(target->pattern);
+		NamePattern_destroy(target->upper_pattern);
+		return TARGET_SET_INVALID_PATTERN;
+	}
+	target->next = TARGET_SET_NONE;
+	if (last == TARGET_SET_NONE){
+		set->patterns = set->count;
+	}else{
+		set->targets[last].next = set->count;
+	}
+	set->pattern_count++;
+	return 1;
+}
+
+
+/***********************************************
+*
+* @Purpose: Adds a name to the set. Names already in the set are ignored
+* @Parameters: TargetSet *set, set
+*              const char *name, name to be added
+* @Return: 0 on success, -1 if there is not enough memory, TARGET_SET_INVALID_PATTERN if the name is a pattern
+*          that cannot be compiled
+*
+************************************************/
+int TargetSet_add(TargetSet *set, const char *name){
+	size_t name_len = strlen(name);
+	Target *targets, *target;
+	int bucket, added;
+
+	if (TargetSet_findExact(set, name, name_len) != NULL) return 0;
+	if (set->count == set->capacity){
+		targets = (Target *) realloc(set->targets, set->capacity * 2 * sizeof(Target));
+		if (targets == NULL) return -1;
+		set->targets = targets;
+		set->capacity *= 2;
+	}
+	target = &set->targets[set->count];
+	target->name = strdup(name);
+	target->upper_name = strdup(name);
+	if (target->name == NULL || target->upper_name == NULL){
+		free(target->name);
+		free(target->upper_name);
+		return -1;
+	}
+	for (size_t i = 0; i < name_len; i++){
+		if (target->upper_name[i] >= 'a' && target->upper_name[i] <= 'z'){
+			target->upper_name[i] = target->upper_name[i] - 'a' + 'A';
+		}
+	}
+	target->name_len = name_len;
+	target->hash = TargetSet_hash(name, name_len);
+	target->found = 0;
+	target->is_path = name[0] == TARGET_SET_PATH_SEPARATOR;
+	target->is_pattern = !target->is_path && NamePattern_isPattern(name);
+	target->pattern = NULL;
+	target->upper_pattern = NULL;
+	if (target->is_pattern){
+		added = TargetSet_addPattern(set, target);
+		if (added <= 0){
+			free(target->name);
+			free(target->upper_name);
+			return added;
+		}
+		set->count++;
+		return 0;
+	}
+	set->path_count += target->is_path;
+	bucket = target->hash & (set->bucket_count - 1);
+	// Appending at the end of the bucket list keeps the order the targets were added
+	target->next = TARGET_SET_NONE;
+	if (set->buckets[bucket] == TARGET_SET_NONE){
+		set->buckets[bucket] = set->count;
+	}else{
+		int last = set->buckets[bucket];
+		while (set->targets[last].next != TARGET_SET_NONE) last = set->targets[last].next;
+		set->targets[last].next = set->count;
+	}
+	set->count++;
+	// Keeping at least two buckets per target
+	if (set->count * 2 > set->bucket_count){
+		return TargetSet_rehash(set);
+	}
+	return 0;
+}
+
+
+/***********************************************
+*
+* @Purpose: Adds the names of a file, one per line. Empty lines are ignored
+* @Parameters: TargetSet *set, set
+*              FILE *file, file with the names
+* @Return: 0 on success, -1 if there is not enough memory
+*
+************************************************/
+int TargetSet_addFromFile(TargetSet *set, FILE *file){
+	char *line = NULL;
+	size_t line_size = 0;
+	ssize_t length;
+	int error = 0;
+
+	while (error == 0 && (length = getline(&line, &line_size, file)) >= 0){
+		// Removing the end of line, also the Windows one
+		while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')){
+			line[--length] = '\0';
+		}
+		if (length > 0){
+			error = TargetSet_add(set, line);
+		}
+	}
+	free(line);
+	return error;
+}
+
+
+/***********************************************
+*
+* @Purpose: Adds the names given by a command line argument: a name, "@<file>" for a file with a name per
+*           line or "-" for the names of the standard input
+* @Parameters: TargetSet *set, set
+*              const char *argument, argument of the command line
+* @Return: 0 on success, -1 if the file cannot be opened or there is not enough memory
+*
+************************************************/
+int TargetSet_addArgument(TargetSet *set, const char *argument){
+	FILE *file;
+	int error;
+
+	if (strcmp(argument, TARGET_SET_STDIN) == 0){
+		return TargetSet_addFromFile(set, stdin);
+	}
+	if (argument[0] == TARGET_SET_LIST_PREFIX){
+		file = fopen(argument + 1, "r");
+		if (file == NULL) return -1;
+		error = TargetSet_addFromFile(set, file);
+		fclose(file);
+		return error;
+	}
+	return TargetSet_add(set, argument);
+}
+
+
+/***********************************************
+*
+* @Purpose: Finds the target with exactly a name
+* @Parameters: TargetSet *set, set
+*              const char *name, name looked for, it does not need to end with '\0'
+*              size_t name_len, length of the name
+* @Return: the target, NULL if the name is not in the set
+*
+************************************************/
+Target *TargetSet_findExact(TargetSet *set, const char *name, size_t name_len){
+	unsigned int hash = TargetSet_hash(name, name_len);
+	Target *target;
+
+	for (int i = set->buckets[hash & (set->bucket_count - 1)]; i != TARGET_SET_NONE; i = target->next){
+		target = &set->targets[i];
+		if (target->hash == hash && target->name_len == name_len && memcmp(target->name, name, name_len) == 0){
+			return target;
+		}
+	}
+	return NULL;
+}
+
+
+/***********************************************
+*
+* @Purpose: Finds the targets with a name ignoring the case, in the order they were added
+* @Parameters: TargetSet *set, set
+*              const char *name, name looked for, it does not need to end with '\0'
+*              size_t name_len, length of the name
+*              Target *previous, target returned by the previous call, NULL to get the first one
+* @Return: the next target, NULL if there are no more
+*
+************************************************/
+Target *TargetSet_findCaseless(TargetSet *set, const char *name, size_t name_len, Target *previous){
+	unsigned int hash = TargetSet_hash(name, name_len);
+	Target *target;
+	int i = previous == NULL ? set->buckets[hash & (set->bucket_count - 1)] : previous->next;
+
+	for (; i != TARGET_SET_NONE; i = target->next){
+		target = &set->targets[i];
+		if (target->hash == hash && target->name_len == name_len && strncasecmp(target->name, name, name_len) == 0){
+			return target;
+		}
+	}
+	return NULL;
+}
+
+
+/***********************************************
+*
+* @Purpose: Finds the patterns a name matches, in the order they were added
+* @Parameters: TargetSet *set, set
+*              const char *name, name of the file, it does not need to end with '\0'
+*              size_t name_len, length of the name
+*              int caseless, 1 to ignore the case (FAT16 8.3 names)
+*              Target *previous, target returned by the previous call, NULL to get the first one
+* @Return: the next target, NULL if there are no more
+*
+************************************************/
+Target *TargetSet_findPattern(TargetSet *set, const char *name, size_t name_len, int caseless, Target *previous){
+	Target *target;
+	int i = previous == NULL ? set->patterns : previous->next;
+
+	for (; i != TARGET_SET_NONE; i = target->next){
+		target = &set->targets[i];
+		if (NamePattern_match(caseless ? target->upper_pattern : target->pattern, name, name_len)){
+			return target;
+		}
+	}
+	return NULL;
+}
+
+
+/***********************************************
+*
+* @Purpose: Finds the target of a file name: the name itself, or the first pattern it matches. A file is only
+*           taken once even if several targets match it
+* @Parameters: TargetSet *set, set
+*              const char *name, name of the file, it does not need to end with '\0'
+*              size_t name_len, length of the name
+* @Return: the target, NULL if no target matches the name
+*
+************************************************/
+Target *TargetSet_match(TargetSet *set, const char *name, size_t name_len){
+	Target *target = TargetSet_findExact(set, name, name_len);
+
+	if (target == NULL && set->patterns != TARGET_SET_NONE){
+		target = TargetSet_findPattern(set, name, name_len, 0, NULL);
+	}
+	return target;
+}
+
+
+/***********************************************
+*
+* @Purpose: Counts a file found for a target
+* @Parameters: TargetSet *set, set
+*              Target *target, target found
+* @Return: -
+*
+************************************************/
+void TargetSet_setFound(TargetSet *set, Target *target){
+	if (target->found == 0){
+		set->found_count++;
+	}
+	target->found++;
+}
+
+
+/***********************************************
+*
+* @Purpose: Checks whether all the targets have been found. A pattern can always match more files, so a set with
+*           patterns is never complete
+* @Parameters: TargetSet *set, set
+* @Return: 1 if all of them have at least a file found, 0 otherwise
+*
+************************************************/
+int TargetSet_isComplete(TargetSet *set){
+	return set->pattern_count == 0 && set->found_count == set->count;
+}
+
+
+/***********************************************
+*
+* @Purpose: Checks whether some target is a bare name, which can only be found by walking the volume
+* @Parameters: TargetSet *set, set
+* @Return: 1 if some target is not an absolute path, 0 otherwise
+*
+************************************************/
+int TargetSet_hasNames(TargetSet *set){
+	return set->count > set->path_count;
+}
+
+
+/***********************************************
+*
+* @Purpose: Finds the next component of a path, skipping the separators before it
+* @Parameters: const char *path, rest of the path, starting after the previous component
+*              size_t *length, filled with the length of the component
+* @Return: the first character of the component, NULL if there are no more components
+*
+************************************************/
+const char *TargetSet_nextComponent(const char *path, size_t *length){
+	const char *end;
+
+	while (*path == TARGET_SET_PATH_SEPARATOR) path++;
+	if (*path == '\0') return NULL;
+	end = strchr(path, TARGET_SET_PATH_SEPARATOR);
+	*length = end == NULL ? strlen(path) : (size_t) (end - path);
+	return path;
+}
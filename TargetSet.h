@@ -0,0 +1,69 @@
+/***********************************************
+*
+* @Purpose: Set of file names looked for by /find and /delete, so that all of them are resolved with a
+*           single walk of the volume. Every name keeps the number of files found with it
+* @Author: Óscar Cubeles Ollé
+* @Creation Date: October 2026
+*
+************************************************/
+#ifndef TARGETSET_H
+    #define TARGETSET_H
+
+    #include <stdio.h>
+    #include <sys/types.h>
+
+    #include "NamePattern.h"
+
+    // Value used to mark the end of the bucket lists
+    #define TARGET_SET_NONE -1
+    // Number of targets allocated at first
+    #define TARGET_SET_INITIAL_TARGETS 16
+    // Prefix of the arguments that are files with a name per line, and argument to read the names from stdin
+    #define TARGET_SET_LIST_PREFIX '@'
+    #define TARGET_SET_STDIN "-"
+    // Separator of the components of the absolute paths, the names starting with it are paths
+    #define TARGET_SET_PATH_SEPARATOR '/'
+    // Value returned by TargetSet_add for a pattern that cannot be compiled
+    #define TARGET_SET_INVALID_PATTERN -2
+
+    typedef struct Target{
+      char *name;                             // Name looked for
+      char *upper_name;                       // Name in uppercase, compared with the FAT16 8.3 names
+      size_t name_len;                        // Length of the name
+      unsigned int hash;                      // Hash of the name, ignoring the case
+      int found;                              // Number of files found with the name
+      int is_path;                            // 1 if the name is an absolute path, resolved without walking the volume
+      int is_pattern;                         // 1 if the name is a glob or a regular expression, matched with pattern
+      NamePattern *pattern;                   // Compiled pattern, NULL for a plain name
+      NamePattern *upper_pattern;             // Compiled pattern ignoring the case, matched with the FAT16 8.3 names
+      int next;                               // Next target of the bucket, or of the patterns, TARGET_SET_NONE at the end
+    } Target;
+
+    typedef struct TargetSet{
+      Target *targets;                        // Targets, in the order they were added
+      int count;                              // Number of targets
+      int capacity;                           // Number of targets allocated
+      int *buckets;                           // First target of every bucket
+      int bucket_count;                       // Number of buckets (power of 2)
+      int found_count;                        // Number of targets with at least a file found
+      int path_count;                         // Number of targets that are absolute paths
+      int patterns;                           // First pattern, TARGET_SET_NONE if none. The patterns are not in the buckets
+      int pattern_count;                      // Number of targets that are patterns
+    } TargetSet;
+
+
+    TargetSet *TargetSet_create();
+    void TargetSet_destroy(TargetSet *set);
+    int TargetSet_add(TargetSet *set, const char *name);
+    int TargetSet_addFromFile(TargetSet *set, FILE *file);
+    int TargetSet_addArgument(TargetSet *set, const char *argument);
+    unsigned int TargetSet_hash(const char *name, size_t name_len);
+    Target *TargetSet_findExact(TargetSet *set, const char *name, size_t name_len);
+    Target *TargetSet_findCaseless(TargetSet *set, const char *name, size_t name_len, Target *previous);
+    Target *TargetSet_findPattern(TargetSet *set, const char *name, size_t name_len, int caseless, Target *previous);
+    Target *TargetSet_match(TargetSet *set, const char *name, size_t name_len);
+    void TargetSet_setFound(TargetSet *set, Target *target);
+    int TargetSet_isComplete(TargetSet *set);
+    int TargetSet_hasNames(TargetSet *set);
+    const char *TargetSet_nextComponent(const char *path, size_t *length);
+#endif
@@ -0,0 +1,1043 @@
+/***********************************************
+*
+* @Purpose: Shared block I/O layer used by the FAT16 and Ext2 modules to access the volume file.
+*           Reads are done with pread() on block aligned units and kept in an LRU block cache,
+*           or directly through a memory mapping of the whole volume when the mapped mode is enabled
+* @Author: Óscar Cubeles Ollé
+* @Creation Date: October 2026
+*
+************************************************/
+#define _GNU_SOURCE
+#include <limits.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include "VolumeIO.h"
+
+typedef struct VolumeIOPrefetch{
+  VolumeIO *volume;                       // Volume whose cache is filled
+  unsigned long long write_calls;         // Writes done on the volume when the units were chosen
+} VolumeIOPrefetch;
+
+
+/***********************************************
+*
+* @Purpose: Computes the hash bucket of a unit number
+* @Parameters: VolumeIO *volume, volume whose hash table is used
+*              off_t number, unit number
+* @Return: index of the bucket
+*
+************************************************/
+static int VolumeIO_bucket(VolumeIO *volume, off_t number){
+	unsigned long long key = (unsigned long long) number * 0x9E3779B97F4A7C15ULL;
+	return (int)(key >> 32) & (volume->hash_size - 1);
+}
+
+
+/***********************************************
+*
+* @Purpose: Looks for the slot holding a unit
+* @Parameters: VolumeIO *volume, volume whose cache is checked
+*              off_t number, unit number
+* @Return: index of the slot, VOLUME_IO_NONE if the unit is not cached
+*
+************************************************/
+static int VolumeIO_lookup(VolumeIO *volume, off_t number){
+	int slot = volume->hash_table[VolumeIO_bucket(volume, number)];
+	while (slot != VOLUME_IO_NONE && volume->blocks[slot].number != number){
+		slot = volume->blocks[slot].hash_next;
+	}
+	return slot;
+}
+
+
+/***********************************************
+*
+* @Purpose: Unlinks a slot from the LRU list
+* @Parameters: VolumeIO *volume, volume whose cache is modified
+*              int slot, slot to be unlinked
+* @Return: -
+*
+************************************************/
+static void VolumeIO_unlinkLRU(VolumeIO *volume, int slot){
+	VolumeIOBlock *block = &volume->blocks[slot];
+	if (block->prev != VOLUME_IO_NONE){
+		volume->blocks[block->prev].next = block->next;
+	}else{
+		volume->lru_head = block->next;
+	}
+	if (block->next != VOLUME_IO_NONE){
+		volume->blocks[block->next].prev = block->prev;
+	}else{
+		volume->lru_tail = block->prev;
+	}
+}
+
+
+/***********************************************
+*
+* @Purpose: Moves a slot to the head of the LRU list, making it the most recently used one
+* @Parameters: VolumeIO *volume, volume whose cache is modified
+*              int slot, slot to be moved
+*              int is_linked, 1 if the slot is already in the list
+* @Return: -
+*
+************************************************/
+static void VolumeIO_touch(VolumeIO *volume, int slot, int is_linked){
+	if (is_linked){
+		if (volume->lru_head == slot) return;
+		VolumeIO_unlinkLRU(volume, slot);
+	}
+	volume->blocks[slot].prev = VOLUME_IO_NONE;
+	volume->blocks[slot].next = volume->lru_head;
+	if (volume->lru_head != VOLUME_IO_NONE){
+		volume->blocks[volume->lru_head].prev = slot;
+	}
+	volume->lru_head = slot;
+	if (volume->lru_tail == VOLUME_IO_NONE){
+		volume->lru_tail = slot;
+	}
+}
+
+
+/***********************************************
+*
+* @Purpose: Removes a slot from its hash bucket
+* @Parameters: VolumeIO *volume, volume whose cache is modified
+*              int slot, slot to be removed
+* @Return: -
+*
+************************************************/
+static void VolumeIO_unlinkHash(VolumeIO *volume, int slot){
+	int *link = &volume->hash_table[VolumeIO_bucket(volume, volume->blocks[slot].number)];
+	while (*link != slot){
+		link = &volume->blocks[*link].hash_next;
+	}
+	*link = volume->blocks[slot].hash_next;
+}
+
+
+/***********************************************
+*
+* @Purpose: Writes a unit written in a batch to the volume file. The caller holds the lock of the volume
+* @Parameters: VolumeIO *volume, volume whose cache is written
+*              int slot, slot of the unit
+* @Return: 0 on success, -1 if the unit could not be written
+*
+************************************************/
+static int VolumeIO_writeBack(VolumeIO *volume, int slot){
+	VolumeIOBlock *block = &volume->blocks[slot];
+	ssize_t written = pwrite(volume->fd, block->data, block->valid, block->number * VOLUME_IO_BLOCK_SIZE);
+
+	volume->counters.write_calls++;
+	volume->counters.bytes_written += written > 0 ? written : 0;
+	block->dirty = 0;
+	volume->dirty_count--;
+	return written == block->valid ? 0 : -1;
+}
+
+
+/***********************************************
+*
+* @Purpose: Gets a slot for a new unit, evicting the least recently used one when the cache is full.
+*           The slot is inserted in the hash table and at the head of the LRU list
+* @Parameters: VolumeIO *volume, volume whose cache is used
+*              off_t number, unit number that the slot will hold
+* @Return: index of the slot
+*
+************************************************/
+static int VolumeIO_allocate(VolumeIO *volume, off_t number){
+	int slot, bucket;
+	if (volume->used_blocks < volume->cache_blocks){
+		slot = volume->used_blocks++;
+	}else{
+		slot = volume->lru_tail;
+		// A unit written in a batch cannot be dropped before it reaches the volume file
+		if (volume->blocks[slot].dirty){
+			VolumeIO_writeBack(volume, slot);
+		}
+		VolumeIO_unlinkLRU(volume, slot);
+		VolumeIO_unlinkHash(volume, slot);
+	}
+	volume->blocks[slot].number = number;
+	volume->blocks[slot].valid = 0;
+	volume->blocks[slot].dirty = 0;
+	bucket = VolumeIO_bucket(volume, number);
+	volume->blocks[slot].hash_next = volume->hash_table[bucket];
+	volume->hash_table[bucket] = slot;
+	VolumeIO_touch(volume, slot, 0);
+	return slot;
+}
+
+
+/***********************************************
+*
+* @Purpose: Drops a slot whose unit could not be read, so that it is reused first
+* @Parameters: VolumeIO *volume, volume whose cache is modified
+*              int slot, slot to be dropped
+* @Return: -
+*
+************************************************/
+static void VolumeIO_discard(VolumeIO *volume, int slot){
+	VolumeIO_unlinkHash(volume, slot);
+	VolumeIO_unlinkLRU(volume, slot);
+	volume->blocks[slot].number = VOLUME_IO_NONE;
+	volume->blocks[slot].hash_next = VOLUME_IO_NONE;
+	// Placing it at the tail of the LRU list
+	volume->blocks[slot].next = VOLUME_IO_NONE;
+	volume->blocks[slot].prev = volume->lru_tail;
+	if (volume->lru_tail != VOLUME_IO_NONE){
+		volume->blocks[volume->lru_tail].next = slot;
+	}else{
+		volume->lru_head = slot;
+	}
+	volume->lru_tail = slot;
+	// A discarded slot must not be found by the hash table, so it is inserted in a bucket on its own
+	volume->blocks[slot].hash_next = volume->hash_table[VolumeIO_bucket(volume, VOLUME_IO_NONE)];
+	volume->hash_table[VolumeIO_bucket(volume, VOLUME_IO_NONE)] = slot;
+}
+
+
+/***********************************************
+*
+* @Purpose: Creates the block I/O handle of a volume file
+* @Parameters: int fd, file descriptor of the volume file
+*              int cache_blocks, number of VOLUME_IO_BLOCK_SIZE units kept in the cache (0 disables the cache)
+* @Return: pointer to the new handle, NULL if there is not enough memory
+*
+************************************************/
+VolumeIO *VolumeIO_open(int fd, int cache_blocks){
+	VolumeIO *volume = (VolumeIO *) calloc(1, sizeof(VolumeIO));
+	if (volume == NULL) return NULL;
+
+	volume->fd = fd;
+	volume->cache_blocks = cache_blocks < 0 ? 0 : cache_blocks;
+	volume->lru_head = VOLUME_IO_NONE;
+	volume->lru_tail = VOLUME_IO_NONE;
+	pthread_mutex_init(&volume->lock, NULL);
+	if (volume->cache_blocks == 0) return volume;
+
+	// Twice as many buckets as slots, rounded to a power of 2
+	volume->hash_size = 1;
+	while (volume->hash_size < volume->cache_blocks * 2){
+		volume->hash_size <<= 1;
+	}
+	volume->hash_table = (int *) malloc(sizeof(int) * volume->hash_size);
+	volume->blocks = (VolumeIOBlock *) calloc(volume->cache_blocks, sizeof(VolumeIOBlock));
+	volume->pool = (char *) malloc((size_t) volume->cache_blocks * VOLUME_IO_BLOCK_SIZE);
+	if (volume->hash_table == NULL || volume->blocks == NULL || volume->pool == NULL){
+		VolumeIO_close(volume);
+		return NULL;
+	}
+	for (int i = 0; i < volume->hash_size; i++){
+		volume->hash_table[i] = VOLUME_IO_NONE;
+	}
+	for (int i = 0; i < volume->cache_blocks; i++){
+		volume->blocks[i].data = volume->pool + (size_t) i * VOLUME_IO_BLOCK_SIZE;
+	}
+	return volume;
+}
+
+
+/***********************************************
+*
+* @Purpose: Frees the block I/O handle. The file descriptor is not closed
+* @Parameters: VolumeIO *volume, handle to be freed
+* @Return: -
+*
+************************************************/
+void VolumeIO_close(VolumeIO *volume){
+	if (volume == NULL) return;
+	// Writing the units of a batch that has not been flushed
+	if (volume->batching){
+		VolumeIO_flush(volume);
+	}
+	if (volume->map != NULL){
+		VolumeIO_sync(volume);
+		munmap(volume->map, volume->map_size);
+	}
+	AsyncRead_destroy(volume->async);
+	free(volume->hash_table);
+	free(volume->blocks);
+	free(volume->pool);
+	pthread_mutex_destroy(&volume->lock);
+	free(volume);
+}
+
+
+/***********************************************
+*
+* @Purpose: Reads a run of consecutive units that are not cached with a single preadv()
+* @Parameters: VolumeIO *volume, volume to be read
+*              off_t first, number of the first unit of the run
+*              int count, number of units of the run
+*              int slots[], filled with the slots holding the units read
+* @Return: 0 on success, -1 if the volume could not be read
+*
+************************************************/
+static int VolumeIO_fetchRun(VolumeIO *volume, off_t first, int count, int slots[]){
+	struct iovec iov[VOLUME_IO_MAX_RUN];
+	ssize_t bytes;
+
+	for (int i = 0; i < count; i++){
+		slots[i] = VolumeIO_allocate(volume, first + i);
+		iov[i].iov_base = volume->blocks[slots[i]].data;
+		iov[i].iov_len = VOLUME_IO_BLOCK_SIZE;
+	}
+	bytes = preadv(volume->fd, iov, count, first * VOLUME_IO_BLOCK_SIZE);
+	volume->counters.read_calls++;
+	if (bytes < 0){
+		for (int i = 0; i < count; i++){
+			VolumeIO_discard(volume, slots[i]);
+		}
+		return -1;
+	}
+	volume->misses += count;
+	volume->counters.bytes_read += bytes;
+	// The last units may be beyond the end of the volume file
+	for (int i = 0; i < count; i++){
+		ssize_t valid = bytes - (ssize_t) i * VOLUME_IO_BLOCK_SIZE;
+		if (valid < 0) valid = 0;
+		if (valid > VOLUME_IO_BLOCK_SIZE) valid = VOLUME_IO_BLOCK_SIZE;
+		volume->blocks[slots[i]].valid = (int) valid;
+		memset(volume->blocks[slots[i]].data + valid, 0, VOLUME_IO_BLOCK_SIZE - valid);
+	}
+	return 0;
+}
+
+
+/***********************************************
+*
+* @Purpose: Reads bytes from the volume through the block cache. The caller holds the lock of the volume
+* @Parameters: VolumeIO *volume, volume to be read
+*              off_t offset, position of the first byte to be read
+*              void *buffer, destination of the bytes
+*              size_t size, number of bytes to be read
+* @Return: number of bytes read (less than size at the end of the volume), -1 on error
+*
+************************************************/
+static ssize_t VolumeIO_readCached(VolumeIO *volume, off_t offset, void *buffer, size_t size){
+	char *destination = (char *) buffer;
+	size_t done = 0;
+	int slots[VOLUME_IO_MAX_RUN];
+
+	while (done < size){
+		off_t number = (offset + done) / VOLUME_IO_BLOCK_SIZE;
+		int slot = VolumeIO_lookup(volume, number);
+		int count = 1;
+
+		if (slot != VOLUME_IO_NONE){
+			volume->hits++;
+			VolumeIO_touch(volume, slot, 1);
+			slots[0] = slot;
+		}else{
+			// Grouping the following units that are not cached either into the same preadv()
+			off_t last = (offset + size - 1) / VOLUME_IO_BLOCK_SIZE;
+			int max_run = volume->cache_blocks < VOLUME_IO_MAX_RUN ? volume->cache_blocks : VOLUME_IO_MAX_RUN;
+			while (number + count <= last && count < max_run && VolumeIO_lookup(volume, number + count) == VOLUME_IO_NONE){
+				count++;
+			}
+			if (VolumeIO_fetchRun(volume, number, count, slots) < 0){
+				return done > 0 ? (ssize_t) done : -1;
+			}
+		}
+
+		for (int i = 0; i < count && done < size; i++){
+			VolumeIOBlock *block = &volume->blocks[slots[i]];
+			size_t start = (offset + done) % VOLUME_IO_BLOCK_SIZE;
+			size_t length = VOLUME_IO_BLOCK_SIZE - start;
+			if (length > size - done) length = size - done;
+			if (start >= (size_t) block->valid) return done;
+			if (start + length > (size_t) block->valid) length = block->valid - start;
+			memcpy(destination + done, block->data + start, length);
+			done += length;
+			if (block->valid < VOLUME_IO_BLOCK_SIZE && done < size) return done;
+		}
+	}
+	return done;
+}
+
+
+/***********************************************
+*
+* @Purpose: Reads bytes from the volume, going through the block cache. It can be called from several threads:
+*           the mapped mode copies from the mapping without locking, while the cache is used by a thread at a time
+* @Parameters: VolumeIO *volume, volume to be read
+*              off_t offset, position of the first byte to be read
+*              void *buffer, destination of the bytes
+*              size_t size, number of bytes to be read
+* @Return: number of bytes read (less than size at the end of the volume), -1 on error
+*
+************************************************/
+ssize_t VolumeIO_read(VolumeIO *volume, off_t offset, void *buffer, size_t size){
+	ssize_t bytes;
+
+	if (volume->map != NULL){
+		if (offset >= volume->map_size) return 0;
+		if ((off_t) size > volume->map_size - offset) size = volume->map_size - offset;
+		memcpy(buffer, volume->map + offset, size);
+		return size;
+	}
+	if (volume->cache_blocks == 0){
+		bytes = pread(volume->fd, buffer, size, offset);
+		pthread_mutex_lock(&volume->lock);
+		volume->misses++;
+		volume->counters.read_calls++;
+		volume->counters.bytes_read += bytes > 0 ? bytes : 0;
+		pthread_mutex_unlock(&volume->lock);
+		return bytes;
+	}
+
+	pthread_mutex_lock(&volume->lock);
+	bytes = VolumeIO_readCached(volume, offset, buffer, size);
+	pthread_mutex_unlock(&volume->lock);
+	return bytes;
+}
+
+
+/***********************************************
+*
+* @Purpose: Compares the positions of two cached units, to sort them with qsort()
+* @Parameters: const void *a, pointer to the first VolumeIOBlock pointer
+*              const void *b, pointer to the second VolumeIOBlock pointer
+* @Return: negative, 0 or positive if the first unit is before, at or after the second one
+*
+************************************************/
+static int VolumeIO_compareBlocks(const void *a, const void *b){
+	off_t first = (*(VolumeIOBlock * const *) a)->number;
+	off_t second = (*(VolumeIOBlock * const *) b)->number;
+	return (first > second) - (first < second);
+}
+
+
+/***********************************************
+*
+* @Purpose: Writes the units written in the batch to the volume file, sorted by their position. Consecutive
+*           units are written with a single pwritev(). The caller holds the lock of the volume
+* @Parameters: VolumeIO *volume, volume whose cache is written
+* @Return: 0 on success, -1 if any unit could not be written
+*
+************************************************/
+static int VolumeIO_writeDirty(VolumeIO *volume){
+	struct iovec iov[VOLUME_IO_MAX_RUN];
+	VolumeIOBlock **dirty;
+	ssize_t expected, written;
+	int count = 0, run, result = 0;
+
+	if (volume->dirty_count == 0) return 0;
+	dirty = (VolumeIOBlock **) malloc(sizeof(VolumeIOBlock *) * volume->dirty_count);
+	if (dirty == NULL){
+		// Writing them one by one in the order of the slots
+		for (int i = 0; i < volume->used_blocks; i++){
+			if (volume->blocks[i].dirty && VolumeIO_writeBack(volume, i) < 0) result = -1;
+		}
+		return result;
+	}
+	for (int i = 0; i < volume->used_blocks; i++){
+		if (volume->blocks[i].dirty) dirty[count++] = &volume->blocks[i];
+	}
+	qsort(dirty, count, sizeof(VolumeIOBlock *), VolumeIO_compareBlocks);
+
+	for (int i = 0; i < count; i += run){
+		expected = 0;
+		// A unit that is not whole is the last one of the volume file, so it ends the run
+		for (run = 0; i + run < count && run < VOLUME_IO_MAX_RUN && run < IOV_MAX; run++){
+			if (run > 0 && (dirty[i + run]->number != dirty[i + run - 1]->number + 1 || dirty[i + run - 1]->valid < VOLUME_IO_BLOCK_SIZE)) break;
+			iov[run].iov_base = dirty[i + run]->data;
+			iov[run].iov_len = dirty[i + run]->valid;
+			expected += dirty[i + run]->valid;
+		}
+		written = pwritev(volume->fd, iov, run, dirty[i]->number * VOLUME_IO_BLOCK_SIZE);
+		volume->counters.write_calls++;
+		volume->counters.bytes_written += written > 0 ? written : 0;
+		if (written != expected) result = -1;
+		for (int j = i; j < i + run; j++){
+			dirty[j]->dirty = 0;
+		}
+	}
+	volume->dirty_count = 0;
+	free(dirty);
+	return result;
+}
+
+
+/***********************************************
+*
+* @Purpose: Writes bytes into the cached units during a batch, reading the units that are not cached first.
+*           The units stay in the cache until the batch is flushed. The caller holds the lock of the volume
+* @Parameters: VolumeIO *volume, volume to be written
+*              off_t offset, position of the first byte to be written
+*              const void *buffer, bytes to be written
+*              size_t size, number of bytes to be written
+* @Return: number of bytes written, -1 on error
+*
+************************************************/
+static ssize_t VolumeIO_writeCached(VolumeIO *volume, off_t offset, const void *buffer, size_t size){
+	const char *source = (const char *) buffer;
+	size_t done = 0;
+	int slot;
+
+	while (done < size){
+		off_t number = (offset + done) / VOLUME_IO_BLOCK_SIZE;
+		size_t start = (offset + done) % VOLUME_IO_BLOCK_SIZE;
+		size_t length = VOLUME_IO_BLOCK_SIZE - start;
+		if (length > size - done) length = size - done;
+
+		slot = VolumeIO_lookup(volume, number);
+		if (slot == VOLUME_IO_NONE){
+			if (VolumeIO_fetchRun(volume, number, 1, &slot) < 0) return done > 0 ? (ssize_t) done : -1;
+		}else{
+			volume->hits++;
+			VolumeIO_touch(volume, slot, 1);
+		}
+		VolumeIOBlock *block = &volume->blocks[slot];
+		memcpy(block->data + start, source + done, length);
+		if (start + length > (size_t) block->valid){
+			block->valid = (int)(start + length);
+		}
+		if (block->dirty == 0){
+			block->dirty = 1;
+			volume->dirty_count++;
+		}
+		done += length;
+	}
+	// Keeping room in the cache for the reads, so that the units of the batch are rarely written one at a time
+	if (volume->dirty_count >= volume->cache_blocks / VOLUME_IO_MAX_DIRTY_DIVISOR){
+		if (VolumeIO_writeDirty(volume) < 0) return -1;
+	}
+	return done;
+}
+
+
+/***********************************************
+*
+* @Purpose: Writes bytes to the volume (write-through) and updates the cached units that overlap them
+* @Parameters: VolumeIO *volume, volume to be written
+*              off_t offset, position of the first byte to be written
+*              const void *buffer, bytes to be written
+*              size_t size, number of bytes to be written
+* @Return: number of bytes written, -1 on error
+*
+************************************************/
+ssize_t VolumeIO_write(VolumeIO *volume, off_t offset, const void *buffer, size_t size){
+	const char *source = (const char *) buffer;
+	ssize_t written;
+
+	// In the mapped mode the bytes are written through the mapping and flushed by VolumeIO_sync()
+	if (volume->map != NULL && offset + (off_t) size <= volume->map_size){
+		memcpy(volume->map + offset, buffer, size);
+		volume->map_dirty = 1;
+		return size;
+	}
+	if (volume->cache_blocks == 0){
+		written = pwrite(volume->fd, buffer, size, offset);
+		pthread_mutex_lock(&volume->lock);
+		volume->counters.write_calls++;
+		volume->counters.bytes_written += written > 0 ? written : 0;
+		pthread_mutex_unlock(&volume->lock);
+		return written;
+	}
+	// The write and the update of the cache are done together, so that no thread caches the old bytes in between
+	pthread_mutex_lock(&volume->lock);
+	if (volume->batching){
+		written = VolumeIO_writeCached(volume, offset, buffer, size);
+		pthread_mutex_unlock(&volume->lock);
+		return written;
+	}
+	written = pwrite(volume->fd, buffer, size, offset);
+	volume->counters.write_calls++;
+	volume->counters.bytes_written += written > 0 ? written : 0;
+	if (written <= 0){
+		pthread_mutex_unlock(&volume->lock);
+		return written;
+	}
+
+	for (off_t number = offset / VOLUME_IO_BLOCK_SIZE; number * VOLUME_IO_BLOCK_SIZE < offset + written; number++){
+		int slot = VolumeIO_lookup(volume, number);
+		if (slot != VOLUME_IO_NONE){
+			off_t start = number * VOLUME_IO_BLOCK_SIZE > offset ? number * VOLUME_IO_BLOCK_SIZE : offset;
+			off_t end = (number + 1) * VOLUME_IO_BLOCK_SIZE < offset + written ? (number + 1) * VOLUME_IO_BLOCK_SIZE : offset + written;
+			VolumeIOBlock *block = &volume->blocks[slot];
+			memcpy(block->data + (start - number * VOLUME_IO_BLOCK_SIZE), source + (start - offset), end - start);
+			if (end - number * VOLUME_IO_BLOCK_SIZE > block->valid){
+				block->valid = (int)(end - number * VOLUME_IO_BLOCK_SIZE);
+			}
+		}
+	}
+	pthread_mutex_unlock(&volume->lock);
+	return written;
+}
+
+
+/***********************************************
+*
+* @Purpose: Copies a part of a range of the volume to another file through user space, from the mapping when
+*           the volume is mapped or with pread() into a buffer otherwise
+* @Parameters: VolumeIO *volume, volume copied
+*              off_t offset, position of the range
+*              size_t size, number of bytes of the range
+*              int out_fd, descriptor written at its current position
+*              char **buffer, buffer of VOLUME_IO_COPY_BUFFER_SIZE bytes, allocated on the first call
+* @Return: number of bytes copied, 0 at the end of the volume file, -1 on error
+*
+************************************************/
+static ssize_t VolumeIO_copyBuffered(VolumeIO *volume, off_t offset, size_t size, int out_fd, char **buffer){
+	const char *source;
+	ssize_t bytes, written;
+	size_t done = 0;
+
+	if (size > VOLUME_IO_COPY_BUFFER_SIZE) size = VOLUME_IO_COPY_BUFFER_SIZE;
+	if (volume->map != NULL){
+		if (offset >= volume->map_size) return 0;
+		if ((off_t) size > volume->map_size - offset) size = volume->map_size - offset;
+		source = volume->map + offset;
+		bytes = size;
+	}else{
+		if (*buffer == NULL) *buffer = (char *) malloc(VOLUME_IO_COPY_BUFFER_SIZE);
+		if (*buffer == NULL) return -1;
+		bytes = pread(volume->fd, *buffer, size, offset);
+		if (bytes <= 0) return bytes;
+		source = *buffer;
+	}
+	while (done < (size_t) bytes){
+		written = write(out_fd, source + done, bytes - done);
+		if (written < 0 && errno == EINTR) continue;
+		if (written <= 0) return -1;
+		done += written;
+	}
+	return bytes;
+}
+
+
+/***********************************************
+*
+* @Purpose: Copies a range of the volume to another file without passing the bytes through user space when the
+*           kernel can do it: copy_file_range() when the output is a regular file, sendfile() when it is a pipe or a
+*           socket, and a buffered copy as the last resort. A way that fails makes the copy go on with the next one
+* @Parameters: VolumeIO *volume, volume copied
+*              off_t offset, position of the first byte of the range
+*              size_t size, number of bytes of the range
+*              int out_fd, descriptor written at its current position
+* @Return: number of bytes copied (less than size at the end of the volume), -1 if nothing could be copied
+*
+************************************************/
+ssize_t VolumeIO_copyTo(VolumeIO *volume, off_t offset, size_t size, int out_fd){
+	int method = VOLUME_IO_COPY_RANGE;
+	char *buffer = NULL;
+	size_t copied = 0;
+	off_t position;
+	ssize_t bytes = 0;
+
+	while (copied < size){
+		position = offset + copied;
+		if (method == VOLUME_IO_COPY_RANGE){
+			bytes = copy_file_range(volume->fd, &position, out_fd, NULL, size - copied, 0);
+		}else if (method == VOLUME_IO_COPY_SENDFILE){
+			bytes = sendfile(out_fd, volume->fd, &position, size - copied);
+		}else{
+			bytes = VolumeIO_copyBuffered(volume, position, size - copied, out_fd, &buffer);
+		}
+		if (bytes < 0 && errno == EINTR) continue;
+		// Nothing has been written to the output, so the next way starts at the same position
+		if (bytes < 0 && method != VOLUME_IO_COPY_BUFFERED){
+			method++;
+			continue;
+		}
+		if (bytes <= 0) break;
+		copied += bytes;
+		pthread_mutex_lock(&volume->lock);
+		volume->counters.read_calls++;
+		volume->counters.bytes_read += bytes;
+		pthread_mutex_unlock(&volume->lock);
+	}
+	free(buffer);
+	if (copied == 0 && bytes < 0) return -1;
+	return copied;
+}
+
+
+/***********************************************
+*
+* @Purpose: Maps the whole volume file in memory, so that reads and writes are done through the mapping.
+*           If the volume cannot be mapped, the pread() path keeps being used
+* @Parameters: VolumeIO *volume, volume handle
+* @Return: 0 if the volume has been mapped, -1 otherwise
+*
+************************************************/
+int VolumeIO_map(VolumeIO *volume){
+	struct stat info;
+	void *map;
+
+	if (volume->map != NULL) return 0;
+	if (fstat(volume->fd, &info) < 0 || info.st_size <= 0) return -1;
+	map = mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, volume->fd, 0);
+	if (map == MAP_FAILED) return -1;
+	volume->map = (char *) map;
+	volume->map_size = info.st_size;
+	volume->map_dirty = 0;
+	return 0;
+}
+
+
+/***********************************************
+*
+* @Purpose: Checks whether the volume is accessed through a memory mapping
+* @Parameters: VolumeIO *volume, volume handle
+* @Return: 1 if it is mapped, 0 otherwise
+*
+************************************************/
+int VolumeIO_isMapped(VolumeIO *volume){
+	return volume->map != NULL;
+}
+
+
+/***********************************************
+*
+* @Purpose: Gives access to bytes of the volume without copying them when it is mapped.
+*           Otherwise the bytes are read into the scratch buffer. The pointer returned is read-only
+*           and the bytes must be written with VolumeIO_write()
+* @Parameters: VolumeIO *volume, volume to be read
+*              off_t offset, position of the first byte
+*              size_t size, number of bytes needed
+*              void *scratch, buffer of at least size bytes used when the volume is not mapped
+* @Return: pointer to the bytes, NULL if they could not be read
+*
+************************************************/
+const void *VolumeIO_view(VolumeIO *volume, off_t offset, size_t size, void *scratch){
+	ssize_t bytes;
+	if (volume->map != NULL && offset >= 0 && offset + (off_t) size <= volume->map_size){
+		return volume->map + offset;
+	}
+	bytes = VolumeIO_read(volume, offset, scratch, size);
+	if (bytes < 0) return NULL;
+	if ((size_t) bytes < size){
+		memset((char *) scratch + bytes, 0, size - bytes);
+	}
+	return scratch;
+}
+
+
+/***********************************************
+*
+* @Purpose: Tells the kernel how a range of the mapped volume is going to be accessed. Nothing is done
+*           when the volume is not mapped
+* @Parameters: VolumeIO *volume, volume handle
+*              off_t offset, position of the first byte of the range
+*              size_t size, number of bytes of the range, 0 to reach the end of the volume
+*              int advice, VOLUME_IO_ADVICE_NORMAL, VOLUME_IO_ADVICE_SEQUENTIAL, VOLUME_IO_ADVICE_RANDOM or
+*                          VOLUME_IO_ADVICE_WILLNEED
+* @Return: -
+*
+************************************************/
+void VolumeIO_advise(VolumeIO *volume, off_t offset, size_t size, int advice){
+	long page_size = sysconf(_SC_PAGESIZE);
+	off_t start;
+	int flag = MADV_NORMAL;
+
+	if (volume->map == NULL || offset >= volume->map_size) return;
+	if (size == 0 || offset + (off_t) size > volume->map_size) size = volume->map_size - offset;
+	if (advice == VOLUME_IO_ADVICE_SEQUENTIAL) flag = MADV_SEQUENTIAL;
+	if (advice == VOLUME_IO_ADVICE_RANDOM) flag = MADV_RANDOM;
+	if (advice == VOLUME_IO_ADVICE_WILLNEED) flag = MADV_WILLNEED;
+	// madvise() needs a page aligned address
+	start = offset - offset % page_size;
+	madvise(volume->map + start, size + (offset - start), flag);
+}
+
+
+/***********************************************
+*
+* @Purpose: Sets how many prefetch reads can be in flight at the same time. In the cache mode they are done
+*           with io_uring or with a pool of threads, in the mapped mode the kernel is asked to read the pages
+* @Parameters: VolumeIO *volume, volume handle, already mapped if the mapped mode is used
+*              int depth, maximum number of reads in flight, 0 to not prefetch
+*              int use_uring, 1 to use io_uring when the kernel allows it, 0 to always use the threads
+* @Return: 0 on success, -1 if the reader could not be created (the reads are not prefetched)
+*
+************************************************/
+int VolumeIO_setQueueDepth(VolumeIO *volume, int depth, int use_uring){
+	AsyncRead_destroy(volume->async);
+	volume->async = NULL;
+	volume->queue_depth = depth < 0 ? 0 : depth;
+	if (volume->queue_depth == 0 || volume->map != NULL || volume->cache_blocks == 0) return 0;
+
+	volume->async = AsyncRead_create(volume->fd, volume->queue_depth, use_uring);
+	if (volume->async == NULL){
+		volume->queue_depth = 0;
+		return -1;
+	}
+	return 0;
+}
+
+
+/***********************************************
+*
+* @Purpose: Tells if VolumeIO_prefetch() does something, so that the callers can skip looking for what to prefetch
+* @Parameters: VolumeIO *volume, volume handle
+* @Return: 1 if the reads are prefetched, 0 otherwise
+*
+************************************************/
+int VolumeIO_canPrefetch(VolumeIO *volume){
+	return volume->queue_depth > 0 && (volume->map != NULL || volume->async != NULL);
+}
+
+
+/***********************************************
+*
+* @Purpose: Compares two unit numbers, to sort them with qsort()
+* @Parameters: const void *a, pointer to the first number
+*              const void *b, pointer to the second number
+* @Return: negative, 0 or positive if the first unit is before, equal to or after the second one
+*
+************************************************/
+static int VolumeIO_compareNumbers(const void *a, const void *b){
+	off_t first = *(const off_t *) a;
+	off_t second = *(const off_t *) b;
+	return (first > second) - (first < second);
+}
+
+
+/***********************************************
+*
+* @Purpose: Inserts in the cache the units of a prefetch read as soon as it completes. The units cached in the
+*           meantime are kept, and nothing is inserted if the volume has been written since they were chosen
+* @Parameters: AsyncReadRequest *request, read completed, of consecutive units
+*              void *context, VolumeIOPrefetch of the batch
+* @Return: -
+*
+************************************************/
+static void VolumeIO_install(AsyncReadRequest *request, void *context){
+	VolumeIOPrefetch *prefetch = (VolumeIOPrefetch *) context;
+	VolumeIO *volume = prefetch->volume;
+	off_t first = request->offset / VOLUME_IO_BLOCK_SIZE;
+	int count = (int) (request->size / VOLUME_IO_BLOCK_SIZE);
+	ssize_t valid;
+	int slot;
+
+	pthread_mutex_lock(&volume->lock);
+	volume->counters.read_calls++;
+	volume->counters.bytes_read += request->result > 0 ? request->result : 0;
+	if (request->result <= 0 || volume->counters.write_calls != prefetch->write_calls){
+		pthread_mutex_unlock(&volume->lock);
+		return;
+	}
+	for (int i = 0; i < count; i++){
+		valid = request->result - (ssize_t) i * VOLUME_IO_BLOCK_SIZE;
+		if (valid <= 0) break;
+		if (valid > VOLUME_IO_BLOCK_SIZE) valid = VOLUME_IO_BLOCK_SIZE;
+		if (VolumeIO_lookup(volume, first + i) != VOLUME_IO_NONE) continue;
+		slot = VolumeIO_allocate(volume, first + i);
+		memcpy(volume->blocks[slot].data, (char *) request->buffer + (size_t) i * VOLUME_IO_BLOCK_SIZE, valid);
+		memset(volume->blocks[slot].data + valid, 0, VOLUME_IO_BLOCK_SIZE - valid);
+		volume->blocks[slot].valid = (int) valid;
+		volume->misses++;
+	}
+	pthread_mutex_unlock(&volume->lock);
+}
+
+
+/***********************************************
+*
+* @Purpose: Reads ahead the ranges of the volume that are going to be needed soon. In the cache mode the units
+*           that are not cached are grouped into runs of consecutive units, all of them are read with up to the
+*           queue depth in flight, and every run is inserted in the cache as it completes. In the mapped mode
+*           the kernel is asked to read the pages of the ranges. Errors are not reported, the units are read
+*           again when they are needed
+* @Parameters: VolumeIO *volume, volume handle
+*              const VolumeIORange *ranges, ranges to be read
+*              int count, number of ranges
+* @Return: 0 on success, -1 if some reads could not be done
+*
+************************************************/
+int VolumeIO_prefetch(VolumeIO *volume, const VolumeIORange *ranges, int count){
+	VolumeIOPrefetch prefetch = {volume, 0};
+	AsyncReadRequest *requests = NULL;
+	off_t *numbers, number, last;
+	char *buffer = NULL;
+	int total = 0, unique = 0, request_count = 0, limit, result = 0, run;
+
+	if (volume->map != NULL && volume->queue_depth > 0){
+		for (int i = 0; i < count; i++){
+			if (ranges[i].size > 0) VolumeIO_advise(volume, ranges[i].offset, ranges[i].size, VOLUME_IO_ADVICE_WILLNEED);
+		}
+		return 0;
+	}
+	if (volume->async == NULL || count <= 0) return 0;
+	limit = volume->cache_blocks / VOLUME_IO_PREFETCH_DIVISOR;
+	if (limit == 0) return 0;
+	numbers = (off_t *) malloc(sizeof(off_t) * limit);
+	if (numbers == NULL) return -1;
+
+	// Choosing the units that are not cached
+	pthread_mutex_lock(&volume->lock);
+	for (int i = 0; i < count && total < limit; i++){
+		if (ranges[i].size == 0 || ranges[i].offset < 0) continue;
+		last = (ranges[i].offset + ranges[i].size - 1) / VOLUME_IO_BLOCK_SIZE;
+		for (number = ranges[i].offset / VOLUME_IO_BLOCK_SIZE; number <= last && total < limit; number++){
+			if (VolumeIO_lookup(volume, number) == VOLUME_IO_NONE) numbers[total++] = number;
+		}
+	}
+	prefetch.write_calls = volume->counters.write_calls;
+	pthread_mutex_unlock(&volume->lock);
+	if (total == 0){
+		free(numbers);
+		return 0;
+	}
+
+	// Removing the repeated units, and grouping the consecutive ones into the same read
+	qsort(numbers, total, sizeof(off_t), VolumeIO_compareNumbers);
+	for (int i = 0; i < total; i++){
+		if (unique == 0 || numbers[i] != numbers[unique - 1]) numbers[unique++] = numbers[i];
+	}
+	requests = (AsyncReadRequest *) malloc(sizeof(AsyncReadRequest) * unique);
+	buffer = (char *) malloc((size_t) unique * VOLUME_IO_BLOCK_SIZE);
+	if (requests == NULL || buffer == NULL){
+		free(numbers);
+		free(requests);
+		free(buffer);
+		return -1;
+	}
+	for (int i = 0; i < unique; i += run){
+		run = 1;
+		while (i + run < unique && run < VOLUME_IO_MAX_RUN && numbers[i + run] == numbers[i] + run){
+			run++;
+		}
+		requests[request_count].offset = numbers[i] * VOLUME_IO_BLOCK_SIZE;
+		requests[request_count].size = (size_t) run * VOLUME_IO_BLOCK_SIZE;
+		requests[request_count].buffer = buffer + (size_t) i * VOLUME_IO_BLOCK_SIZE;
+		request_count++;
+	}
+
+	result = AsyncRead_run(volume->async, requests, request_count, VolumeIO_install, &prefetch);
+	free(numbers);
+	free(requests);
+	free(buffer);
+	return result;
+}
+
+
+/***********************************************
+*
+* @Purpose: Flushes to the volume file the writes done through the mapping
+* @Parameters: VolumeIO *volume, volume handle
+* @Return: 0 on success, -1 on error
+*
+************************************************/
+int VolumeIO_sync(VolumeIO *volume){
+	if (volume->map == NULL || volume->map_dirty == 0) return 0;
+	volume->map_dirty = 0;
+	volume->counters.sync_calls++;
+	return msync(volume->map, volume->map_size, MS_SYNC);
+}
+
+
+/***********************************************
+*
+* @Purpose: Starts a batch of writes. Until VolumeIO_flush() the writes are kept in the block cache, where the
+*           reads find them, instead of being written right away. Nothing changes when the volume is mapped,
+*           its writes are already flushed together, or when there is no cache
+* @Parameters: VolumeIO *volume, volume handle
+* @Return: -
+*
+************************************************/
+void VolumeIO_beginBatch(VolumeIO *volume){
+	if (volume->map != NULL || volume->cache_blocks == 0) return;
+	pthread_mutex_lock(&volume->lock);
+	volume->batching = 1;
+	pthread_mutex_unlock(&volume->lock);
+}
+
+
+/***********************************************
+*
+* @Purpose: Ends a batch of writes, writing the units of the batch sorted by their position, and flushes the
+*           writes to the disk with a single fdatasync(). The writes through the mapping are flushed with msync()
+* @Parameters: VolumeIO *volume, volume handle
+* @Return: 0 on success, -1 on error
+*
+************************************************/
+int VolumeIO_flush(VolumeIO *volume){
+	int result;
+
+	if (volume->map != NULL) return VolumeIO_sync(volume);
+	pthread_mutex_lock(&volume->lock);
+	if (volume->batching == 0){
+		pthread_mutex_unlock(&volume->lock);
+		return 0;
+	}
+	result = VolumeIO_writeDirty(volume);
+	volume->batching = 0;
+	volume->counters.sync_calls++;
+	pthread_mutex_unlock(&volume->lock);
+	if (fdatasync(volume->fd) < 0) result = -1;
+	return result;
+}
+
+
+/***********************************************
+*
+* @Purpose: Returns the number of units served from the cache
+* @Parameters: VolumeIO *volume, volume handle
+* @Return: number of cache hits
+*
+************************************************/
+unsigned long long VolumeIO_getHits(VolumeIO *volume){
+	return volume->hits;
+}
+
+
+/***********************************************
+*
+* @Purpose: Returns the number of units that had to be read from the volume file
+* @Parameters: VolumeIO *volume, volume handle
+* @Return: number of cache misses
+*
+************************************************/
+unsigned long long VolumeIO_getMisses(VolumeIO *volume){
+	return volume->misses;
+}
+
+
+/***********************************************
+*
+* @Purpose: Copies the counters of the system calls done on the volume file
+* @Parameters: VolumeIO *volume, volume handle
+*              VolumeIOCounters *counters, filled with the counters
+* @Return: -
+*
+************************************************/
+void VolumeIO_getCounters(VolumeIO *volume, VolumeIOCounters *counters){
+	pthread_mutex_lock(&volume->lock);
+	*counters = volume->counters;
+	pthread_mutex_unlock(&volume->lock);
+}
+
+
+/***********************************************
+*
+* @Purpose: Prints in screen the hit and miss counters of the block cache
+* @Parameters: VolumeIO *volume, volume handle
+* @Return: -
+*
+************************************************/
+void VolumeIO_printStats(VolumeIO *volume){
+	unsigned long long total = volume->hits + volume->misses;
+	if (volume->map != NULL){
+		printf("\nMapped volume: %lld bytes, the block cache is not used\n", (long long) volume->map_size);
+		return;
+	}
+	printf("\nBlock cache: %d blocks of %d bytes\n", volume->cache_blocks, VOLUME_IO_BLOCK_SIZE);
+	printf("Hits: %llu\nMisses: %llu\n", volume->hits, volume->misses);
+	printf("Hit ratio: %.2f%%\n", total == 0 ? 0.0 : 100.0 * volume->hits / total);
+	if (volume->async != NULL){
+		printf("Prefetch: %s, up to %d reads in flight\n", AsyncRead_getModeName(volume->async), volume->async->depth);
+	}
+}
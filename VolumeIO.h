@@ -0,0 +1,109 @@
+/***********************************************
+*
+* @Purpose: Shared block I/O layer used by the FAT16 and Ext2 modules to access the volume file.
+*           Reads are done with pread() on block aligned units and kept in an LRU block cache,
+*           or directly through a memory mapping of the whole volume when the mapped mode is enabled
+* @Author: Óscar Cubeles Ollé
+* @Creation Date: October 2026
+*
+************************************************/
+#ifndef VOLUMEIO_H
+    #define VOLUMEIO_H
+
+    #include <sys/types.h>
+    #include <pthread.h>
+
+    #include "AsyncRead.h"
+
+    // Size of one cached unit, multiple of the FAT16 sector size and of the usual Ext2 block sizes
+    #define VOLUME_IO_BLOCK_SIZE 4096
+    // Number of cached units used when no size is specified
+    #define VOLUME_IO_DEFAULT_CACHE_BLOCKS 256
+    // Maximum number of consecutive missing units fetched with a single preadv()
+    #define VOLUME_IO_MAX_RUN 32
+    // Part of the cache that can hold units written in a batch, the batch is written out when it is reached
+    #define VOLUME_IO_MAX_DIRTY_DIVISOR 2
+    // Part of the cache that can be filled by a single VolumeIO_prefetch(), the rest keeps the units being used
+    #define VOLUME_IO_PREFETCH_DIVISOR 2
+    // Ways of copying a range of the volume to another file, from the cheapest one. The buffered copy does not
+    // go through the block cache, so that a big file does not evict the metadata
+    #define VOLUME_IO_COPY_RANGE 0
+    #define VOLUME_IO_COPY_SENDFILE 1
+    #define VOLUME_IO_COPY_BUFFERED 2
+    #define VOLUME_IO_COPY_BUFFER_SIZE (VOLUME_IO_BLOCK_SIZE * VOLUME_IO_MAX_RUN)
+    // Value used to mark the end of the LRU and hash lists
+    #define VOLUME_IO_NONE -1
+
+    // Access pattern hints for the mapped mode
+    #define VOLUME_IO_ADVICE_NORMAL 0
+    #define VOLUME_IO_ADVICE_SEQUENTIAL 1
+    #define VOLUME_IO_ADVICE_RANDOM 2
+    #define VOLUME_IO_ADVICE_WILLNEED 3
+
+    typedef struct VolumeIOBlock{
+      off_t number;                           // Index of the unit in the volume (offset / VOLUME_IO_BLOCK_SIZE)
+      int valid;                              // Number of bytes of the unit that exist in the volume file
+      int dirty;                              // 1 if the unit has been written in a batch and not written to the volume file yet
+      int prev;                               // Previous slot in the LRU list (more recently used)
+      int next;                               // Next slot in the LRU list (less recently used)
+      int hash_next;                          // Next slot in the same hash bucket
+      char *data;                             // VOLUME_IO_BLOCK_SIZE bytes with the content of the unit
+    } VolumeIOBlock;
+
+    typedef struct VolumeIOCounters{
+      unsigned long long read_calls;          // pread(), preadv(), copy_file_range(), sendfile() and prefetch reads on the volume file
+      unsigned long long write_calls;         // pwrite() calls on the volume file
+      unsigned long long sync_calls;          // msync() and fdatasync() calls flushing the writes
+      unsigned long long bytes_read;          // Bytes returned by the reads and copied to other files
+      unsigned long long bytes_written;       // Bytes written by the writes
+    } VolumeIOCounters;
+
+    typedef struct VolumeIORange{
+      off_t offset;                           // Position of the first byte of the range
+      size_t size;                            // Number of bytes of the range
+    } VolumeIORange;
+
+    typedef struct VolumeIO{
+      int fd;                                 // File descriptor of the volume file
+      int cache_blocks;                       // Number of slots of the cache, 0 disables the cache
+      int used_blocks;                        // Number of slots currently holding a unit
+      int lru_head;                           // Most recently used slot
+      int lru_tail;                           // Least recently used slot, the first one to be evicted
+      int hash_size;                          // Number of buckets of the hash table (power of 2)
+      int *hash_table;                        // First slot of every bucket
+      VolumeIOBlock *blocks;                  // Cache slots
+      char *pool;                             // Memory holding the data of all the slots
+      unsigned long long hits;                // Number of units served from the cache
+      unsigned long long misses;              // Number of units read from the volume file
+      char *map;                              // Mapping of the whole volume file, NULL when the pread() path is used
+      off_t map_size;                         // Size in bytes of the mapping
+      int map_dirty;                          // 1 if the mapping has been written since the last msync()
+      int batching;                           // 1 between VolumeIO_beginBatch() and VolumeIO_flush(), the writes are kept in the cache
+      int dirty_count;                        // Number of slots written in the batch
+      VolumeIOCounters counters;              // System calls done on the volume file
+      int queue_depth;                        // Maximum number of prefetch reads in flight, 0 if the reads are not prefetched
+      AsyncRead *async;                       // Reader of the prefetches into the cache, NULL in the mapped mode
+      pthread_mutex_t lock;                   // Protects the cache and the counters when several threads read the volume
+    } VolumeIO;
+
+
+    VolumeIO *VolumeIO_open(int fd, int cache_blocks);
+    void VolumeIO_close(VolumeIO *volume);
+    ssize_t VolumeIO_read(VolumeIO *volume, off_t offset, void *buffer, size_t size);
+    ssize_t VolumeIO_write(VolumeIO *volume, off_t offset, const void *buffer, size_t size);
+    ssize_t VolumeIO_copyTo(VolumeIO *volume, off_t offset, size_t size, int out_fd);
+    int VolumeIO_map(VolumeIO *volume);
+    int VolumeIO_isMapped(VolumeIO *volume);
+    const void *VolumeIO_view(VolumeIO *volume, off_t offset, size_t size, void *scratch);
+    void VolumeIO_advise(VolumeIO *volume, off_t offset, size_t size, int advice);
+    int VolumeIO_setQueueDepth(VolumeIO *volume, int depth, int use_uring);
+    int VolumeIO_canPrefetch(VolumeIO *volume);
+    int VolumeIO_prefetch(VolumeIO *volume, const VolumeIORange *ranges, int count);
+    int VolumeIO_sync(VolumeIO *volume);
+    void VolumeIO_beginBatch(VolumeIO *volume);
+    int VolumeIO_flush(VolumeIO *volume);
+    unsigned long long VolumeIO_getHits(VolumeIO *volume);
+    unsigned long long VolumeIO_getMisses(VolumeIO *volume);
+    void VolumeIO_getCounters(VolumeIO *volume, VolumeIOCounters *counters);
+    void VolumeIO_printStats(VolumeIO *volume);
+#endif
@@ -0,0 +1,300 @@
+/***********************************************
+*
+* @Purpose: Pool of worker threads with a task queue per worker, used to walk the folders of a volume in parallel
+* @Author: Óscar Cubeles Ollé
+* @Creation Date: October 2026
+*
+************************************************/
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "WorkPool.h"
+
+typedef struct WorkPoolWorker{
+  WorkPool *pool;                         // Pool of the worker
+  int number;                             // Number of the worker, also the position of its queue
+} WorkPoolWorker;
+
+
+/***********************************************
+*
+* @Purpose: Adds a task at the end of a queue, growing it when it is full
+* @Parameters: WorkPoolQueue *queue, queue
+*              WorkPoolTask task, task to be added
+* @Return: 0 on success, -1 if there is not enough memory
+*
+************************************************/
+static int WorkPool_push(WorkPoolQueue *queue, WorkPoolTask task){
+	int error = 0;
+
+	pthread_mutex_lock(&queue->lock);
+	if (queue->count == queue->capacity){
+		WorkPoolTask *tasks = (WorkPoolTask *) malloc(queue->capacity * 2 * sizeof(WorkPoolTask));
+		if (tasks == NULL){
+			error = -1;
+		}else{
+			// Unrolling the circular buffer so that the oldest task is the first one
+			for (int i = 0; i < queue->count; i++){
+				tasks[i] = queue->tasks[(queue->first + i) % queue->capacity];
+			}
+			free(queue->tasks);
+			queue->tasks = tasks;
+			queue->first = 0;
+			queue->capacity *= 2;
+		}
+	}
+	if (error == 0){
+		queue->tasks[(queue->first + queue->count) % queue->capacity] = task;
+		queue->count++;
+	}
+	pthread_mutex_unlock(&queue->lock);
+	return error;
+}
+
+
+/***********************************************
+*
+* @Purpose: Takes a task from a queue: the newest one for its owner and the oldest one for a thief
+* @Parameters: WorkPoolQueue *queue, queue
+*              int newest, 1 to take the newest task, 0 to take the oldest one
+*              WorkPoolTask *task, filled with the task taken
+* @Return: 1 if a task has been taken, 0 if the queue is empty
+*
+************************************************/
+static int WorkPool_pop(WorkPoolQueue *queue, int newest, WorkPoolTask *task){
+	int taken = 0;
+
+	pthread_mutex_lock(&queue->lock);
+	if (queue->count > 0){
+		if (newest){
+			*task = queue->tasks[(queue->first + queue->count - 1) % queue->capacity];
+		}else{
+			*task = queue->tasks[queue->first];
+			queue->first = (queue->first + 1) % queue->capacity;
+		}
+		queue->count--;
+		taken = 1;
+	}
+	pthread_mutex_unlock(&queue->lock);
+	return taken;
+}
+
+
+/***********************************************
+*
+* @Purpose: Looks for a task for a worker, first in its own queue and then in the queues of the other workers
+* @Parameters: WorkPool *pool, pool
+*              int worker, number of the worker
+*              WorkPoolTask *task, filled with the task found
+* @Return: 1 if a task has been found, 0 if all the queues are empty
+*
+************************************************/
+static int WorkPool_take(WorkPool *pool, int worker, WorkPoolTask *task){
+	if (WorkPool_pop(&pool->queues[worker], 1, task)) return 1;
+	// Stealing from the next workers, so that the thieves do not all go to the same queue
+	for (int i = 1; i < pool->threads; i++){
+		if (WorkPool_pop(&pool->queues[(worker + i) % pool->threads], 0, task)) return 1;
+	}
+	return 0;
+}
+
+
+/***********************************************
+*
+* @Purpose: Main function of the worker threads: runs tasks until the pool is destroyed
+* @Parameters: void *argument, WorkPoolWorker of the thread
+* @Return: NULL
+*
+************************************************/
+static void *WorkPool_run(void *argument){
+	WorkPoolWorker *worker = (WorkPoolWorker *) argument;
+	WorkPool *pool = worker->pool;
+	WorkPoolTask task;
+
+	while (1){
+		if (WorkPool_take(pool, worker->number, &task)){
+			pthread_mutex_lock(&pool->lock);
+			pool->queued--;
+			pthread_mutex_unlock(&pool->lock);
+
+			task.function(task.argument, worker->number);
+
+			pthread_mutex_lock(&pool->lock);
+			pool->pending--;
+			if (pool->pending == 0){
+				pthread_cond_broadcast(&pool->work_done);
+			}
+			pthread_mutex_unlock(&pool->lock);
+			continue;
+		}
+		// Sleeping until there is something to take. The task counted may have been taken meanwhile, then the queues are checked again
+		pthread_mutex_lock(&pool->lock);
+		while (pool->queued <= 0 && pool->shutdown == 0){
+			pthread_cond_wait(&pool->work_ready, &pool->lock);
+		}
+		if (pool->shutdown && pool->queued <= 0){
+			pthread_mutex_unlock(&pool->lock);
+			break;
+		}
+		pthread_mutex_unlock(&pool->lock);
+	}
+	free(worker);
+	return NULL;
+}
+
+
+/***********************************************
+*
+* @Purpose: Creates a pool and starts its worker threads
+* @Parameters: int threads, number of worker threads (at least 1)
+* @Return: the pool, NULL if it cannot be created
+*
+************************************************/
+WorkPool *WorkPool_create(int threads){
+	WorkPool *pool = (WorkPool *) calloc(1, sizeof(WorkPool));
+	WorkPoolWorker *worker;
+
+	if (pool == NULL) return NULL;
+	if (threads < 1) threads = 1;
+	pool->workers = (pthread_t *) calloc(threads, sizeof(pthread_t));
+	pool->queues = (WorkPoolQueue *) calloc(threads, sizeof(WorkPoolQueue));
+	if (pool->workers == NULL || pool->queues == NULL){
+		free(pool->workers);
+		free(pool->queues);
+		free(pool);
+		return NULL;
+	}
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->work_ready, NULL);
+	pthread_cond_init(&pool->work_done, NULL);
+	for (int i = 0; i < threads; i++){
+		pthread_mutex_init(&pool->queues[i].lock, NULL);
+		pool->queues[i].capacity = WORK_POOL_INITIAL_TASKS;
+		pool->queues[i].tasks = (WorkPoolTask *) malloc(WORK_POOL_INITIAL_TASKS * sizeof(WorkPoolTask));
+		if (pool->queues[i].tasks == NULL){
+			pool->threads = i + 1;
+			WorkPool_destroy(pool);
+			return NULL;
+		}
+	}
+	pool->threads = threads;
+	// The workers are started once all the queues exist, since any of them can be robbed
+	for (int i = 0; i < threads; i++){
+		worker = (WorkPoolWorker *) malloc(sizeof(WorkPoolWorker));
+		if (worker == NULL){
+			WorkPool_destroy(pool);
+			return NULL;
+		}
+		worker->pool = pool;
+		worker->number = i;
+		if (pthread_create(&pool->workers[i], NULL, WorkPool_run, worker) != 0){
+			free(worker);
+			WorkPool_destroy(pool);
+			return NULL;
+		}
+		pool->started++;
+	}
+	return pool;
+}
+
+
+/***********************************************
+*
+* @Purpose: Submits a task to the pool. The tasks submitted by a worker go to its own queue
+* @Parameters: WorkPool *pool, pool
+*              int worker, number of the worker submitting the task, WORK_POOL_NO_WORKER from outside the pool
+*              WorkPoolFunction function, function to be run
+*              void *argument, argument of the function
+* @Return: 0 on success, -1 if there is not enough memory
+*
+************************************************/
+int WorkPool_submit(WorkPool *pool, int worker, WorkPoolFunction function, void *argument){
+	WorkPoolTask task;
+	int queue;
+
+	task.function = function;
+	task.argument = argument;
+	pthread_mutex_lock(&pool->lock);
+	if (worker == WORK_POOL_NO_WORKER){
+		queue = pool->next_queue;
+		pool->next_queue = (pool->next_queue + 1) % pool->threads;
+	}else{
+		queue = worker;
+	}
+	// Counting the task before it can be taken, so that WorkPool_wait() never sees it finished before being counted
+	pool->pending++;
+	pool->queued++;
+	pthread_mutex_unlock(&pool->lock);
+
+	if (WorkPool_push(&pool->queues[queue], task) < 0){
+		pthread_mutex_lock(&pool->lock);
+		pool->pending--;
+		pool->queued--;
+		if (pool->pending == 0){
+			pthread_cond_broadcast(&pool->work_done);
+		}
+		pthread_mutex_unlock(&pool->lock);
+		return -1;
+	}
+	pthread_mutex_lock(&pool->lock);
+	pthread_cond_signal(&pool->work_ready);
+	pthread_mutex_unlock(&pool->lock);
+	return 0;
+}
+
+
+/***********************************************
+*
+* @Purpose: Waits until all the tasks submitted, including the ones submitted by other tasks, have finished
+* @Parameters: WorkPool *pool, pool
+* @Return: -
+*
+************************************************/
+void WorkPool_wait(WorkPool *pool){
+	pthread_mutex_lock(&pool->lock);
+	while (pool->pending > 0){
+		pthread_cond_wait(&pool->work_done, &pool->lock);
+	}
+	pthread_mutex_unlock(&pool->lock);
+}
+
+
+/***********************************************
+*
+* @Purpose: Stops the worker threads once the queued tasks have been run, and frees the pool
+* @Parameters: WorkPool *pool, pool to be freed
+* @Return: -
+*
+************************************************/
+void WorkPool_destroy(WorkPool *pool){
+	if (pool == NULL) return;
+	pthread_mutex_lock(&pool->lock);
+	pool->shutdown = 1;
+	pthread_cond_broadcast(&pool->work_ready);
+	pthread_mutex_unlock(&pool->lock);
+	for (int i = 0; i < pool->started; i++){
+		pthread_join(pool->workers[i], NULL);
+	}
+	for (int i = 0; i < pool->threads; i++){
+		pthread_mutex_destroy(&pool->queues[i].lock);
+		free(pool->queues[i].tasks);
+	}
+	pthread_mutex_destroy(&pool->lock);
+	pthread_cond_destroy(&pool->work_ready);
+	pthread_cond_destroy(&pool->work_done);
+	free(pool->workers);
+	free(pool->queues);
+	free(pool);
+}
+
+
+/***********************************************
+*
+* @Purpose: Returns the number of worker threads of a pool
+* @Parameters: WorkPool *pool, pool
+* @Return: number of workers, which is also the number of per worker buffers the tasks need
+*
+************************************************/
+int WorkPool_getThreads(WorkPool *pool){
+	return pool->threads;
+}
@@ -0,0 +1,55 @@
+/***********************************************
+*
+* @Purpose: Pool of worker threads with a task queue per worker. A worker takes the tasks it submitted itself
+*           last in first out, and when it runs out of them it steals the oldest task of another worker
+* @Author: Óscar Cubeles Ollé
+* @Creation Date: October 2026
+*
+************************************************/
+#ifndef WORKPOOL_H
+    #define WORKPOOL_H
+
+    #include <pthread.h>
+
+    // Number of tasks allocated at first in every queue
+    #define WORK_POOL_INITIAL_TASKS 64
+    // Worker number used to submit tasks from a thread that is not a worker of the pool
+    #define WORK_POOL_NO_WORKER -1
+
+    // Function run by a task, with the argument given when it was submitted and the number of the worker running it
+    typedef void (*WorkPoolFunction)(void *argument, int worker);
+
+    typedef struct WorkPoolTask{
+      WorkPoolFunction function;              // Function to be run
+      void *argument;                         // Argument of the function
+    } WorkPoolTask;
+
+    typedef struct WorkPoolQueue{
+      pthread_mutex_t lock;                   // Protects the queue from its owner and from the thieves
+      WorkPoolTask *tasks;                    // Circular buffer of tasks
+      int first;                              // Position of the oldest task
+      int count;                              // Number of tasks in the queue
+      int capacity;                           // Number of tasks allocated
+    } WorkPoolQueue;
+
+    typedef struct WorkPool{
+      int threads;                            // Number of worker threads
+      int started;                            // Number of worker threads running
+      pthread_t *workers;                     // Worker threads
+      WorkPoolQueue *queues;                  // Queue of every worker
+      pthread_mutex_t lock;                   // Protects the counters below
+      pthread_cond_t work_ready;              // Signaled when a task is submitted or the pool is destroyed
+      pthread_cond_t work_done;               // Signaled when the last pending task finishes
+      int queued;                             // Number of tasks waiting in the queues
+      int pending;                            // Number of tasks submitted and not finished yet
+      int next_queue;                         // Queue receiving the next task submitted from outside the pool
+      int shutdown;                           // 1 when the workers have to finish
+    } WorkPool;
+
+
+    WorkPool *WorkPool_create(int threads);
+    int WorkPool_submit(WorkPool *pool, int worker, WorkPoolFunction function, void *argument);
+    void WorkPool_wait(WorkPool *pool);
+    void WorkPool_destroy(WorkPool *pool);
+    int WorkPool_getThreads(WorkPool *pool);
+#endif